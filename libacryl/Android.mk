@@ -37,6 +37,9 @@ else
 endif
 
 LOCAL_SHARED_LIBRARIES := liblog libutils libcutils libion_google android.hardware.graphics.common-V3-ndk
+ifeq ($(BOARD_LIBACRYL_G2D_EMULATOR), true)
+    LOCAL_CFLAGS += -DLIBACRYL_G2D_EMULATOR
+endif
 ifdef BOARD_LIBACRYL_G2D_HDR_PLUGIN
     LOCAL_SHARED_LIBRARIES += $(BOARD_LIBACRYL_G2D_HDR_PLUGIN)
     LOCAL_CFLAGS += -DLIBACRYL_G2D_HDR_PLUGIN
@@ -54,7 +57,7 @@ LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/include
 
 LOCAL_SRC_FILES := acrylic.cpp acrylic_g2d.cpp
 LOCAL_SRC_FILES += acrylic_factory.cpp acrylic_layer.cpp acrylic_formats.cpp
-LOCAL_SRC_FILES += acrylic_performance.cpp acrylic_device.cpp
+LOCAL_SRC_FILES += acrylic_performance.cpp acrylic_device.cpp acrylic_g2d_emulator.cpp
 
 LOCAL_MODULE_TAGS := optional
 LOCAL_MODULE := libacryl
@@ -24,8 +24,8 @@
 #include "acrylic_internal.h"
 
 Acrylic::Acrylic(const HW2DCapability &capability)
-    : mCapability(capability), mHasBackgroundColor(false),
-      mMaxTargetLuminance(100), mMinTargetLuminance(0), mTargetDisplayInfo(nullptr),
+    : mCapability(capability), mHasBackgroundColor(false), mCanvasClip{0, 0, 0, 0},
+      mHasCanvasClip(false), mMaxTargetLuminance(100), mMinTargetLuminance(0), mTargetDisplayInfo(nullptr),
       mCanvas(this, AcrylicCanvas::CANVAS_TARGET)
 {
     ALOGD_TEST("Created a new Acrylic on %p", this);
@@ -96,6 +96,47 @@ bool Acrylic::setHDRToneMapCoefficients(uint32_t __unused *matrix[2], int __unus
     return true;
 }
 
+bool Acrylic::setCanvasClip(hwc_rect_t &area)
+{
+    if ((area.left < 0) || (area.top < 0) ||
+            (area.left >= area.right) || (area.top >= area.bottom)) {
+        ALOGE("Invalid clipping area: (%d, %d) -> (%d, %d)",
+              area.left, area.top, area.right, area.bottom);
+        return false;
+    }
+
+    mCanvasClip = area;
+    mHasCanvasClip = true;
+
+    return true;
+}
+
+bool Acrylic::getCanvasClip(hw2d_rect_t &rect)
+{
+    if (!mHasCanvasClip)
+        return false;
+
+    // the dimension of the canvas may be configured after the clipping area
+    hw2d_coord_t xy = mCanvas.getImageDimension();
+    int32_t right = std::min(mCanvasClip.right, static_cast<int32_t>(xy.hori));
+    int32_t bottom = std::min(mCanvasClip.bottom, static_cast<int32_t>(xy.vert));
+
+    if ((mCanvasClip.left >= right) || (mCanvasClip.top >= bottom))
+        return false;
+
+    if ((mCanvasClip.left == 0) && (mCanvasClip.top == 0) &&
+            (right == static_cast<int32_t>(xy.hori)) &&
+            (bottom == static_cast<int32_t>(xy.vert)))
+        return false;
+
+    rect.pos.hori = mCanvasClip.left;
+    rect.pos.vert = mCanvasClip.top;
+    rect.size.hori = right - mCanvasClip.left;
+    rect.size.vert = bottom - mCanvasClip.top;
+
+    return true;
+}
+
 bool Acrylic::validateAllLayers()
 {
     const HW2DCapability &cap = getCapabilities();
@@ -120,6 +161,8 @@ bool Acrylic::validateAllLayers()
     bool prot = false;
     hw2d_rect_t rect;
     hw2d_coord_t xy = mCanvas.getImageDimension();
+    // A change of the target invalidates the scaling and the bound checks of all layers
+    bool revalidate = !(mCanvas.getSettingFlags() & AcrylicCanvas::SETTING_VALIDATED);
 
     for (auto layer: mLayers) {
         if (!layer->isSettingOkay()) {
@@ -128,6 +171,11 @@ bool Acrylic::validateAllLayers()
             return false;
         }
 
+        prot = prot || layer->isProtected();
+
+        if (!revalidate && !!(layer->getSettingFlags() & AcrylicCanvas::SETTING_VALIDATED))
+            continue;
+
         if ((layer->isCompressed() || layer->isCompressedWideblk()) &&
             !cap.isFeatureSupported(HW2DCapability::FEATURE_AFBC_DECODE)) {
             ALOGE("AFBC decoding is not supported");
@@ -171,8 +219,6 @@ bool Acrylic::validateAllLayers()
                     mLayers.size(), xy.hori, xy.vert);
             return false;
         }
-
-        prot = prot || layer->isProtected();
     }
 
     if (prot && !mCanvas.isProtected()) {
@@ -180,10 +226,18 @@ bool Acrylic::validateAllLayers()
         return false;
     }
 
+    mCanvas.set(AcrylicCanvas::SETTING_VALIDATED);
+    for (auto layer: mLayers)
+        layer->set(AcrylicCanvas::SETTING_VALIDATED);
+
     return true;
 }
 
 void Acrylic::sortLayers()
 {
-    std::sort(std::begin(mLayers), std::end(mLayers), [] (auto l1, auto l2) { return l1->getZOrder() < l2->getZOrder(); });
+    auto zorder_less = [] (auto l1, auto l2) { return l1->getZOrder() < l2->getZOrder(); };
+
+    // z-order rarely changes between frames
+    if (!std::is_sorted(std::begin(mLayers), std::end(mLayers), zorder_less))
+        std::sort(std::begin(mLayers), std::end(mLayers), zorder_less);
 }
@@ -31,6 +31,13 @@ AcrylicDevice::AcrylicDevice(const char *devpath)
 {
 }
 
+AcrylicDevice::AcrylicDevice(const char *devpath, AcrylicDeviceBackend *backend)
+    : mDevPath(devpath), mDevFD(-1), mBackend(backend)
+{
+    if (mBackend)
+        ALOGI("%s is served by an emulated backend", mDevPath.c_str());
+}
+
 AcrylicDevice::~AcrylicDevice()
 {
     if (mDevFD >= 0)
@@ -55,6 +62,9 @@ bool AcrylicDevice::open()
 
 int AcrylicDevice::ioctl(int cmd, void *arg)
 {
+    if (mBackend)
+        return mBackend->ioctl(cmd, arg);
+
     if (!open())
         return -1;
 
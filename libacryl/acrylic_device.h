@@ -18,11 +18,26 @@
 #ifndef __HARDWARE_EXYNOS_ACRYLIC_DEVICE_H__
 #define __HARDWARE_EXYNOS_ACRYLIC_DEVICE_H__
 
+#include <memory>
 #include <string>
 
+/*
+ * Serves the ioctls of AcrylicDevice in place of the device driver
+ */
+class AcrylicDeviceBackend {
+public:
+    virtual ~AcrylicDeviceBackend() { }
+    virtual int ioctl(int cmd, void *arg) = 0;
+};
+
 class AcrylicDevice {
 public:
     AcrylicDevice(const char *path);
+    /*
+     * The ioctls are forwarded to @backend instead of @path if @backend is not NULL.
+     * AcrylicDevice owns @backend.
+     */
+    AcrylicDevice(const char *path, AcrylicDeviceBackend *backend);
     virtual ~AcrylicDevice();
     int ioctl(int cmd, void *arg);
 private:
@@ -30,6 +45,7 @@ private:
 
     std::string mDevPath;
     int mDevFD;
+    std::unique_ptr<AcrylicDeviceBackend> mBackend;
 };
 
 #define MAX_DEVICE_FD 3
@@ -15,6 +15,8 @@
  * limitations under the License.
  */
 
+#include <unordered_map>
+
 #include <linux/videodev2.h>
 #include <log/log.h>
 #include <mali_gralloc_formats.h>
@@ -137,7 +139,7 @@ uint32_t halfmt_to_v4l2_deprecated(uint32_t halfmt)
 }
 
 
-static struct {
+static struct halfmt_desc {
     uint32_t fmt;                   // HAL_PIXEL_FORMAT that describe how pixels are stored in memory
     uint8_t  bufcnt;                // the number of buffer to describe @fmt
     uint8_t  subfactor;             // Horizontal (upper 4 bits)and vertical (lower 4 bits) chroma subsampling factor
@@ -199,16 +201,34 @@ static struct {
 #define NV12_MFC_C_PAYLOAD(w, h)    (MFC_ALIGN(w) * MFC_ALIGN(h) / 2)
 #define NV12_MFC_PAYLOAD(w, h)      (NV12_MFC_Y_PAYLOAD(w, h) + MFC_PAD_SIZE + (MFC_ALIGN(w) * (h) / 2))
 
+/*
+ * The properties of a format are looked up several times for every layer in every
+ * frame. The table is indexed by the format on the first lookup rather than scanned
+ * linearly. The first entry wins on duplicates as the linear search did.
+ */
+static const halfmt_desc *find_halfmt_desc(uint32_t fmt)
+{
+    static const std::unordered_map<uint32_t, const halfmt_desc *> index = [] {
+        std::unordered_map<uint32_t, const halfmt_desc *> map;
+        for (size_t i = 0; i < ARRSIZE(__halfmt_plane_bpp); i++)
+            map.emplace(__halfmt_plane_bpp[i].fmt, &__halfmt_plane_bpp[i]);
+        return map;
+    }();
+
+    auto it = index.find(fmt);
+    return (it == index.end()) ? NULL : it->second;
+}
+
 size_t halfmt_plane_length(uint32_t fmt, unsigned int plane, uint32_t width, uint32_t height)
 {
-    for (size_t i = 0; i < ARRSIZE(__halfmt_plane_bpp); i++) {
-        if (__halfmt_plane_bpp[i].fmt == fmt) {
-            LOGASSERT(plane < __halfmt_plane_bpp[i].bufcnt,
-                      "Plane count of HAL format %#x is %u but %d plane is requested", fmt,
-                      __halfmt_plane_bpp[i].bufcnt, plane);
-            if (plane < __halfmt_plane_bpp[i].bufcnt)
-                return (__halfmt_plane_bpp[i].bpp[plane] * width * height) / 8;
-        }
+    const halfmt_desc *desc = find_halfmt_desc(fmt);
+
+    if (desc) {
+        LOGASSERT(plane < desc->bufcnt,
+                  "Plane count of HAL format %#x is %u but %d plane is requested", fmt,
+                  desc->bufcnt, plane);
+        if (plane < desc->bufcnt)
+            return (desc->bpp[plane] * width * height) / 8;
     }
 
     LOGASSERT(1, "Unable to find HAL format %#x with plane %d", fmt, plane);
@@ -218,10 +238,10 @@ size_t halfmt_plane_length(uint32_t fmt, unsigned int plane, uint32_t width, uin
 
 unsigned int halfmt_bpp(uint32_t fmt)
 {
-    for (size_t i = 0 ; i < ARRSIZE(__halfmt_plane_bpp); i++) {
-        if (__halfmt_plane_bpp[i].fmt == fmt)
-                return __halfmt_plane_bpp[i].bpp[0] + __halfmt_plane_bpp[i].bpp[1] + __halfmt_plane_bpp[i].bpp[2];
-    }
+    const halfmt_desc *desc = find_halfmt_desc(fmt);
+
+    if (desc)
+        return desc->bpp[0] + desc->bpp[1] + desc->bpp[2];
 
     LOGASSERT(1, "Unable to find HAL format %#x", fmt);
 
@@ -231,10 +251,9 @@ unsigned int halfmt_bpp(uint32_t fmt)
 #define DEFINE_HALFMT_PROPERTY_GETTER(rettype, funcname, member)    \
     rettype funcname(uint32_t fmt)                                  \
     {                                                               \
-        for (size_t i = 0 ; i < ARRSIZE(__halfmt_plane_bpp); i++) { \
-            if (__halfmt_plane_bpp[i].fmt == fmt)                   \
-                return __halfmt_plane_bpp[i].member;                \
-        }                                                           \
+        const halfmt_desc *desc = find_halfmt_desc(fmt);            \
+        if (desc)                                                   \
+            return desc->member;                                    \
         LOGASSERT(1, "Unable to find HAL format %#x", fmt);         \
         return 0;                                                   \
     }
@@ -26,11 +26,19 @@
 #include <mali_gralloc_formats.h>
 #include <sys/ioctl.h>
 #include <system/graphics.h>
+#include <unistd.h>
 #include <utils/Trace.h>
 
 #include <algorithm>
 #include <cstring>
 
+#ifdef LIBACRYL_G2D_EMULATOR
+#include "acrylic_g2d_emulator.h"
+#define G2D_DEVICE_BACKEND (new G2DEmulator())
+#else
+#define G2D_DEVICE_BACKEND NULL
+#endif
+
 enum {
     G2D_CSC_STD_UNDEFINED = -1,
     G2D_CSC_STD_601       = 0,
@@ -534,12 +542,11 @@ static g2d_fmt __halfmt_to_g2dfmt[] = {
     {HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L80, G2D_FMT_NV12_SBWC_10B, 1,0},
 };
 
-static g2d_fmt *halfmt_to_g2dfmt(struct g2d_fmt *tbl, size_t tbl_len, uint32_t halfmt)
+g2d_fmt *AcrylicCompositorG2D::findG2DFormat(uint32_t halfmt)
 {
-    for (size_t i = 0 ; i < tbl_len; i++) {
-        if (tbl[i].halfmt == halfmt)
-            return &tbl[i];
-    }
+    auto it = mG2DFormats.find(halfmt);
+    if (it != mG2DFormats.end())
+        return it->second;
 
     ALOGE("Unable to find the proper G2D format for HAL format %#x", halfmt);
 
@@ -547,7 +554,14 @@ static g2d_fmt *halfmt_to_g2dfmt(struct g2d_fmt *tbl, size_t tbl_len, uint32_t h
 }
 
 AcrylicCompositorG2D::AcrylicCompositorG2D(const HW2DCapability &capability, bool newcolormode)
-    : Acrylic(capability), mDev((capability.maxLayerCount() > 2) ? "/dev/g2d" : "/dev/fimg2d"),
+    : AcrylicCompositorG2D(capability, newcolormode, G2D_DEVICE_BACKEND)
+{
+}
+
+AcrylicCompositorG2D::AcrylicCompositorG2D(const HW2DCapability &capability, bool newcolormode,
+                                           AcrylicDeviceBackend *backend)
+    : Acrylic(capability),
+      mDev((capability.maxLayerCount() > 2) ? "/dev/g2d" : "/dev/fimg2d", backend),
       mMaxSourceCount(0), mPriority(-1)
 {
     memset(&mTask, 0, sizeof(mTask));
@@ -557,8 +571,11 @@ AcrylicCompositorG2D::AcrylicCompositorG2D(const HW2DCapability &capability, boo
         ALOGERR("Failed to get G2D command version");
     ALOGI("G2D API Version %d", mVersion);
 
-    halfmt_to_g2dfmt_tbl = newcolormode ? __halfmt_to_g2dfmt : __halfmt_to_g2dfmt_legacy;
-    len_halfmt_to_g2dfmt_tbl = newcolormode ? ARRSIZE(__halfmt_to_g2dfmt) : ARRSIZE(__halfmt_to_g2dfmt_legacy);
+    g2d_fmt *tbl = newcolormode ? __halfmt_to_g2dfmt : __halfmt_to_g2dfmt_legacy;
+    size_t tbl_len = newcolormode ? ARRSIZE(__halfmt_to_g2dfmt) : ARRSIZE(__halfmt_to_g2dfmt_legacy);
+    // the first entry of a HAL format wins as the linear search of the table did
+    for (size_t i = 0; i < tbl_len; i++)
+        mG2DFormats.emplace(tbl[i].halfmt, &tbl[i]);
 
     mUsePolyPhaseFilter = getCapabilities().supportedMinDecimation() == hw2d_coord_t{4, 4};
 
@@ -649,7 +666,7 @@ bool AcrylicCompositorG2D::prepareImage(AcrylicCanvas &layer, struct g2d_layer &
     if (layer.isProtected())
         image.flags |= G2D_LAYERFLAG_SECURE;
 
-    g2d_fmt *g2dfmt = halfmt_to_g2dfmt(halfmt_to_g2dfmt_tbl, len_halfmt_to_g2dfmt_tbl, layer.getFormat());
+    g2d_fmt *g2dfmt = findG2DFormat(layer.getFormat());
     if (!g2dfmt)
         return false;
 
@@ -817,6 +834,15 @@ bool AcrylicCompositorG2D::prepareSolidLayer(AcrylicCanvas &canvas, struct g2d_l
     cmd[G2DSFR_SRC_DSTRIGHT]  = xy.hori;
     cmd[G2DSFR_SRC_DSTBOTTOM] = xy.vert;
 
+    hw2d_rect_t clip;
+    if (getCanvasClip(clip)) {
+        // fill only the clipping area not to overwrite the pixels kept
+        cmd[G2DSFR_IMG_LEFT]   = cmd[G2DSFR_SRC_DSTLEFT]   = clip.pos.hori;
+        cmd[G2DSFR_IMG_TOP]    = cmd[G2DSFR_SRC_DSTTOP]    = clip.pos.vert;
+        cmd[G2DSFR_IMG_RIGHT]  = cmd[G2DSFR_SRC_DSTRIGHT]  = clip.pos.hori + clip.size.hori;
+        cmd[G2DSFR_IMG_BOTTOM] = cmd[G2DSFR_SRC_DSTBOTTOM] = clip.pos.vert + clip.size.vert;
+    }
+
     cmd[G2DSFR_SRC_ALPHA] = 0;
     cmd[G2DSFR_SRC_BLEND] = 0;
 
@@ -1071,10 +1097,43 @@ bool AcrylicCompositorG2D::executeG2D(int fence[], unsigned int num_fences, bool
 
     bool hasBackground = hasBackgroundColor();
 
-    g2d_fmt *g2dfmt = halfmt_to_g2dfmt(halfmt_to_g2dfmt_tbl, len_halfmt_to_g2dfmt_tbl, getCanvas().getFormat());
+    g2d_fmt *g2dfmt = findG2DFormat(getCanvas().getFormat());
     if (g2dfmt && (g2dfmt->g2dfmt & G2D_DATAFORMAT_SBWC))
         hasBackground = true;
 
+    sortLayers();
+
+    // G2D rejects a source entirely out of the target rect. So the layers out of
+    // the clipping area are left out of the task.
+    hw2d_rect_t clip;
+    bool clipped = getCanvasClip(clip);
+    unsigned int *layerindex = reinterpret_cast<unsigned int *>(
+            alloca(sizeof(unsigned int) * std::max(layercount, 1U)));
+    unsigned int sourcecount = 0;
+    hw2d_coord_t xy = getCanvas().getImageDimension();
+
+    for (unsigned int i = 0; i < layercount; i++) {
+        hw2d_rect_t window = getLayer(i)->getTargetRect();
+        if (area_is_zero(window))
+            window.size = xy;
+
+        if (!clipped ||
+                ((window.pos.hori < clip.pos.hori + clip.size.hori) &&
+                 (clip.pos.hori < window.pos.hori + window.size.hori) &&
+                 (window.pos.vert < clip.pos.vert + clip.size.vert) &&
+                 (clip.pos.vert < window.pos.vert + window.size.vert)))
+            layerindex[sourcecount++] = i;
+    }
+
+    // nothing is written to the clipping area. Then a task without the clipping
+    // does the same as the full composition does.
+    if (clipped && (sourcecount == 0) && !hasBackground) {
+        clipped = false;
+        for (sourcecount = 0; sourcecount < layercount; sourcecount++)
+            layerindex[sourcecount] = sourcecount;
+    }
+    layercount = sourcecount;
+
     if (hasBackground) {
         layercount++;
 
@@ -1087,8 +1146,6 @@ bool AcrylicCompositorG2D::executeG2D(int fence[], unsigned int num_fences, bool
     if (!reallocLayer(layercount))
         return false;
 
-    sortLayers();
-
     mTask.flags = 0;
 
     if (!prepareImage(getCanvas(), mTask.target, mTask.commands.target, -1)) {
@@ -1096,6 +1153,14 @@ bool AcrylicCompositorG2D::executeG2D(int fence[], unsigned int num_fences, bool
         return false;
     }
 
+    if (clipped) {
+        // G2D does not write the pixels out of the target rect
+        mTask.commands.target[G2DSFR_IMG_LEFT]   = clip.pos.hori;
+        mTask.commands.target[G2DSFR_IMG_TOP]    = clip.pos.vert;
+        mTask.commands.target[G2DSFR_IMG_RIGHT]  = clip.pos.hori + clip.size.hori;
+        mTask.commands.target[G2DSFR_IMG_BOTTOM] = clip.pos.vert + clip.size.vert;
+    }
+
     if (getCanvas().isOTF())
         mTask.flags |= G2D_FLAG_HWFC;
 
@@ -1115,12 +1180,14 @@ bool AcrylicCompositorG2D::executeG2D(int fence[], unsigned int num_fences, bool
     mTask.commands.target[G2DSFR_DST_YCBCRMODE] |= (G2D_LAYER_YCBCRMODE_OFFX | G2D_LAYER_YCBCRMODE_OFFY);
 
     for (unsigned int i = baseidx; i < layercount; i++) {
-        AcrylicLayer &layer = *getLayer(i - baseidx);
+        // the blending of a layer does not depend on the layers left out
+        unsigned int index = layerindex[i - baseidx];
+        AcrylicLayer &layer = *getLayer(index);
 
         if (!prepareSource(layer, mTask.source[i],
                            mTask.commands.source[i], getCanvas().getImageDimension(),
-                           i, i - baseidx)) {
-            ALOGE("Failed to configure source layer %u", i - baseidx);
+                           i, index)) {
+            ALOGE("Failed to configure source layer %u", index);
             return false;
         }
 
@@ -1155,8 +1222,10 @@ bool AcrylicCompositorG2D::executeG2D(int fence[], unsigned int num_fences, bool
     if (nonblocking)
         mTask.flags |= G2D_FLAG_NONBLOCK;
 
-    mTask.num_release_fences = num_fences;
-    mTask.release_fence = reinterpret_cast<int *>(alloca(sizeof(int) * num_fences));
+    // every release fence of a task signals at its completion
+    unsigned int num_task_fences = std::min(num_fences, layercount + 1);
+    mTask.num_release_fences = num_task_fences;
+    mTask.release_fence = reinterpret_cast<int *>(alloca(sizeof(int) * num_task_fences));
 
     mTask.commands.num_extra_regs = cscMatrixWriter.getRegisterCount() +
                                     mHdrWriter.getCommandCount();
@@ -1197,15 +1266,32 @@ bool AcrylicCompositorG2D::executeG2D(int fence[], unsigned int num_fences, bool
         getLayer(i)->setFence(-1);
     }
 
-    for (unsigned int i = 0; i < num_fences; i++)
-        fence[i] = mTask.release_fence[i];
+    for (unsigned int i = 0; i < num_fences; i++) {
+        if (i < num_task_fences)
+            fence[i] = mTask.release_fence[i];
+        else
+            fence[i] = (mTask.release_fence[0] < 0) ? -1 : dup(mTask.release_fence[0]);
+    }
 
     return true;
 }
 
+bool AcrylicCompositorG2D::executeUnclipped(int fence[], unsigned int num_fences, bool nonblocking)
+{
+    if (!hasCanvasClip())
+        return false;
+
+    // the acquire fences are still valid because the failed task did not consume them
+    ALOGE("Failed to composite the clipping area. Compositing the entire target");
+    clearCanvasClip();
+    mHdrWriter.putCommands();
+
+    return executeG2D(fence, num_fences, nonblocking);
+}
+
 bool AcrylicCompositorG2D::execute(int fence[], unsigned int num_fences)
 {
-    if (!executeG2D(fence, num_fences, true)) {
+    if (!executeG2D(fence, num_fences, true) && !executeUnclipped(fence, num_fences, true)) {
         // Clearing all acquire fences because their buffers are expired.
         // The clients should configure everything again to start new execution
         for (unsigned int i = 0; i < layerCount(); i++)
@@ -1220,7 +1306,8 @@ bool AcrylicCompositorG2D::execute(int fence[], unsigned int num_fences)
 
 bool AcrylicCompositorG2D::execute(int *handle)
 {
-    if (!executeG2D(NULL, 0, handle ? true : false)) {
+    if (!executeG2D(NULL, 0, handle ? true : false) &&
+            !executeUnclipped(NULL, 0, handle ? true : false)) {
         // Clearing all acquire fences because their buffers are expired.
         // The clients should configure everything again to start new execution
         for (unsigned int i = 0; i < layerCount(); i++)
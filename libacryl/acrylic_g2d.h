@@ -19,6 +19,7 @@
 #define __HARDWARE_EXYNOS_HW2DCOMPOSITOR_G2D_H__
 
 #include <memory>
+#include <unordered_map>
 
 #include <hardware/exynos/acryl.h>
 
@@ -120,6 +121,9 @@ struct g2d_fmt;
 class AcrylicCompositorG2D: public Acrylic {
 public:
     AcrylicCompositorG2D(const HW2DCapability &capability, bool newcolormode);
+    // the ioctls to G2D are served by @backend. The compositor owns @backend.
+    AcrylicCompositorG2D(const HW2DCapability &capability, bool newcolormode,
+                         AcrylicDeviceBackend *backend);
     virtual ~AcrylicCompositorG2D();
     virtual bool execute(int fence[], unsigned int num_fences);
     virtual bool execute(int *handle = NULL);
@@ -136,6 +140,8 @@ public:
 private:
     int ioctlG2D(void);
     bool executeG2D(int fence[], unsigned int num_fences, bool nonblocking);
+    bool executeUnclipped(int fence[], unsigned int num_fences, bool nonblocking);
+    g2d_fmt *findG2DFormat(uint32_t halfmt);
     bool prepareImage(AcrylicCanvas &layer, struct g2d_layer &image, uint32_t cmd[], int index);
     bool prepareSource(AcrylicLayer &layer, struct g2d_layer &image, uint32_t cmd[], hw2d_coord_t target_size,
                        unsigned int index, unsigned int image_index);
@@ -152,8 +158,8 @@ private:
     unsigned int mVersion;
     bool mUsePolyPhaseFilter;
 
-    g2d_fmt *halfmt_to_g2dfmt_tbl;
-    size_t len_halfmt_to_g2dfmt_tbl;
+    // the G2D format table of the color mode indexed by the HAL format
+    std::unordered_map<uint32_t, g2d_fmt *> mG2DFormats;
 };
 
 #endif //__HARDWARE_EXYNOS_HW2DCOMPOSITOR_G2D_H__
@@ -0,0 +1,607 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <log/log.h>
+
+#include "acrylic_internal.h"
+#include "acrylic_g2d_emulator.h"
+
+#define FENCE_TIMEOUT_MS 1000
+
+static const char *dstFieldNames[G2DSFR_DST_FIELD_COUNT] = {
+    "stride", "colormode", "left", "top", "right", "bottom", "width", "height",
+    "ycbcrmode", "y_header_stride", "y_payload_stride", "c_header_stride",
+    "c_payload_stride", "sbwcinfo",
+};
+
+static const char *srcFieldNames[G2DSFR_SRC_FIELD_COUNT] = {
+    "stride", "colormode", "left", "top", "right", "bottom", "width", "height",
+    "command", "select", "rotate", "dstleft", "dsttop", "dstright", "dstbottom",
+    "scalecontrol", "xscale", "yscale", "xphase", "yphase", "color", "alpha", "blend",
+    "ycbcrmode", "hdrmode", "y_header_stride", "y_payload_stride", "c_header_stride",
+    "c_payload_stride", "sbwcinfo",
+};
+
+static void appendFormat(std::string &out, const char *fmt, ...)
+{
+    char buf[128];
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    out += buf;
+}
+
+static void dumpImage(std::string &out, const char *name, const G2DEmulatedImage &image,
+                      const char *fields[], unsigned int count)
+{
+    appendFormat(out, "%s: flags %#x, fence %s, buffer_type %u, num_buffers %u",
+                 name, image.flags, (image.fence < 0) ? "none" : "set",
+                 image.bufferType, image.numBuffers);
+    for (unsigned int i = 0; i < image.numBuffers; i++)
+        appendFormat(out, ", length[%u] %u", i, image.buffer[i].length);
+    out += "\n";
+
+    for (unsigned int i = 0; i < count; i++)
+        appendFormat(out, "  %-16s 0x%08x\n", fields[i], image.commands[i]);
+}
+
+void G2DEmulatedJob::dump(std::string &out) const
+{
+    appendFormat(out, "job: flags %#x, priority %u, num_source %zu, num_extra_regs %zu\n",
+                 flags, priority, sources.size(), extra.size());
+
+    dumpImage(out, "target", target, dstFieldNames, G2DSFR_DST_FIELD_COUNT);
+
+    for (size_t i = 0; i < sources.size(); i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "source[%zu]", i);
+        dumpImage(out, name, sources[i], srcFieldNames, G2DSFR_SRC_FIELD_COUNT);
+    }
+
+    for (auto &reg : extra)
+        appendFormat(out, "extra: 0x%04x = 0x%08x\n", reg.offset, reg.value);
+}
+
+G2DEmulator::G2DEmulator(bool render)
+    : mRender(render), mPriority(G2D_DEFAULT_PRIORITY), mJobCount(0)
+{
+    mLastJob = {};
+}
+
+int G2DEmulator::ioctl(int cmd, void *arg)
+{
+    // the commands do not fit in int
+    switch (static_cast<unsigned int>(cmd)) {
+    case G2D_IOC_VERSION:
+        // g2d_task is supported
+        *static_cast<uint32_t *>(arg) = 1;
+        return 0;
+    case G2D_IOC_PROCESS:
+        return process(*static_cast<g2d_task *>(arg));
+    case G2D_IOC_COMPAT_PROCESS: {
+        g2d_compat_task &compat = *static_cast<g2d_compat_task *>(arg);
+        g2d_task task;
+        uint32_t target[G2DSFR_DST_FIELD_COUNT] = {};
+
+        memcpy(&task, &compat, sizeof(task) - sizeof(task.commands));
+        memcpy(target, compat.commands.target, sizeof(compat.commands.target));
+
+        task.commands.target = target;
+        for (unsigned int i = 0; i < G2D_MAX_IMAGES; i++)
+            task.commands.source[i] = compat.commands.source[i];
+        task.commands.extra = compat.commands.extra;
+        task.commands.num_extra_regs = compat.commands.num_extra_regs;
+
+        int ret = process(task);
+
+        compat.flags = task.flags;
+        compat.laptime_in_usec = task.laptime_in_usec;
+
+        return ret;
+    }
+    case G2D_IOC_PRIORITY: {
+        int32_t priority = *static_cast<int32_t *>(arg);
+        if ((priority < 0) || (priority >= G2D_PRIORITY_END)) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPriority = priority;
+        return 0;
+    }
+    case G2D_IOC_PERFORMANCE:
+        // no clock to scale
+        return 0;
+    default:
+        ALOGE("Unknown G2D ioctl %#x", cmd);
+        errno = ENOTTY;
+        return -1;
+    }
+}
+
+G2DEmulatedJob G2DEmulator::getLastJob()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    return mLastJob;
+}
+
+unsigned int G2DEmulator::getJobCount()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    return mJobCount;
+}
+
+int G2DEmulator::process(g2d_task &task)
+{
+    auto start = std::chrono::steady_clock::now();
+    G2DEmulatedJob job;
+
+    if (!decode(task, job)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    job.rendered = mRender && render(job);
+
+    for (unsigned int i = 0; i < task.num_release_fences; i++)
+        task.release_fence[i] = -1;
+
+    task.laptime_in_usec = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mLastJob = std::move(job);
+    mJobCount++;
+
+    return 0;
+}
+
+static void decodeImage(const g2d_layer &layer, const uint32_t cmd[], unsigned int count,
+                        G2DEmulatedImage &image)
+{
+    memset(&image, 0, sizeof(image));
+
+    image.flags = layer.flags;
+    image.fence = (layer.flags & G2D_LAYERFLAG_ACQUIRE_FENCE) ? layer.fence : -1;
+    image.bufferType = layer.buffer_type;
+    image.numBuffers = std::min(layer.num_buffers, static_cast<uint32_t>(G2D_MAX_BUFFERS));
+    memcpy(image.buffer, layer.buffer, sizeof(image.buffer));
+    memcpy(image.commands, cmd, sizeof(cmd[0]) * count);
+}
+
+bool G2DEmulator::decode(g2d_task &task, G2DEmulatedJob &job)
+{
+    if ((task.num_source == 0) || (task.num_source > G2D_MAX_IMAGES)) {
+        ALOGE("Invalid number of source images %u", task.num_source);
+        return false;
+    }
+
+    if ((task.num_release_fences > task.num_source + 1) ||
+            ((task.num_release_fences > 0) && (task.release_fence == NULL))) {
+        ALOGE("Invalid release fences %u for %u source images",
+              task.num_release_fences, task.num_source);
+        return false;
+    }
+
+    if ((task.commands.num_extra_regs > G2D_MAX_SFR_COUNT) ||
+            ((task.commands.num_extra_regs > 0) && (task.commands.extra == NULL))) {
+        ALOGE("Invalid number of extra commands %u", task.commands.num_extra_regs);
+        return false;
+    }
+
+    if ((task.commands.target == NULL) || (task.source == NULL)) {
+        ALOGE("No command list of the target or the source images");
+        return false;
+    }
+
+    job.flags = task.flags;
+    job.priority = task.priority;
+
+    decodeImage(task.target, task.commands.target, G2DSFR_DST_FIELD_COUNT, job.target);
+    if (!(task.flags & G2D_FLAG_HWFC) && !validateImage(job.target, true))
+        return false;
+
+    job.sources.resize(task.num_source);
+    for (unsigned int i = 0; i < task.num_source; i++) {
+        if (task.commands.source[i] == NULL) {
+            ALOGE("No command list of source[%u]", i);
+            return false;
+        }
+
+        decodeImage(task.source[i], task.commands.source[i], G2DSFR_SRC_FIELD_COUNT,
+                    job.sources[i]);
+        if (!validateImage(job.sources[i], false) || !validateSource(job.sources[i], job.target)) {
+            ALOGE("Invalid source[%u]", i);
+            return false;
+        }
+    }
+
+    job.extra.assign(task.commands.extra, task.commands.extra + task.commands.num_extra_regs);
+    for (auto &reg : job.extra) {
+        if (reg.offset & 3) {
+            ALOGE("Unaligned extra command offset %#x", reg.offset);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct G2DEmulatedPlane {
+    uint64_t stride;
+    // the rows of the plane for the number of rows of the luma plane
+    unsigned int subsampling;
+};
+
+/*
+ * The planes of an uncompressed image. The stride of YCbCr is not in the command
+ * but derived from the width like the driver does.
+ */
+static unsigned int getPlanes(const uint32_t cmd[], G2DEmulatedPlane planes[G2D_MAX_PLANES])
+{
+    uint32_t fmt = cmd[G2DSFR_IMG_COLORMODE];
+    uint64_t stride = cmd[G2DSFR_IMG_WIDTH];
+
+    if (!IS_YUV(fmt)) {
+        planes[0] = {cmd[G2DSFR_IMG_STRIDE], 1};
+        return 1;
+    }
+
+    if (((fmt & G2D_DATAFMT_MASK) == G2D_DATAFMT_P010_LGCY) ||
+            ((fmt & G2D_FMT_YCBCR_BITDEPTH_MASK) == G2D_FMT_YCBCR_10BIT))
+        stride *= 2;
+
+    switch (fmt & G2D_DATAFMT_MASK) {
+    case G2D_DATAFMT_YUV420SP:
+    case G2D_DATAFMT_P010_LGCY:
+        planes[0] = {stride, 1};
+        planes[1] = {stride, 2};
+        return 2;
+    case G2D_DATAFMT_YUV422SP:
+        planes[0] = {stride, 1};
+        planes[1] = {stride, 1};
+        return 2;
+    case G2D_DATAFMT_YUV420P:
+        planes[0] = {stride, 1};
+        planes[1] = {stride / 2, 2};
+        planes[2] = {stride / 2, 2};
+        return 3;
+    default: // G2D_DATAFMT_YUV422I
+        planes[0] = {stride * 2, 1};
+        return 1;
+    }
+}
+
+static inline uint64_t planeSize(const G2DEmulatedPlane &plane, uint32_t rows)
+{
+    return plane.stride * ((rows + plane.subsampling - 1) / plane.subsampling);
+}
+
+/*
+ * Checks that the rows of the image rect of every plane are in its buffer. The
+ * planes in a single buffer follow the previous plane of IMG_HEIGHT rows.
+ */
+static bool validateBufferBounds(const G2DEmulatedImage &image)
+{
+    const uint32_t *cmd = image.commands;
+    G2DEmulatedPlane planes[G2D_MAX_PLANES];
+    unsigned int count = getPlanes(cmd, planes);
+    uint64_t offset = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int buf = std::min(i, image.numBuffers - 1);
+        uint64_t extent = offset + planeSize(planes[i], cmd[G2DSFR_IMG_BOTTOM]);
+
+        if (extent > image.buffer[buf].length) {
+            ALOGE("Plane %u of %" PRIu64 " bytes to row %u overflows buffer[%u] of %u bytes",
+                  i, extent, cmd[G2DSFR_IMG_BOTTOM], buf, image.buffer[buf].length);
+            return false;
+        }
+
+        offset = (image.numBuffers > 1) ? 0 : offset + planeSize(planes[i], cmd[G2DSFR_IMG_HEIGHT]);
+    }
+
+    return true;
+}
+
+bool G2DEmulator::validateImage(const G2DEmulatedImage &image, bool target)
+{
+    const uint32_t *cmd = image.commands;
+
+    if ((image.flags & G2D_LAYERFLAG_ACQUIRE_FENCE) && (image.fence < 0)) {
+        ALOGE("Acquire fence flag without a fence");
+        return false;
+    }
+
+    if (!target && (image.flags & G2D_LAYERFLAG_COLORFILL)) {
+        if (cmd[G2DSFR_SRC_SELECT] != G2D_LAYERSEL_COLORFILL) {
+            ALOGE("Color fill image selects a buffer %#x", cmd[G2DSFR_SRC_SELECT]);
+            return false;
+        }
+        return true;
+    }
+
+    if (!G2D_BUFTYPE_VALID(image.bufferType) || (image.numBuffers == 0)) {
+        ALOGE("Invalid buffer type %u with %u buffers", image.bufferType, image.numBuffers);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < image.numBuffers; i++) {
+        if (image.buffer[i].length == 0) {
+            ALOGE("Empty buffer[%u]", i);
+            return false;
+        }
+        if ((image.bufferType == G2D_BUFTYPE_DMABUF) && (image.buffer[i].dmabuf.fd < 0)) {
+            ALOGE("Invalid dmabuf fd %d of buffer[%u]", image.buffer[i].dmabuf.fd, i);
+            return false;
+        }
+    }
+
+    if ((cmd[G2DSFR_IMG_WIDTH] == 0) || (cmd[G2DSFR_IMG_HEIGHT] == 0) ||
+            (cmd[G2DSFR_IMG_LEFT] >= cmd[G2DSFR_IMG_RIGHT]) ||
+            (cmd[G2DSFR_IMG_TOP] >= cmd[G2DSFR_IMG_BOTTOM]) ||
+            (cmd[G2DSFR_IMG_RIGHT] > cmd[G2DSFR_IMG_WIDTH]) ||
+            (cmd[G2DSFR_IMG_BOTTOM] > cmd[G2DSFR_IMG_HEIGHT])) {
+        ALOGE("Invalid image rect (%u, %u) -> (%u, %u) in %ux%u",
+              cmd[G2DSFR_IMG_LEFT], cmd[G2DSFR_IMG_TOP], cmd[G2DSFR_IMG_RIGHT],
+              cmd[G2DSFR_IMG_BOTTOM], cmd[G2DSFR_IMG_WIDTH], cmd[G2DSFR_IMG_HEIGHT]);
+        return false;
+    }
+
+    bool compressed = !!(cmd[G2DSFR_IMG_COLORMODE] & (G2D_DATAFORMAT_AFBC | G2D_DATAFORMAT_SBWC));
+    if (!compressed && IS_RGB(cmd[G2DSFR_IMG_COLORMODE]) && (cmd[G2DSFR_IMG_STRIDE] == 0)) {
+        ALOGE("Zero stride of an uncompressed image");
+        return false;
+    }
+
+    if (!compressed && !validateBufferBounds(image))
+        return false;
+
+    if (!target && (cmd[G2DSFR_SRC_SELECT] != 0)) {
+        ALOGE("Buffer image selects the color fill %#x", cmd[G2DSFR_SRC_SELECT]);
+        return false;
+    }
+
+    return true;
+}
+
+bool G2DEmulator::validateSource(const G2DEmulatedImage &source, const G2DEmulatedImage &target)
+{
+    const uint32_t *cmd = source.commands;
+    const uint32_t *dst = target.commands;
+
+    if (!(cmd[G2DSFR_SRC_COMMAND] & G2D_LAYERCMD_VALID)) {
+        ALOGE("Source is not valid: command %#x", cmd[G2DSFR_SRC_COMMAND]);
+        return false;
+    }
+
+    int32_t left = static_cast<int32_t>(cmd[G2DSFR_SRC_DSTLEFT]);
+    int32_t top = static_cast<int32_t>(cmd[G2DSFR_SRC_DSTTOP]);
+    int32_t right = static_cast<int32_t>(cmd[G2DSFR_SRC_DSTRIGHT]);
+    int32_t bottom = static_cast<int32_t>(cmd[G2DSFR_SRC_DSTBOTTOM]);
+
+    if ((left >= right) || (top >= bottom)) {
+        ALOGE("Invalid destination rect (%d, %d) -> (%d, %d)", left, top, right, bottom);
+        return false;
+    }
+
+    // the part out of the target rect is clipped but nothing to composite is an error
+    if ((left >= static_cast<int32_t>(dst[G2DSFR_IMG_RIGHT])) ||
+            (top >= static_cast<int32_t>(dst[G2DSFR_IMG_BOTTOM])) ||
+            (right <= static_cast<int32_t>(dst[G2DSFR_IMG_LEFT])) ||
+            (bottom <= static_cast<int32_t>(dst[G2DSFR_IMG_TOP]))) {
+        ALOGE("Destination rect (%d, %d) -> (%d, %d) is out of the target rect",
+              left, top, right, bottom);
+        return false;
+    }
+
+    if (cmd[G2DSFR_SRC_ROTATE] & ~(G2D_ROTATEDIR_ROT90CCW | (3 << G2D_ROTATEDIR_FLIP_SHIFT))) {
+        ALOGE("Invalid rotation %#x", cmd[G2DSFR_SRC_ROTATE]);
+        return false;
+    }
+
+    return true;
+}
+
+static bool isRenderable(const G2DEmulatedImage &image, uint32_t colormode)
+{
+    if (image.flags & G2D_LAYERFLAG_COLORFILL)
+        return true;
+
+    // every buffer image should have the same swizzling with the target
+    return (image.bufferType == G2D_BUFTYPE_DMABUF) && (image.numBuffers == 1) &&
+           (G2D_IMGFMT(image.commands[G2DSFR_IMG_COLORMODE]) == colormode) &&
+           !(image.commands[G2DSFR_IMG_COLORMODE] & (G2D_DATAFORMAT_AFBC | G2D_DATAFORMAT_SBWC));
+}
+
+static bool waitFence(int fence)
+{
+    if (fence < 0)
+        return true;
+
+    struct pollfd fds = {.fd = fence, .events = POLLIN, .revents = 0};
+    int ret = poll(&fds, 1, FENCE_TIMEOUT_MS);
+    if (ret <= 0) {
+        ALOGE("Failed to wait for fence %d: %d", fence, ret);
+        return false;
+    }
+
+    return true;
+}
+
+static void *mapImage(const G2DEmulatedImage &image, int prot)
+{
+    const g2d_buffer &buf = image.buffer[0];
+    void *addr = mmap(NULL, buf.length + buf.dmabuf.offset, prot, MAP_SHARED, buf.dmabuf.fd, 0);
+    if (addr == MAP_FAILED) {
+        ALOGERR("Failed to map dmabuf %d", buf.dmabuf.fd);
+        return NULL;
+    }
+
+    return static_cast<char *>(addr) + buf.dmabuf.offset;
+}
+
+static void unmapImage(const G2DEmulatedImage &image, void *addr)
+{
+    const g2d_buffer &buf = image.buffer[0];
+    munmap(static_cast<char *>(addr) - buf.dmabuf.offset, buf.length + buf.dmabuf.offset);
+}
+
+static inline uint32_t mul8(uint32_t a, uint32_t b)
+{
+    return (a * b + 127) / 255;
+}
+
+/*
+ * Blends a pixel in the order of the channels of the target. The alpha is always
+ * in the most significant byte of the 32-bit RGB formats.
+ */
+static uint32_t blendPixel(uint32_t s, uint32_t d, uint32_t command, uint32_t blend,
+                           uint32_t galpha)
+{
+    uint32_t sa = (command & G2D_LAYERCMD_OPAQUE) ? 255 : (s >> 24);
+    uint32_t out = 0;
+
+    if (blend == 0)
+        return s;
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t sc = (shift == 24) ? sa : ((s >> shift) & 0xFF);
+        uint32_t dc = (d >> shift) & 0xFF;
+        uint32_t c;
+
+        if (blend == G2D_BLEND_SRCCOPY)
+            c = mul8(galpha, sc);
+        else if (blend == G2D_BLEND_SRCOVER)
+            c = mul8(galpha, sc) + mul8(255 - mul8(sa, galpha), dc);
+        else // G2D_BLEND_NONE
+            c = ((shift == 24) ? mul8(galpha, sa) : mul8(mul8(galpha, sa), sc)) +
+                mul8(255 - mul8(sa, galpha), dc);
+
+        out |= std::min(c, 255U) << shift;
+    }
+
+    return out;
+}
+
+bool G2DEmulator::render(G2DEmulatedJob &job)
+{
+    const uint32_t *tcmd = job.target.commands;
+    uint32_t colormode = G2D_IMGFMT(tcmd[G2DSFR_IMG_COLORMODE]);
+
+    if ((colormode & G2D_DATAFMT_MASK) != G2D_DATAFMT_8888)
+        return false;
+
+    if (!isRenderable(job.target, colormode))
+        return false;
+
+    for (auto &source : job.sources) {
+        if (!isRenderable(source, colormode) || (source.commands[G2DSFR_SRC_ROTATE] != 0))
+            return false;
+    }
+
+    if (!waitFence(job.target.fence))
+        return false;
+
+    char *target = static_cast<char *>(mapImage(job.target, PROT_READ | PROT_WRITE));
+    if (!target)
+        return false;
+
+    // the color of the color fill is ARGB
+    bool bgr = ((colormode & G2D_SWZ_MASK) == G2D_SWZ_ABGR) ||
+               ((colormode & G2D_SWZ_MASK) == G2D_SWZ_xBGR);
+    // the alpha of the images without alpha channel is always 255
+    uint32_t opaque = ((colormode & G2D_SWZ_ALPHA_MASK) == G2D_SWZ_ALPHA_ONE) ?
+                      G2D_LAYERCMD_OPAQUE : 0;
+    bool ret = true;
+
+    for (auto &source : job.sources) {
+        const uint32_t *cmd = source.commands;
+        bool colorfill = !!(source.flags & G2D_LAYERFLAG_COLORFILL);
+        char *src = NULL;
+
+        if (!waitFence(source.fence)) {
+            ret = false;
+            break;
+        }
+
+        if (!colorfill) {
+            src = static_cast<char *>(mapImage(source, PROT_READ));
+            if (!src) {
+                ret = false;
+                break;
+            }
+        }
+
+        uint32_t color = cmd[G2DSFR_SRC_COLOR];
+        if (bgr)
+            color = (color & 0xFF00FF00) | ((color >> 16) & 0xFF) | ((color & 0xFF) << 16);
+
+        int32_t dl = cmd[G2DSFR_SRC_DSTLEFT], dt = cmd[G2DSFR_SRC_DSTTOP];
+        int32_t dw = cmd[G2DSFR_SRC_DSTRIGHT] - dl, dh = cmd[G2DSFR_SRC_DSTBOTTOM] - dt;
+        uint32_t cw = cmd[G2DSFR_IMG_RIGHT] - cmd[G2DSFR_IMG_LEFT];
+        uint32_t ch = cmd[G2DSFR_IMG_BOTTOM] - cmd[G2DSFR_IMG_TOP];
+        int32_t left = std::max(dl, static_cast<int32_t>(tcmd[G2DSFR_IMG_LEFT]));
+        int32_t top = std::max(dt, static_cast<int32_t>(tcmd[G2DSFR_IMG_TOP]));
+        int32_t right = std::min(dl + dw, static_cast<int32_t>(tcmd[G2DSFR_IMG_RIGHT]));
+        int32_t bottom = std::min(dt + dh, static_cast<int32_t>(tcmd[G2DSFR_IMG_BOTTOM]));
+        uint32_t galpha = cmd[G2DSFR_SRC_ALPHA] & 0xFF;
+
+        // nearest sampling for both of scaling up and down
+        for (int32_t y = top; y < bottom; y++) {
+            uint32_t *d = reinterpret_cast<uint32_t *>(target + y * tcmd[G2DSFR_IMG_STRIDE]);
+            const uint32_t *s = NULL;
+
+            if (!colorfill) {
+                uint32_t sy = cmd[G2DSFR_IMG_TOP] + (y - dt) * ch / dh;
+                s = reinterpret_cast<const uint32_t *>(src + sy * cmd[G2DSFR_IMG_STRIDE]);
+            }
+
+            for (int32_t x = left; x < right; x++) {
+                uint32_t pixel = colorfill ? color : s[cmd[G2DSFR_IMG_LEFT] + (x - dl) * cw / dw];
+                d[x] = blendPixel(pixel, d[x], cmd[G2DSFR_SRC_COMMAND] | opaque,
+                                  cmd[G2DSFR_SRC_BLEND], galpha);
+            }
+        }
+
+        if (src)
+            unmapImage(source, src);
+    }
+
+    unmapImage(job.target, target);
+
+    return ret;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HARDWARE_EXYNOS_ACRYLIC_G2D_EMULATOR_H__
+#define __HARDWARE_EXYNOS_ACRYLIC_G2D_EMULATOR_H__
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <uapi/g2d.h>
+
+#include "acrylic_device.h"
+
+/*
+ * An image of a G2D task decoded from the command list. @commands is the copy of
+ * the command list of the image. The target image has G2DSFR_DST_FIELD_COUNT
+ * commands and the source images have G2DSFR_SRC_FIELD_COUNT commands.
+ */
+struct G2DEmulatedImage {
+    uint32_t flags;
+    int32_t fence;
+    uint32_t bufferType;
+    uint32_t numBuffers;
+    g2d_buffer buffer[G2D_MAX_BUFFERS];
+    uint32_t commands[G2DSFR_SRC_FIELD_COUNT];
+};
+
+struct G2DEmulatedJob {
+    uint32_t flags;
+    uint32_t priority;
+    G2DEmulatedImage target;
+    std::vector<G2DEmulatedImage> sources;
+    std::vector<g2d_reg> extra;
+    // the target image is written by the CPU renderer
+    bool rendered;
+
+    /*
+     * Describes the job in a stable text form without the file descriptors and
+     * the addresses that change from run to run. It is for comparing the
+     * command streams with the golden files.
+     */
+    void dump(std::string &out) const;
+};
+
+/*
+ * Emulates /dev/g2d for running libacryl without a G2D device.
+ *
+ * G2D_IOC_PROCESS and G2D_IOC_COMPAT_PROCESS decode the command lists of the task
+ * into a G2DEmulatedJob and validate it against the constraints of the uapi. The
+ * invalid tasks fail with EINVAL like the driver does. The valid tasks are
+ * rendered on the CPU if the images are uncompressed 32-bit RGB without rotation.
+ * Otherwise only the job description is kept.
+ *
+ * The task is completed before the ioctl returns. So the release fences are
+ * -1 which means 'already signaled'.
+ */
+class G2DEmulator: public AcrylicDeviceBackend {
+public:
+    G2DEmulator(bool render = true);
+    virtual ~G2DEmulator() { }
+    virtual int ioctl(int cmd, void *arg);
+
+    // the last job processed successfully
+    G2DEmulatedJob getLastJob();
+    unsigned int getJobCount();
+private:
+    int process(g2d_task &task);
+    bool decode(g2d_task &task, G2DEmulatedJob &job);
+    bool validateImage(const G2DEmulatedImage &image, bool target);
+    bool validateSource(const G2DEmulatedImage &source, const G2DEmulatedImage &target);
+    bool render(G2DEmulatedJob &job);
+
+    std::mutex mMutex;
+    bool mRender;
+    int32_t mPriority;
+    G2DEmulatedJob mLastJob;
+    unsigned int mJobCount;
+};
+
+#endif //__HARDWARE_EXYNOS_ACRYLIC_G2D_EMULATOR_H__
@@ -53,7 +53,7 @@ bool AcrylicCanvas::setImageDimension(int32_t width, int32_t height)
         return false;
     }
 
-    unset(SETTING_DIMENSION);
+    unset(SETTING_DIMENSION | SETTING_VALIDATED);
 
     const HW2DCapability &cap = getCompositor()->getCapabilities();
 
@@ -110,7 +110,7 @@ bool AcrylicCanvas::setImageBuffer(int a, int r, int g, int b, uint32_t attr)
     mMemoryType = MT_EMPTY;
     mNumBuffers = 0;
 
-    mAttributes = (attr & ATTR_ALL_MASK) | ATTR_SOLIDCOLOR;
+    setAttributes((attr & ATTR_ALL_MASK) | ATTR_SOLIDCOLOR);
 
     set(SETTING_BUFFER | SETTING_BUFFER_MODIFIED);
 
@@ -168,7 +168,7 @@ bool AcrylicCanvas::setImageBuffer(int fd[MAX_HW2D_PLANES], size_t len[MAX_HW2D_
     mMemoryType = MT_DMABUF;
     mNumBuffers = num_buffers;
 
-    mAttributes = attr & ATTR_ALL_MASK;
+    setAttributes(attr & ATTR_ALL_MASK);
     ALOGD_TEST("Configured buffer: fence %d, type %d, count %d, attr %#x (type: %s)",
                mFence, mMemoryType, mNumBuffers, mAttributes, canvasTypeName(mCanvasType));
 
@@ -220,7 +220,7 @@ bool AcrylicCanvas::setImageBuffer(void *addr[MAX_HW2D_PLANES], size_t len[MAX_H
     mMemoryType = MT_USERPTR;
     mNumBuffers = num_buffers;
 
-    mAttributes = attr & ATTR_ALL_MASK;
+    setAttributes(attr & ATTR_ALL_MASK);
 
     ALOGD_TEST("Configured buffer: fence %d, type %d, count %d, attr %#x (type: %s)",
                mFence, mMemoryType, mNumBuffers, mAttributes, canvasTypeName(mCanvasType));
@@ -249,7 +249,7 @@ bool AcrylicCanvas::setImageOTFBuffer(uint32_t attr)
     mMemoryType = MT_EMPTY;
     mNumBuffers = 0;
 
-    mAttributes = (attr & ATTR_ALL_MASK) | ATTR_OTF;
+    setAttributes((attr & ATTR_ALL_MASK) | ATTR_OTF);
 
     set(SETTING_BUFFER | SETTING_BUFFER_MODIFIED);
 
@@ -301,8 +301,9 @@ void AcrylicCanvas::setFence(int fence)
 }
 
 AcrylicLayer::AcrylicLayer(Acrylic *compositor)
-    : AcrylicCanvas(compositor), mTransitData(nullptr), mBlendingMode(HWC_BLENDING_NONE),
-      mTransform(0), mZOrder(0), mMaxLuminance(100), mMinLuminance(0), mPlaneAlpha(255)
+    : AcrylicCanvas(compositor), mTransitData(nullptr), mLayerData(nullptr), mLayerDataLen(0),
+      mBlendingMode(HWC_BLENDING_NONE), mTransform(0), mZOrder(0), mCompositAttr(0),
+      mMaxLuminance(100), mMinLuminance(0), mPlaneAlpha(255), mLayerHDR(false)
 {
     // Default settings:
     // - Bleding mode: SRC_OVER
@@ -358,6 +359,9 @@ bool AcrylicLayer::setCompositMode(uint32_t mode, uint8_t alpha, int z_order)
         return false;
     }
 
+    if (mPlaneAlpha != alpha)
+        unset(SETTING_VALIDATED);
+
     mBlendingMode = mode;
 
     mZOrder = z_order;
@@ -455,6 +459,10 @@ bool AcrylicLayer::setCompositArea(hwc_rect_t &src_area, hwc_rect_t &out_area, u
         }
     }
 
+    if ((mTargetRect != out_area) || (mImageRect != src_area) ||
+            (mTransform != transform) || (mCompositAttr != (attr & ATTR_ALL_MASK)))
+        unset(SETTING_VALIDATED);
+
     mTargetRect.pos.hori = static_cast<int16_t>(out_area.left);
     mTargetRect.pos.vert = static_cast<int16_t>(out_area.top);
     mTargetRect.size.hori = static_cast<int16_t>(get_width(out_area));
@@ -551,4 +559,6 @@ void AcrylicLayer::importLayer(AcrylicLayer &other, bool inherit_transform)
     mImageRect = other.mImageRect;
     if (inherit_transform)
         mTransform = other.mTransform;
+
+    unset(SETTING_VALIDATED);
 }
@@ -472,12 +472,15 @@ public:
      *                            it is not applied to HW yet.
      * - SETTING_DIMENSION_MODIFIED: Image dimension information is configured by users
      *                               and it is not applied to HW yet.
+     * - SETTING_VALIDATED: The settings are validated by Acrylic and none of the settings
+     *                      that the validation depends on has changed since then.
      */
     enum setting_check_t {
         SETTING_TYPE = 1,
         SETTING_BUFFER = 2,
         SETTING_DIMENSION = 4,
         SETTING_MASK = SETTING_TYPE | SETTING_BUFFER | SETTING_DIMENSION,
+        SETTING_VALIDATED = 8,
         SETTING_TYPE_MODIFIED = 16,
         SETTING_BUFFER_MODIFIED = 32,
         SETTING_DIMENSION_MODIFIED = 64,
@@ -678,6 +681,12 @@ protected:
 
     void unset(uint32_t flag) { mSettingFlags &= ~flag; }
     void set(uint32_t flag) { mSettingFlags |= flag; }
+    void setAttributes(uint32_t attr)
+    {
+        if (mAttributes != attr)
+            unset(SETTING_VALIDATED);
+        mAttributes = attr;
+    }
 private:
     /*
      * called when Acrylic is being destroyed to inform AcrylicCanvas
@@ -1075,6 +1084,26 @@ public:
     {
         mHasBackgroundColor = false;
     }
+    /*
+     * Restrict the region of the target image written by execute() to @area.
+     * The pixels out of @area keep their values, including the ones that would
+     * be filled with the default color. It is for updating the region changed
+     * since the target image was composited last. The layers entirely out of
+     * @area are not composited. If the composition of @area fails, the entire
+     * target image is composited and the clipping area is cancelled. The
+     * implementations of Acrylic that do not support the clipping composite
+     * the entire target image as before. The configured area is effective
+     * until clearCanvasClip() is called.
+     */
+    bool setCanvasClip(hwc_rect_t &area);
+    /*
+     * Cancel the configured clipping area.
+     */
+    void clearCanvasClip()
+    {
+        mHasCanvasClip = false;
+    }
+    bool hasCanvasClip() const { return mHasCanvasClip; }
     /*
      * Configures cofficients the tone mapper if the user of Acrylic wants to
      * overrides the default coefficients of the tone mapper for HDR display.
@@ -1207,6 +1236,12 @@ protected:
         *alpha = mBackgroundColor.A;
     }
     bool hasBackgroundColor() { return mHasBackgroundColor; }
+    /*
+     * The clipping area limited to the dimension of the target image.
+     * Returns false if no clipping area is configured or the target image is
+     * entirely in the clipping area.
+     */
+    bool getCanvasClip(hw2d_rect_t &rect);
     uint16_t getMaxTargetDisplayLuminance() { return mMaxTargetLuminance; }
     uint16_t getMinTargetDisplayLuminance() { return mMinTargetLuminance; }
     void *getTargetDisplayInfo() { return mTargetDisplayInfo; }
@@ -1220,6 +1255,8 @@ private:
         uint16_t A;
     } mBackgroundColor;
     bool mHasBackgroundColor;
+    hwc_rect_t mCanvasClip;
+    bool mHasCanvasClip;
     uint16_t mMaxTargetLuminance;
     uint16_t mMinTargetLuminance;
     void *mTargetDisplayInfo;
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <sys/ioctl.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+#include "acrylic_g2d.h"
+#include "acrylic_g2d_emulator.h"
+#include "acrylic_test_common.h"
+
+namespace {
+
+constexpr int32_t kWidth = 256;
+constexpr int32_t kHeight = 256;
+
+/*
+ * Fails the tasks that do not write the entire target if @mRejectClipped is set
+ * like a G2D that does not support the clipping of the target.
+ */
+class UnclippedG2DEmulator: public G2DEmulator {
+public:
+    virtual int ioctl(int cmd, void *arg)
+    {
+        if (mRejectClipped && (static_cast<unsigned int>(cmd) == G2D_IOC_PROCESS)) {
+            const uint32_t *cmds = static_cast<g2d_task *>(arg)->commands.target;
+            if ((cmds[G2DSFR_IMG_LEFT] != 0) || (cmds[G2DSFR_IMG_TOP] != 0) ||
+                    (cmds[G2DSFR_IMG_RIGHT] != cmds[G2DSFR_IMG_WIDTH]) ||
+                    (cmds[G2DSFR_IMG_BOTTOM] != cmds[G2DSFR_IMG_HEIGHT])) {
+                mRejected++;
+                errno = EINVAL;
+                return -1;
+            }
+        }
+
+        return G2DEmulator::ioctl(cmd, arg);
+    }
+
+    bool mRejectClipped = false;
+    unsigned int mRejected = 0;
+};
+
+/*
+ * A screen of an opaque background, a translucent layer at the top and a layer
+ * at the bottom. Only the bottom layer changes from frame to frame.
+ */
+class AcrylicClipTest: public testing::Test {
+protected:
+    void SetUp() override
+    {
+        mEmulator = new UnclippedG2DEmulator();
+        mCompositor = std::make_unique<AcrylicCompositorG2D>(gTestCapability, true, mEmulator);
+        ASSERT_TRUE(mBackground.valid() && mTop.valid() && mBottom.valid());
+        ASSERT_TRUE(mTarget.valid() && mReference.valid());
+
+        mBackground.pattern(0);
+        mTop.fill(0x80402010); // premultiplied by 0x80
+        mBottom.pattern(0x55);
+
+        for (auto &layer : mLayers) {
+            layer = mCompositor->createLayer();
+            ASSERT_NE(nullptr, layer);
+        }
+
+        hwc_rect_t full = {0, 0, kWidth, kHeight};
+        ASSERT_TRUE(mBackground.setLayer(*mLayers[0], full));
+        ASSERT_TRUE(mLayers[0]->setCompositMode(HWC_BLENDING_PREMULT, 0xFF, 0));
+        ASSERT_TRUE(mTop.setLayer(*mLayers[1], mTopWindow));
+        ASSERT_TRUE(mLayers[1]->setCompositMode(HWC_BLENDING_PREMULT, 0xFF, 1));
+        ASSERT_TRUE(mBottom.setLayer(*mLayers[2], mBottomWindow));
+        ASSERT_TRUE(mLayers[2]->setCompositMode(HWC_BLENDING_PREMULT, 0xC0, 2));
+    }
+
+    void TearDown() override
+    {
+        for (auto &layer : mLayers)
+            delete layer;
+    }
+
+    bool composite(TestImage &target, hwc_rect_t *clip, bool fallback = false)
+    {
+        int fence = -1;
+
+        if (!target.setCanvasOf(*mCompositor))
+            return false;
+
+        if (clip)
+            mCompositor->setCanvasClip(*clip);
+        else
+            mCompositor->clearCanvasClip();
+
+        mEmulator->mRejectClipped = fallback;
+        mEmulator->mRejected = 0;
+
+        if (!mCompositor->execute(&fence, 1))
+            return false;
+        if (fence >= 0)
+            close(fence);
+
+        // the pixels are compared only if the emulator wrote them
+        return mEmulator->getLastJob().rendered;
+    }
+
+    UnclippedG2DEmulator *mEmulator = nullptr; // owned by mCompositor
+    std::unique_ptr<AcrylicCompositorG2D> mCompositor;
+    AcrylicLayer *mLayers[3] = {};
+    hwc_rect_t mTopWindow = {0, 0, kWidth, 48};
+    hwc_rect_t mBottomWindow = {32, 160, 224, 240};
+
+    TestImage mBackground{kWidth, kHeight};
+    TestImage mTop{kWidth, 48};
+    TestImage mBottom{kWidth, kHeight};
+    TestImage mTarget{kWidth, kHeight};
+    TestImage mReference{kWidth, kHeight};
+};
+
+TEST_F(AcrylicClipTest, ClippedCompositionEqualsFullComposition)
+{
+    mTarget.fill(0);
+    ASSERT_TRUE(composite(mTarget, NULL));
+
+    mBottom.pattern(0xAA);
+    mReference.fill(0);
+    ASSERT_TRUE(composite(mReference, NULL));
+    ASSERT_FALSE(mTarget.equals(mReference));
+
+    ASSERT_TRUE(composite(mTarget, &mBottomWindow));
+    EXPECT_TRUE(mCompositor->hasCanvasClip());
+    EXPECT_TRUE(mTarget.equals(mReference));
+}
+
+TEST_F(AcrylicClipTest, LayersOutOfClipAreLeftOut)
+{
+    mTarget.fill(0);
+    ASSERT_TRUE(composite(mTarget, &mBottomWindow));
+
+    G2DEmulatedJob job = mEmulator->getLastJob();
+    // the top layer does not intersect the clipping area
+    ASSERT_EQ(2u, job.sources.size());
+    EXPECT_EQ(static_cast<uint32_t>(mBottomWindow.left),
+              job.sources[1].commands[G2DSFR_SRC_DSTLEFT]);
+    EXPECT_EQ(static_cast<uint32_t>(mBottomWindow.top), job.target.commands[G2DSFR_IMG_TOP]);
+
+    // the pixels of the top layer are untouched
+    for (int32_t i = 0; i < kWidth * mTopWindow.bottom; i++)
+        ASSERT_EQ(0u, mTarget.mPixels[i]) << "pixel " << i;
+}
+
+TEST_F(AcrylicClipTest, FailedClippedCompositionIsCompositedInFull)
+{
+    mTarget.fill(0);
+    ASSERT_TRUE(composite(mTarget, NULL));
+
+    mBottom.pattern(0xAA);
+    mReference.fill(0);
+    ASSERT_TRUE(composite(mReference, NULL));
+
+    ASSERT_TRUE(composite(mTarget, &mBottomWindow, true));
+    EXPECT_EQ(1u, mEmulator->mRejected);
+    // the caller should learn that the entire target is written
+    EXPECT_FALSE(mCompositor->hasCanvasClip());
+    EXPECT_TRUE(mTarget.equals(mReference));
+}
+
+TEST_F(AcrylicClipTest, ClipOutOfAllLayers)
+{
+    hwc_rect_t full = {0, 0, kWidth, 48};
+    hwc_rect_t clip = {0, 200, 16, 240};
+
+    // only the top layer is left which does not intersect the clipping area
+    mLayers[0]->setCompositArea(full, mTopWindow);
+    mLayers[2]->setCompositArea(full, mTopWindow);
+    mTarget.fill(0);
+    ASSERT_TRUE(composite(mTarget, &clip));
+    EXPECT_EQ(0u, mEmulator->getLastJob().target.commands[G2DSFR_IMG_TOP]);
+}
+
+TEST_F(AcrylicClipTest, ClippedCompositionBenchmark)
+{
+    constexpr int kNumFrames = 50;
+
+    mTarget.fill(0);
+    ASSERT_TRUE(composite(mTarget, NULL));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumFrames; i++) {
+        mBottom.pattern(i);
+        ASSERT_TRUE(composite(mReference, NULL));
+    }
+    auto full = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count() / kNumFrames;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumFrames; i++) {
+        mBottom.pattern(i);
+        ASSERT_TRUE(composite(mTarget, &mBottomWindow));
+    }
+    auto clipped = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count() / kNumFrames;
+
+    EXPECT_TRUE(mTarget.equals(mReference));
+    std::cout << "full composition " << full << " us, clipped composition " << clipped
+              << " us per frame" << std::endl;
+    RecordProperty("FullUs", static_cast<int>(full));
+    RecordProperty("ClippedUs", static_cast<int>(clipped));
+}
+
+} // namespace
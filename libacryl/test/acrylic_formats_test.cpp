@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include <exynos_format.h>
+
+#include "acrylic_g2d.h"
+#include "acrylic_g2d_emulator.h"
+#include "acrylic_internal.h"
+#include "acrylic_test_common.h"
+
+namespace {
+
+/*
+ * The lookups of the format table by the index of the HAL pixel formats.
+ */
+TEST(AcrylicFormatsTest, FindsTheDescriptionOfFormats)
+{
+    EXPECT_EQ(1U, halfmt_buf_count(HAL_PIXEL_FORMAT_RGBA_8888));
+    EXPECT_EQ(1U, halfmt_plane_count(HAL_PIXEL_FORMAT_RGBA_8888));
+    EXPECT_EQ(32U, halfmt_bpp(HAL_PIXEL_FORMAT_RGBA_8888));
+    EXPECT_EQ(0x11, halfmt_chroma_subsampling(HAL_PIXEL_FORMAT_RGBA_8888));
+    EXPECT_EQ(64U * 32U * 4U, halfmt_plane_length(HAL_PIXEL_FORMAT_RGBA_8888, 0, 64, 32));
+
+    EXPECT_EQ(16U, halfmt_bpp(HAL_PIXEL_FORMAT_RGB_565));
+
+    EXPECT_EQ(1U, halfmt_buf_count(HAL_PIXEL_FORMAT_YCrCb_420_SP));
+    EXPECT_EQ(2U, halfmt_plane_count(HAL_PIXEL_FORMAT_YCrCb_420_SP));
+    EXPECT_EQ(12U, halfmt_bpp(HAL_PIXEL_FORMAT_YCrCb_420_SP));
+    EXPECT_EQ(0x22, halfmt_chroma_subsampling(HAL_PIXEL_FORMAT_YCrCb_420_SP));
+
+    EXPECT_EQ(3U, halfmt_buf_count(HAL_PIXEL_FORMAT_EXYNOS_YV12_M));
+    EXPECT_EQ(halfmt_plane_count(HAL_PIXEL_FORMAT_YV12),
+              halfmt_plane_count(HAL_PIXEL_FORMAT_EXYNOS_YV12_M));
+    EXPECT_EQ(static_cast<uint32_t>(HAL_PIXEL_FORMAT_YV12),
+              find_format_equivalent(HAL_PIXEL_FORMAT_EXYNOS_YV12_M));
+    EXPECT_EQ(64U * 32U, halfmt_plane_length(HAL_PIXEL_FORMAT_EXYNOS_YV12_M, 0, 64, 32));
+    EXPECT_EQ(64U * 32U / 4U, halfmt_plane_length(HAL_PIXEL_FORMAT_EXYNOS_YV12_M, 1, 64, 32));
+
+    EXPECT_EQ(2U, halfmt_buf_count(HAL_PIXEL_FORMAT_EXYNOS_YCrCb_420_SP_M));
+
+    // the last entry of the table
+    EXPECT_EQ(1U, halfmt_buf_count(HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L80));
+    EXPECT_EQ(24U, halfmt_bpp(HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_SPN_10B_SBWC_L80));
+}
+
+TEST(AcrylicFormatsTest, UnknownFormatIsNotFound)
+{
+    const uint32_t unknown = 0x7FFFFFFF;
+
+    EXPECT_EQ(0U, halfmt_buf_count(unknown));
+    EXPECT_EQ(0U, halfmt_plane_count(unknown));
+    EXPECT_EQ(0U, halfmt_bpp(unknown));
+    EXPECT_EQ(0U, halfmt_plane_length(unknown, 0, 64, 32));
+}
+
+uint32_t gFormatTestFormats[] = {
+    HAL_PIXEL_FORMAT_RGBA_8888,
+    HAL_PIXEL_FORMAT_RGB_565,
+    HAL_PIXEL_FORMAT_YCrCb_420_SP,
+    HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_P,
+};
+
+stHW2DCapability makeFormatTestCap()
+{
+    stHW2DCapability cap = gTestCap;
+
+    cap.num_formats = sizeof(gFormatTestFormats) / sizeof(gFormatTestFormats[0]);
+    cap.pixformats = gFormatTestFormats;
+
+    return cap;
+}
+
+const stHW2DCapability gFormatTestCap = makeFormatTestCap();
+const HW2DCapability gFormatTestCapability(gFormatTestCap);
+
+struct G2DFormat {
+    uint32_t halfmt;
+    uint32_t legacy;
+    uint32_t current;
+};
+
+/*
+ * The color mode of the G2D which the compositor finds for the HAL pixel format
+ * in the table of the color mode of the G2D.
+ */
+class AcrylicG2DFormatTest: public testing::TestWithParam<bool> {
+protected:
+    uint32_t findColorMode(uint32_t format)
+    {
+        G2DEmulator *emulator = new G2DEmulator(false);
+        AcrylicCompositorG2D compositor(gFormatTestCapability, GetParam(), emulator);
+        TestImage target(64, 64);
+        TestImage source(64, 64, format);
+        hwc_rect_t window = {0, 0, 64, 64};
+        int fence = -1;
+
+        EXPECT_TRUE(target.valid() && source.valid());
+        EXPECT_TRUE(target.setCanvasOf(compositor));
+
+        std::unique_ptr<AcrylicLayer> layer(compositor.createLayer());
+        EXPECT_NE(nullptr, layer);
+        // a copy of RGBA_8888 forces the alpha of the color mode to one
+        if (!layer || !source.setLayer(*layer, window) ||
+                !layer->setCompositMode(HWC_BLENDING_PREMULT, 0xFF, 0))
+            return 0;
+
+        EXPECT_TRUE(compositor.execute(&fence, 1));
+        if (fence >= 0)
+            close(fence);
+        if (emulator->getJobCount() != 1)
+            return 0;
+
+        G2DEmulatedJob job = emulator->getLastJob();
+        EXPECT_EQ(static_cast<uint32_t>(G2D_FMT_ABGR8888), job.target.commands[G2DSFR_IMG_COLORMODE]);
+        EXPECT_EQ(1U, job.sources.size());
+
+        return job.sources.empty() ? 0 : job.sources[0].commands[G2DSFR_IMG_COLORMODE];
+    }
+};
+
+TEST_P(AcrylicG2DFormatTest, FindsTheColorMode)
+{
+    const G2DFormat formats[] = {
+        {HAL_PIXEL_FORMAT_RGBA_8888, G2D_FMT_ABGR8888, G2D_FMT_ABGR8888},
+        {HAL_PIXEL_FORMAT_RGB_565, G2D_FMT_RGB565, G2D_FMT_RGB565},
+        {HAL_PIXEL_FORMAT_YCrCb_420_SP, G2D_FMT_NV21, G2D_FMT_NV21},
+        // the color mode that differs between the tables
+        {HAL_PIXEL_FORMAT_EXYNOS_YCbCr_420_P, G2D_FMT_YV12, G2D_FMT_YUV420P},
+    };
+
+    for (auto &fmt : formats)
+        EXPECT_EQ(GetParam() ? fmt.current : fmt.legacy, findColorMode(fmt.halfmt))
+                << "format " << fmt.halfmt;
+}
+
+INSTANTIATE_TEST_SUITE_P(ColorMode, AcrylicG2DFormatTest, testing::Bool(),
+                         [](const testing::TestParamInfo<bool> &info) {
+                             return info.param ? "New" : "Legacy";
+                         });
+
+} // namespace
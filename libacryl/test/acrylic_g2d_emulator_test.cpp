@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <limits.h>
+#include <sys/ioctl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "acrylic_g2d.h"
+#include "acrylic_g2d_emulator.h"
+#include "acrylic_test_common.h"
+
+namespace {
+
+constexpr int32_t kWidth = 64;
+constexpr int32_t kHeight = 64;
+
+/*
+ * The golden files are installed in golden/ next to the test binary. Setting
+ * LIBACRYL_UPDATE_GOLDEN to a directory writes the command streams there
+ * instead of comparing them.
+ */
+std::string readGolden(const std::string &name)
+{
+    char exe[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0)
+        return "";
+    exe[len] = '\0';
+
+    std::string path(exe);
+    path = path.substr(0, path.rfind('/')) + "/golden/" + name + ".txt";
+
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+
+    return content.str();
+}
+
+void expectGolden(const std::string &name, const G2DEmulatedJob &job)
+{
+    std::string actual;
+    job.dump(actual);
+
+    const char *update = getenv("LIBACRYL_UPDATE_GOLDEN");
+    if (update) {
+        std::ofstream(std::string(update) + "/" + name + ".txt") << actual;
+        return;
+    }
+
+    std::string golden = readGolden(name);
+    ASSERT_FALSE(golden.empty()) << "No golden file of " << name;
+    EXPECT_EQ(golden, actual) << "The command stream of " << name << " changed";
+}
+
+/*
+ * The command streams of the common layer configurations. The emulator does
+ * not render, so only the commands are checked.
+ */
+class G2DEmulatorTest: public testing::Test {
+protected:
+    void SetUp() override
+    {
+        mEmulator = new G2DEmulator(false);
+        mCompositor = std::make_unique<AcrylicCompositorG2D>(gTestCapability, true, mEmulator);
+        ASSERT_TRUE(mTarget.valid());
+        ASSERT_TRUE(mTarget.setCanvasOf(*mCompositor));
+    }
+
+    void TearDown() override
+    {
+        for (auto layer : mLayers)
+            delete layer;
+    }
+
+    AcrylicLayer *addLayer(TestImage &image, hwc_rect_t window, uint32_t mode = HWC_BLENDING_PREMULT,
+                           uint8_t alpha = 0xFF, uint32_t transform = 0)
+    {
+        AcrylicLayer *layer = mCompositor->createLayer();
+        if (!layer)
+            return NULL;
+
+        mLayers.push_back(layer);
+        if (!image.valid() || !image.setLayer(*layer, window, transform) ||
+                !layer->setCompositMode(mode, alpha, static_cast<int>(mLayers.size())))
+            return NULL;
+
+        return layer;
+    }
+
+    bool execute()
+    {
+        int fence = -1;
+
+        if (!mCompositor->execute(&fence, 1))
+            return false;
+        if (fence >= 0)
+            close(fence);
+
+        return true;
+    }
+
+    G2DEmulator *mEmulator = nullptr; // owned by mCompositor
+    std::unique_ptr<AcrylicCompositorG2D> mCompositor;
+    std::vector<AcrylicLayer *> mLayers;
+    TestImage mTarget{kWidth, kHeight};
+};
+
+TEST_F(G2DEmulatorTest, GoldenCopy)
+{
+    TestImage image(kWidth, kHeight);
+
+    ASSERT_NE(nullptr, addLayer(image, {0, 0, kWidth, kHeight}, HWC_BLENDING_NONE));
+    ASSERT_TRUE(execute());
+    expectGolden("copy", mEmulator->getLastJob());
+}
+
+TEST_F(G2DEmulatorTest, GoldenBlendWithPlaneAlpha)
+{
+    TestImage background(kWidth, kHeight);
+    TestImage overlay(32, 16);
+
+    ASSERT_NE(nullptr, addLayer(background, {0, 0, kWidth, kHeight}, HWC_BLENDING_NONE));
+    ASSERT_NE(nullptr, addLayer(overlay, {8, 40, 40, 56}, HWC_BLENDING_PREMULT, 0x80));
+    ASSERT_NE(nullptr, addLayer(overlay, {16, 0, 48, 16}, HWC_BLENDING_COVERAGE, 0xC0));
+    ASSERT_TRUE(execute());
+    expectGolden("blend_plane_alpha", mEmulator->getLastJob());
+}
+
+TEST_F(G2DEmulatorTest, GoldenScaling)
+{
+    TestImage large(kWidth * 2, kHeight * 2);
+    TestImage small(kWidth / 4, kHeight / 4);
+
+    ASSERT_NE(nullptr, addLayer(large, {0, 0, kWidth, kHeight}));
+    ASSERT_NE(nullptr, addLayer(small, {0, 0, kWidth / 2, kHeight / 2}));
+    ASSERT_TRUE(execute());
+    expectGolden("scaling", mEmulator->getLastJob());
+}
+
+TEST_F(G2DEmulatorTest, GoldenRotation)
+{
+    TestImage image(kHeight / 2, kWidth);
+
+    ASSERT_NE(nullptr, addLayer(image, {0, 0, kWidth, kHeight / 2}, HWC_BLENDING_PREMULT, 0xFF,
+                                HAL_TRANSFORM_ROT_90));
+    ASSERT_NE(nullptr, addLayer(image, {0, kHeight / 2, kWidth, kHeight}, HWC_BLENDING_PREMULT,
+                                0xFF, HAL_TRANSFORM_FLIP_H));
+    ASSERT_TRUE(execute());
+    expectGolden("rotation", mEmulator->getLastJob());
+}
+
+TEST_F(G2DEmulatorTest, GoldenYCbCrToRGB)
+{
+    TestImage video(kWidth, kHeight, HAL_PIXEL_FORMAT_YCrCb_420_SP,
+                    HAL_DATASPACE_STANDARD_BT709 | HAL_DATASPACE_RANGE_LIMITED);
+
+    ASSERT_NE(nullptr, addLayer(video, {0, 0, kWidth, kHeight}, HWC_BLENDING_NONE));
+    ASSERT_TRUE(execute());
+    expectGolden("ycbcr_to_rgb", mEmulator->getLastJob());
+}
+
+TEST_F(G2DEmulatorTest, GoldenBackgroundColor)
+{
+    TestImage image(kWidth / 2, kHeight / 2, HAL_PIXEL_FORMAT_RGB_565);
+
+    mCompositor->setDefaultColor(0x1000, 0x2000, 0x3000, 0xFFFF);
+    ASSERT_NE(nullptr, addLayer(image, {16, 16, 48, 48}));
+    ASSERT_TRUE(execute());
+    expectGolden("background_color", mEmulator->getLastJob());
+}
+
+TEST_F(G2DEmulatorTest, GoldenClipping)
+{
+    TestImage background(kWidth, kHeight);
+    TestImage overlay(32, 16);
+    hwc_rect_t clip = {0, 32, kWidth, kHeight};
+
+    ASSERT_NE(nullptr, addLayer(background, {0, 0, kWidth, kHeight}, HWC_BLENDING_NONE));
+    ASSERT_NE(nullptr, addLayer(overlay, {8, 0, 40, 16}));
+    ASSERT_NE(nullptr, addLayer(overlay, {8, 40, 40, 56}));
+    ASSERT_TRUE(mCompositor->setCanvasClip(clip));
+    ASSERT_TRUE(execute());
+    expectGolden("clipping", mEmulator->getLastJob());
+}
+
+/*
+ * A task of an RGBA_8888 target written directly to the emulator. Each test
+ * breaks one thing of it.
+ */
+class G2DEmulatorValidationTest: public testing::Test {
+protected:
+    void SetUp() override
+    {
+        memset(&mTask, 0, sizeof(mTask));
+        memset(mLayers, 0, sizeof(mLayers));
+
+        mLayers[0].buffer_type = G2D_BUFTYPE_DMABUF;
+        mLayers[0].num_buffers = 1;
+        mLayers[0].buffer[0].dmabuf.fd = memfd_create("target", 0);
+        mLayers[0].buffer[0].length = kWidth * kHeight * 4;
+        mTarget[G2DSFR_IMG_STRIDE] = kWidth * 4;
+        mTarget[G2DSFR_IMG_COLORMODE] = G2D_FMT_ABGR8888;
+        mTarget[G2DSFR_IMG_RIGHT] = mTarget[G2DSFR_IMG_WIDTH] = kWidth;
+        mTarget[G2DSFR_IMG_BOTTOM] = mTarget[G2DSFR_IMG_HEIGHT] = kHeight;
+
+        mLayers[1].buffer_type = G2D_BUFTYPE_DMABUF;
+        mLayers[1].num_buffers = 1;
+        mLayers[1].buffer[0].dmabuf.fd = memfd_create("source", 0);
+        mLayers[1].buffer[0].length = kWidth * kHeight * 4;
+        mSource[G2DSFR_IMG_STRIDE] = kWidth * 4;
+        mSource[G2DSFR_IMG_COLORMODE] = G2D_FMT_ABGR8888;
+        mSource[G2DSFR_IMG_RIGHT] = mSource[G2DSFR_IMG_WIDTH] = kWidth;
+        mSource[G2DSFR_IMG_BOTTOM] = mSource[G2DSFR_IMG_HEIGHT] = kHeight;
+        mSource[G2DSFR_SRC_COMMAND] = G2D_LAYERCMD_VALID;
+        mSource[G2DSFR_SRC_DSTRIGHT] = kWidth;
+        mSource[G2DSFR_SRC_DSTBOTTOM] = kHeight;
+
+        mTask.target = mLayers[0];
+        mTask.source = &mLayers[1];
+        mTask.num_source = 1;
+        mTask.commands.target = mTarget;
+        mTask.commands.source[0] = mSource;
+    }
+
+    void TearDown() override
+    {
+        close(mLayers[0].buffer[0].dmabuf.fd);
+        close(mLayers[1].buffer[0].dmabuf.fd);
+    }
+
+    // the YCbCr source of @planes buffers in 4:2:0 of kWidth x kHeight
+    void setYCbCrSource(uint32_t colormode, unsigned int planes)
+    {
+        mSource[G2DSFR_IMG_COLORMODE] = colormode;
+        mSource[G2DSFR_IMG_STRIDE] = 0;
+        mLayers[1].num_buffers = planes;
+        if (planes == 1) {
+            mLayers[1].buffer[0].length = kWidth * kHeight * 3 / 2;
+        } else {
+            mLayers[1].buffer[0].length = kWidth * kHeight;
+            mLayers[1].buffer[1].dmabuf.fd = mLayers[1].buffer[0].dmabuf.fd;
+            mLayers[1].buffer[1].length = kWidth * kHeight / 2;
+        }
+    }
+
+    int process()
+    {
+        mTask.target = mLayers[0];
+
+        return mEmulator.ioctl(G2D_IOC_PROCESS, &mTask);
+    }
+
+    G2DEmulator mEmulator{false};
+    g2d_task mTask;
+    g2d_layer mLayers[2];
+    uint32_t mTarget[G2DSFR_DST_FIELD_COUNT] = {};
+    uint32_t mSource[G2DSFR_SRC_FIELD_COUNT] = {};
+};
+
+TEST_F(G2DEmulatorValidationTest, ValidTask)
+{
+    EXPECT_EQ(0, process());
+    EXPECT_EQ(1u, mEmulator.getJobCount());
+}
+
+TEST_F(G2DEmulatorValidationTest, TargetBufferShorterThanRect)
+{
+    mLayers[0].buffer[0].length = kWidth * kHeight * 4 - 1;
+    EXPECT_EQ(-1, process());
+    EXPECT_EQ(EINVAL, errno);
+
+    // only the rows to the bottom of the rect should be in the buffer
+    mTarget[G2DSFR_IMG_BOTTOM] = kHeight - 1;
+    mSource[G2DSFR_SRC_DSTBOTTOM] = kHeight - 1;
+    EXPECT_EQ(0, process());
+}
+
+TEST_F(G2DEmulatorValidationTest, SourceBufferShorterThanRect)
+{
+    mLayers[1].buffer[0].length = kWidth * 4 * (kHeight / 2);
+    EXPECT_EQ(-1, process());
+
+    mSource[G2DSFR_IMG_TOP] = 0;
+    mSource[G2DSFR_IMG_BOTTOM] = kHeight / 2;
+    EXPECT_EQ(0, process());
+}
+
+TEST_F(G2DEmulatorValidationTest, YCbCrSingleBuffer)
+{
+    setYCbCrSource(G2D_FMT_NV12, 1);
+    EXPECT_EQ(0, process());
+
+    // the chroma plane follows kHeight rows of the luma plane
+    mLayers[1].buffer[0].length--;
+    EXPECT_EQ(-1, process());
+}
+
+TEST_F(G2DEmulatorValidationTest, YCbCrMultiBuffers)
+{
+    setYCbCrSource(G2D_FMT_NV21, 2);
+    EXPECT_EQ(0, process());
+
+    mLayers[1].buffer[1].length--;
+    EXPECT_EQ(-1, process());
+
+    mLayers[1].buffer[1].length++;
+    mLayers[1].buffer[0].length--;
+    EXPECT_EQ(-1, process());
+}
+
+TEST_F(G2DEmulatorValidationTest, YCbCr10BitSingleBuffer)
+{
+    setYCbCrSource(G2D_FMT_NV12_P010, 1);
+    EXPECT_EQ(-1, process());
+
+    mLayers[1].buffer[0].length *= 2;
+    EXPECT_EQ(0, process());
+}
+
+TEST_F(G2DEmulatorValidationTest, CompressedImageIsNotBoundByStride)
+{
+    mSource[G2DSFR_IMG_COLORMODE] |= G2D_DATAFORMAT_AFBC;
+    mSource[G2DSFR_IMG_STRIDE] = 0;
+    mLayers[1].buffer[0].length = 1;
+    EXPECT_EQ(0, process());
+}
+
+/*
+ * The throughput of preparing the commands of a task in libacryl. The emulator
+ * decodes and validates the commands without rendering.
+ */
+TEST_F(G2DEmulatorTest, CommandPreparationBenchmark)
+{
+    constexpr int kNumTasks = 2000;
+    TestImage background(kWidth, kHeight);
+    TestImage scaled(kWidth * 2, kHeight * 2);
+    TestImage video(kWidth, kHeight, HAL_PIXEL_FORMAT_YCrCb_420_SP,
+                    HAL_DATASPACE_STANDARD_BT709 | HAL_DATASPACE_RANGE_LIMITED);
+
+    ASSERT_NE(nullptr, addLayer(background, {0, 0, kWidth, kHeight}, HWC_BLENDING_NONE));
+    ASSERT_NE(nullptr, addLayer(scaled, {0, 0, kWidth / 2, kHeight / 2}));
+    ASSERT_NE(nullptr, addLayer(video, {kWidth / 2, kHeight / 2, kWidth, kHeight}));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumTasks; i++)
+        ASSERT_TRUE(execute());
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_EQ(static_cast<unsigned int>(kNumTasks), mEmulator->getJobCount());
+
+    int64_t perTask = elapsed / kNumTasks;
+    std::cout << "command preparation: " << perTask << " ns per task of 3 layers ("
+              << 1000000000LL / std::max<int64_t>(perTask, 1) << " tasks/s)" << std::endl;
+    RecordProperty("NsPerTask", static_cast<int>(perTask));
+}
+
+} // namespace
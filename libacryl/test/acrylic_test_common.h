@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <hardware/exynos/acryl.h>
+
+inline uint32_t gTestFormats[] = {
+    HAL_PIXEL_FORMAT_RGBA_8888,
+    HAL_PIXEL_FORMAT_RGB_565,
+    HAL_PIXEL_FORMAT_YCrCb_420_SP,
+};
+
+inline int gTestDataspaces[] = {
+    HAL_DATASPACE_UNKNOWN,
+    HAL_DATASPACE_STANDARD_BT709 | HAL_DATASPACE_RANGE_LIMITED,
+};
+
+inline const stHW2DCapability gTestCap = {
+    .max_upsampling_num = {8, 8},
+    .max_downsampling_factor = {4, 4},
+    .max_upsizing_num = {8, 8},
+    .max_downsizing_factor = {4, 4},
+    .min_src_dimension = {1, 1},
+    .max_src_dimension = {8192, 8192},
+    .min_dst_dimension = {1, 1},
+    .max_dst_dimension = {8192, 8192},
+    .min_pix_align = {1, 1},
+    .rescaling_count = 0,
+    .compositing_mode = HW2DCapability::BLEND_NONE | HW2DCapability::BLEND_SRC_COPY |
+                        HW2DCapability::BLEND_SRC_OVER,
+    .transform_type = HW2DCapability::TRANSFORM_ALL,
+    .auxiliary_feature = HW2DCapability::FEATURE_PLANE_ALPHA | HW2DCapability::FEATURE_SOLIDCOLOR,
+    .num_formats = sizeof(gTestFormats) / sizeof(gTestFormats[0]),
+    .num_dataspaces = sizeof(gTestDataspaces) / sizeof(gTestDataspaces[0]),
+    .max_layers = 4,
+    .pixformats = gTestFormats,
+    .dataspaces = gTestDataspaces,
+    .base_align = 1,
+};
+
+// Acrylic keeps the reference to the capability
+inline const HW2DCapability gTestCapability(gTestCap);
+
+/*
+ * An image in a memfd which is mapped by the G2D emulator like a dmabuf.
+ */
+class TestImage {
+public:
+    TestImage(int32_t width, int32_t height, uint32_t format = HAL_PIXEL_FORMAT_RGBA_8888,
+              int dataspace = HAL_DATASPACE_UNKNOWN)
+        : mWidth(width), mHeight(height), mFormat(format), mDataspace(dataspace)
+    {
+        if (format == HAL_PIXEL_FORMAT_YCrCb_420_SP)
+            mLength = width * height * 3 / 2;
+        else if (format == HAL_PIXEL_FORMAT_RGB_565)
+            mLength = width * height * 2;
+        else
+            mLength = width * height * 4;
+
+        mFd = memfd_create("acrylic_test", 0);
+        if ((mFd >= 0) && (ftruncate(mFd, mLength) == 0))
+            mPixels = static_cast<uint32_t *>(
+                    mmap(NULL, mLength, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0));
+    }
+
+    ~TestImage()
+    {
+        if (mPixels && (mPixels != MAP_FAILED))
+            munmap(mPixels, mLength);
+        if (mFd >= 0)
+            close(mFd);
+    }
+
+    bool valid() const { return (mFd >= 0) && mPixels && (mPixels != MAP_FAILED); }
+
+    void fill(uint32_t color)
+    {
+        for (size_t i = 0; i < mLength / 4; i++)
+            mPixels[i] = color;
+    }
+
+    // a pattern of RGBA_8888 that differs per pixel to catch the misplaced pixels
+    void pattern(uint32_t seed)
+    {
+        for (int32_t y = 0; y < mHeight; y++)
+            for (int32_t x = 0; x < mWidth; x++)
+                mPixels[y * mWidth + x] = 0xFF000000 | ((x * 7 + seed) & 0xFF) |
+                                          (((y * 5 + seed) & 0xFF) << 8) |
+                                          (((x + y + seed) & 0xFF) << 16);
+    }
+
+    bool equals(const TestImage &other) const
+    {
+        return (mLength == other.mLength) && (memcmp(mPixels, other.mPixels, mLength) == 0);
+    }
+
+    bool setCanvasOf(Acrylic &compositor)
+    {
+        int fd[MAX_HW2D_PLANES] = {mFd};
+        size_t len[MAX_HW2D_PLANES] = {mLength};
+
+        return compositor.setCanvasDimension(mWidth, mHeight) &&
+               compositor.setCanvasImageType(mFormat, mDataspace) &&
+               compositor.setCanvasBuffer(fd, len, 1);
+    }
+
+    bool setLayer(AcrylicLayer &layer, hwc_rect_t &window, uint32_t transform = 0)
+    {
+        int fd[MAX_HW2D_PLANES] = {mFd};
+        size_t len[MAX_HW2D_PLANES] = {mLength};
+        hwc_rect_t crop = {0, 0, mWidth, mHeight};
+
+        return layer.setImageDimension(mWidth, mHeight) &&
+               layer.setImageType(mFormat, mDataspace) &&
+               layer.setImageBuffer(fd, len, 1) &&
+               layer.setCompositArea(crop, window, transform);
+    }
+
+    uint32_t *mPixels = NULL;
+private:
+    int32_t mWidth;
+    int32_t mHeight;
+    uint32_t mFormat;
+    int mDataspace;
+    size_t mLength;
+    int mFd = -1;
+};
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+#include "acrylic_g2d.h"
+#include "acrylic_g2d_emulator.h"
+#include "acrylic_test_common.h"
+
+namespace {
+
+constexpr int32_t kWidth = 256;
+constexpr int32_t kHeight = 256;
+
+/*
+ * The layers that are validated by an execution skip the validation of the next
+ * executions until a setting that the validation depends on changes.
+ */
+class AcrylicValidationTest: public testing::Test {
+protected:
+    void SetUp() override
+    {
+        mEmulator = new G2DEmulator(false);
+        mCompositor = std::make_unique<AcrylicCompositorG2D>(gTestCapability, true, mEmulator);
+        ASSERT_TRUE(mTarget.valid() && mBackground.valid() && mOverlay.valid());
+        ASSERT_TRUE(mTarget.setCanvasOf(*mCompositor));
+
+        for (auto &layer : mLayers) {
+            layer = mCompositor->createLayer();
+            ASSERT_NE(nullptr, layer);
+        }
+
+        ASSERT_TRUE(mBackground.setLayer(*mLayers[0], mFull));
+        ASSERT_TRUE(mLayers[0]->setCompositMode(HWC_BLENDING_NONE, 0xFF, 0));
+        ASSERT_TRUE(mOverlay.setLayer(*mLayers[1], mWindow));
+        ASSERT_TRUE(mLayers[1]->setCompositMode(HWC_BLENDING_PREMULT, 0xFF, 1));
+    }
+
+    void TearDown() override
+    {
+        for (auto &layer : mLayers)
+            delete layer;
+    }
+
+    bool execute()
+    {
+        int fence = -1;
+
+        if (!mCompositor->execute(&fence, 1))
+            return false;
+        if (fence >= 0)
+            close(fence);
+
+        return true;
+    }
+
+    static bool isValidated(AcrylicCanvas &canvas)
+    {
+        return !!(canvas.getSettingFlags() & AcrylicCanvas::SETTING_VALIDATED);
+    }
+
+    G2DEmulator *mEmulator = nullptr; // owned by mCompositor
+    std::unique_ptr<AcrylicCompositorG2D> mCompositor;
+    AcrylicLayer *mLayers[2] = {};
+    hwc_rect_t mFull = {0, 0, kWidth, kHeight};
+    hwc_rect_t mWindow = {16, 16, 80, 80};
+
+    TestImage mTarget{kWidth, kHeight};
+    TestImage mBackground{kWidth, kHeight};
+    TestImage mOverlay{64, 64};
+};
+
+TEST_F(AcrylicValidationTest, UnchangedSettingsKeepValidation)
+{
+    EXPECT_FALSE(isValidated(*mLayers[0]));
+    ASSERT_TRUE(execute());
+    EXPECT_TRUE(isValidated(mCompositor->getCanvas()));
+    EXPECT_TRUE(isValidated(*mLayers[0]));
+    EXPECT_TRUE(isValidated(*mLayers[1]));
+
+    // the next frame configures the same layers again
+    ASSERT_TRUE(mTarget.setCanvasOf(*mCompositor));
+    ASSERT_TRUE(mBackground.setLayer(*mLayers[0], mFull));
+    ASSERT_TRUE(mLayers[0]->setCompositMode(HWC_BLENDING_NONE, 0xFF, 0));
+    ASSERT_TRUE(mOverlay.setLayer(*mLayers[1], mWindow));
+    ASSERT_TRUE(mLayers[1]->setCompositMode(HWC_BLENDING_PREMULT, 0xFF, 1));
+    EXPECT_TRUE(isValidated(mCompositor->getCanvas()));
+    EXPECT_TRUE(isValidated(*mLayers[0]));
+    EXPECT_TRUE(isValidated(*mLayers[1]));
+    EXPECT_TRUE(execute());
+}
+
+TEST_F(AcrylicValidationTest, ChangedSettingsInvalidateTheLayer)
+{
+    ASSERT_TRUE(execute());
+
+    // the plane alpha
+    ASSERT_TRUE(mLayers[1]->setCompositMode(HWC_BLENDING_PREMULT, 0x80, 1));
+    EXPECT_FALSE(isValidated(*mLayers[1]));
+    EXPECT_TRUE(isValidated(*mLayers[0]));
+    ASSERT_TRUE(execute());
+
+    // the composition area
+    hwc_rect_t window = {32, 32, 96, 96};
+    ASSERT_TRUE(mOverlay.setLayer(*mLayers[1], window));
+    EXPECT_FALSE(isValidated(*mLayers[1]));
+    ASSERT_TRUE(execute());
+
+    // the transform
+    ASSERT_TRUE(mOverlay.setLayer(*mLayers[1], window, HAL_TRANSFORM_ROT_90));
+    EXPECT_FALSE(isValidated(*mLayers[1]));
+    ASSERT_TRUE(execute());
+
+    // the dimension
+    ASSERT_TRUE(mLayers[1]->setImageDimension(32, 32));
+    EXPECT_FALSE(isValidated(*mLayers[1]));
+    EXPECT_TRUE(isValidated(*mLayers[0]));
+}
+
+TEST_F(AcrylicValidationTest, ChangedLayerIsRevalidated)
+{
+    ASSERT_TRUE(execute());
+
+    // the bound of the target area is checked only by the validation
+    hwc_rect_t outOfBound = {kWidth - 32, kHeight - 32, kWidth + 32, kHeight + 32};
+    ASSERT_TRUE(mOverlay.setLayer(*mLayers[1], outOfBound));
+    EXPECT_FALSE(execute());
+    EXPECT_FALSE(isValidated(*mLayers[1])) << "a failed validation validates nothing";
+
+    ASSERT_TRUE(mOverlay.setLayer(*mLayers[1], mWindow));
+    EXPECT_TRUE(execute());
+    EXPECT_TRUE(isValidated(*mLayers[1]));
+}
+
+TEST_F(AcrylicValidationTest, ChangedTargetRevalidatesAllLayers)
+{
+    ASSERT_TRUE(execute());
+
+    // the unchanged background is larger than the smaller target
+    TestImage small(kWidth / 2, kHeight / 2);
+    ASSERT_TRUE(small.valid());
+    ASSERT_TRUE(small.setCanvasOf(*mCompositor));
+    EXPECT_FALSE(isValidated(mCompositor->getCanvas()));
+    EXPECT_TRUE(isValidated(*mLayers[0]));
+    EXPECT_FALSE(execute());
+
+    ASSERT_TRUE(mTarget.setCanvasOf(*mCompositor));
+    EXPECT_TRUE(execute());
+}
+
+/*
+ * The cost of execute() without the G2D: the validation of the layers and the
+ * build of the command list. The emulator does not render.
+ */
+TEST_F(AcrylicValidationTest, ExecuteBenchmark)
+{
+    constexpr int kNumFrames = 20000;
+    constexpr int kNumRuns = 5;
+
+    // as many layers as the G2D takes
+    TestImage extra{64, 64};
+    hwc_rect_t windows[2] = {{96, 96, 160, 160}, {176, 176, 240, 240}};
+    std::unique_ptr<AcrylicLayer> extraLayers[2];
+    ASSERT_TRUE(extra.valid());
+    for (int i = 0; i < 2; i++) {
+        extraLayers[i].reset(mCompositor->createLayer());
+        ASSERT_NE(nullptr, extraLayers[i]);
+        ASSERT_TRUE(extra.setLayer(*extraLayers[i], windows[i]));
+        ASSERT_TRUE(extraLayers[i]->setCompositMode(HWC_BLENDING_PREMULT, 0xFF, 2 + i));
+    }
+    AcrylicLayer *layers[] = {mLayers[0], mLayers[1], extraLayers[0].get(), extraLayers[1].get()};
+
+    // the best of the runs to be less affected by the scheduling
+    auto measure = [&](bool change) {
+        int64_t best = INT64_MAX;
+        for (int run = 0; run < kNumRuns; run++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < kNumFrames; i++) {
+                // a changed plane alpha invalidates every layer
+                unsigned int alpha = (change && (i % 2)) ? 0xFE : 0xFF;
+                for (auto layer : layers)
+                    if (!layer->setCompositMode(HWC_BLENDING_PREMULT, alpha, layer->getZOrder()))
+                        return static_cast<int64_t>(-1);
+                if (!execute())
+                    return static_cast<int64_t>(-1);
+            }
+            best = std::min(best, static_cast<int64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start).count() / kNumFrames));
+        }
+        return best;
+    };
+
+    int64_t validated = measure(false);
+    int64_t revalidated = measure(true);
+    ASSERT_LE(0, validated);
+    ASSERT_LE(0, revalidated);
+    EXPECT_EQ(static_cast<unsigned int>(2 * kNumRuns * kNumFrames), mEmulator->getJobCount());
+
+    std::cout << "execute() of 4 layers: " << validated << " ns with the layers validated, "
+              << revalidated << " ns with the layers revalidated" << std::endl;
+    RecordProperty("ValidatedNs", static_cast<int>(validated));
+    RecordProperty("RevalidatedNs", static_cast<int>(revalidated));
+}
+
+} // namespace
@@ -110,15 +110,26 @@ LOCAL_C_INCLUDES += \
         $(TOP)/hardware/google/graphics/$(soc_ver)
 LOCAL_SRC_FILES := \
 	libhwchelper/ExynosHWCHelper.cpp \
+	libhwchelper/DamageHelper.cpp \
 	ExynosHWCDebug.cpp \
 	libdevice/BrightnessController.cpp \
+	libdevice/CommitScheduler.cpp \
 	libdevice/ExynosDisplay.cpp \
 	libdevice/ExynosDevice.cpp \
 	libdevice/ExynosLayer.cpp \
+	libdevice/FrameTimeline.cpp \
 	libdevice/HistogramDevice.cpp \
+	libdevice/PresentDurationPredictor.cpp \
+	libdevice/ReadbackStreamCodec.cpp \
+	libdevice/ReadbackStreamer.cpp \
+	libdevice/ReadbackStreamerDisplay.cpp \
+	libdevice/VideoMetaCache.cpp \
 	libmaindisplay/ExynosPrimaryDisplay.cpp \
+	libresource/DamageHistory.cpp \
+	libresource/DstBufferPool.cpp \
 	libresource/ExynosMPP.cpp \
 	libresource/ExynosResourceManager.cpp \
+	libresource/SupportCheckWorkers.cpp \
 	libexternaldisplay/ExynosExternalDisplay.cpp \
 	libvirtualdisplay/ExynosVirtualDisplay.cpp \
 	libdisplayinterface/ExynosDeviceInterface.cpp \
@@ -126,6 +137,7 @@ LOCAL_SRC_FILES := \
 	libdisplayinterface/ExynosDeviceDrmInterface.cpp \
 	libdisplayinterface/ExynosDisplayDrmInterface.cpp \
 	pixel-display.cpp \
+	histogram_buffer.cpp \
 	histogram_mediator.cpp
 
 LOCAL_EXPORT_SHARED_LIBRARY_HEADERS += libacryl libdrm libui libvendorgraphicbuffer
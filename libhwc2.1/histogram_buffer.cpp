@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "histogram_buffer.h"
+
+#include <string.h>
+
+#include <thread>
+
+void histogram::HistogramBuffer::publish(const char16_t *bins) {
+    // publish() is the only writer. Write to the slot not read recently.
+    const uint32_t index = mLatestSlot.load(std::memory_order_relaxed) ^ 1;
+    const uint64_t id = mPublished.load(std::memory_order_relaxed) + 1;
+    Slot &slot = mSlots[index];
+
+    slot.seq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(slot.bins, bins, sizeof(slot.bins));
+    slot.id = id;
+    slot.seq.fetch_add(1, std::memory_order_release);
+
+    mLatestSlot.store(index, std::memory_order_release);
+    mPublished.store(id, std::memory_order_release);
+
+    {
+        // a waiter checking the id under the lock does not miss the notification
+        std::lock_guard<std::mutex> lock(mMutex);
+    }
+    mPublishedCv.notify_all();
+}
+
+uint64_t histogram::HistogramBuffer::read(uint16_t *bins) const {
+    while (true) {
+        const Slot &slot = mSlots[mLatestSlot.load(std::memory_order_acquire)];
+
+        const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        if ((seq & 1) == 0) {
+            memcpy(bins, slot.bins, sizeof(slot.bins));
+            const uint64_t id = slot.id;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == seq) return id;
+        }
+        // overwritten by a newer histogram. Let the publisher finish it
+        std::this_thread::yield();
+    }
+}
+
+uint64_t histogram::HistogramBuffer::waitNewer(uint64_t afterId, std::chrono::nanoseconds timeout,
+                                               uint16_t *bins) {
+    if (getPublishedId() <= afterId) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!mPublishedCv.wait_for(lock, timeout,
+                                   [this, afterId]() { return getPublishedId() > afterId; })) {
+            return 0;
+        }
+    }
+    return read(bins);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace histogram {
+
+constexpr size_t HISTOGRAM_BINS_SIZE = 256;
+
+/*
+ * Latest histogram received from the DRM event thread.
+ *
+ * Every histogram is published to one of two slots alternately, each guarded by its own
+ * sequence counter (seqlock), and tagged with an id that increases by one per histogram.
+ * The publisher never waits for the readers, and readers retry only if the slot being read
+ * is overwritten, which needs two new histograms during a copy.
+ */
+class HistogramBuffer {
+public:
+    // called for each histogram received
+    void publish(const char16_t *bins);
+
+    // id of the latest histogram or 0 if no histogram has been received
+    uint64_t getPublishedId() const { return mPublished.load(std::memory_order_acquire); }
+
+    // copies the latest histogram into @bins and returns its id
+    uint64_t read(uint16_t *bins) const;
+
+    /*
+     * Copies the first histogram newer than @afterId into @bins, waiting up to @timeout for
+     * it. Returns its id, or 0 without touching @bins if no such histogram arrived in time.
+     */
+    uint64_t waitNewer(uint64_t afterId, std::chrono::nanoseconds timeout, uint16_t *bins);
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq{0}; // odd while the slot is being written
+        uint64_t id = 0;
+        uint16_t bins[HISTOGRAM_BINS_SIZE] = {}; // luma buffer
+    };
+    Slot mSlots[2];
+    std::atomic<uint32_t> mLatestSlot{0};
+    std::atomic<uint64_t> mPublished{0};
+
+    // held only to check the wait conditions
+    std::mutex mMutex;
+    std::condition_variable mPublishedCv;
+};
+
+} // namespace histogram
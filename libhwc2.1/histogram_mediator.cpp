@@ -36,13 +36,13 @@ histogram::HistogramErrorCode histogram::HistogramMediator::requestHist() {
     ExynosDisplayDrmInterface *moduleDisplayInterface =
             static_cast<ExynosDisplayDrmInterface *>(mDisplay->mDisplayInterface.get());
 
-    {
-        std::unique_lock<std::mutex> lk(mIDLHistogram->mDataCollectingMutex);
-        if (moduleDisplayInterface->setHistogramControl(
+    // the histograms already received, even if received during the request, are too old
+    mIDLHistogram->mRequestedHistId = mIDLHistogram->mBuffer.getPublishedId();
+    mIDLHistogram->mHistReq_pending = true;
+    if (moduleDisplayInterface->setHistogramControl(
                 hidl_histogram_control_t::HISTOGRAM_CONTROL_REQUEST) != NO_ERROR) {
-            return histogram::HistogramErrorCode::ENABLE_HIST_ERROR;
-        }
-        mIDLHistogram->mHistReq_pending = true;
+        mIDLHistogram->mHistReq_pending = false;
+        return histogram::HistogramErrorCode::ENABLE_HIST_ERROR;
     }
     return histogram::HistogramErrorCode::NONE;
 }
@@ -59,12 +59,8 @@ histogram::HistogramErrorCode histogram::HistogramMediator::cancelHistRequest()
 }
 
 void histogram::HistogramMediator::HistogramReceiver::callbackHistogram(char16_t *bin) {
-    std::unique_lock<std::mutex> lk(mDataCollectingMutex);
-    if (mHistReq_pending == true) {
-        std::memcpy(mHistData, bin, HISTOGRAM_BINS_SIZE * sizeof(char16_t));
-        mHistReq_pending = false;
-    }
-    mHistData_cv.notify_all();
+    mHistReq_pending = false;
+    mBuffer.publish(bin);
 }
 
 int histogram::HistogramMediator::calculateThreshold(const RoiRect &roi) {
@@ -75,6 +71,10 @@ int histogram::HistogramMediator::calculateThreshold(const RoiRect &roi) {
 histogram::HistogramErrorCode histogram::HistogramMediator::setRoiWeightThreshold(
         const RoiRect &roi, const Weight &weight, const HistogramPos &pos) {
     int threshold = calculateThreshold(roi);
+
+    // the histograms received so far are not for the new config
+    mIDLHistogram->mRequestedHistId = mIDLHistogram->mBuffer.getPublishedId();
+
     mIDLHistogram->setHistogramROI((uint16_t)roi.left, (uint16_t)roi.top,
                                    (uint16_t)(roi.right - roi.left),
                                    (uint16_t)(roi.bottom - roi.top));
@@ -87,13 +87,19 @@ histogram::HistogramErrorCode histogram::HistogramMediator::setRoiWeightThreshol
 
 histogram::HistogramErrorCode histogram::HistogramMediator::collectRoiLuma(
         std::vector<char16_t> *buf) {
-    std::unique_lock<std::mutex> lk(mIDLHistogram->mDataCollectingMutex);
+    uint16_t bins[HISTOGRAM_BINS_SIZE];
+    // blocks the binder thread up to a few frames for the histogram of the request. No
+    // histogram comes while the display is off
+    const auto timeout = mDisplay->isPowerModeOff() ? std::chrono::milliseconds(0)
+                                                    : std::chrono::milliseconds(50);
 
-    mIDLHistogram->mHistData_cv.wait_for(lk, std::chrono::milliseconds(50), [this]() {
-        return (!mDisplay->isPowerModeOff() && !mIDLHistogram->mHistReq_pending);
-    });
-    if (mIDLHistogram->mHistReq_pending == false) setSampleFrameCounter(getFrameCount());
-    buf->assign(mIDLHistogram->mHistData, mIDLHistogram->mHistData + HISTOGRAM_BINS_SIZE);
+    if (mIDLHistogram->mBuffer.waitNewer(mIDLHistogram->mRequestedHistId, timeout, bins) != 0) {
+        setSampleFrameCounter(getFrameCount());
+    } else {
+        // no histogram for the request in time. Return the latest one
+        mIDLHistogram->mBuffer.read(bins);
+    }
+    buf->assign(bins, bins + HISTOGRAM_BINS_SIZE);
 
     return histogram::HistogramErrorCode::NONE;
 }
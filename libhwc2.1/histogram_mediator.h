@@ -26,7 +26,7 @@
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
-#include <condition_variable>
+#include <atomic>
 #include <mutex>
 #include <vector>
 
@@ -40,6 +40,7 @@
 #include "ExynosDisplayDrmInterfaceModule.h"
 #include "ExynosDisplayInterface.h"
 #include "ExynosLayer.h"
+#include "histogram_buffer.h"
 
 namespace histogram {
 using RoiRect = ::aidl::android::hardware::graphics::common::Rect;
@@ -48,7 +49,6 @@ using HistogramPos = ::aidl::com::google::hardware::pixel::display::HistogramPos
 using Priority = ::aidl::com::google::hardware::pixel::display::Priority;
 using HistogramErrorCode = ::aidl::com::google::hardware::pixel::display::HistogramErrorCode;
 
-constexpr size_t HISTOGRAM_BINS_SIZE = 256;
 constexpr size_t WEIGHT_SUM = 1024;
 
 class HistogramMediator {
@@ -64,12 +64,16 @@ public:
                                              const HistogramPos &pos);
     RoiRect calRoi(const RoiRect &roi);
     struct HistogramReceiver : public IDLHistogram {
-        HistogramReceiver() : mHistData(){};
+        HistogramReceiver() = default;
         void callbackHistogram(char16_t *bin) override;
-        uint16_t mHistData[HISTOGRAM_BINS_SIZE]; // luma buffer
-        std::condition_variable mHistData_cv;    // for pullback data sync ctrl
-        bool mHistReq_pending = false;
-        std::mutex mDataCollectingMutex; // for data collecting operations
+
+        HistogramBuffer mBuffer;
+        std::atomic<bool> mHistReq_pending{false};
+        /*
+         * Id of the latest histogram when the pending request was made or the config was
+         * changed. Only the histograms newer than it are collected.
+         */
+        std::atomic<uint64_t> mRequestedHistId{0};
     };
 
     struct HistogramConfig {
@@ -108,6 +112,7 @@ private:
     int calculateThreshold(const RoiRect &roi);
     std::shared_ptr<HistogramReceiver> mIDLHistogram;
     ExynosDisplay *mDisplay = nullptr;
+    // the frame of the last histogram collected by collectRoiLuma() on the binder thread
     uint32_t mSampledFrameCounter = 0;
 };
 
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG (ATRACE_TAG_GRAPHICS | ATRACE_TAG_HAL)
+
+#include "CommitScheduler.h"
+
+#include <cutils/properties.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+
+using namespace android;
+
+nsecs_t CommitScheduler::Clock::now() const {
+    return systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
+void CommitScheduler::Clock::sleepUntil(nsecs_t time) const {
+    const struct timespec ts = {static_cast<time_t>(time / 1000000000),
+                                static_cast<long>(time % 1000000000)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+CommitScheduler::CommitScheduler(std::unique_ptr<Clock> clock) : mClock(std::move(clock)) {
+    mEnabled = property_get_bool("vendor.display.commit_scheduler.enabled", false);
+    mMargin = us2ns(property_get_int32("vendor.display.commit_scheduler.margin_us",
+                                       static_cast<int32_t>(ns2us(kDefaultMargin))));
+}
+
+nsecs_t CommitScheduler::predictLatencyLocked() const {
+    const size_t count = std::min(mNumLatencies, kNumLatencySamples);
+    return *std::max_element(mLatencies.begin(), mLatencies.begin() + count);
+}
+
+nsecs_t CommitScheduler::getLatchTime(nsecs_t expectedPresentTime, nsecs_t vsyncPeriod,
+                                      nsecs_t now) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // commit right away until the latency is measured
+    if ((expectedPresentTime <= now) || (mNumLatencies == 0)) return 0;
+
+    const nsecs_t latchTime = expectedPresentTime - predictLatencyLocked() - mMargin;
+    if ((latchTime <= now) || (latchTime - now > vsyncPeriod)) return 0;
+
+    return std::min(latchTime, now + kMaxHoldTime);
+}
+
+nsecs_t CommitScheduler::beginFrame(nsecs_t expectedPresentTime, nsecs_t vsyncPeriod) {
+    const nsecs_t now = mClock->now();
+    const nsecs_t latchTime = getLatchTime(expectedPresentTime, vsyncPeriod, now);
+
+    if (latchTime != 0) {
+        ATRACE_NAME("CommitScheduler::hold");
+        mClock->sleepUntil(latchTime);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFrame.expectedPresentTime = expectedPresentTime;
+    mFrame.latchTime = mClock->now();
+    mFrame.held = (latchTime != 0);
+    if (!mFrame.held) {
+        mStats.notHeld++;
+        return 0;
+    }
+
+    const nsecs_t holdTime = mFrame.latchTime - now;
+    mStats.held++;
+    mStats.totalHoldTime += holdTime;
+    mStats.maxHoldTime = std::max(mStats.maxHoldTime, holdTime);
+    return holdTime;
+}
+
+void CommitScheduler::endFrame() {
+    const nsecs_t now = mClock->now();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFrame.latchTime == 0) return;
+
+    const nsecs_t latency = now - mFrame.latchTime;
+    mLatencies[mNumLatencies % kNumLatencySamples] = latency;
+    mNumLatencies++;
+    mStats.totalLatency += latency;
+    mStats.maxLatency = std::max(mStats.maxLatency, latency);
+    if (mFrame.held && (now > mFrame.expectedPresentTime)) mStats.missed++;
+
+    mFrame = Frame();
+}
+
+void CommitScheduler::failFrame() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFrame.latchTime == 0) return;
+
+    mStats.failed++;
+    mFrame = Frame();
+}
+
+CommitScheduler::Stats CommitScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void CommitScheduler::dump(String8 &result) const {
+    if (!mEnabled) return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    result.appendFormat("Commit scheduler: margin %" PRId64 " us, predicted latency %" PRId64
+                        " us\n",
+                        ns2us(mMargin), (mNumLatencies != 0) ? ns2us(predictLatencyLocked()) : 0);
+    result.appendFormat("\theld %" PRIu64 ", not held %" PRIu64 ", missed %" PRIu64
+                        ", failed %" PRIu64 "\n",
+                        mStats.held, mStats.notHeld, mStats.missed, mStats.failed);
+    if (mStats.held != 0) {
+        result.appendFormat("\thold (us): avg %" PRId64 ", max %" PRId64 "\n",
+                            ns2us(mStats.totalHoldTime / static_cast<nsecs_t>(mStats.held)),
+                            ns2us(mStats.maxHoldTime));
+    }
+    if (mNumLatencies != 0) {
+        result.appendFormat("\tlatch to commit (us): avg %" PRId64 ", max %" PRId64 "\n",
+                            ns2us(mStats.totalLatency / static_cast<nsecs_t>(mNumLatencies)),
+                            ns2us(mStats.maxLatency));
+    }
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+/*
+ * Holds the atomic commit of a frame until the latest time it still reaches the display at
+ * the expected present time, so the states latched right before the commit (brightness,
+ * histogram) are as fresh as possible.
+ *
+ * The latch time is the expected present time less the worst commit latency of the recent
+ * frames and a margin. A frame is not held if its latch time already passed or is more than
+ * a vsync period away, i.e. the hint is stale, nor if the caller has no reliable expected
+ * present time and passes 0.
+ *
+ * The hold runs in the commit path with the display mutex held, which blocks the other
+ * calls to the display in the meantime, so it never exceeds kMaxHoldTime. The frame is
+ * latched early rather than late if the latch time is farther away. The mutex is not
+ * released for the hold: whether a frame may be held depends on its mode set and readback
+ * state, which is only known after the request is built under the mutex, and
+ * setPowerMode() or setReadbackBuffer() on another thread must not change the display
+ * between the build of the request and its commit. The brightness updates the hold waits
+ * for do not take the display mutex.
+ *
+ * The hold is not work of the frame, so the callers measuring the work duration of a commit
+ * exclude it with getWorkDuration().
+ *
+ * Disabled unless vendor.display.commit_scheduler.enabled is set. The margin is
+ * vendor.display.commit_scheduler.margin_us.
+ */
+class CommitScheduler {
+  public:
+    static constexpr size_t kNumLatencySamples = 16;
+    static constexpr nsecs_t kDefaultMargin = us2ns(1000);
+    static constexpr nsecs_t kMaxHoldTime = ms2ns(8);
+
+    // the time source of the scheduler, replaced by a simulated clock in the tests
+    class Clock {
+      public:
+        virtual ~Clock() = default;
+        virtual nsecs_t now() const;
+        // returns at @time or later
+        virtual void sleepUntil(nsecs_t time) const;
+    };
+
+    struct Stats {
+        uint64_t held = 0;
+        uint64_t notHeld = 0;
+        // held frames committed after the expected present time
+        uint64_t missed = 0;
+        nsecs_t totalHoldTime = 0;
+        nsecs_t maxHoldTime = 0;
+        nsecs_t totalLatency = 0;
+        nsecs_t maxLatency = 0;
+        // frames begun but not committed
+        uint64_t failed = 0;
+    };
+
+    // ends the frame begun by beginFrame() on every exit path of the commit. The frame is
+    // failed when the scope is left without committed()
+    class ScopedFrame {
+      public:
+        ScopedFrame() = default;
+        explicit ScopedFrame(CommitScheduler *scheduler) : mScheduler(scheduler) {}
+        ScopedFrame(ScopedFrame &&other) : mScheduler(std::exchange(other.mScheduler, nullptr)) {}
+        ScopedFrame &operator=(ScopedFrame &&other) {
+            if (this != &other) {
+                end(false);
+                mScheduler = std::exchange(other.mScheduler, nullptr);
+            }
+            return *this;
+        }
+        ~ScopedFrame() { end(false); }
+
+        // the frame was committed
+        void committed() { end(true); }
+
+      private:
+        void end(bool committed) {
+            CommitScheduler *scheduler = std::exchange(mScheduler, nullptr);
+            if (!scheduler) return;
+            if (committed)
+                scheduler->endFrame();
+            else
+                scheduler->failFrame();
+        }
+
+        CommitScheduler *mScheduler = nullptr;
+    };
+
+    explicit CommitScheduler(std::unique_ptr<Clock> clock = std::make_unique<Clock>());
+
+    bool isEnabled() const { return mEnabled; }
+
+    // returns when the frame expected at @expectedPresentTime should be latched, or 0 if the
+    // frame should be committed at @now. At most kMaxHoldTime after @now
+    nsecs_t getLatchTime(nsecs_t expectedPresentTime, nsecs_t vsyncPeriod, nsecs_t now) const;
+    // holds the caller until the latch time of the frame, @expectedPresentTime is 0 if
+    // unknown. Returns how long the caller was held. Ended by endFrame()
+    nsecs_t beginFrame(nsecs_t expectedPresentTime, nsecs_t vsyncPeriod);
+    // the frame begun last was committed
+    void endFrame();
+    // the commit of the frame begun last failed, so its latency is not sampled
+    void failFrame();
+
+    // the work duration from @start to @end of a commit which was held for @holdTime
+    static nsecs_t getWorkDuration(nsecs_t start, nsecs_t end, nsecs_t holdTime) {
+        return std::max(end - start - holdTime, static_cast<nsecs_t>(0));
+    }
+
+    Stats getStats() const;
+    void dump(android::String8 &result) const;
+
+  private:
+    struct Frame {
+        nsecs_t expectedPresentTime = 0;
+        // when the frame was released to latch the states and commit
+        nsecs_t latchTime = 0;
+        bool held = false;
+    };
+
+    // the worst latency from the latch to the end of the commit of the recent frames
+    nsecs_t predictLatencyLocked() const;
+
+    const std::unique_ptr<Clock> mClock;
+    bool mEnabled = false;
+    nsecs_t mMargin = kDefaultMargin;
+
+    mutable std::mutex mMutex;
+    std::array<nsecs_t, kNumLatencySamples> mLatencies{};
+    size_t mNumLatencies = 0;
+    Frame mFrame;
+    Stats mStats;
+};
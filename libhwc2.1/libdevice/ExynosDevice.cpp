@@ -155,8 +155,6 @@ ExynosDevice::ExynosDevice()
 #endif
     }
 
-    memset(mCallbackInfos, 0, sizeof(mCallbackInfos));
-
     dynamicRecompositionThreadCreate();
 
     for (uint32_t i = 0; i < FENCE_IP_ALL; i++)
@@ -473,13 +471,16 @@ int32_t ExynosDevice::registerCallback (
         return HWC2_ERROR_BAD_PARAMETER;
 
     Mutex::Autolock lock(mDeviceCallbackMutex);
-    mCallbackInfos[descriptor].callbackData = callbackData;
-    mCallbackInfos[descriptor].funcPointer = point;
+    /* hotplug events wait until the plugged displays are reported below */
+    Mutex::Autolock hotplugLock(mHotplugMutex);
+    CallbackTable *table = new CallbackTable(mCallbackTable.current());
+    table->hwc2[descriptor].callbackData = callbackData;
+    table->hwc2[descriptor].funcPointer = point;
+    mCallbackTable.publish(table);
 
     /* Call hotplug callback for primary display*/
     if (descriptor == HWC2_CALLBACK_HOTPLUG) {
-        HWC2_PFN_HOTPLUG callbackFunc =
-                reinterpret_cast<HWC2_PFN_HOTPLUG>(mCallbackInfos[descriptor].funcPointer);
+        HWC2_PFN_HOTPLUG callbackFunc = reinterpret_cast<HWC2_PFN_HOTPLUG>(point);
         if (callbackFunc != nullptr) {
             for (auto it : mDisplays) {
                 if (it->mPlugState)
@@ -500,14 +501,14 @@ int32_t ExynosDevice::registerCallback (
     return HWC2_ERROR_NONE;
 }
 
-bool ExynosDevice::isCallbackRegisteredLocked(int32_t descriptor) {
+bool ExynosDevice::isCallbackRegistered(const CallbackTable &table, int32_t descriptor) {
     if (descriptor < 0 || descriptor > HWC2_CALLBACK_SEAMLESS_POSSIBLE) {
         ALOGE("%s:: %d callback is unknown", __func__, descriptor);
         return false;
     }
 
-    if (mCallbackInfos[descriptor].callbackData == nullptr ||
-        mCallbackInfos[descriptor].funcPointer == nullptr) {
+    if (table.hwc2[descriptor].callbackData == nullptr ||
+        table.hwc2[descriptor].funcPointer == nullptr) {
         ALOGE("%s:: %d callback is not registered", __func__, descriptor);
         return false;
     }
@@ -516,18 +517,19 @@ bool ExynosDevice::isCallbackRegisteredLocked(int32_t descriptor) {
 }
 
 bool ExynosDevice::isCallbackAvailable(int32_t descriptor) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
-    return isCallbackRegisteredLocked(descriptor);
+    EpochPointer<CallbackTable>::Reader table(mCallbackTable);
+    return isCallbackRegistered(*table, descriptor);
 }
 
 void ExynosDevice::onHotPlug(uint32_t displayId, bool status) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    Mutex::Autolock lock(mHotplugMutex);
+    EpochPointer<CallbackTable>::Reader table(mCallbackTable);
 
-    if (!isCallbackRegisteredLocked(HWC2_CALLBACK_HOTPLUG)) return;
+    if (!isCallbackRegistered(*table, HWC2_CALLBACK_HOTPLUG)) return;
 
-    hwc2_callback_data_t callbackData = mCallbackInfos[HWC2_CALLBACK_HOTPLUG].callbackData;
+    hwc2_callback_data_t callbackData = table->hwc2[HWC2_CALLBACK_HOTPLUG].callbackData;
     HWC2_PFN_HOTPLUG callbackFunc =
-            reinterpret_cast<HWC2_PFN_HOTPLUG>(mCallbackInfos[HWC2_CALLBACK_HOTPLUG].funcPointer);
+            reinterpret_cast<HWC2_PFN_HOTPLUG>(table->hwc2[HWC2_CALLBACK_HOTPLUG].funcPointer);
     callbackFunc(callbackData, displayId,
                  status ? HWC2_CONNECTION_CONNECTED : HWC2_CONNECTION_DISCONNECTED);
 }
@@ -538,9 +540,9 @@ void ExynosDevice::onRefreshDisplays() {
 }
 
 void ExynosDevice::onRefresh(uint32_t displayId) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    EpochPointer<CallbackTable>::Reader table(mCallbackTable);
 
-    if (!isCallbackRegisteredLocked(HWC2_CALLBACK_REFRESH)) return;
+    if (!isCallbackRegistered(*table, HWC2_CALLBACK_REFRESH)) return;
 
     if (!checkDisplayConnection(displayId)) return;
 
@@ -550,31 +552,31 @@ void ExynosDevice::onRefresh(uint32_t displayId) {
              (display->mPowerModeState.value() == (hwc2_power_mode_t)HWC_POWER_MODE_OFF))
         return;
 
-    hwc2_callback_data_t callbackData = mCallbackInfos[HWC2_CALLBACK_REFRESH].callbackData;
+    hwc2_callback_data_t callbackData = table->hwc2[HWC2_CALLBACK_REFRESH].callbackData;
     HWC2_PFN_REFRESH callbackFunc =
-            reinterpret_cast<HWC2_PFN_REFRESH>(mCallbackInfos[HWC2_CALLBACK_REFRESH].funcPointer);
+            reinterpret_cast<HWC2_PFN_REFRESH>(table->hwc2[HWC2_CALLBACK_REFRESH].funcPointer);
     callbackFunc(callbackData, displayId);
 }
 
 void ExynosDevice::onVsync(uint32_t displayId, int64_t timestamp) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    EpochPointer<CallbackTable>::Reader table(mCallbackTable);
 
-    if (!isCallbackRegisteredLocked(HWC2_CALLBACK_VSYNC)) return;
+    if (!isCallbackRegistered(*table, HWC2_CALLBACK_VSYNC)) return;
 
-    hwc2_callback_data_t callbackData = mCallbackInfos[HWC2_CALLBACK_VSYNC].callbackData;
+    hwc2_callback_data_t callbackData = table->hwc2[HWC2_CALLBACK_VSYNC].callbackData;
     HWC2_PFN_VSYNC callbackFunc =
-            reinterpret_cast<HWC2_PFN_VSYNC>(mCallbackInfos[HWC2_CALLBACK_VSYNC].funcPointer);
+            reinterpret_cast<HWC2_PFN_VSYNC>(table->hwc2[HWC2_CALLBACK_VSYNC].funcPointer);
     callbackFunc(callbackData, displayId, timestamp);
 }
 
 bool ExynosDevice::onVsync_2_4(uint32_t displayId, int64_t timestamp, uint32_t vsyncPeriod) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    EpochPointer<CallbackTable>::Reader table(mCallbackTable);
 
-    if (!isCallbackRegisteredLocked(HWC2_CALLBACK_VSYNC_2_4)) return false;
+    if (!isCallbackRegistered(*table, HWC2_CALLBACK_VSYNC_2_4)) return false;
 
-    hwc2_callback_data_t callbackData = mCallbackInfos[HWC2_CALLBACK_VSYNC_2_4].callbackData;
+    hwc2_callback_data_t callbackData = table->hwc2[HWC2_CALLBACK_VSYNC_2_4].callbackData;
     HWC2_PFN_VSYNC_2_4 callbackFunc = reinterpret_cast<HWC2_PFN_VSYNC_2_4>(
-            mCallbackInfos[HWC2_CALLBACK_VSYNC_2_4].funcPointer);
+            table->hwc2[HWC2_CALLBACK_VSYNC_2_4].funcPointer);
     callbackFunc(callbackData, displayId, timestamp, vsyncPeriod);
 
     return true;
@@ -582,20 +584,20 @@ bool ExynosDevice::onVsync_2_4(uint32_t displayId, int64_t timestamp, uint32_t v
 
 void ExynosDevice::onVsyncPeriodTimingChanged(uint32_t displayId,
                                               hwc_vsync_period_change_timeline_t *timeline) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    EpochPointer<CallbackTable>::Reader table(mCallbackTable);
 
     if (!timeline) {
         ALOGE("vsync period change timeline is null");
         return;
     }
 
-    if (!isCallbackRegisteredLocked(HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED)) return;
+    if (!isCallbackRegistered(*table, HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED)) return;
 
     hwc2_callback_data_t callbackData =
-            mCallbackInfos[HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED].callbackData;
+            table->hwc2[HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED].callbackData;
     HWC2_PFN_VSYNC_PERIOD_TIMING_CHANGED callbackFunc =
             reinterpret_cast<HWC2_PFN_VSYNC_PERIOD_TIMING_CHANGED>(
-                    mCallbackInfos[HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED].funcPointer);
+                    table->hwc2[HWC2_CALLBACK_VSYNC_PERIOD_TIMING_CHANGED].funcPointer);
     callbackFunc(callbackData, displayId, timeline);
 }
 
@@ -697,6 +699,17 @@ void ExynosDevice::setHWCControl(uint32_t displayId, uint32_t ctrl, int32_t val)
         case HWC_CTL_CAPTURE_READBACK:
             captureScreenWithReadback(displayId);
             break;
+        case HWC_CTL_STREAM_READBACK:
+            ALOGI("%s::HWC_CTL_STREAM_READBACK buffers=%d", __func__, val);
+            exynosDisplay = (ExynosDisplay *)getDisplay(displayId);
+            if (exynosDisplay == NULL) {
+                ALOGE("There is no display(%d)", displayId);
+                break;
+            }
+            if (exynosDisplay->setReadbackStream((uint32_t)val) != HWC2_ERROR_NONE)
+                ALOGE("%s::HWC_CTL_STREAM_READBACK fail", __func__);
+            onRefresh(displayId);
+            break;
         case HWC_CTL_DISPLAY_MODE:
             ALOGI("%s::HWC_CTL_DISPLAY_MODE mode=%d", __func__, val);
             setDisplayMode((uint32_t)val);
@@ -1184,17 +1197,20 @@ uint64_t ExynosDevice::getSpecialPlaneAttr(uint32_t index)
 int32_t ExynosDevice::registerHwc3Callback(uint32_t descriptor, hwc2_callback_data_t callbackData,
                                            hwc2_function_pointer_t point) {
     Mutex::Autolock lock(mDeviceCallbackMutex);
-    mHwc3CallbackInfos[descriptor].callbackData = callbackData;
-    mHwc3CallbackInfos[descriptor].funcPointer = point;
+    CallbackTable *table = new CallbackTable(mCallbackTable.current());
+    table->hwc3[descriptor].callbackData = callbackData;
+    table->hwc3[descriptor].funcPointer = point;
+    mCallbackTable.publish(table);
 
     return HWC2_ERROR_NONE;
 }
 
 void ExynosDevice::onVsyncIdle(hwc2_display_t displayId) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
-    const auto &idleCallback = mHwc3CallbackInfos.find(IComposerCallback::TRANSACTION_onVsyncIdle);
+    EpochPointer<CallbackTable>::Reader table(mCallbackTable);
+    const auto &hwc3Callbacks = table->hwc3;
+    const auto &idleCallback = hwc3Callbacks.find(IComposerCallback::TRANSACTION_onVsyncIdle);
 
-    if (idleCallback == mHwc3CallbackInfos.end()) return;
+    if (idleCallback == hwc3Callbacks.end()) return;
 
     const auto &callbackInfo = idleCallback->second;
     if (callbackInfo.funcPointer == nullptr || callbackInfo.callbackData == nullptr) return;
@@ -1222,11 +1238,12 @@ void ExynosDevice::handleHotplug() {
 }
 
 void ExynosDevice::onRefreshRateChangedDebug(hwc2_display_t displayId, uint32_t vsyncPeriod) {
-    Mutex::Autolock lock(mDeviceCallbackMutex);
+    EpochPointer<CallbackTable>::Reader table(mCallbackTable);
+    const auto &hwc3Callbacks = table->hwc3;
     const auto &refreshRateCallback =
-            mHwc3CallbackInfos.find(IComposerCallback::TRANSACTION_onRefreshRateChangedDebug);
+            hwc3Callbacks.find(IComposerCallback::TRANSACTION_onRefreshRateChangedDebug);
 
-    if (refreshRateCallback == mHwc3CallbackInfos.end()) return;
+    if (refreshRateCallback == hwc3Callbacks.end()) return;
 
     const auto &callbackInfo = refreshRateCallback->second;
     if (callbackInfo.funcPointer == nullptr || callbackInfo.callbackData == nullptr) return;
@@ -36,6 +36,7 @@
 #include <map>
 #include <thread>
 
+#include "EpochPointer.h"
 #include "ExynosDeviceInterface.h"
 #include "ExynosHWC.h"
 #include "ExynosHWCHelper.h"
@@ -186,11 +187,27 @@ class ExynosDevice {
          * - HotplugCallback: Hot plug event by new display hardware.
          */
 
-        /** TODO : Array size shuld be checked */
-        exynos_callback_info_t mCallbackInfos[HWC2_CALLBACK_SEAMLESS_POSSIBLE + 1];
+        struct CallbackTable {
+            /** TODO : Array size shuld be checked */
+            exynos_callback_info_t hwc2[HWC2_CALLBACK_SEAMLESS_POSSIBLE + 1] = {};
+            std::map<uint32_t, exynos_callback_info_t> hwc3;
+        };
 
-        std::map<uint32_t, exynos_callback_info_t> mHwc3CallbackInfos;
+        /*
+         * The callbacks are read by the event threads without a lock. Registration
+         * publishes a new table and frees the old one once its readers are done, so no
+         * callback is called after it is unregistered.
+         */
+        EpochPointer<CallbackTable> mCallbackTable{new CallbackTable()};
+        // serializes the registrations. The only writer of mCallbackTable
         Mutex mDeviceCallbackMutex;
+        /*
+         * Serializes the hotplug events with the registrations. Otherwise an event which read
+         * the new hotplug callback could reach the client before registerCallback()
+         * reports the displays plugged at that time, and the stale report would win.
+         * Taken after mDeviceCallbackMutex.
+         */
+        Mutex mHotplugMutex;
 
         /**
          * Thread variables
@@ -355,7 +372,7 @@ class ExynosDevice {
         Condition mCaptureCondition;
         std::atomic<bool> mIsWaitingReadbackReqDone = false;
         void setVBlankOffDelay(int vblankOffDelay);
-        bool isCallbackRegisteredLocked(int32_t descriptor);
+        bool isCallbackRegistered(const CallbackTable &table, int32_t descriptor);
 
     public:
         void enterToTUI() { mIsInTUI = true; };
@@ -36,9 +36,11 @@
 #include <map>
 
 #include "BrightnessController.h"
+#include "ExynosDevice.h"
 #include "ExynosExternalDisplay.h"
 #include "ExynosLayer.h"
 #include "HistogramController.h"
+#include "ReleaseFenceHelper.h"
 #include "VendorGraphicBuffer.h"
 #include "exynos_format.h"
 #include "utils/Timers.h"
@@ -832,14 +834,6 @@ ExynosCompositionInfo::ExynosCompositionInfo(uint32_t type)
     else
         mCompressionInfo.type = COMP_TYPE_AFBC;
 
-    memset(&mSkipSrcInfo, 0, sizeof(mSkipSrcInfo));
-    for (int i = 0; i < NUM_SKIP_STATIC_LAYER; i++) {
-        mSkipSrcInfo.srcInfo[i].acquireFenceFd = -1;
-        mSkipSrcInfo.srcInfo[i].releaseFenceFd = -1;
-        mSkipSrcInfo.dstInfo[i].acquireFenceFd = -1;
-        mSkipSrcInfo.dstInfo[i].releaseFenceFd = -1;
-    }
-
     if(type == COMPOSITION_CLIENT)
         mEnableSkipStatic = true;
 
@@ -1050,6 +1044,11 @@ ExynosDisplay::ExynosDisplay(uint32_t type, uint32_t index, ExynosDevice *device
     mDisplayControl.adjustDisplayFrame = false;
     mDisplayControl.cursorSupport = false;
 
+    mWindowUpdateAlign.x =
+            std::max(property_get_int32("vendor.display.window_update.align_x", 1), 1);
+    mWindowUpdateAlign.y =
+            std::max(property_get_int32("vendor.display.window_update.align_y", 1), 1);
+
     mDisplayConfigs.clear();
 
     mPowerModeState = std::nullopt;
@@ -1102,13 +1101,7 @@ void ExynosDisplay::initDisplay() {
     mClientCompositionInfo.mEnableSkipStatic = true;
     mClientCompositionInfo.mSkipStaticInitFlag = false;
     mClientCompositionInfo.mSkipFlag = false;
-    memset(&mClientCompositionInfo.mSkipSrcInfo, 0x0, sizeof(mClientCompositionInfo.mSkipSrcInfo));
-    for (int i = 0; i < NUM_SKIP_STATIC_LAYER; i++) {
-        mClientCompositionInfo.mSkipSrcInfo.srcInfo[i].acquireFenceFd = -1;
-        mClientCompositionInfo.mSkipSrcInfo.srcInfo[i].releaseFenceFd = -1;
-        mClientCompositionInfo.mSkipSrcInfo.dstInfo[i].acquireFenceFd = -1;
-        mClientCompositionInfo.mSkipSrcInfo.dstInfo[i].releaseFenceFd = -1;
-    }
+    mClientCompositionInfo.mSkipStaticLayers.clear();
     memset(&mClientCompositionInfo.mLastWinConfigData, 0x0, sizeof(mClientCompositionInfo.mLastWinConfigData));
     mClientCompositionInfo.mLastWinConfigData.acq_fence = -1;
     mClientCompositionInfo.mLastWinConfigData.rel_fence = -1;
@@ -1117,13 +1110,7 @@ void ExynosDisplay::initDisplay() {
     mExynosCompositionInfo.mEnableSkipStatic = false;
     mExynosCompositionInfo.mSkipStaticInitFlag = false;
     mExynosCompositionInfo.mSkipFlag = false;
-    memset(&mExynosCompositionInfo.mSkipSrcInfo, 0x0, sizeof(mExynosCompositionInfo.mSkipSrcInfo));
-    for (int i = 0; i < NUM_SKIP_STATIC_LAYER; i++) {
-        mExynosCompositionInfo.mSkipSrcInfo.srcInfo[i].acquireFenceFd = -1;
-        mExynosCompositionInfo.mSkipSrcInfo.srcInfo[i].releaseFenceFd = -1;
-        mExynosCompositionInfo.mSkipSrcInfo.dstInfo[i].acquireFenceFd = -1;
-        mExynosCompositionInfo.mSkipSrcInfo.dstInfo[i].releaseFenceFd = -1;
-    }
+    mExynosCompositionInfo.mSkipStaticLayers.clear();
 
     memset(&mExynosCompositionInfo.mLastWinConfigData, 0x0, sizeof(mExynosCompositionInfo.mLastWinConfigData));
     mExynosCompositionInfo.mLastWinConfigData.acq_fence = -1;
@@ -1570,67 +1557,37 @@ int ExynosDisplay::handleStaticLayers(ExynosCompositionInfo& compositionInfo)
     return NO_ERROR;
 }
 
-bool ExynosDisplay::skipStaticLayerChanged(ExynosCompositionInfo& compositionInfo)
+std::optional<uint64_t> ExynosDisplay::getSkipStaticSignature(
+        const ExynosCompositionInfo& compositionInfo)
 {
-    if ((int)compositionInfo.mSkipSrcInfo.srcNum !=
-            (compositionInfo.mLastIndex - compositionInfo.mFirstIndex + 1)) {
-        DISPLAY_LOGD(eDebugSkipStaicLayer, "Client composition number is changed (%d -> %d)",
-                compositionInfo.mSkipSrcInfo.srcNum,
-                compositionInfo.mLastIndex - compositionInfo.mFirstIndex + 1);
-        return true;
-    }
+    SignatureHasher hasher;
+    hasher.add(compositionInfo.mFirstIndex).add(compositionInfo.mLastIndex);
 
-    bool isChanged = false;
     for (size_t i = (size_t)compositionInfo.mFirstIndex; i <= (size_t)compositionInfo.mLastIndex; i++) {
         ExynosLayer *layer = mLayers[i];
-        size_t index = i - compositionInfo.mFirstIndex;
-        if ((layer->mLayerBuffer == NULL) ||
-            (compositionInfo.mSkipSrcInfo.srcInfo[index].bufferHandle != layer->mLayerBuffer))
-        {
-            isChanged = true;
-            DISPLAY_LOGD(eDebugSkipStaicLayer, "layer[%zu] handle is changed"\
-                    " handle(%p -> %p), layerFlag(0x%8x)",
-                    i, compositionInfo.mSkipSrcInfo.srcInfo[index].bufferHandle,
-                    layer->mLayerBuffer, layer->mLayerFlag);
-            break;
-        } else if ((compositionInfo.mSkipSrcInfo.srcInfo[index].x != layer->mSrcImg.x) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].y != layer->mSrcImg.y) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].w != layer->mSrcImg.w) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].h != layer->mSrcImg.h) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].dataSpace != layer->mSrcImg.dataSpace) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].blending != layer->mSrcImg.blending) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].transform != layer->mSrcImg.transform) ||
-                (compositionInfo.mSkipSrcInfo.srcInfo[index].planeAlpha != layer->mSrcImg.planeAlpha))
-        {
-            isChanged = true;
-            DISPLAY_LOGD(eDebugSkipStaicLayer, "layer[%zu] source info is changed, "\
-                    "x(%d->%d), y(%d->%d), w(%d->%d), h(%d->%d), dataSpace(%d->%d), "\
-                    "blending(%d->%d), transform(%d->%d), planeAlpha(%3.1f->%3.1f)", i,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].x, layer->mSrcImg.x,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].y, layer->mSrcImg.y,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].w,  layer->mSrcImg.w,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].h,  layer->mSrcImg.h,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].dataSpace, layer->mSrcImg.dataSpace,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].blending, layer->mSrcImg.blending,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].transform, layer->mSrcImg.transform,
-                    compositionInfo.mSkipSrcInfo.srcInfo[index].planeAlpha, layer->mSrcImg.planeAlpha);
-            break;
-        } else if ((compositionInfo.mSkipSrcInfo.dstInfo[index].x != layer->mDstImg.x) ||
-                (compositionInfo.mSkipSrcInfo.dstInfo[index].y != layer->mDstImg.y) ||
-                (compositionInfo.mSkipSrcInfo.dstInfo[index].w != layer->mDstImg.w) ||
-                (compositionInfo.mSkipSrcInfo.dstInfo[index].h != layer->mDstImg.h))
-        {
-            isChanged = true;
-            DISPLAY_LOGD(eDebugSkipStaicLayer, "layer[%zu] dst info is changed, "\
-                    "x(%d->%d), y(%d->%d), w(%d->%d), h(%d->%d)", i,
-                    compositionInfo.mSkipSrcInfo.dstInfo[index].x, layer->mDstImg.x,
-                    compositionInfo.mSkipSrcInfo.dstInfo[index].y, layer->mDstImg.y,
-                    compositionInfo.mSkipSrcInfo.dstInfo[index].w, layer->mDstImg.w,
-                    compositionInfo.mSkipSrcInfo.dstInfo[index].h, layer->mDstImg.h);
-            break;
+        if (layer->mLayerBuffer == NULL) {
+            DISPLAY_LOGD(eDebugSkipStaicLayer, "layer[%zu] has no buffer, layerFlag(0x%8x)",
+                    i, layer->mLayerFlag);
+            return std::nullopt;
         }
+        hasher.add(layer->mClientSignature);
     }
-    return isChanged;
+    return hasher.get();
+}
+
+bool ExynosDisplay::skipStaticLayerChanged(ExynosCompositionInfo& compositionInfo)
+{
+    std::optional<uint64_t> signature = getSkipStaticSignature(compositionInfo);
+    auto getState = [&](size_t i) {
+        return mLayers[compositionInfo.mFirstIndex + i]->getClientState();
+    };
+    if (compositionInfo.mSkipStaticLayers.isSame(signature,
+                compositionInfo.mLastIndex - compositionInfo.mFirstIndex + 1, getState))
+        return false;
+
+    DISPLAY_LOGD(eDebugSkipStaicLayer, "Client composition is changed (0x%" PRIx64 " -> 0x%" PRIx64 ")",
+            compositionInfo.mSkipStaticLayers.signature(), signature.value_or(0));
+    return true;
 }
 
 void ExynosDisplay::requestLhbm(bool on) {
@@ -1661,8 +1618,7 @@ int ExynosDisplay::skipStaticLayers(ExynosCompositionInfo& compositionInfo)
 
     if ((compositionInfo.mHasCompositionLayer == false) ||
         (compositionInfo.mFirstIndex < 0) ||
-        (compositionInfo.mLastIndex < 0) ||
-        ((compositionInfo.mLastIndex - compositionInfo.mFirstIndex + 1) > NUM_SKIP_STATIC_LAYER)) {
+        (compositionInfo.mLastIndex < 0)) {
         DISPLAY_LOGD(eDebugSkipStaicLayer, "mHasCompositionLayer(%d), mFirstIndex(%d), mLastIndex(%d)",
                 compositionInfo.mHasCompositionLayer,
                 compositionInfo.mFirstIndex, compositionInfo.mLastIndex);
@@ -1670,52 +1626,48 @@ int ExynosDisplay::skipStaticLayers(ExynosCompositionInfo& compositionInfo)
         return NO_ERROR;
     }
 
-    if (compositionInfo.mSkipStaticInitFlag) {
-        bool isChanged = skipStaticLayerChanged(compositionInfo);
-        if (isChanged == true) {
-            compositionInfo.mSkipStaticInitFlag = false;
-            return NO_ERROR;
-        }
-
-        for (size_t i = (size_t)compositionInfo.mFirstIndex; i <= (size_t)compositionInfo.mLastIndex; i++) {
-            ExynosLayer *layer = mLayers[i];
-            if (layer->mValidateCompositionType == COMPOSITION_CLIENT) {
-                layer->mOverlayInfo |= eSkipStaticLayer;
-            } else {
-                compositionInfo.mSkipStaticInitFlag = false;
-                if (layer->mOverlayPriority < ePriorityHigh) {
-                    DISPLAY_LOGE("[%zu] Invalid layer type: %d",
-                            i, layer->mValidateCompositionType);
-                    return -EINVAL;
-                } else {
-                    return NO_ERROR;
-                }
-            }
-        }
-
-        compositionInfo.mSkipFlag = true;
-        DISPLAY_LOGD(eDebugSkipStaicLayer, "SkipStaicLayer is enabled");
+    std::optional<uint64_t> signature = getSkipStaticSignature(compositionInfo);
+    if (!signature.has_value()) {
+        compositionInfo.mSkipStaticInitFlag = false;
         return NO_ERROR;
     }
 
+    auto getState = [&](size_t i) {
+        return mLayers[compositionInfo.mFirstIndex + i]->getClientState();
+    };
+    uint32_t stableFrames = compositionInfo.mSkipStaticLayers.update(
+            compositionInfo.mSkipStaticInitFlag, signature.value(),
+            compositionInfo.mLastIndex - compositionInfo.mFirstIndex + 1, getState);
     compositionInfo.mSkipStaticInitFlag = true;
-    memset(&compositionInfo.mSkipSrcInfo, 0, sizeof(compositionInfo.mSkipSrcInfo));
-    for (int i = 0; i < NUM_SKIP_STATIC_LAYER; i++) {
-        compositionInfo.mSkipSrcInfo.srcInfo[i].acquireFenceFd = -1;
-        compositionInfo.mSkipSrcInfo.srcInfo[i].releaseFenceFd = -1;
-        compositionInfo.mSkipSrcInfo.dstInfo[i].acquireFenceFd = -1;
-        compositionInfo.mSkipSrcInfo.dstInfo[i].releaseFenceFd = -1;
+    if (stableFrames == 0) {
+        DISPLAY_LOGD(eDebugSkipStaicLayer, "Client composition signature is initialized, 0x%" PRIx64 "",
+                signature.value());
+        return NO_ERROR;
+    }
+    if (stableFrames < SKIP_STATIC_LAYER_STABLE_FRAMES) {
+        DISPLAY_LOGD(eDebugSkipStaicLayer, "Client composition is stable for %d frames",
+                stableFrames);
+        return NO_ERROR;
     }
 
     for (size_t i = (size_t)compositionInfo.mFirstIndex; i <= (size_t)compositionInfo.mLastIndex; i++) {
         ExynosLayer *layer = mLayers[i];
-        size_t index = i - compositionInfo.mFirstIndex;
-        compositionInfo.mSkipSrcInfo.srcInfo[index] = layer->mSrcImg;
-        compositionInfo.mSkipSrcInfo.dstInfo[index] = layer->mDstImg;
-        DISPLAY_LOGD(eDebugSkipStaicLayer, "mSkipSrcInfo.srcInfo[%zu] is initialized, %p",
-                index, layer->mSrcImg.bufferHandle);
+        if (layer->mValidateCompositionType == COMPOSITION_CLIENT) {
+            layer->mOverlayInfo |= eSkipStaticLayer;
+        } else {
+            compositionInfo.mSkipStaticInitFlag = false;
+            if (layer->mOverlayPriority < ePriorityHigh) {
+                DISPLAY_LOGE("[%zu] Invalid layer type: %d",
+                        i, layer->mValidateCompositionType);
+                return -EINVAL;
+            } else {
+                return NO_ERROR;
+            }
+        }
     }
-    compositionInfo.mSkipSrcInfo.srcNum = (compositionInfo.mLastIndex - compositionInfo.mFirstIndex + 1);
+
+    compositionInfo.mSkipFlag = true;
+    DISPLAY_LOGD(eDebugSkipStaicLayer, "SkipStaicLayer is enabled");
     return NO_ERROR;
 }
 
@@ -2730,11 +2682,12 @@ int ExynosDisplay::deliverWinConfigData() {
         }
         if (mUsePowerHints) {
             mRetireFenceAcquireTime = systemTime();
+            mCommitHoldTime = 0;
         }
-        for (size_t i = 0; i < mDpuData.configs.size(); i++) {
-            setFenceInfo(mDpuData.configs[i].acq_fence, this, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_DPP,
-                         HwcFenceDirection::TO);
-        }
+        mConfigFences.clear();
+        for (const auto &config : mDpuData.configs) mConfigFences.push_back(config.acq_fence);
+        setFenceInfos(mConfigFences, this, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_DPP,
+                      HwcFenceDirection::TO);
 
         if ((ret = mDisplayInterface->deliverWinConfigData()) < 0) {
             errString.appendFormat("interface's deliverWinConfigData() failed: %s ret(%d)\n", strerror(errno), ret);
@@ -2743,10 +2696,10 @@ int ExynosDisplay::deliverWinConfigData() {
             mLastDpuData = mDpuData;
         }
 
-        for (size_t i = 0; i < mDpuData.configs.size(); i++) {
-            setFenceInfo(mDpuData.configs[i].rel_fence, this, FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP,
-                         HwcFenceDirection::FROM);
-        }
+        mConfigFences.clear();
+        for (const auto &config : mDpuData.configs) mConfigFences.push_back(config.rel_fence);
+        setFenceInfos(mConfigFences, this, FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP,
+                      HwcFenceDirection::FROM);
         setFenceInfo(mDpuData.retire_fence, this, FENCE_TYPE_RETIRE, FENCE_IP_DPP,
                      HwcFenceDirection::FROM);
     }
@@ -2779,22 +2732,26 @@ int ExynosDisplay::setReleaseFences() {
 
         exynos_win_config_data &config = mDpuData.configs[mClientCompositionInfo.mWindowIndex];
 
-        for (int i = mClientCompositionInfo.mFirstIndex; i <= mClientCompositionInfo.mLastIndex; i++) {
-            if (mLayers[i]->mExynosCompositionType != HWC2_COMPOSITION_CLIENT) {
-                if(mLayers[i]->mOverlayPriority < ePriorityHigh) {
-                    errString.appendFormat("%d layer compositionType is not client(%d)\n", i, mLayers[i]->mExynosCompositionType);
-                    goto err;
-                } else {
-                    continue;
-                }
-            }
-            if (mType == HWC_DISPLAY_VIRTUAL)
-                mLayers[i]->mReleaseFence = -1;
-            else
-                mLayers[i]->mReleaseFence =
-                    hwcCheckFenceDebug(this, FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP,
-                            hwc_dup(config.rel_fence, this,
-                                FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP));
+        /* The client layers of the virtual display get no release fence */
+        int noFence = -1;
+        int &relFence = (mType == HWC_DISPLAY_VIRTUAL) ? noFence : config.rel_fence;
+        int invalidIndex = handOutClientReleaseFence(
+                relFence, mClientCompositionInfo.mFirstIndex, mClientCompositionInfo.mLastIndex,
+                [this](int i) {
+                    return mLayers[i]->mExynosCompositionType == HWC2_COMPOSITION_CLIENT;
+                },
+                [this](int i) { return mLayers[i]->mOverlayPriority >= ePriorityHigh; },
+                [this](int fd) {
+                    return hwc_dup(fd, this, FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP);
+                },
+                [this](int i, int fd) {
+                    mLayers[i]->mReleaseFence =
+                            hwcCheckFenceDebug(this, FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP, fd);
+                });
+        if (invalidIndex >= 0) {
+            errString.appendFormat("%d layer compositionType is not client(%d)\n", invalidIndex,
+                                   mLayers[invalidIndex]->mExynosCompositionType);
+            goto err;
         }
         config.rel_fence = fence_close(config.rel_fence, this,
                    FENCE_TYPE_SRC_RELEASE, FENCE_IP_FB);
@@ -3451,6 +3408,8 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
         *outRetireFence = -1;
         mRenderingState = RENDERING_STATE_PRESENTED;
         applyExpectedPresentTime();
+        // close the frame opened by the validation, it has no retire fence
+        mFrameTimeline.endFrame();
         return ret;
     }
 
@@ -3469,6 +3428,9 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
             presentPostProcessing();
     });
 
+    beginFrameTimeline();
+    mFrameTimeline.stamp(FrameTimeline::Stage::PRESENT_START);
+
     if (mSkipFrame) {
         ALOGI("[%d] presentDisplay is skipped by mSkipFrame", mDisplayId);
         closeFencesForSkipFrame(RENDERING_STATE_PRESENTED);
@@ -3636,6 +3598,7 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
     handleWindowUpdate();
 
     setDisplayWinConfigData();
+    mFrameTimeline.stamp(FrameTimeline::Stage::COMMIT_BUILT);
 
     if ((ret = deliverWinConfigData()) != NO_ERROR) {
         HWC_LOGE(this, "%s:: fail to deliver win_config (%d)", __func__, ret);
@@ -3643,6 +3606,7 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
             fence_close(mDpuData.retire_fence, this, FENCE_TYPE_RETIRE, FENCE_IP_DPP);
         mDpuData.retire_fence = -1;
     }
+    mFrameTimeline.stamp(FrameTimeline::Stage::COMMIT_DONE);
 
     setReleaseFences();
 
@@ -3726,7 +3690,9 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
         updateAverages(now);
         nsecs_t duration = now - mPresentStartTime;
         if (mRetireFenceWaitTime.has_value() && mRetireFenceAcquireTime.has_value()) {
-            duration = now - *mRetireFenceAcquireTime + *mRetireFenceWaitTime - mPresentStartTime;
+            duration = CommitScheduler::getWorkDuration(*mRetireFenceAcquireTime, now,
+                                                        mCommitHoldTime) +
+                    *mRetireFenceWaitTime - mPresentStartTime;
         }
         mPowerHalHint.signalActualWorkDuration(duration + mValidationDuration.value_or(0));
     }
@@ -3767,9 +3733,17 @@ not_validated:
 int32_t ExynosDisplay::presentPostProcessing()
 {
     setReadbackBufferInternal(NULL, -1, false);
-    if (mDpuData.enable_readback)
+    if (mReadbackStreamer) {
+        int32_t fence = -1;
+        if (mDpuData.enable_readback)
+            getReadbackBufferFence(&fence);
+        mReadbackStreamer->queueFrame(fence);
+    } else if (mDpuData.enable_readback) {
         mDevice->signalReadbackDone();
+    }
     mDpuData.enable_readback = false;
+    if (mReadbackStreamer)
+        armReadbackStream();
 
     for (auto it : mIgnoreLayers) {
         /*
@@ -3781,9 +3755,25 @@ int32_t ExynosDisplay::presentPostProcessing()
         }
         it->mAcquireFence = -1;
     }
+
+    mFrameTimeline.stamp(FrameTimeline::Stage::RELEASE);
+    mTimelineRetirePendingFrame = mFrameTimeline.endFrame();
     return NO_ERROR;
 }
 
+void ExynosDisplay::beginFrameTimeline()
+{
+    // the previous retire fence usually signals before the next frame starts
+    if (mTimelineRetirePendingFrame.has_value()) {
+        nsecs_t signalTime = getSignalTime(mLastRetireFence);
+        if (signalTime != SIGNAL_TIME_INVALID && signalTime != SIGNAL_TIME_PENDING) {
+            mFrameTimeline.stampRetire(*mTimelineRetirePendingFrame, signalTime);
+            mTimelineRetirePendingFrame = std::nullopt;
+        }
+    }
+    mFrameTimeline.beginFrame();
+}
+
 int32_t ExynosDisplay::setActiveConfig(hwc2_config_t config)
 {
     Mutex::Autolock lock(mDisplayMutex);
@@ -4174,6 +4164,22 @@ int32_t ExynosDisplay::setActiveConfigWithConstraints(hwc2_config_t config,
         return HWC2_ERROR_NONE;
     }
 
+    if (mPendingConfigSwitch.isSupersededBy(mConfigRequestState, config) &&
+        mXres == mDisplayConfigs[config].width && mYres == mDisplayConfigs[config].height) {
+        DISPLAY_LOGD(eDebugDisplayConfig, "%s: pending config %d superseded by %d", __func__,
+                     mDesiredConfig, config);
+        mConfigRequestState = hwc_request_state_t::SET_CONFIG_STATE_DONE;
+        mDesiredConfig = config;
+        mActiveConfig = config;
+        DISPLAY_ATRACE_INT("Pending ActiveConfig", 0);
+
+        outTimeline->refreshRequired = false;
+        outTimeline->newVsyncAppliedTimeNanos = vsyncPeriodChangeConstraints->desiredTimeNanos;
+        mVsyncAppliedTimeLine = *outTimeline;
+        updateBtsVsyncPeriod(getDisplayVsyncPeriodFromConfig(config), true);
+        return HWC2_ERROR_NONE;
+    }
+
     if ((mXres != mDisplayConfigs[config].width) || (mYres != mDisplayConfigs[config].height)) {
         if ((mDisplayInterface->setActiveConfigWithConstraints(config, true)) != NO_ERROR) {
             ALOGW("Mode change not possible");
@@ -4197,6 +4203,7 @@ int32_t ExynosDisplay::setActiveConfigWithConstraints(hwc2_config_t config,
                      __func__, mDesiredConfig, config);
     }
     /* Config would be requested on present time */
+    mPendingConfigSwitch.onPending(mConfigRequestState, mActiveConfig);
     mConfigRequestState = hwc_request_state_t::SET_CONFIG_STATE_PENDING;
     mVsyncPeriodChangeConstraints = *vsyncPeriodChangeConstraints;
     mDesiredConfig = config;
@@ -4508,6 +4515,9 @@ int32_t ExynosDisplay::setPowerMode(
     mPowerModeState = (hwc2_power_mode_t)mode;
 
     if (mode == HWC_POWER_MODE_OFF) {
+        /* the buffers returned later are freed by the periodic trim */
+        mResourceManager->getDstBufferPool().clear(mDisplayId);
+
         /* It should be called from validate() when the screen is on */
         mSkipFrame = true;
         setGeometryChanged(GEOMETRY_DISPLAY_POWER_OFF);
@@ -4576,7 +4586,10 @@ int32_t ExynosDisplay::validateDisplay(
     bool validateError = false;
     mUpdateEventCnt++;
     mUpdateCallCnt++;
+    mValidateGeneration++;
     mLastUpdateTimeStamp = systemTime(SYSTEM_TIME_MONOTONIC);
+    beginFrameTimeline();
+    mFrameTimeline.stamp(FrameTimeline::Stage::VALIDATE_START, mLastUpdateTimeStamp);
 
     if (usePowerHintSession()) {
         mValidateStartTime = mLastUpdateTimeStamp;
@@ -4618,6 +4631,7 @@ int32_t ExynosDisplay::validateDisplay(
         printDebugInfos(errString);
         mDisplayInterface->setForcePanic();
     }
+    mFrameTimeline.stamp(FrameTimeline::Stage::RESOURCE_ASSIGNED);
 
     if ((ret = skipStaticLayers(mClientCompositionInfo)) != NO_ERROR) {
         validateError = true;
@@ -4683,6 +4697,7 @@ int32_t ExynosDisplay::validateDisplay(
     }
 
     mSkipFrame = false;
+    mFrameTimeline.stamp(FrameTimeline::Stage::VALIDATE_END);
 
     if ((*outNumTypes == 0) && (*outNumRequests == 0))
         return HWC2_ERROR_NONE;
@@ -4790,6 +4805,13 @@ void ExynosDisplay::dump(String8& result)
 
     result.appendFormat("PanelGammaSource (%d)\n\n", GetCurrentPanelGammaSource());
 
+    if (mWindowUpdateStats.frames) {
+        result.appendFormat("WindowUpdate: partial %" PRIu64 "/%" PRIu64 " frames, saved %" PRIu64
+                            " pixels\n\n",
+                            mWindowUpdateStats.partialFrames, mWindowUpdateStats.frames,
+                            mWindowUpdateStats.savedPixels);
+    }
+
     {
         Mutex::Autolock lock(mDRMutex);
         if (mLayers.size()) {
@@ -4814,6 +4836,14 @@ void ExynosDisplay::dump(String8& result)
     if (mHistogramController) {
         mHistogramController->dump(result);
     }
+    if (mUsePowerHintSession.value_or(false)) {
+        mDurationPredictor.dump(result);
+    }
+    if (mReadbackStreamer) {
+        mReadbackStreamer->dump(result);
+    }
+    mFrameTimeline.dump(result);
+    mCommitScheduler.dump(result);
 }
 
 void ExynosDisplay::dumpConfig(String8 &result, const exynos_win_config_data &c)
@@ -5388,6 +5418,10 @@ bool ExynosDisplay::windowUpdateExceptions()
     for (size_t i = 0; i < mLayers.size(); i++) {
         if (mLayers[i]->mM2mMPP != NULL) return true;
         if (mLayers[i]->mLayerBuffer == NULL) return true;
+        /*
+         * The DPU crops the source of each window against the update region
+         * assuming the window is neither rotated nor flipped.
+         */
         if (mLayers[i]->mTransform != 0) return true;
     }
 
@@ -5495,13 +5529,18 @@ int ExynosDisplay::handleWindowUpdate()
     DISPLAY_LOGD(eDebugWindowUpdate, "Partial(origin) : %d, %d, %d, %d",
             mergedRect.left, mergedRect.top, mergedRect.right, mergedRect.bottom);
 
-    if (mergedRect.left < 0) mergedRect.left = 0;
-    if (mergedRect.right > (int32_t)mXres) mergedRect.right = mXres;
-    if (mergedRect.top < 0) mergedRect.top = 0;
-    if (mergedRect.bottom > (int32_t)mYres) mergedRect.bottom = mYres;
+    mergedRect = getWindowUpdateRegion(mergedRect, mXres, mYres, mWindowUpdateAlign.x,
+                                       mWindowUpdateAlign.y);
+    if (rectArea(mergedRect) == 0) {
+        DISPLAY_LOGD(eDebugWindowUpdate, "Partial canceled, out of the panel");
+        return 0;
+    }
 
-    if (mergedRect.left == 0 && mergedRect.right == (int32_t)mXres &&
-        mergedRect.top == 0 && mergedRect.bottom == (int32_t)mYres) {
+    const uint64_t fullArea = static_cast<uint64_t>(mXres) * mYres;
+    const uint64_t partialArea = rectArea(mergedRect);
+    mWindowUpdateStats.frames++;
+
+    if (partialArea == fullArea) {
         DISPLAY_LOGD(eDebugWindowUpdate, "Partial : Full size");
         mDpuData.enable_win_update = true;
         mDpuData.win_update_region.x = 0;
@@ -5512,6 +5551,9 @@ int ExynosDisplay::handleWindowUpdate()
         return 0;
     }
 
+    mWindowUpdateStats.partialFrames++;
+    mWindowUpdateStats.savedPixels += fullArea - partialArea;
+
     mDpuData.enable_win_update = true;
     mDpuData.win_update_region.x = mergedRect.left;
     mDpuData.win_update_region.w = WIDTH(mergedRect);
@@ -5557,15 +5599,15 @@ unsigned int ExynosDisplay::getLayerRegion(ExynosLayer *layer, hwc_rect *rect_ar
                 return eDamageRegionFull;
             }
 
-            rect.left = layer->mDisplayFrame.left + hwcRects[j].left - layer->mSourceCrop.left;
-            rect.top = layer->mDisplayFrame.top + hwcRects[j].top - layer->mSourceCrop.top;
-            rect.right = layer->mDisplayFrame.left + hwcRects[j].right - layer->mSourceCrop.left;
-            rect.bottom = layer->mDisplayFrame.top + hwcRects[j].bottom - layer->mSourceCrop.top;
+            rect = transformDamage(hwcRects[j], layer->mSourceCrop, layer->mDisplayFrame);
             DISPLAY_LOGD(eDebugWindowUpdate, "Display frame : %d, %d, %d, %d", layer->mDisplayFrame.left,
                     layer->mDisplayFrame.top, layer->mDisplayFrame.right, layer->mDisplayFrame.bottom);
             DISPLAY_LOGD(eDebugWindowUpdate, "hwcRects : %d, %d, %d, %d", hwcRects[j].left,
                     hwcRects[j].top, hwcRects[j].right, hwcRects[j].bottom);
             adjustRect(rect, INT_MAX, INT_MAX);
+            /* outside of the source crop */
+            if (rectArea(rect) == 0)
+                continue;
             /* Get sums of rects */
             *rect_area = expand(*rect_area, rect);
         }
@@ -5858,6 +5900,14 @@ int32_t ExynosDisplay::setReadbackBuffer(buffer_handle_t buffer,
     if (buffer == nullptr)
         return HWC2_ERROR_BAD_PARAMETER;
 
+    if (mReadbackStreamer) {
+        DISPLAY_LOGE("readback is being streamed, buffer(%p)", buffer);
+        if (releaseFence >= 0)
+            releaseFence = fence_close(releaseFence, this,
+                    FENCE_TYPE_READBACK_RELEASE, FENCE_IP_FB);
+        return HWC2_ERROR_NO_RESOURCES;
+    }
+
     if (mDisplayControl.readbackSupport) {
         mDpuData.enable_readback = true;
     } else {
@@ -5894,6 +5944,65 @@ void ExynosDisplay::setReadbackBufferInternal(buffer_handle_t buffer,
     mDpuData.readback_info.requested_from_service = requestedService;
 }
 
+int32_t ExynosDisplay::setReadbackStream(uint32_t ringSize)
+{
+    /*
+     * Stopping a stream waits for the queued readback fences and writes the frames,
+     * which can take seconds. The stopped streamer is declared before the lock so it
+     * is destroyed after mDisplayMutex is released.
+     */
+    std::unique_ptr<ReadbackStreamer> stoppedStreamer;
+    Mutex::Autolock lock(mDisplayMutex);
+
+    if (mReadbackStreamer) {
+        /* The armed buffer is freed with the streamer */
+        setReadbackBufferInternal(NULL, -1, false);
+        mDpuData.readback_info.handle = NULL;
+        mDpuData.enable_readback = false;
+        stoppedStreamer = std::move(mReadbackStreamer);
+    }
+
+    if (ringSize == 0)
+        return HWC2_ERROR_NONE;
+
+    if (!mDisplayControl.readbackSupport) {
+        DISPLAY_LOGE("readback is not supported");
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+
+    int32_t format, dataspace;
+    int32_t ret = getReadbackBufferAttributes(&format, &dataspace);
+    if (ret != HWC2_ERROR_NONE)
+        return ret;
+
+    String8 filePath;
+    time_t curTime = time(NULL);
+    struct tm *tm = localtime(&curTime);
+    filePath.appendFormat("%s/stream_display%d_format%d_%dx%d_%04d-%02d-%02d_%02d_%02d_%02d.rbs",
+            WRITEBACK_CAPTURE_PATH, mDisplayId, format, mXres, mYres,
+            tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+            tm->tm_hour, tm->tm_min, tm->tm_sec);
+
+    auto streamer = std::make_unique<ReadbackStreamer>(this);
+    if (streamer->start(format, mXres, mYres, ringSize, filePath) != NO_ERROR)
+        return HWC2_ERROR_NO_RESOURCES;
+
+    mReadbackStreamer = std::move(streamer);
+    armReadbackStream();
+    return HWC2_ERROR_NONE;
+}
+
+void ExynosDisplay::armReadbackStream()
+{
+    /* The frame is not read back if the ring is full */
+    buffer_handle_t buffer = mReadbackStreamer->armFrame();
+    if (buffer == NULL)
+        return;
+
+    setReadbackBufferInternal(buffer, -1, true);
+    mDpuData.enable_readback = true;
+}
+
 int32_t ExynosDisplay::getReadbackBufferFence(int32_t* outFence)
 {
     /*
@@ -6054,6 +6163,26 @@ bool ExynosDisplay::usePowerHintSession() {
     return mUsePowerHintSession.value_or(false);
 }
 
+CommitScheduler::ScopedFrame ExynosDisplay::beginCommitLatch() {
+    /*
+     * Hold the commit only for a hint of SurfaceFlinger or a prediction from a signaled
+     * retire fence. The fallback of getPredictedPresentTime() is a guess and holding for
+     * it may miss the vsync.
+     */
+    nsecs_t expectedPresentTime = 0;
+    ExynosDisplay *primaryDisplay = mDevice->getDisplay(HWC_DISPLAY_PRIMARY);
+    if (primaryDisplay) expectedPresentTime = primaryDisplay->getPendingExpectedPresentTime();
+    if (expectedPresentTime == 0) {
+        auto lastRetireFenceSignalTime = getSignalTime(mLastRetireFence);
+        if (lastRetireFenceSignalTime != SIGNAL_TIME_INVALID &&
+            lastRetireFenceSignalTime != SIGNAL_TIME_PENDING)
+            expectedPresentTime = lastRetireFenceSignalTime + mVsyncPeriod;
+    }
+
+    mCommitHoldTime = mCommitScheduler.beginFrame(expectedPresentTime, mVsyncPeriod);
+    return CommitScheduler::ScopedFrame(&mCommitScheduler);
+}
+
 nsecs_t ExynosDisplay::getExpectedPresentTime(nsecs_t startTime) {
     ExynosDisplay *primaryDisplay = mDevice->getDisplay(HWC_DISPLAY_PRIMARY);
     if (primaryDisplay) {
@@ -6119,7 +6248,36 @@ nsecs_t ExynosDisplay::getSignalTime(int32_t fd) const {
     return nsecs_t(timestamp);
 }
 
+PresentDurationPredictor::Features ExynosDisplay::getPresentFeatures() const {
+    PresentDurationPredictor::Features features;
+
+    // the composition of the last validation, which is the current one if validation is skipped
+    for (size_t i = 0; i < mLayers.size(); i++) {
+        ExynosLayer *layer = mLayers[i];
+        if (layer->mValidateCompositionType == HWC2_COMPOSITION_DEVICE &&
+            layer->mM2mMPP == nullptr)
+            features.deviceLayers++;
+        else if (layer->mValidateCompositionType == HWC2_COMPOSITION_EXYNOS ||
+                 layer->mM2mMPP != nullptr)
+            features.m2mLayers++;
+        features.srcPixels += static_cast<uint64_t>(WIDTH(layer->mSourceCrop)) *
+                HEIGHT(layer->mSourceCrop);
+    }
+    features.layers = mLayers.size();
+    features.clientComposition = mClientCompositionInfo.mHasCompositionLayer;
+    features.geometryChanged = mGeometryChanged != 0;
+    features.refreshRate = mVsyncPeriod ? static_cast<uint32_t>(nsecsPerSec / mVsyncPeriod) : 0;
+
+    return features;
+}
+
 std::optional<nsecs_t> ExynosDisplay::getPredictedDuration(bool duringValidation) {
+    mPresentFeatures = getPresentFeatures();
+    mPresentPrediction = mDurationPredictor.predict(*mPresentFeatures, duringValidation);
+    if (mPresentPrediction.has_value()) {
+        return mPresentPrediction;
+    }
+
     AveragesKey beforeFenceKey(mLayers.size(), duringValidation, true);
     AveragesKey afterFenceKey(mLayers.size(), duringValidation, false);
     if (mRollingAverages.count(beforeFenceKey) == 0 || mRollingAverages.count(afterFenceKey) == 0) {
@@ -6131,16 +6289,28 @@ std::optional<nsecs_t> ExynosDisplay::getPredictedDuration(bool duringValidation
 }
 
 void ExynosDisplay::updateAverages(nsecs_t endTime) {
+    std::optional<PresentDurationPredictor::Features> features = mPresentFeatures;
+    std::optional<nsecs_t> prediction = mPresentPrediction;
+    mPresentFeatures = std::nullopt;
+    mPresentPrediction = std::nullopt;
+
     if (!mRetireFenceWaitTime.has_value() || !mRetireFenceAcquireTime.has_value()) {
         return;
     }
     nsecs_t beforeFenceTime =
             mValidationDuration.value_or(0) + (*mRetireFenceWaitTime - mPresentStartTime);
-    nsecs_t afterFenceTime = endTime - *mRetireFenceAcquireTime;
+    nsecs_t afterFenceTime =
+            CommitScheduler::getWorkDuration(*mRetireFenceAcquireTime, endTime, mCommitHoldTime);
     mRollingAverages[AveragesKey(mLayers.size(), mValidationDuration.has_value(), true)].insert(
             beforeFenceTime);
     mRollingAverages[AveragesKey(mLayers.size(), mValidationDuration.has_value(), false)].insert(
             afterFenceTime);
+
+    if (features.has_value()) {
+        nsecs_t actual = beforeFenceTime + afterFenceTime;
+        if (prediction.has_value()) mDurationPredictor.recordError(*prediction, actual);
+        mDurationPredictor.update(*features, mValidationDuration.has_value(), actual);
+    }
 }
 
 int32_t ExynosDisplay::getRCDLayerSupport(bool &outSupport) const {
@@ -27,6 +27,7 @@
 #include <chrono>
 #include <set>
 
+#include "ClientLayerState.h"
 #include "DeconHeader.h"
 #include "ExynosDisplayInterface.h"
 #include "ExynosHWC.h"
@@ -35,6 +36,11 @@
 #include "ExynosHwc3Types.h"
 #include "ExynosMPP.h"
 #include "ExynosResourceManager.h"
+#include "CommitScheduler.h"
+#include "FrameTimeline.h"
+#include "PendingConfigSwitch.h"
+#include "PresentDurationPredictor.h"
+#include "ReadbackStreamer.h"
 #include "drmeventlistener.h"
 #include "worker.h"
 
@@ -143,12 +149,6 @@ enum class PanelGammaSource {
     GAMMA_TYPES,
 };
 
-enum class hwc_request_state_t {
-    SET_CONFIG_STATE_DONE = 0,
-    SET_CONFIG_STATE_PENDING,
-    SET_CONFIG_STATE_REQUESTED,
-};
-
 enum class VrrThrottleRequester : uint32_t {
     PIXEL_DISP = 0,
     TEST,
@@ -163,14 +163,6 @@ enum class DispIdleTimerRequester : uint32_t {
     MAX,
 };
 
-#define NUM_SKIP_STATIC_LAYER  5
-struct ExynosFrameInfo
-{
-    uint32_t srcNum;
-    exynos_image srcInfo[NUM_SKIP_STATIC_LAYER];
-    exynos_image dstInfo[NUM_SKIP_STATIC_LAYER];
-};
-
 struct exynos_readback_info
 {
     buffer_handle_t handle = NULL;
@@ -321,7 +313,8 @@ class ExynosCompositionInfo : public ExynosMPPSource {
         bool mEnableSkipStatic;
         bool mSkipStaticInitFlag;
         bool mSkipFlag;
-        ExynosFrameInfo mSkipSrcInfo;
+        /* the client composition layers recorded when mSkipStaticInitFlag is set */
+        StaticClientLayers mSkipStaticLayers;
         exynos_win_config_data mLastWinConfigData;
 
         int32_t mWindowIndex;
@@ -497,6 +490,8 @@ class ExynosDisplay {
         uint64_t mLastUpdateTimeStamp;
         uint64_t mUpdateEventCnt;
         uint64_t mUpdateCallCnt;
+        /* counts the validations, never reset unlike mUpdateEventCnt */
+        uint64_t mValidateGeneration = 0;
 
         /* default DMA for the display */
         decon_idma_type mDefaultDMA;
@@ -511,6 +506,12 @@ class ExynosDisplay {
          */
         exynos_dpu_data mLastDpuData;
 
+        /**
+         * Fences of the win_configs updated to the fence tracker at once.
+         * The capacity is kept between the frames.
+         */
+        std::vector<int32_t> mConfigFences;
+
         /**
          * Restore release fenc from DECON.
          */
@@ -566,6 +567,7 @@ class ExynosDisplay {
         hwc_vsync_period_change_timeline_t mVsyncAppliedTimeLine;
         hwc_request_state_t mConfigRequestState;
         hwc2_config_t mDesiredConfig;
+        PendingConfigSwitch mPendingConfigSwitch;
 
         hwc2_config_t mActiveConfig = UINT_MAX;
         hwc2_config_t mPendingConfig = UINT_MAX;
@@ -1175,6 +1177,9 @@ class ExynosDisplay {
         int32_t getReadbackBufferFence(int32_t* outFence);
         /* This function is called by ExynosDisplayInterface class to set acquire fence*/
         int32_t setReadbackBufferAcqFence(int32_t acqFence);
+        /* Streams the readback of every frame with @ringSize buffers. 0 stops the stream */
+        int32_t setReadbackStream(uint32_t ringSize);
+        void armReadbackStream();
 
         virtual void dump(String8& result);
 
@@ -1190,6 +1195,21 @@ class ExynosDisplay {
         int handleWindowUpdate();
         bool windowUpdateExceptions();
 
+        /*
+         * The granularity of the partial update of the panel. The update region
+         * is aligned to it before it is programmed and counted in the stats.
+         */
+        struct {
+            int32_t x = 1;
+            int32_t y = 1;
+        } mWindowUpdateAlign;
+        struct WindowUpdateStats {
+            uint64_t frames = 0;
+            uint64_t partialFrames = 0;
+            /* pixels not transferred by the partial updates */
+            uint64_t savedPixels = 0;
+        } mWindowUpdateStats;
+
         /* For debugging */
         void setHWC1LayerList(hwc_display_contents_1_t *contents) {mHWC1LayerList = contents;};
         void traceLayerTypes();
@@ -1244,6 +1264,10 @@ class ExynosDisplay {
         virtual void setExpectedPresentTime(uint64_t __unused timestamp) {}
         virtual uint64_t getPendingExpectedPresentTime() { return 0; }
         virtual void applyExpectedPresentTime() {}
+        /* Holds the commit of the frame until its latch time, see CommitScheduler. The frame
+         * ends with the returned scope */
+        CommitScheduler::ScopedFrame beginCommitLatch();
+        bool isCommitSchedulerEnabled() const { return mCommitScheduler.isEnabled(); }
         virtual int32_t getDisplayIdleTimerSupport(bool& outSupport);
         virtual int32_t getDisplayMultiThreadedPresentSupport(bool& outSupport);
         virtual int32_t setDisplayIdleTimer(const int32_t __unused timeoutMs) {
@@ -1328,6 +1352,7 @@ class ExynosDisplay {
 
     private:
         bool skipStaticLayerChanged(ExynosCompositionInfo& compositionInfo);
+        std::optional<uint64_t> getSkipStaticSignature(const ExynosCompositionInfo& compositionInfo);
 
         bool skipSignalIdle();
 
@@ -1539,6 +1564,23 @@ class ExynosDisplay {
         nsecs_t getSignalTime(int32_t fd) const;
         void updateAverages(nsecs_t endTime);
         std::optional<nsecs_t> getPredictedDuration(bool duringValidation);
+        PresentDurationPredictor::Features getPresentFeatures() const;
+        // the averages above are used until the predictor is trained
+        PresentDurationPredictor mDurationPredictor;
+        // the features the duration of the current frame was predicted from, and the
+        // prediction. The model is trained with the same features
+        std::optional<PresentDurationPredictor::Features> mPresentFeatures;
+        std::optional<nsecs_t> mPresentPrediction;
+        // the streaming readback, while it is enabled by HWC_CTL_STREAM_READBACK
+        std::unique_ptr<ReadbackStreamer> mReadbackStreamer;
+        // the stage timestamps of the recent frames
+        FrameTimeline mFrameTimeline;
+        CommitScheduler mCommitScheduler;
+        // how long the commit after mRetireFenceAcquireTime was held by mCommitScheduler
+        nsecs_t mCommitHoldTime = 0;
+        // the frame presented last, until its retire fence signal time is recorded
+        std::optional<uint64_t> mTimelineRetirePendingFrame;
+        void beginFrameTimeline();
         atomic_bool mDebugRCDLayerEnabled = true;
 
     protected:
@@ -190,74 +190,60 @@ int32_t ExynosLayer::doPreProcess()
     mPreprocessedInfo.mUsePrivateFormat = false;
     mPreprocessedInfo.mPrivateFormat = gmeta.format;
 
-    if (isFormatYUV(gmeta.format)) {
+    const bool isYuv = isFormatYUV(gmeta.format);
+
+    if (isYuv) {
         mPreprocessedInfo.sourceCrop.top = (int)mSourceCrop.top;
         mPreprocessedInfo.sourceCrop.left = (int)mSourceCrop.left;
         mPreprocessedInfo.sourceCrop.bottom = (int)(mSourceCrop.bottom + 0.9);
         mPreprocessedInfo.sourceCrop.right = (int)(mSourceCrop.right + 0.9);
         mPreprocessedInfo.preProcessed = true;
-    }
-
-    if (isFormatYUV(gmeta.format)) {
-
-        ExynosVideoMeta *metaData = NULL;
-        int priv_fd = -1;
-
-        if (gmeta.flags & VendorGraphicBufferMeta::PRIV_FLAGS_USES_2PRIVATE_DATA)
-            priv_fd = gmeta.fd1;
-        else if (gmeta.flags & VendorGraphicBufferMeta::PRIV_FLAGS_USES_3PRIVATE_DATA)
-            priv_fd = gmeta.fd2;
-
-        if (priv_fd >= 0) {
-
-            metaData = (ExynosVideoMeta*)mmap(0, sizeof(ExynosVideoMeta), PROT_READ|PROT_WRITE, MAP_SHARED, priv_fd, 0);
 
-            if (metaData == NULL) {
-                HWC_LOGE(mDisplay, "Layer's metadata is NULL!!");
-            } else if (metaData == MAP_FAILED) {
-                HWC_LOGE(mDisplay, "Layer's metadata map failed!!");
-            } else {
-                mBufferHasMetaParcel = true;
-                if ((metaData->eType & VIDEO_INFO_TYPE_HDR_STATIC) ||
-                        (metaData->eType & VIDEO_INFO_TYPE_HDR_DYNAMIC)) {
-                    if (allocMetaParcel() == NO_ERROR) {
-                        mMetaParcel->eType = metaData->eType;
-                        if (metaData->eType & VIDEO_INFO_TYPE_HDR_STATIC) {
-                            mMetaParcel->sHdrStaticInfo = metaData->sHdrStaticInfo;
-                            HDEBUGLOGD(eDebugLayer, "HWC2: Static metadata min(%d), max(%d)",
-                                    mMetaParcel->sHdrStaticInfo.sType1.mMinDisplayLuminance,
-                                    mMetaParcel->sHdrStaticInfo.sType1.mMaxDisplayLuminance);
-                        }
-                        if (metaData->eType & VIDEO_INFO_TYPE_HDR_DYNAMIC) {
-                            /* Reserved field for dynamic meta data */
-                            /* Currently It's not be used not only HWC but also OMX */
-                            mMetaParcel->sHdrDynamicInfo = metaData->sHdrDynamicInfo;
-                            HDEBUGLOGD(eDebugLayer, "HWC2: Layer has dynamic metadata");
-                        }
+        bool metaChanged = false;
+        ExynosVideoMeta *metaData = getVideoMeta(gmeta, metaChanged);
+
+        if (metaData != NULL) {
+            mBufferHasMetaParcel = true;
+            /* the parcel already holds the HDR info if it was parsed in this frame */
+            if (metaChanged && ((metaData->eType & VIDEO_INFO_TYPE_HDR_STATIC) ||
+                    (metaData->eType & VIDEO_INFO_TYPE_HDR_DYNAMIC))) {
+                if (allocMetaParcel() == NO_ERROR) {
+                    mMetaParcel->eType = metaData->eType;
+                    if (metaData->eType & VIDEO_INFO_TYPE_HDR_STATIC) {
+                        mMetaParcel->sHdrStaticInfo = metaData->sHdrStaticInfo;
+                        HDEBUGLOGD(eDebugLayer, "HWC2: Static metadata min(%d), max(%d)",
+                                mMetaParcel->sHdrStaticInfo.sType1.mMinDisplayLuminance,
+                                mMetaParcel->sHdrStaticInfo.sType1.mMaxDisplayLuminance);
                     }
-                }
-                if (metaData->eType & VIDEO_INFO_TYPE_INTERLACED) {
-                    mPreprocessedInfo.interlacedType = metaData->data.dec.nInterlacedType;
-                    if (mPreprocessedInfo.interlacedType == V4L2_FIELD_INTERLACED_BT) {
-                        if ((int)mSourceCrop.left < (int)(gmeta.stride)) {
-                            mPreprocessedInfo.sourceCrop.left = (int)mSourceCrop.left + gmeta.stride;
-                            mPreprocessedInfo.sourceCrop.right = (int)mSourceCrop.right + gmeta.stride;
-                        }
+                    if (metaData->eType & VIDEO_INFO_TYPE_HDR_DYNAMIC) {
+                        /* Reserved field for dynamic meta data */
+                        /* Currently It's not be used not only HWC but also OMX */
+                        mMetaParcel->sHdrDynamicInfo = metaData->sHdrDynamicInfo;
+                        HDEBUGLOGD(eDebugLayer, "HWC2: Layer has dynamic metadata");
                     }
-                    if (mPreprocessedInfo.interlacedType == V4L2_FIELD_INTERLACED_TB ||
-                            mPreprocessedInfo.interlacedType == V4L2_FIELD_INTERLACED_BT) {
-                        mPreprocessedInfo.sourceCrop.top = (int)(mSourceCrop.top)/2;
-                        mPreprocessedInfo.sourceCrop.bottom = (int)(mSourceCrop.bottom)/2;
+                }
+            }
+            if (metaData->eType & VIDEO_INFO_TYPE_INTERLACED) {
+                mPreprocessedInfo.interlacedType = metaData->data.dec.nInterlacedType;
+                if (mPreprocessedInfo.interlacedType == V4L2_FIELD_INTERLACED_BT) {
+                    if ((int)mSourceCrop.left < (int)(gmeta.stride)) {
+                        mPreprocessedInfo.sourceCrop.left = (int)mSourceCrop.left + gmeta.stride;
+                        mPreprocessedInfo.sourceCrop.right = (int)mSourceCrop.right + gmeta.stride;
                     }
                 }
-                if (metaData->eType & VIDEO_INFO_TYPE_CHECK_PIXEL_FORMAT) {
-                    mPreprocessedInfo.mUsePrivateFormat = true;
-                    mPreprocessedInfo.mPrivateFormat = metaData->nPixelFormat;
+                if (mPreprocessedInfo.interlacedType == V4L2_FIELD_INTERLACED_TB ||
+                        mPreprocessedInfo.interlacedType == V4L2_FIELD_INTERLACED_BT) {
+                    mPreprocessedInfo.sourceCrop.top = (int)(mSourceCrop.top)/2;
+                    mPreprocessedInfo.sourceCrop.bottom = (int)(mSourceCrop.bottom)/2;
                 }
-                munmap(metaData, sizeof(ExynosVideoMeta));
+            }
+            if (metaData->eType & VIDEO_INFO_TYPE_CHECK_PIXEL_FORMAT) {
+                mPreprocessedInfo.mUsePrivateFormat = true;
+                mPreprocessedInfo.mPrivateFormat = metaData->nPixelFormat;
             }
         }
-        mPreprocessedInfo.preProcessed = true;
+    } else if (!mVideoMetaCache.empty()) {
+        mVideoMetaCache.clear();
     }
 
     exynos_image src_img;
@@ -265,17 +251,13 @@ int32_t ExynosLayer::doPreProcess()
     setSrcExynosImage(&src_img);
     setDstExynosImage(&dst_img);
     ExynosMPP *exynosMPPVG = nullptr;
-    if (isFormatYUV(gmeta.format)) {
-        auto otfMPPs = ExynosResourceManager::getOtfMPPs();
-        auto mpp_it = std::find_if(otfMPPs.begin(), otfMPPs.end(),
-                [&src_img](auto m) { return m->isSrcFormatSupported(src_img); });
-        exynosMPPVG = mpp_it == otfMPPs.end() ? nullptr : *mpp_it;
-    }
+    if (isYuv)
+        exynosMPPVG = ExynosResourceManager::getOtfMPPForSrcFormat(src_img);
 
     /* Set HDR Flag */
     if(hasHdrInfo(src_img)) mIsHdrLayer = true;
 
-    if (isFormatYUV(gmeta.format) && exynosMPPVG) {
+    if (isYuv && exynosMPPVG) {
         /*
          * layer's sourceCrop should be aligned
          */
@@ -421,6 +403,7 @@ int32_t ExynosLayer::setLayerBuffer(buffer_handle_t buffer, int32_t acquireFence
     {
         Mutex::Autolock lock(mDisplay->mDRMutex);
         mLayerBuffer = buffer;
+        mVideoMetaCache.nextFrame();
         checkFps(mLastLayerBuffer != mLayerBuffer);
         if (mLayerBuffer != mLastLayerBuffer) {
             mLastUpdateTime = systemTime(CLOCK_MONOTONIC);
@@ -461,6 +444,7 @@ int32_t ExynosLayer::setLayerBuffer(buffer_handle_t buffer, int32_t acquireFence
     } else {
         setLayerDataspace(HAL_DATASPACE_UNKNOWN);
     }
+    updateClientSignature();
 
     HDEBUGLOGD(eDebugFence,
                "layers bufferHandle: %p, mDataSpace: 0x%8x, acquireFence: %d, compressionType: "
@@ -493,6 +477,7 @@ int32_t ExynosLayer::setLayerBlendMode(int32_t /*hwc2_blend_mode_t*/ mode) {
     if (mBlending != mode)
         setGeometryChanged(GEOMETRY_LAYER_BLEND_CHANGED);
     mBlending = mode;
+    updateClientSignature();
     return HWC2_ERROR_NONE;
 }
 
@@ -500,6 +485,7 @@ int32_t ExynosLayer::setLayerBlendMode(int32_t /*hwc2_blend_mode_t*/ mode) {
 int32_t ExynosLayer::setLayerColor(hwc_color_t color) {
     /* TODO : Implementation here */
     mColor = color;
+    updateClientSignature();
     return 0;
 }
 
@@ -563,9 +549,11 @@ int32_t ExynosLayer::setLayerDataspace(int32_t /*android_dataspace_t*/ dataspace
         // to be after dataspace update.
         if (mMetaParcel != nullptr) {
             mMetaParcel->eType = VIDEO_INFO_TYPE_INVALID;
+            mVideoMetaCache.invalidate();
         }
     }
     mDataSpace = currentDataSpace;
+    updateClientSignature();
 
     return HWC2_ERROR_NONE;
 }
@@ -578,6 +566,7 @@ int32_t ExynosLayer::setLayerDisplayFrame(hwc_rect_t frame) {
         (frame.bottom != mDisplayFrame.bottom))
         setGeometryChanged(GEOMETRY_LAYER_DISPLAYFRAME_CHANGED);
     mDisplayFrame = frame;
+    updateClientSignature();
 
     return HWC2_ERROR_NONE;
 }
@@ -597,6 +586,7 @@ int32_t ExynosLayer::setLayerPlaneAlpha(float alpha) {
         mLayerFlag &= ~(EXYNOS_HWC_IGNORE_LAYER);
     else
         mLayerFlag |= EXYNOS_HWC_IGNORE_LAYER;
+    updateClientSignature();
 
     return HWC2_ERROR_NONE;
 }
@@ -613,6 +603,7 @@ int32_t ExynosLayer::setLayerSourceCrop(hwc_frect_t crop) {
         (crop.bottom != mSourceCrop.bottom)) {
         setGeometryChanged(GEOMETRY_LAYER_SOURCECROP_CHANGED);
         mSourceCrop = crop;
+        updateClientSignature();
     }
 
     return HWC2_ERROR_NONE;
@@ -623,6 +614,7 @@ int32_t ExynosLayer::setLayerTransform(int32_t /*hwc_transform_t*/ transform) {
     if (mTransform != transform) {
         setGeometryChanged(GEOMETRY_LAYER_TRANSFORM_CHANGED);
         mTransform = transform;
+        updateClientSignature();
     }
 
     return HWC2_ERROR_NONE;
@@ -648,6 +640,7 @@ int32_t ExynosLayer::setLayerPerFrameMetadata(uint32_t numElements,
 {
     if (allocMetaParcel() != NO_ERROR)
         return -1;
+    mVideoMetaCache.invalidate();
     unsigned int multipliedVal = 50000;
     mMetaParcel->eType =
         static_cast<ExynosVideoInfoType>(mMetaParcel->eType | VIDEO_INFO_TYPE_HDR_STATIC);
@@ -721,6 +714,7 @@ int32_t ExynosLayer::setLayerPerFrameMetadataBlobs(uint32_t numElements, const i
         switch (keys[i]) {
         case HWC2_HDR10_PLUS_SEI:
             if (allocMetaParcel() == NO_ERROR) {
+                mVideoMetaCache.invalidate();
                 mMetaParcel->eType =
                     static_cast<ExynosVideoInfoType>(mMetaParcel->eType | VIDEO_INFO_TYPE_HDR_DYNAMIC);
                 ExynosHdrDynamicInfo *info = &(mMetaParcel->sHdrDynamicInfo);
@@ -776,6 +770,7 @@ int32_t ExynosLayer::setLayerBrightness(float brightness) {
         // Trigger display validation in case client composition is needed.
         setGeometryChanged(GEOMETRY_LAYER_WHITEPOINT_CHANGED);
         mBrightness = brightness;
+        updateClientSignature();
     }
     return HWC2_ERROR_NONE;
 }
@@ -1193,6 +1188,27 @@ void ExynosLayer::setGeometryChanged(uint64_t changedBit)
         mDisplay->setGeometryChanged(changedBit);
 }
 
+ClientLayerState ExynosLayer::getClientState() const
+{
+    ClientLayerState state;
+    state.layer = this;
+    state.buffer = mLayerBuffer;
+    state.sourceCrop = mSourceCrop;
+    state.displayFrame = mDisplayFrame;
+    state.dataSpace = mDataSpace;
+    state.blending = mBlending;
+    state.transform = mTransform;
+    state.planeAlpha = mPlaneAlpha;
+    state.color = mColor;
+    state.brightness = mBrightness;
+    return state;
+}
+
+void ExynosLayer::updateClientSignature()
+{
+    mClientSignature = getClientState().hash();
+}
+
 int ExynosLayer::allocMetaParcel()
 {
     /* Already allocated */
@@ -1225,6 +1241,28 @@ int ExynosLayer::allocMetaParcel()
     return NO_ERROR;
 }
 
+ExynosVideoMeta *ExynosLayer::getVideoMeta(const VendorGraphicBufferMeta &gmeta, bool &changed)
+{
+    int priv_fd = -1;
+
+    if (gmeta.flags & VendorGraphicBufferMeta::PRIV_FLAGS_USES_2PRIVATE_DATA)
+        priv_fd = gmeta.fd1;
+    else if (gmeta.flags & VendorGraphicBufferMeta::PRIV_FLAGS_USES_3PRIVATE_DATA)
+        priv_fd = gmeta.fd2;
+
+    if (priv_fd < 0)
+        return NULL;
+
+    VideoMetaCache::Mapping *mapping = mVideoMetaCache.get(gmeta.unique_id, priv_fd);
+    if (mapping == NULL) {
+        HWC_LOGE(mDisplay, "Layer's metadata map failed!!");
+        return NULL;
+    }
+
+    changed = mVideoMetaCache.checkChanged(mapping);
+    return static_cast<ExynosVideoMeta*>(mapping->addr);
+}
+
 bool ExynosLayer::isDimLayer()
 {
     if (mLayerFlag & EXYNOS_HWC_DIM_LAYER)
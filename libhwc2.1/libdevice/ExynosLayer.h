@@ -25,12 +25,15 @@
 
 #include <array>
 #include <unordered_map>
+#include <vector>
 
+#include "ClientLayerState.h"
 #include "ExynosDisplay.h"
 #include "ExynosHWC.h"
 #include "ExynosHWCHelper.h"
 #include "VendorGraphicBuffer.h"
 #include "VendorVideoAPI.h"
+#include "VideoMetaCache.h"
 
 #ifndef HWC2_HDR10_PLUS_SEI
 /* based on android.hardware.composer.2_3 */
@@ -258,6 +261,12 @@ class ExynosLayer : public ExynosMPPSource {
          */
         float mBrightness = 1.0;
 
+        /**
+         * Hash of getClientState(). The setters update it so that a change of the
+         * client layers is detected without comparing the attributes layer by layer.
+         */
+        uint64_t mClientSignature = 0;
+
         /**
          * user defined flag
          */
@@ -507,6 +516,8 @@ class ExynosLayer : public ExynosMPPSource {
         }
         size_t getDisplayFrameArea() { return HEIGHT(mDisplayFrame) * WIDTH(mDisplayFrame); }
         void setGeometryChanged(uint64_t changedBit);
+        ClientLayerState getClientState() const;
+        void updateClientSignature();
         void clearGeometryChanged() {mGeometryChanged = 0;};
         bool isDimLayer();
         const ExynosVideoMeta* getMetaParcel() { return mMetaParcel; };
@@ -514,6 +525,11 @@ class ExynosLayer : public ExynosMPPSource {
     private:
         ExynosVideoMeta *mMetaParcel;
         int allocMetaParcel();
+
+        /* Metadata of the video buffers the decoder cycles */
+        VideoMetaCache mVideoMetaCache{sizeof(ExynosVideoMeta)};
+        /* @changed is false if the metadata was already parsed in this frame */
+        ExynosVideoMeta *getVideoMeta(const VendorGraphicBufferMeta &gmeta, bool &changed);
 };
 
 #endif //_EXYNOSLAYER_H
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameTimeline.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace android;
+
+using Stage = FrameTimeline::Stage;
+
+namespace {
+
+struct Interval {
+    const char *name;
+    Stage from;
+    Stage to;
+};
+
+// the intervals aggregated in dump
+constexpr Interval kIntervals[] = {
+        {"assign", Stage::VALIDATE_START, Stage::RESOURCE_ASSIGNED},
+        {"validate", Stage::VALIDATE_START, Stage::VALIDATE_END},
+        {"build", Stage::PRESENT_START, Stage::COMMIT_BUILT},
+        {"commit", Stage::COMMIT_BUILT, Stage::COMMIT_DONE},
+        {"present", Stage::PRESENT_START, Stage::RELEASE},
+        {"retire", Stage::COMMIT_DONE, Stage::RETIRE_SIGNALED},
+};
+
+constexpr uint32_t kPercentiles[] = {50, 90, 99};
+
+} // namespace
+
+void FrameTimeline::openRecord(Record &record) {
+    record.seq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void FrameTimeline::closeRecord(Record &record) {
+    record.seq.fetch_add(1, std::memory_order_release);
+}
+
+void FrameTimeline::beginFrame() {
+    if (mOpenRecord != nullptr) return;
+
+    uint64_t frame = mFrames.load(std::memory_order_relaxed);
+    Record &record = mRecords[frame % kNumRecords];
+    openRecord(record);
+    record.frame = frame;
+    record.time.fill(0);
+    mFrames.store(frame + 1, std::memory_order_release);
+    mOpenRecord = &record;
+}
+
+void FrameTimeline::stamp(Stage stage, nsecs_t now) {
+    if (mOpenRecord == nullptr) return;
+    mOpenRecord->time[static_cast<size_t>(stage)] = now;
+}
+
+std::optional<uint64_t> FrameTimeline::endFrame() {
+    if (mOpenRecord == nullptr) return std::nullopt;
+
+    uint64_t frame = mOpenRecord->frame;
+    closeRecord(*mOpenRecord);
+    mOpenRecord = nullptr;
+    return frame;
+}
+
+void FrameTimeline::stampRetire(uint64_t frame, nsecs_t time) {
+    Record &record = mRecords[frame % kNumRecords];
+    if (&record == mOpenRecord || record.frame != frame) return;
+
+    openRecord(record);
+    record.time[static_cast<size_t>(Stage::RETIRE_SIGNALED)] = time;
+    closeRecord(record);
+}
+
+std::vector<FrameTimeline::Snapshot> FrameTimeline::snapshot() const {
+    uint64_t frames = mFrames.load(std::memory_order_acquire);
+    uint64_t first = frames > kNumRecords ? frames - kNumRecords : 0;
+
+    std::vector<Snapshot> out;
+    out.reserve(frames - first);
+    for (uint64_t frame = first; frame < frames; frame++) {
+        const Record &record = mRecords[frame % kNumRecords];
+
+        // the open record and the records overwritten during the copy are skipped
+        uint32_t seq = record.seq.load(std::memory_order_acquire);
+        if (seq & 1) continue;
+
+        Snapshot snap{record.frame, record.time};
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (record.seq.load(std::memory_order_relaxed) != seq || snap.frame != frame) continue;
+        out.push_back(snap);
+    }
+    return out;
+}
+
+void FrameTimeline::dump(String8 &result) const {
+    std::vector<Snapshot> frames = snapshot();
+    result.appendFormat("Frame timeline: %zu frames (us)\n", frames.size());
+
+    std::vector<nsecs_t> durations;
+    durations.reserve(frames.size());
+    for (const auto &interval : kIntervals) {
+        durations.clear();
+        for (const auto &snap : frames) {
+            nsecs_t from = snap.time[static_cast<size_t>(interval.from)];
+            nsecs_t to = snap.time[static_cast<size_t>(interval.to)];
+            if (from != 0 && to >= from) durations.push_back(to - from);
+        }
+        if (durations.empty()) continue;
+
+        std::sort(durations.begin(), durations.end());
+        result.appendFormat("\t%-8s n %4zu", interval.name, durations.size());
+        for (uint32_t percentile : kPercentiles) {
+            // nearest-rank percentile
+            size_t rank = (percentile * durations.size() + 99) / 100;
+            result.appendFormat(" p%u %6" PRId64, percentile, durations[rank - 1] / 1000);
+        }
+        result.appendFormat(" max %6" PRId64 "\n", durations.back() / 1000);
+    }
+}
+
+void FrameTimeline::exportBinary(std::vector<uint8_t> &out) const {
+    std::vector<Snapshot> frames = snapshot();
+
+    ExportHeader header = {
+            .magic = kExportMagic,
+            .version = kExportVersion,
+            .numStages = kNumStages,
+            .count = static_cast<uint32_t>(frames.size()),
+    };
+    constexpr size_t kRecordSize = sizeof(uint64_t) + kNumStages * sizeof(nsecs_t);
+
+    out.resize(sizeof(header) + frames.size() * kRecordSize);
+    uint8_t *dst = out.data();
+    std::memcpy(dst, &header, sizeof(header));
+    dst += sizeof(header);
+    for (const auto &snap : frames) {
+        std::memcpy(dst, &snap.frame, sizeof(snap.frame));
+        std::memcpy(dst + sizeof(snap.frame), snap.time.data(), kNumStages * sizeof(nsecs_t));
+        dst += kRecordSize;
+    }
+}
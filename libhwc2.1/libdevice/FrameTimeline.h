@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <array>
+#include <atomic>
+#include <optional>
+#include <vector>
+
+/*
+ * Records when each frame of a display reaches the stages of the composition, so the
+ * timing of a frame can be followed from the validation to the retire fence.
+ *
+ * The frames are kept in a ring of fixed-size records written only by the composition
+ * thread of the display. Each record is guarded by its own sequence counter (seqlock),
+ * so dump and the service read the ring without blocking the composition.
+ *
+ * Export layout: an ExportHeader followed by ExportHeader::count records of
+ * (uint64_t frame, int64_t time[numStages]) in the frame order. A time is 0 if the frame
+ * did not reach the stage.
+ */
+class FrameTimeline {
+  public:
+    enum class Stage : uint32_t {
+        VALIDATE_START = 0,
+        RESOURCE_ASSIGNED,
+        VALIDATE_END,
+        PRESENT_START,
+        COMMIT_BUILT,
+        COMMIT_DONE,
+        // the release fences are handed back to the client
+        RELEASE,
+        // stamped when the next frame starts
+        RETIRE_SIGNALED,
+        NUM_STAGES,
+    };
+    static constexpr size_t kNumStages = static_cast<size_t>(Stage::NUM_STAGES);
+    static constexpr size_t kNumRecords = 128;
+
+    struct ExportHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t numStages;
+        uint32_t count;
+    };
+    static constexpr uint32_t kExportMagic = 0x4c544d46; // "FMTL"
+    static constexpr uint32_t kExportVersion = 1;
+
+    // starts a frame unless one is open. The validation and the present share a frame
+    void beginFrame();
+    void stamp(Stage stage, nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC));
+    // returns the id of the frame ended, or nullopt if no frame is open
+    std::optional<uint64_t> endFrame();
+    // the retire fence of @frame signaled at @time. Ignored once @frame left the ring
+    void stampRetire(uint64_t frame, nsecs_t time);
+
+    void dump(android::String8 &result) const;
+    void exportBinary(std::vector<uint8_t> &out) const;
+
+  private:
+    struct Record {
+        std::atomic<uint32_t> seq{0}; // odd while the record is being written
+        uint64_t frame = 0;
+        std::array<nsecs_t, kNumStages> time{};
+    };
+    struct Snapshot {
+        uint64_t frame;
+        std::array<nsecs_t, kNumStages> time;
+    };
+
+    static void openRecord(Record &record);
+    static void closeRecord(Record &record);
+    // copies the completed records in the frame order
+    std::vector<Snapshot> snapshot() const;
+
+    std::array<Record, kNumRecords> mRecords;
+    // the frames begun so far. The last is in mRecords[(mFrames - 1) % kNumRecords]
+    std::atomic<uint64_t> mFrames{0};
+
+    // accessed only by the writer
+    Record *mOpenRecord = nullptr;
+};
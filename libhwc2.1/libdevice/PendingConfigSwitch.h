@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <hardware/hwcomposer2.h>
+#include <stdint.h>
+
+enum class hwc_request_state_t {
+    SET_CONFIG_STATE_DONE = 0,
+    SET_CONFIG_STATE_PENDING,
+    SET_CONFIG_STATE_REQUESTED,
+};
+
+/*
+ * The config still applied while a config switch is pending, i.e. not requested to the
+ * display yet. A switch back to it before the next present drops the pending switch
+ * rather than switching twice.
+ */
+class PendingConfigSwitch {
+  public:
+    // a switch is made pending in @state while @activeConfig is the active config
+    void onPending(hwc_request_state_t state, hwc2_config_t activeConfig) {
+        if (state == hwc_request_state_t::SET_CONFIG_STATE_DONE)
+            mConfigBeforePending = activeConfig;
+        else if (state == hwc_request_state_t::SET_CONFIG_STATE_REQUESTED)
+            mConfigBeforePending = UINT32_MAX; // the config in flight is not known to be applied
+    }
+
+    // true if a switch to @config in @state drops the pending switch
+    bool isSupersededBy(hwc_request_state_t state, hwc2_config_t config) const {
+        return (state == hwc_request_state_t::SET_CONFIG_STATE_PENDING) &&
+                (config == mConfigBeforePending);
+    }
+
+  private:
+    hwc2_config_t mConfigBeforePending = UINT32_MAX;
+};
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PresentDurationPredictor.h"
+
+#include <inttypes.h>
+
+#include <cmath>
+
+using namespace android;
+
+// the covariance grows without bound in the directions the features do not excite
+static constexpr double kMaxCovarianceTrace = 1e6;
+
+PresentDurationPredictor::PresentDurationPredictor() {
+    for (auto &model : mModels) reset(model);
+}
+
+void PresentDurationPredictor::reset(Model &model) {
+    model.theta.fill(0);
+    for (size_t i = 0; i < kNumFeatures; i++) {
+        model.p[i].fill(0);
+        model.p[i][i] = kInitialCovariance;
+    }
+    model.samples = 0;
+}
+
+PresentDurationPredictor::Vector PresentDurationPredictor::toVector(const Features &features) {
+    // scaled to be around 1 to keep the covariance well conditioned
+    return {1.0,
+            features.layers / 8.0,
+            features.deviceLayers / 8.0,
+            features.m2mLayers / 4.0,
+            features.clientComposition ? 1.0 : 0.0,
+            features.srcPixels / 1e7,
+            features.geometryChanged ? 1.0 : 0.0,
+            features.refreshRate / 120.0};
+}
+
+std::optional<nsecs_t> PresentDurationPredictor::predict(const Features &features,
+                                                         bool validated) const {
+    const Model &model = mModels[validated];
+    if (model.samples < kMinSamples) return std::nullopt;
+
+    Vector x = toVector(features);
+    double us = 0;
+    for (size_t i = 0; i < kNumFeatures; i++) us += model.theta[i] * x[i];
+
+    if (!std::isfinite(us)) return std::nullopt;
+    return static_cast<nsecs_t>(std::max(us, 0.0) * 1000);
+}
+
+void PresentDurationPredictor::update(const Features &features, bool validated, nsecs_t actual) {
+    Model &model = mModels[validated];
+    Vector x = toVector(features);
+    double y = actual / 1000.0;
+
+    Vector px{};
+    for (size_t i = 0; i < kNumFeatures; i++)
+        for (size_t j = 0; j < kNumFeatures; j++) px[i] += model.p[i][j] * x[j];
+
+    double denom = kForgettingFactor;
+    double err = y;
+    for (size_t i = 0; i < kNumFeatures; i++) {
+        denom += x[i] * px[i];
+        err -= model.theta[i] * x[i];
+    }
+
+    double trace = 0;
+    for (size_t i = 0; i < kNumFeatures; i++) {
+        double gain = px[i] / denom;
+        model.theta[i] += gain * err;
+        for (size_t j = 0; j < kNumFeatures; j++)
+            model.p[i][j] = (model.p[i][j] - gain * px[j]) / kForgettingFactor;
+        trace += model.p[i][i];
+    }
+
+    if (!std::isfinite(trace) || !std::isfinite(err)) {
+        reset(model);
+        return;
+    }
+    if (trace > kMaxCovarianceTrace) {
+        for (auto &row : model.p)
+            for (auto &v : row) v *= kMaxCovarianceTrace / trace;
+    }
+
+    if (model.samples < kMinSamples) model.samples++;
+}
+
+void PresentDurationPredictor::recordError(nsecs_t predicted, nsecs_t actual) {
+    nsecs_t errorUs = std::abs(predicted - actual) / 1000;
+    for (size_t i = 0; i < kErrorBucketsUs.size(); i++) {
+        if (errorUs < kErrorBucketsUs[i]) {
+            mErrorHistogram[i]++;
+            break;
+        }
+    }
+
+    if (predicted < actual)
+        mUnderPredictions++;
+    else
+        mOverPredictions++;
+}
+
+void PresentDurationPredictor::dump(String8 &result) const {
+    result.appendFormat("Present duration prediction error (us):");
+    nsecs_t lower = 0;
+    for (size_t i = 0; i < kErrorBucketsUs.size(); i++) {
+        if (kErrorBucketsUs[i] == INT64_MAX)
+            result.appendFormat(" [%" PRId64 "-]: %" PRIu64, lower, mErrorHistogram[i]);
+        else
+            result.appendFormat(" [%" PRId64 "-%" PRId64 "): %" PRIu64, lower, kErrorBucketsUs[i],
+                                mErrorHistogram[i]);
+        lower = kErrorBucketsUs[i];
+    }
+    result.appendFormat(", under %" PRIu64 ", over %" PRIu64 "\n", mUnderPredictions,
+                        mOverPredictions);
+}
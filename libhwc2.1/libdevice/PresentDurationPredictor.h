@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <array>
+#include <optional>
+
+/*
+ * Predicts the work duration of a frame reported to the ADPF hint session from the
+ * composition of the frame. Each of the validated and validation-skipped frames has
+ * its own online linear model trained by recursive least squares with a forgetting
+ * factor, so the memory is fixed and the model follows the workload changes.
+ */
+class PresentDurationPredictor {
+  public:
+    struct Features {
+        uint32_t layers = 0;
+        uint32_t deviceLayers = 0;
+        // layers composited by M2M MPPs, including the exynos composition
+        uint32_t m2mLayers = 0;
+        bool clientComposition = false;
+        uint64_t srcPixels = 0;
+        bool geometryChanged = false;
+        uint32_t refreshRate = 0;
+    };
+
+    PresentDurationPredictor();
+
+    std::optional<nsecs_t> predict(const Features &features, bool validated) const;
+    // trains the model with the actual duration of the frame predicted with @features
+    void update(const Features &features, bool validated, nsecs_t actual);
+    // the error of the prediction made for the frame which took @actual
+    void recordError(nsecs_t predicted, nsecs_t actual);
+
+    void dump(android::String8 &result) const;
+
+  private:
+    static constexpr size_t kNumFeatures = 8;
+    // the weight of a sample halves after about 70 frames
+    static constexpr double kForgettingFactor = 0.99;
+    // the initial covariance, large enough to follow the first samples quickly
+    static constexpr double kInitialCovariance = 1000.0;
+    // the predictions are not used until the model is trained with the samples
+    static constexpr uint32_t kMinSamples = 16;
+
+    using Vector = std::array<double, kNumFeatures>;
+
+    struct Model {
+        Vector theta{};
+        std::array<Vector, kNumFeatures> p{};
+        uint32_t samples = 0;
+    };
+
+    static Vector toVector(const Features &features);
+    static void reset(Model &model);
+
+    std::array<Model, 2> mModels;
+
+    // upper bounds of the absolute error buckets in microseconds. The last is unbounded
+    static constexpr std::array<nsecs_t, 6> kErrorBucketsUs = {250, 500, 1000, 2000, 4000,
+                                                               INT64_MAX};
+    std::array<uint64_t, kErrorBucketsUs.size()> mErrorHistogram{};
+    uint64_t mUnderPredictions = 0;
+    uint64_t mOverPredictions = 0;
+};
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ReadbackStreamCodec.h"
+
+// unchanged words shorter than this are cheaper to carry in the literals than in a new run
+static constexpr size_t kMinSkipWords = 4;
+
+void ReadbackStreamCodec::encode(const uint32_t *frame, uint32_t *prev, size_t words,
+                                 std::vector<uint32_t> &out) {
+    out.clear();
+
+    size_t i = 0;
+    while (i < words) {
+        size_t start = i;
+        while (start < words && frame[start] == prev[start]) start++;
+        if (start == words) break;
+
+        // extend the literals until a long enough unchanged span starts
+        size_t end = start;
+        size_t unchanged = 0;
+        while (end < words && unchanged < kMinSkipWords) {
+            unchanged = (frame[end] == prev[end]) ? unchanged + 1 : 0;
+            end++;
+        }
+        end -= unchanged;
+
+        out.push_back(static_cast<uint32_t>(start - i));
+        out.push_back(static_cast<uint32_t>(end - start));
+        for (size_t k = start; k < end; k++) {
+            out.push_back(frame[k] ^ prev[k]);
+            prev[k] = frame[k];
+        }
+        i = end;
+    }
+}
+
+bool ReadbackStreamCodec::decode(const uint32_t *in, size_t size, uint32_t *frame,
+                                 size_t words) {
+    size_t pos = 0;
+    size_t i = 0;
+    while (pos < size) {
+        if (size - pos < 2) return false;
+        const size_t skip = in[pos++];
+        const size_t count = in[pos++];
+        if ((skip > words - i) || (count > words - i - skip) || (count > size - pos))
+            return false;
+
+        i += skip;
+        for (size_t k = 0; k < count; k++) frame[i++] ^= in[pos++];
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/*
+ * Coding of the frames in a readback stream file.
+ *
+ * Stream file layout: a FrameHeader followed by the payload for each frame. The payload
+ * is a sequence of runs, each of which is a (skip, count) pair of uint32_t followed by
+ * @count words, where the words in between are unchanged from the previous frame. The
+ * words are XOR-ed with the previous frame except for the key frames, which are coded
+ * against a blank frame.
+ */
+class ReadbackStreamCodec {
+  public:
+    struct FrameHeader {
+        uint32_t magic;
+        uint32_t flags;
+        uint64_t frame;
+        int64_t timestamp;
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t stride;
+        uint32_t vstride;
+        uint32_t payloadSize;
+    };
+    static constexpr uint32_t kFrameMagic = 0x46534252; // "RBSF"
+    static constexpr uint32_t kFlagKeyFrame = 1 << 0;
+
+    // codes @frame against @prev into @out and updates @prev to @frame
+    static void encode(const uint32_t *frame, uint32_t *prev, size_t words,
+                       std::vector<uint32_t> &out);
+    // applies the payload @in of @size words to @frame. false if the payload is corrupted
+    static bool decode(const uint32_t *in, size_t size, uint32_t *frame, size_t words);
+};
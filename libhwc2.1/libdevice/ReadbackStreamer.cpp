@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ReadbackStreamer.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <log/log.h>
+#include <sys/prctl.h>
+#include <utils/Errors.h>
+
+#include <algorithm>
+
+using namespace android;
+
+ReadbackStreamer::ReadbackStreamer(const String8 &displayName, std::unique_ptr<Display> display)
+      : mDisplayName(displayName), mDisplay(std::move(display)) {}
+
+ReadbackStreamer::~ReadbackStreamer() {
+    stop();
+
+    for (auto &slot : mSlots) {
+        if (slot.fence >= 0) closeFence(slot.fence);
+        if (slot.buffer != nullptr) mDisplay->freeBuffer(slot.buffer);
+    }
+
+    if (mFile != nullptr) fclose(mFile);
+}
+
+int32_t ReadbackStreamer::start(uint32_t format, uint32_t width, uint32_t height,
+                                uint32_t ringSize, const String8 &filePath) {
+    if (mWriter.joinable()) return -EBUSY;
+
+    // the frames are delta coded in 32 bit words
+    if (mDisplay->getBitsPerPixel(format) != 32) {
+        ALOGE("%s: readback format(%d) is not supported", mDisplayName.string(), format);
+        return -EINVAL;
+    }
+
+    mSlots.resize(std::clamp(ringSize, 1u, kMaxRingSize));
+    for (auto &slot : mSlots) {
+        slot.buffer = mDisplay->allocateBuffer(format, width, height);
+        if (slot.buffer == nullptr) {
+            ALOGE("%s: failed to allocate readback buffer(%dx%d)", mDisplayName.string(), width,
+                  height);
+            return -ENOMEM;
+        }
+    }
+
+    mFile = fopen(filePath.string(), "w");
+    if (mFile == nullptr) {
+        int err = errno;
+        ALOGE("%s: failed to open %s", mDisplayName.string(), filePath.string());
+        return -err;
+    }
+
+    mFormat = format;
+    mWidth = width;
+    mHeight = height;
+    mWriter = std::thread(&ReadbackStreamer::writerLoop, this);
+
+    ALOGI("%s: streaming readback to %s with %zu buffers", mDisplayName.string(),
+          filePath.string(), mSlots.size());
+    return NO_ERROR;
+}
+
+void ReadbackStreamer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExit = true;
+    }
+    mCondition.notify_all();
+
+    // the queued frames are written before the writer exits
+    if (mWriter.joinable()) mWriter.join();
+}
+
+buffer_handle_t ReadbackStreamer::armFrame() {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    uint64_t frame = mFrames++;
+    if (mArmedSlot >= 0) {
+        // the armed buffer was not handed over, it reads this frame back instead
+        mSlots[mArmedSlot].frame = frame;
+        return mSlots[mArmedSlot].buffer;
+    }
+
+    for (size_t i = 0; i < mSlots.size(); i++) {
+        if (mSlots[i].state == SlotState::FREE) {
+            mSlots[i].state = SlotState::ARMED;
+            mSlots[i].frame = frame;
+            mArmedSlot = i;
+            mStats.armed++;
+            return mSlots[i].buffer;
+        }
+    }
+
+    // the writer is behind. Skip this frame rather than stall the present
+    mStats.dropped++;
+    return nullptr;
+}
+
+void ReadbackStreamer::queueFrame(int32_t fence) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mArmedSlot < 0) {
+        if (fence >= 0) closeFence(fence);
+        return;
+    }
+
+    Slot &slot = mSlots[mArmedSlot];
+    if (fence < 0) {
+        // the frame was skipped or the readback failed
+        slot.state = SlotState::FREE;
+        mStats.cancelled++;
+    } else {
+        slot.state = SlotState::QUEUED;
+        slot.fence = fence;
+        slot.presentTime = mDisplay->now();
+        mQueue.push_back(mArmedSlot);
+        mCondition.notify_one();
+    }
+    mArmedSlot = -1;
+}
+
+void ReadbackStreamer::writerLoop() {
+    prctl(PR_SET_NAME, "ReadbackWriter", 0, 0, 0);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mCondition.wait(lock, [this] { return mExit || !mQueue.empty(); });
+        if (mQueue.empty()) break;
+
+        // the queued slot is not touched by the present path until it is freed
+        Slot &slot = mSlots[mQueue.front()];
+        lock.unlock();
+        bool written = writeFrame(slot);
+        lock.lock();
+
+        if (written)
+            mStats.written++;
+        else
+            mStats.failed++;
+        slot.state = SlotState::FREE;
+        mQueue.pop_front();
+    }
+}
+
+bool ReadbackStreamer::writeFrame(Slot &slot) {
+    int err = mDisplay->waitFence(slot.fence, kFenceTimeoutMs);
+    closeFence(slot.fence);
+    if (err < 0) {
+        ALOGE("%s: readback fence wait error(%d)", mDisplayName.string(), err);
+        return false;
+    }
+
+    const Display::Mapping mapping = mDisplay->mapBuffer(slot.buffer);
+    if (mapping.data == nullptr) {
+        ALOGE("%s: failed to mmap readback buffer", mDisplayName.string());
+        return false;
+    }
+
+    size_t size = mapping.size;
+    size_t words = size / sizeof(uint32_t);
+    bool keyFrame = (mFramesSinceKeyFrame >= kKeyFrameInterval) || (mPrevFrame.size() != words);
+    if (keyFrame) {
+        // a key frame is coded against a blank frame
+        mPrevFrame.assign(words, 0);
+        mFramesSinceKeyFrame = 0;
+    }
+    ReadbackStreamCodec::encode(static_cast<const uint32_t *>(mapping.data), mPrevFrame.data(),
+                                words, mPayload);
+    mDisplay->unmapBuffer(mapping);
+
+    ReadbackStreamCodec::FrameHeader header = {
+            .magic = ReadbackStreamCodec::kFrameMagic,
+            .flags = keyFrame ? ReadbackStreamCodec::kFlagKeyFrame : 0,
+            .frame = slot.frame,
+            .timestamp = slot.presentTime,
+            .format = mFormat,
+            .width = mWidth,
+            .height = mHeight,
+            .stride = mapping.stride,
+            .vstride = mapping.vstride,
+            .payloadSize = static_cast<uint32_t>(mPayload.size() * sizeof(uint32_t)),
+    };
+    if ((fwrite(&header, sizeof(header), 1, mFile) != 1) ||
+        (header.payloadSize && fwrite(mPayload.data(), header.payloadSize, 1, mFile) != 1)) {
+        ALOGE("%s: failed to write readback frame", mDisplayName.string());
+        // the decoder can not follow the deltas after a partial write
+        mFramesSinceKeyFrame = kKeyFrameInterval;
+        return false;
+    }
+    fflush(mFile);
+    mFramesSinceKeyFrame++;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.rawBytes += size;
+    mStats.fileBytes += sizeof(header) + header.payloadSize;
+    return true;
+}
+
+void ReadbackStreamer::closeFence(int32_t &fence) {
+    mDisplay->closeFence(fence);
+    fence = -1;
+}
+
+ReadbackStreamer::Stats ReadbackStreamer::getStats() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void ReadbackStreamer::dump(String8 &result) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    result.appendFormat("Readback stream: %zu buffers, armed %" PRIu64 ", dropped %" PRIu64
+                        ", cancelled %" PRIu64 ", written %" PRIu64 ", failed %" PRIu64
+                        ", queued %zu",
+                        mSlots.size(), mStats.armed, mStats.dropped, mStats.cancelled,
+                        mStats.written, mStats.failed, mQueue.size());
+    if (mStats.fileBytes)
+        result.appendFormat(", compression %.1f:1",
+                            static_cast<double>(mStats.rawBytes) / mStats.fileBytes);
+    result.appendFormat("\n");
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cutils/native_handle.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ReadbackStreamCodec.h"
+
+class ExynosDisplay;
+
+/*
+ * Streams the readback of the consecutive frames of a display to a file.
+ *
+ * The readback buffers are allocated once in a ring. The display arms a free buffer for
+ * each frame it presents and hands the buffer over with its readback fence after the
+ * present. A writer thread waits for the fences and appends the frames to the file,
+ * delta coded against the previous frame and run-length encoded, so the present path
+ * never waits for the readback or the file. The frame is not read back if every buffer
+ * of the ring is still waiting for the writer. The stream file is coded by
+ * ReadbackStreamCodec.
+ *
+ * The destructor stops the writer after the queued frames are written, which waits for
+ * their readback fences, so it should not run under the display lock.
+ *
+ * The buffers and fences are handled by a Display, so that the streamer runs against a
+ * fake display in the tests.
+ */
+class ReadbackStreamer {
+  public:
+    // a lost or corrupted frame breaks the decoding only until the next key frame
+    static constexpr uint64_t kKeyFrameInterval = 60;
+    static constexpr uint32_t kMaxRingSize = 8;
+    // the frame is dropped if its readback is not done by then
+    static constexpr int kFenceTimeoutMs = 1000;
+
+    // the readback buffers and fences of a display
+    class Display {
+      public:
+        struct Mapping {
+            const void *data = nullptr;
+            size_t size = 0;
+            uint32_t stride = 0;
+            uint32_t vstride = 0;
+        };
+
+        virtual ~Display() = default;
+        virtual uint32_t getBitsPerPixel(uint32_t format) const = 0;
+        // returns nullptr on failure
+        virtual buffer_handle_t allocateBuffer(uint32_t format, uint32_t width,
+                                               uint32_t height) = 0;
+        virtual void freeBuffer(buffer_handle_t buffer) = 0;
+        // returns < 0 on error, or if @fence is not signaled within @timeoutMs
+        virtual int waitFence(int32_t fence, int timeoutMs) = 0;
+        virtual void closeFence(int32_t fence) = 0;
+        // maps @buffer for reading, the data is nullptr on failure
+        virtual Mapping mapBuffer(buffer_handle_t buffer) = 0;
+        virtual void unmapBuffer(const Mapping &mapping) = 0;
+        virtual nsecs_t now() const = 0;
+    };
+
+    struct Stats {
+        uint64_t armed = 0;
+        // frames not read back as the ring was full
+        uint64_t dropped = 0;
+        uint64_t cancelled = 0;
+        uint64_t written = 0;
+        // frames whose readback failed or timed out, or which were not written
+        uint64_t failed = 0;
+        uint64_t rawBytes = 0;
+        uint64_t fileBytes = 0;
+    };
+
+    // @display tracks the readback fences handed over to the streamer
+    explicit ReadbackStreamer(ExynosDisplay *display);
+    ReadbackStreamer(const android::String8 &displayName, std::unique_ptr<Display> display);
+    ~ReadbackStreamer();
+
+    int32_t start(uint32_t format, uint32_t width, uint32_t height, uint32_t ringSize,
+                  const android::String8 &filePath);
+
+    // the buffer to read the next frame back into. nullptr if the ring is full
+    buffer_handle_t armFrame();
+    // hands the buffer armed last over to the writer. @fence < 0 cancels the readback
+    void queueFrame(int32_t fence);
+
+    Stats getStats();
+    void dump(android::String8 &result);
+
+  private:
+    enum class SlotState { FREE, ARMED, QUEUED };
+
+    struct Slot {
+        buffer_handle_t buffer = nullptr;
+        SlotState state = SlotState::FREE;
+        int32_t fence = -1;
+        uint64_t frame = 0;
+        nsecs_t presentTime = 0;
+    };
+
+    void stop();
+    void writerLoop();
+    bool writeFrame(Slot &slot);
+    void closeFence(int32_t &fence);
+
+    const android::String8 mDisplayName;
+    const std::unique_ptr<Display> mDisplay;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<Slot> mSlots;
+    // slots in the queued order
+    std::deque<size_t> mQueue;
+    ssize_t mArmedSlot = -1;
+    // the presented frames since the start, including the dropped ones
+    uint64_t mFrames = 0;
+    bool mExit = false;
+    std::thread mWriter;
+
+    // accessed only by the writer thread once started
+    FILE *mFile = nullptr;
+    std::vector<uint32_t> mPrevFrame;
+    std::vector<uint32_t> mPayload;
+    uint64_t mFramesSinceKeyFrame = kKeyFrameInterval;
+
+    uint32_t mFormat = 0;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+
+    Stats mStats;
+};
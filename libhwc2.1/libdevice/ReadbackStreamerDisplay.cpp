@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <hardware/gralloc1.h>
+#include <log/log.h>
+#include <sync/sync.h>
+#include <sys/mman.h>
+
+#include "ExynosDisplay.h"
+#include "ExynosHWCHelper.h"
+#include "ReadbackStreamer.h"
+#include "VendorGraphicBuffer.h"
+
+using namespace android;
+using namespace vendor::graphics;
+
+namespace {
+
+// the readback buffers are gralloc buffers, the fences are tracked by the display
+class ExynosReadbackDisplay : public ReadbackStreamer::Display {
+  public:
+    explicit ExynosReadbackDisplay(ExynosDisplay *display) : mDisplay(display) {}
+
+    uint32_t getBitsPerPixel(uint32_t format) const override { return formatToBpp(format); }
+
+    buffer_handle_t allocateBuffer(uint32_t format, uint32_t width, uint32_t height) override {
+        VendorGraphicBufferAllocator &gAllocator(VendorGraphicBufferAllocator::get());
+        uint64_t usage = static_cast<uint64_t>(GRALLOC1_CONSUMER_USAGE_HWCOMPOSER |
+                                               GRALLOC1_CONSUMER_USAGE_CPU_READ_OFTEN);
+        buffer_handle_t buffer = nullptr;
+        uint32_t stride = 0;
+        status_t error =
+                gAllocator.allocate(width, height, format, 1, usage, &buffer, &stride, "HWC");
+        if (error != NO_ERROR) {
+            ALOGE("%s: gralloc error(%d)", mDisplay->mDisplayName.string(), error);
+            return nullptr;
+        }
+        return buffer;
+    }
+
+    void freeBuffer(buffer_handle_t buffer) override {
+        VendorGraphicBufferMapper::get().freeBuffer(buffer);
+    }
+
+    int waitFence(int32_t fence, int timeoutMs) override { return sync_wait(fence, timeoutMs); }
+
+    void closeFence(int32_t fence) override {
+        fence_close(fence, mDisplay, FENCE_TYPE_READBACK_ACQUIRE, FENCE_IP_DPP);
+    }
+
+    Mapping mapBuffer(buffer_handle_t buffer) override {
+        VendorGraphicBufferMeta gmeta(buffer);
+        Mapping mapping;
+        mapping.size = gmeta.stride * gmeta.vstride * formatToBpp(gmeta.format) / 8;
+        mapping.stride = gmeta.stride;
+        mapping.vstride = gmeta.vstride;
+        void *data = mmap(0, mapping.size, PROT_READ, MAP_SHARED, gmeta.fd, 0);
+        if (data != MAP_FAILED) mapping.data = data;
+        return mapping;
+    }
+
+    void unmapBuffer(const Mapping &mapping) override {
+        munmap(const_cast<void *>(mapping.data), mapping.size);
+    }
+
+    nsecs_t now() const override { return systemTime(SYSTEM_TIME_MONOTONIC); }
+
+  private:
+    ExynosDisplay *const mDisplay;
+};
+
+} // namespace
+
+ReadbackStreamer::ReadbackStreamer(ExynosDisplay *display)
+      : ReadbackStreamer(display->mDisplayName, std::make_unique<ExynosReadbackDisplay>(display)) {}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VideoMetaCache.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+
+void *VideoMetaCache::Mapper::map(int fd, size_t size) {
+    void *addr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return (addr == MAP_FAILED) ? nullptr : addr;
+}
+
+void VideoMetaCache::Mapper::unmap(void *addr, size_t size) {
+    munmap(addr, size);
+}
+
+VideoMetaCache::VideoMetaCache(size_t size, size_t maxMappings, std::unique_ptr<Mapper> mapper)
+      : mSize(size), mMaxMappings(std::max<size_t>(maxMappings, 1)), mMapper(std::move(mapper)) {}
+
+VideoMetaCache::~VideoMetaCache() {
+    clear();
+}
+
+void VideoMetaCache::nextFrame() {
+    mFrame++;
+    mGeneration++;
+    if (mFrame % kIdleFrames == 0) releaseIdle();
+}
+
+VideoMetaCache::Mapping *VideoMetaCache::get(uint64_t bufferId, int fd) {
+    if (fd < 0) return nullptr;
+
+    if (bufferId != 0) {
+        for (auto &mapping : mMappings) {
+            if (mapping.bufferId == bufferId) {
+                mapping.lastUsed = mFrame;
+                return &mapping;
+            }
+        }
+    }
+
+    releaseIdle();
+
+    void *addr = mMapper->map(fd, mSize);
+    if (addr == nullptr) return nullptr;
+
+    if (mMappings.size() >= mMaxMappings) {
+        unmap(std::min_element(mMappings.begin(), mMappings.end(),
+                               [](const auto &a, const auto &b) {
+                                   return a.lastUsed < b.lastUsed;
+                               }));
+    }
+
+    mMappings.push_back({bufferId, addr, mFrame, 0});
+    return &mMappings.back();
+}
+
+bool VideoMetaCache::checkChanged(Mapping *mapping) {
+    if (mapping->parsedGeneration == mGeneration) return false;
+    mapping->parsedGeneration = mGeneration;
+    return true;
+}
+
+void VideoMetaCache::clear() {
+    for (auto &mapping : mMappings) mMapper->unmap(mapping.addr, mSize);
+    mMappings.clear();
+}
+
+void VideoMetaCache::releaseIdle() {
+    for (auto it = mMappings.begin(); it != mMappings.end();) {
+        if ((it->bufferId == 0) || (mFrame - it->lastUsed > kIdleFrames)) {
+            mMapper->unmap(it->addr, mSize);
+            it = mMappings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void VideoMetaCache::unmap(std::vector<Mapping>::iterator it) {
+    mMapper->unmap(it->addr, mSize);
+    mMappings.erase(it);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+/*
+ * Keeps the metadata of the video buffers of a layer mapped while the decoder cycles its
+ * buffer pool, so that the layer does not map and unmap the metadata on every validation.
+ *
+ * The cache is not bounded by a fixed number of buffers, which would map every frame again
+ * once the pool of the decoder is larger: a mapping stays until its buffer was not presented
+ * for kIdleFrames frames of the layer, so the cache grows to the buffers the decoder
+ * actually cycles. The idle mappings are released on a miss and every kIdleFrames frames,
+ * as they keep the metadata of the freed buffers alive. kMaxMappings only bounds the mappings of a misbehaving producer.
+ *
+ * The buffers without unique id can not be told apart and are mapped again on every call.
+ *
+ * Each mapping records the generation its metadata was last parsed in. The generation
+ * advances with every frame of the layer and whenever the caller changed the state derived
+ * from the metadata, so the repeated validations of a frame parse the metadata only once.
+ * The producer does not write the metadata of a buffer while it is presented.
+ */
+class VideoMetaCache {
+  public:
+    static constexpr uint64_t kIdleFrames = 120;
+    static constexpr size_t kMaxMappings = 64;
+
+    // maps the metadata buffers, replaced by a counting mapper in the tests
+    class Mapper {
+      public:
+        virtual ~Mapper() = default;
+        // returns nullptr on failure
+        virtual void *map(int fd, size_t size);
+        virtual void unmap(void *addr, size_t size);
+    };
+
+    struct Mapping {
+        uint64_t bufferId;
+        void *addr;
+        // the frame the buffer was last presented in
+        uint64_t lastUsed;
+        // the generation the metadata was last parsed in, 0 if never
+        uint64_t parsedGeneration;
+    };
+
+    explicit VideoMetaCache(size_t size, size_t maxMappings = kMaxMappings,
+                            std::unique_ptr<Mapper> mapper = std::make_unique<Mapper>());
+    ~VideoMetaCache();
+
+    VideoMetaCache(const VideoMetaCache &) = delete;
+    VideoMetaCache &operator=(const VideoMetaCache &) = delete;
+
+    // the layer got the buffer of a new frame
+    void nextFrame();
+    // the state derived from the metadata was changed by the caller
+    void invalidate() { mGeneration++; }
+
+    // returns the mapped metadata of the buffer @bufferId, which is the buffer @fd, or
+    // nullptr if it can not be mapped. Valid until the next call to the cache
+    Mapping *get(uint64_t bufferId, int fd);
+    // returns true if the metadata of @mapping was not parsed since the last change, and
+    // marks it parsed
+    bool checkChanged(Mapping *mapping);
+
+    void clear();
+    size_t size() const { return mMappings.size(); }
+    bool empty() const { return mMappings.empty(); }
+
+  private:
+    // unmaps the idle mappings and the mappings of the buffers without unique id
+    void releaseIdle();
+    void unmap(std::vector<Mapping>::iterator it);
+
+    const size_t mSize;
+    const size_t mMaxMappings;
+    const std::unique_ptr<Mapper> mMapper;
+    std::vector<Mapping> mMappings;
+    uint64_t mFrame = 1;
+    uint64_t mGeneration = 1;
+};
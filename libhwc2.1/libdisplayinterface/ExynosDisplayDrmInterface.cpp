@@ -1017,8 +1017,15 @@ int32_t ExynosDisplayDrmInterface::getDisplayConfigs(
              * but it is not complete. It will be completed after Hot Plug Detection
              * & DRM Mode update.
              */
-            if (mExynosDisplay->mType == HWC_DISPLAY_EXTERNAL)
-                mDrmConnector->UpdateEdidProperty();
+            if ((mExynosDisplay->mType == HWC_DISPLAY_EXTERNAL) &&
+                (mDrmConnector->UpdateEdidProperty() == 0)) {
+                ALOGD("%s: EDID is not changed", mExynosDisplay->mDisplayName.string());
+                /* The same sink gets back the ids of its modes, so the configs are still valid */
+                if (isDisplayConfigsCurrent()) {
+                    mExynosDisplay->mPlugState = true;
+                    goto no_mode_changes;
+                }
+            }
 
             mExynosDisplay->mPlugState = true;
         } else
@@ -1031,40 +1038,26 @@ int32_t ExynosDisplayDrmInterface::getDisplayConfigs(
         uint32_t mm_width = mDrmConnector->mm_width();
         uint32_t mm_height = mDrmConnector->mm_height();
 
-        /* key: (width<<32 | height) */
-        std::map<uint64_t, uint32_t> groupIds;
-        uint32_t groupId = 0;
-        float peakRr = -1;
-
-        for (const DrmMode &mode : mDrmConnector->modes()) {
+        const std::vector<DrmMode> &modes = mDrmConnector->modes();
+        for (size_t i = 0; i < modes.size(); i++) {
+            const DrmMode &mode = modes[i];
             displayConfigs_t configs;
             float rr = mode.v_refresh();
             configs.vsyncPeriod = nsecsPerSec / rr;
             configs.width = mode.h_display();
             configs.height = mode.v_display();
-            uint64_t key = ((uint64_t)configs.width<<32) | configs.height;
-            auto it = groupIds.find(key);
-            if (it != groupIds.end()) {
-                configs.groupId = it->second;
-            } else {
-                configs.groupId = groupId;
-                groupIds.insert(std::make_pair(key, groupId));
-                groupId++;
-            }
+            configs.groupId = mDrmConnector->mode_group(i);
 
             // Dots per 1000 inches
             configs.Xdpi = mm_width ? (mode.h_display() * kUmPerInch) / mm_width : -1;
             // Dots per 1000 inches
             configs.Ydpi = mm_height ? (mode.v_display() * kUmPerInch) / mm_height : -1;
-            // find peak rr
-            if (rr > peakRr)
-                  peakRr = rr;
             mExynosDisplay->mDisplayConfigs.insert(std::make_pair(mode.id(), configs));
             ALOGD("config group(%d), w(%d), h(%d), vsync(%d), xdpi(%d), ydpi(%d)",
                     configs.groupId, configs.width, configs.height,
                     configs.vsyncPeriod, configs.Xdpi, configs.Ydpi);
         }
-        mExynosDisplay->setPeakRefreshRate(peakRr);
+        mExynosDisplay->setPeakRefreshRate(mDrmConnector->peak_refresh());
     }
 
 no_mode_changes:
@@ -1086,6 +1079,19 @@ no_mode_changes:
     return 0;
 }
 
+bool ExynosDisplayDrmInterface::isDisplayConfigsCurrent() const
+{
+    const std::vector<DrmMode> &modes = mDrmConnector->modes();
+    if (modes.empty() || (mExynosDisplay->mDisplayConfigs.size() != modes.size()))
+        return false;
+
+    for (const DrmMode &mode : modes) {
+        if (mExynosDisplay->mDisplayConfigs.count(mode.id()) == 0)
+            return false;
+    }
+    return true;
+}
+
 void ExynosDisplayDrmInterface::dumpDisplayConfigs()
 {
     std::lock_guard<std::recursive_mutex> lock(mDrmConnector->modesLock());
@@ -1236,9 +1242,8 @@ int32_t ExynosDisplayDrmInterface::setActiveConfigWithConstraints(
     ALOGD("%s:: %s config(%d) test(%d)", __func__, mExynosDisplay->mDisplayName.string(), config,
           test);
 
-    auto mode = std::find_if(mDrmConnector->modes().begin(), mDrmConnector->modes().end(),
-            [config](DrmMode const &m) { return m.id() == config;});
-    if (mode == mDrmConnector->modes().end()) {
+    const DrmMode *mode = mDrmConnector->FindMode(config);
+    if (mode == nullptr) {
         HWC_LOGE(mExynosDisplay, "Could not find active mode for %d", config);
         return HWC2_ERROR_BAD_CONFIG;
     }
@@ -1354,9 +1359,8 @@ int32_t ExynosDisplayDrmInterface::setActiveDrmMode(DrmMode const &mode) {
 int32_t ExynosDisplayDrmInterface::setActiveConfig(hwc2_config_t config) {
     std::lock_guard<std::recursive_mutex> lock(mDrmConnector->modesLock());
 
-    auto mode = std::find_if(mDrmConnector->modes().begin(), mDrmConnector->modes().end(),
-                             [config](DrmMode const &m) { return m.id() == config; });
-    if (mode == mDrmConnector->modes().end()) {
+    const DrmMode *mode = mDrmConnector->FindMode(config);
+    if (mode == nullptr) {
         HWC_LOGE(mExynosDisplay, "Could not find active mode for %d", config);
         return HWC2_ERROR_BAD_CONFIG;
     }
@@ -1975,6 +1979,18 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
         mExynosDisplay->traceLayerTypes();
     }
 
+    /*
+     * The states below are latched right before the commit. Hold the seamless commits until
+     * the latch time so they pick up the brightness and histogram updates of the wait. The
+     * display mutex stays held for the hold, see CommitScheduler. The frame ends on every
+     * return below.
+     */
+    CommitScheduler::ScopedFrame commitLatch;
+    if (mExynosDisplay->isCommitSchedulerEnabled() && !needModesetForReadback &&
+        mDesiredModeState.isSeamless() && !mVsyncCallback.getDesiredVsyncPeriod()) {
+        commitLatch = mExynosDisplay->beginCommitLatch();
+    }
+
     if (mExynosDisplay->mBrightnessController) {
         bool ghbmSync, lhbmSync, blSync, opRateSync;
         bool mixedComposition = mExynosDisplay->isMixedComposition()
@@ -2071,6 +2087,8 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
         return ret;
     }
 
+    commitLatch.committed();
+
     mExynosDisplay->mDpuData.retire_fence = (int)out_fences[mDrmCrtc->pipe()];
     /*
      * [HACK] dup retire_fence for each layer's release fence
@@ -2636,7 +2654,6 @@ int32_t ExynosDisplayDrmInterface::getDisplayIdentificationData(
 
     if (outPort == nullptr || outDataSize == nullptr) return HWC2_ERROR_BAD_PARAMETER;
 
-    drmModePropertyBlobPtr blob;
     int ret;
     uint64_t blobId;
 
@@ -2651,20 +2668,12 @@ int32_t ExynosDisplayDrmInterface::getDisplayIdentificationData(
         return getDisplayFakeEdid(*outPort, *outDataSize, outData);
     }
 
-    blob = drmModeGetPropertyBlob(mDrmDevice->fd(), blobId);
-    if (blob == nullptr) {
+    /* The EDID is cached by the connector until the blob is replaced */
+    if (mDrmConnector->GetEdid(outData, outDataSize) != 0) {
         ALOGD("%s: Failed to get blob",
                 mExynosDisplay->mDisplayName.string());
         return HWC2_ERROR_UNSUPPORTED;
     }
-
-    if (outData) {
-        *outDataSize = std::min(*outDataSize, blob->length);
-        memcpy(outData, blob->data, *outDataSize);
-    } else {
-        *outDataSize = blob->length;
-    }
-    drmModeFreePropertyBlob(blob);
     *outPort = mDrmConnector->id();
 
     return HWC2_ERROR_NONE;
@@ -2698,12 +2707,11 @@ void ExynosDisplayDrmInterface::retrievePanelFullResolution() {
     std::lock_guard<std::recursive_mutex> lock(mDrmConnector->modesLock());
 
     // The largest resolution in the modes of mDrmConnector is the panel full resolution.
-    for (auto it = mDrmConnector->modes().begin(); it != mDrmConnector->modes().end(); it++) {
-        if (it->h_display() * it->v_display() >
-            mPanelFullResolutionHSize * mPanelFullResolutionVSize) {
-            mPanelFullResolutionHSize = it->h_display();
-            mPanelFullResolutionVSize = it->v_display();
-        }
+    const DrmMode *mode = mDrmConnector->largest_mode();
+    if (mode && (mode->h_display() * mode->v_display() >
+                 mPanelFullResolutionHSize * mPanelFullResolutionVSize)) {
+        mPanelFullResolutionHSize = mode->h_display();
+        mPanelFullResolutionVSize = mode->v_display();
     }
 
     if (mPanelFullResolutionHSize <= 0 || mPanelFullResolutionVSize <= 0) {
@@ -556,6 +556,9 @@ class ExynosDisplayDrmInterface :
          */
         void retrievePanelFullResolution();
 
+        /* whether mDisplayConfigs has an entry for each mode of the connector */
+        bool isDisplayConfigsCurrent() const;
+
     public:
         virtual bool readHotplugStatus();
 };
@@ -22,9 +22,12 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <stdint.h>
+#include <string.h>
 
+#include <algorithm>
 #include <array>
 #include <sstream>
+#include <unordered_set>
 
 #include <log/log.h>
 #include <xf86drmMode.h>
@@ -36,6 +39,8 @@
 namespace android {
 
 constexpr size_t TYPES_COUNT = 18;
+// The known modes are forgotten when a connector has seen this many modes
+constexpr size_t kMaxKnownModes = 1024;
 
 DrmConnector::DrmConnector(DrmDevice *drm, drmModeConnectorPtr c,
                            DrmEncoder *current_encoder,
@@ -265,33 +270,37 @@ int DrmConnector::UpdateModes() {
   if (state_ == DRM_MODE_CONNECTED &&
       c->connection == DRM_MODE_CONNECTED && modes_.size() > 0) {
     // no need to update modes
+    drmModeFreeConnector(c);
     return 0;
   }
 
   if (state_ == DRM_MODE_DISCONNECTED &&
       c->connection == DRM_MODE_DISCONNECTED && modes_.size() == 0) {
     // no need to update modes
+    drmModeFreeConnector(c);
     return 0;
   }
 
+  if (state_ != c->connection) {
+    std::lock_guard<std::mutex> edid_lock(edid_lock_);
+    edid_valid_ = false;
+  }
   state_ = c->connection;
 
   bool preferred_mode_found = false;
   std::vector<DrmMode> new_modes;
+  std::unordered_set<uint32_t> ids;
+  new_modes.reserve(c->count_modes);
   for (int i = 0; i < c->count_modes; ++i) {
-    bool exists = false;
-    for (const DrmMode &mode : modes_) {
-      if (mode == c->modes[i]) {
-        new_modes.push_back(mode);
-        exists = true;
-        break;
-      }
-    }
-    if (!exists) {
-      DrmMode m(&c->modes[i]);
-      m.set_id(drm_->next_mode_id());
-      new_modes.push_back(m);
+    DrmMode m(&c->modes[i]);
+    uint32_t id = GetKnownModeId(m, c->modes[i]);
+    // a sink may list the same timing twice
+    if (!ids.insert(id).second) {
+      id = drm_->next_mode_id();
+      ids.insert(id);
     }
+    m.set_id(id);
+    new_modes.push_back(m);
     // Use only the first DRM_MODE_TYPE_PREFERRED mode found
     if (!preferred_mode_found &&
         (new_modes.back().type() & DRM_MODE_TYPE_PREFERRED)) {
@@ -299,15 +308,127 @@ int DrmConnector::UpdateModes() {
       preferred_mode_found = true;
     }
   }
+  drmModeFreeConnector(c);
+
   modes_.swap(new_modes);
   if (!preferred_mode_found && modes_.size() != 0) {
     preferred_mode_id_ = modes_[0].id();
   }
+  UpdateModeIndex();
   return 1;
 }
 
+uint32_t DrmConnector::GetKnownModeId(const DrmMode &mode,
+                                      const drmModeModeInfo &info) {
+  uint64_t hash = DrmMode::TimingHash(info);
+  auto range = known_modes_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == info)
+      return it->second.id();
+  }
+
+  if (known_modes_.size() >= kMaxKnownModes)
+    known_modes_.clear();
+
+  auto it = known_modes_.emplace(hash, mode);
+  it->second.set_id(drm_->next_mode_id());
+  return it->second.id();
+}
+
+void DrmConnector::UpdateModeIndex() {
+  mode_index_.clear();
+  mode_groups_.clear();
+  largest_mode_ = -1;
+  peak_refresh_ = -1;
+
+  // key: (width << 32 | height)
+  std::unordered_map<uint64_t, uint32_t> groups;
+  for (size_t i = 0; i < modes_.size(); ++i) {
+    const DrmMode &mode = modes_[i];
+    mode_index_.emplace(mode.id(), i);
+
+    uint64_t key = ((uint64_t)mode.h_display() << 32) | mode.v_display();
+    uint32_t group = groups.size();
+    mode_groups_.push_back(groups.emplace(key, group).first->second);
+
+    if (largest_mode_ < 0 ||
+        mode.h_display() * mode.v_display() >
+            modes_[largest_mode_].h_display() * modes_[largest_mode_].v_display())
+      largest_mode_ = i;
+    peak_refresh_ = std::max(peak_refresh_, mode.v_refresh());
+  }
+}
+
+const DrmMode *DrmConnector::FindMode(uint32_t id) const {
+  auto it = mode_index_.find(id);
+  return it == mode_index_.end() ? nullptr : &modes_[it->second];
+}
+
 int DrmConnector::UpdateEdidProperty() {
-  return drm_->UpdateConnectorProperty(*this, &edid_property_);
+  int ret = drm_->UpdateConnectorProperty(*this, &edid_property_);
+  if (ret)
+    return ret;
+
+  std::lock_guard<std::mutex> lock(edid_lock_);
+  uint64_t checksum = edid_checksum_;
+  size_t size = edid_.size();
+  edid_valid_ = false;
+  if ((ret = ReadEdidLocked()))
+    return ret;
+
+  return (edid_checksum_ != checksum || edid_.size() != size) ? 1 : 0;
+}
+
+int DrmConnector::GetEdid(uint8_t *data, uint32_t *size) {
+  std::lock_guard<std::mutex> lock(edid_lock_);
+  int ret = ReadEdidLocked();
+  if (ret)
+    return ret;
+  if (edid_.empty())
+    return -ENOENT;
+
+  if (data) {
+    *size = std::min(*size, static_cast<uint32_t>(edid_.size()));
+    memcpy(data, edid_.data(), *size);
+  } else {
+    *size = edid_.size();
+  }
+  return 0;
+}
+
+int DrmConnector::ReadEdidLocked() {
+  auto [ret, blob_id] = edid_property_.value();
+  if (ret)
+    return ret;
+  if (edid_valid_ && blob_id == edid_blob_id_)
+    return 0;
+
+  std::vector<uint8_t> edid;
+  if (blob_id) {
+    drmModePropertyBlobPtr blob = drmModeGetPropertyBlob(drm_->fd(), blob_id);
+    if (!blob) {
+      ALOGE("Failed to get EDID blob %" PRIu64 " of connector %d", blob_id, id_);
+      return -ENOENT;
+    }
+    auto bytes = static_cast<const uint8_t *>(blob->data);
+    edid.assign(bytes, bytes + blob->length);
+    drmModeFreePropertyBlob(blob);
+  }
+
+  // FNV-1a
+  uint64_t checksum = 0xcbf29ce484222325ULL;
+  for (uint8_t byte : edid) {
+    checksum ^= byte;
+    checksum *= 0x100000001b3ULL;
+  }
+  if (checksum != edid_checksum_ || edid.size() != edid_.size())
+    ALOGI("EDID of connector %d is updated, size %zu", id_, edid.size());
+
+  edid_valid_ = true;
+  edid_blob_id_ = blob_id;
+  edid_checksum_ = checksum;
+  edid_.swap(edid);
+  return 0;
 }
 
 const DrmMode &DrmConnector::active_mode() const {
@@ -44,6 +44,9 @@ DrmDevice::DrmDevice() : event_listener_(this) {
 
 DrmDevice::~DrmDevice() {
   event_listener_.Exit();
+
+  for (auto &[id, p] : property_metadata_)
+    drmModeFreeProperty(p);
 }
 
 std::tuple<int, int> DrmDevice::Init(const char *path, int num_displays) {
@@ -80,6 +83,11 @@ std::tuple<int, int> DrmDevice::Init(const char *path, int num_displays) {
     return std::make_tuple(-ENODEV, 0);
   }
 
+  {
+    std::lock_guard<std::mutex> lock(property_lock_);
+    use_property_snapshot_ = true;
+  }
+
   min_resolution_ = std::pair<uint32_t, uint32_t>(res->min_width,
                                                   res->min_height);
   max_resolution_ = std::pair<uint32_t, uint32_t>(res->max_width,
@@ -209,12 +217,15 @@ std::tuple<int, int> DrmDevice::Init(const char *path, int num_displays) {
     drmModeFreeResources(res);
 
   // Catch-all for the above loops
-  if (ret)
+  if (ret) {
+    ReleasePropertySnapshots();
     return std::make_tuple(ret, 0);
+  }
 
   drmModePlaneResPtr plane_res = drmModeGetPlaneResources(fd());
   if (!plane_res) {
     ALOGE("Failed to get plane resources");
+    ReleasePropertySnapshots();
     return std::make_tuple(-ENOENT, 0);
   }
 
@@ -239,6 +250,7 @@ std::tuple<int, int> DrmDevice::Init(const char *path, int num_displays) {
     planes_.emplace_back(std::move(plane));
   }
   drmModeFreePlaneResources(plane_res);
+  ReleasePropertySnapshots();
   if (ret)
     return std::make_tuple(ret, 0);
 
@@ -470,8 +482,72 @@ DrmEventListener *DrmDevice::event_listener() {
   return &event_listener_;
 }
 
+drmModePropertyPtr DrmDevice::GetPropertyMetadataLocked(uint32_t prop_id) {
+  auto it = property_metadata_.find(prop_id);
+  if (it != property_metadata_.end())
+    return it->second;
+
+  drmModePropertyPtr p = drmModeGetProperty(fd(), prop_id);
+  if (!p) {
+    ALOGE("Failed to get property %d", prop_id);
+    return NULL;
+  }
+
+  property_metadata_[prop_id] = p;
+  return p;
+}
+
+const DrmDevice::PropertySnapshot *DrmDevice::GetPropertySnapshotLocked(
+    uint32_t obj_id, uint32_t obj_type) {
+  auto key = std::make_pair(obj_id, obj_type);
+  auto it = property_snapshots_.find(key);
+  if (it != property_snapshots_.end())
+    return &it->second;
+
+  drmModeObjectPropertiesPtr props =
+      drmModeObjectGetProperties(fd(), obj_id, obj_type);
+  if (!props) {
+    ALOGE("Failed to get properties for %d/%x", obj_id, obj_type);
+    return NULL;
+  }
+
+  PropertySnapshot &snapshot = property_snapshots_[key];
+  for (uint32_t i = 0; i < props->count_props; ++i) {
+    drmModePropertyPtr p = GetPropertyMetadataLocked(props->props[i]);
+    if (p)
+      snapshot[p->name] = {p, props->prop_values[i]};
+  }
+
+  drmModeFreeObjectProperties(props);
+  return &snapshot;
+}
+
+void DrmDevice::ReleasePropertySnapshots() {
+  std::lock_guard<std::mutex> lock(property_lock_);
+
+  use_property_snapshot_ = false;
+  property_snapshots_.clear();
+}
+
 int DrmDevice::GetProperty(uint32_t obj_id, uint32_t obj_type,
                            const char *prop_name, DrmProperty *property) {
+  std::lock_guard<std::mutex> lock(property_lock_);
+
+  if (use_property_snapshot_) {
+    const PropertySnapshot *snapshot = GetPropertySnapshotLocked(obj_id, obj_type);
+    if (!snapshot)
+      return -ENODEV;
+
+    auto it = snapshot->find(prop_name);
+    if (it == snapshot->end()) {
+      property->SetName(prop_name);
+      return -ENOENT;
+    }
+
+    property->Init(it->second.property, it->second.value);
+    return 0;
+  }
+
   drmModeObjectPropertiesPtr props;
 
   props = drmModeObjectGetProperties(fd(), obj_id, obj_type);
@@ -482,12 +558,11 @@ int DrmDevice::GetProperty(uint32_t obj_id, uint32_t obj_type,
 
   bool found = false;
   for (int i = 0; !found && (size_t)i < props->count_props; ++i) {
-    drmModePropertyPtr p = drmModeGetProperty(fd(), props->props[i]);
-    if (!strcmp(p->name, prop_name)) {
+    drmModePropertyPtr p = GetPropertyMetadataLocked(props->props[i]);
+    if (p && !strcmp(p->name, prop_name)) {
       property->Init(p, props->prop_values[i]);
       found = true;
     }
-    drmModeFreeProperty(p);
   }
 
   if (!found)
@@ -523,12 +598,10 @@ int DrmDevice::UpdateObjectProperty(int id, int type, DrmProperty *property) {
     }
     bool found = false;
     for (int i = 0; !found && (size_t)i < props->count_props; ++i) {
-        drmModePropertyPtr p = drmModeGetProperty(fd(), props->props[i]);
         if (props->props[i] == property->id()) {
             property->UpdateValue(props->prop_values[i]);
             found = true;
         }
-        drmModeFreeProperty(p);
     }
     drmModeFreeObjectProperties(props);
     return found ? 0 : -ENOENT;
@@ -28,6 +28,7 @@
 #include <linux/netlink.h>
 #include <log/log.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <utils/String8.h>
 #include <xf86drm.h>
 
@@ -233,46 +234,113 @@ void DrmEventListener::FlipHandler(int /* fd */, unsigned int /* sequence */,
 }
 
 void DrmEventListener::UEventHandler() {
-  char buffer[1024];
-  int ret;
-
-  struct timespec ts;
-  uint64_t timestamp = 0;
-  ret = clock_gettime(CLOCK_MONOTONIC, &ts);
-  if (!ret)
-    timestamp = ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
-  else
-    ALOGE("Failed to get monotonic clock on hotplug %d", ret);
+  struct mmsghdr msgs[kUEventBatch];
+  struct iovec iovs[kUEventBatch];
+
+  memset(msgs, 0, sizeof(msgs));
+  for (unsigned i = 0; i < kUEventBatch; i++) {
+    // the last byte is kept for the terminator of the last field
+    iovs[i].iov_base = uevent_buffers_[i].data();
+    iovs[i].iov_len = kUEventBufferSize - 1;
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
 
-  ret = read(uevent_fd_.get(), &buffer, sizeof(buffer));
-  if (ret == 0) {
+  int count = recvmmsg(uevent_fd_.get(), msgs, kUEventBatch, MSG_DONTWAIT, nullptr);
+  if (count == 0) {
     return;
-  } else if (ret < 0) {
-    ALOGE("Got error reading uevent %d", ret);
+  } else if (count < 0) {
+    if (errno != EAGAIN && errno != EINTR)
+      ALOGE("Got error reading uevent %s", strerror(errno));
     return;
   }
 
+  uint64_t timestamp = Now();
+  for (int i = 0; i < count; i++) {
+    // a truncated uevent is parsed up to the cut
+    char *msg = uevent_buffers_[i].data();
+    msg[msgs[i].msg_len] = '\0';
+    ParseUEvent(msg, msgs[i].msg_len, timestamp);
+  }
+}
+
+void DrmEventListener::ParseUEvent(const char *msg, size_t len, uint64_t timestamp) {
+  static constexpr std::string_view kPanelIdleEnter = "PANEL_IDLE_ENTER=";
+
   bool drm_event = false, hotplug_event = false;
-  for (int i = 0; i < ret;) {
-    char *event = buffer + i;
+  for (size_t i = 0; i < len;) {
+    // the fields are null-terminated in place
+    std::string_view field(msg + i);
+    i += field.size() + 1;
 
-    if (!strcmp(event, "DEVTYPE=drm_minor")) {
+    if (field == "DEVTYPE=drm_minor") {
       drm_event = true;
-    } else if (!strncmp(event, "PANEL_IDLE_ENTER=", strlen("PANEL_IDLE_ENTER="))) {
-      panel_idle_handler_->handleIdleEnterEvent(event);
-    } else if (!strcmp(event, "HOTPLUG=1")) {
+    } else if (field == "HOTPLUG=1") {
       hotplug_event = true;
+    } else if (field.substr(0, kPanelIdleEnter.size()) == kPanelIdleEnter) {
+      if (panel_idle_handler_)
+        panel_idle_handler_->handleIdleEnterEvent(field.data());
     }
-
-    i += strlen(event) + 1;
   }
 
-  if (drm_event && hotplug_event) {
-    if (!hotplug_handler_)
-      return;
+  if (!drm_event || !hotplug_event)
+    return;
+
+  // the first hotplug after a quiet window is not delayed. The ones of a burst
+  // wait for the end of the window
+  if (!pending_hotplugs_ &&
+      (!last_hotplug_ts_ || timestamp >= last_hotplug_ts_ + kHotplugDebounceNs)) {
+    DispatchHotplug(timestamp);
+    return;
+  }
+  if (pending_hotplugs_++ == 0)
+    pending_hotplug_ts_ = timestamp;
+}
 
-    hotplug_handler_->handleEvent(timestamp);
+uint64_t DrmEventListener::Now() const {
+  struct timespec ts;
+  int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+  if (ret) {
+    ALOGE("Failed to get monotonic clock on hotplug %d", ret);
+    return 0;
   }
+  return (uint64_t)ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+int DrmEventListener::HotplugTimeoutMs() {
+  if (!pending_hotplugs_)
+    return -1;
+
+  uint64_t now = Now();
+  uint64_t due = last_hotplug_ts_ + kHotplugDebounceNs;
+  if (now >= due)
+    return 0;
+  // rounded up not to wake up before the due time
+  return (due - now + 999999) / 1000000;
+}
+
+void DrmEventListener::DispatchPendingHotplug() {
+  if (!pending_hotplugs_ || HotplugTimeoutMs() > 0)
+    return;
+
+  if (pending_hotplugs_ > 1)
+    ALOGI("Coalesced %u hotplug uevents", pending_hotplugs_);
+
+  uint64_t timestamp = pending_hotplug_ts_;
+  pending_hotplugs_ = 0;
+  pending_hotplug_ts_ = 0;
+  DispatchHotplug(timestamp);
+  // the window of a trailing dispatch starts when it is done
+  last_hotplug_ts_ = Now();
+}
+
+void DrmEventListener::DispatchHotplug(uint64_t timestamp) {
+  last_hotplug_ts_ = timestamp;
+
+  if (!hotplug_handler_)
+    return;
+
+  hotplug_handler_->handleEvent(timestamp);
 }
 
 void DrmEventListener::DRMEventHandler() {
@@ -357,17 +425,19 @@ void DrmEventListener::Routine() {
   int nfds, n;
 
   do {
-    nfds = epoll_wait(epoll_fd_.get(), events, maxFds, -1);
+    nfds = epoll_wait(epoll_fd_.get(), events, maxFds, HotplugTimeoutMs());
+    if (nfds == 0)
+      DispatchPendingHotplug();
   } while (nfds <= 0);
 
+  // the vsync and histogram events are handled first not to be delayed by the others
   for (n = 0; n < nfds; n++) {
-    if (events[n].events & EPOLLIN) {
-      if (events[n].data.fd == uevent_fd_.get()) {
-        UEventHandler();
-      } else if (events[n].data.fd == drm_->fd()) {
-        DRMEventHandler();
-      }
-    } else if (events[n].events & EPOLLPRI) {
+    if ((events[n].events & EPOLLIN) && events[n].data.fd == drm_->fd())
+      DRMEventHandler();
+  }
+
+  for (n = 0; n < nfds; n++) {
+    if (events[n].events & EPOLLPRI) {
       if (tuievent_fd_.get() >= 0 && events[n].data.fd == tuievent_fd_.get()) {
         TUIEventHandler();
       } else {
@@ -375,5 +445,12 @@ void DrmEventListener::Routine() {
       }
     }
   }
+
+  for (n = 0; n < nfds; n++) {
+    if ((events[n].events & EPOLLIN) && events[n].data.fd == uevent_fd_.get())
+      UEventHandler();
+  }
+
+  DispatchPendingHotplug();
 }
 }  // namespace android
@@ -51,6 +51,19 @@ bool DrmMode::operator==(const drmModeModeInfo &m) const {
          v_scan_ == m.vscan && flags_ == m.flags && type_ == m.type;
 }
 
+uint64_t DrmMode::TimingHash(const drmModeModeInfo &m) {
+  const uint32_t fields[] = {m.clock, m.hdisplay, m.hsync_start, m.hsync_end, m.htotal,
+                             m.hskew, m.vdisplay, m.vsync_start, m.vsync_end, m.vtotal,
+                             m.vscan, m.flags, m.type};
+  // FNV-1a over the fields
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (uint32_t field : fields) {
+    hash ^= field;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
 void DrmMode::ToDrmModeModeInfo(drm_mode_modeinfo *m) const {
   m->clock = clock_;
   m->hdisplay = h_display_;
@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <xf86drmMode.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <mutex>
 
@@ -54,11 +55,28 @@ class DrmConnector {
   std::string name() const;
 
   int UpdateModes();
+  // Re-reads the EDID blob. Returns 1 if the EDID content changed, 0 if it did
+  // not
   int UpdateEdidProperty();
+  // Copies up to *size bytes of the EDID into data and sets *size to the number
+  // of bytes copied, or to the EDID size if data is null
+  int GetEdid(uint8_t *data, uint32_t *size);
 
   const std::vector<DrmMode> &modes() const {
     return modes_;
   }
+  // The lookups below are rebuilt by UpdateModes and need modesLock() as modes()
+  const DrmMode *FindMode(uint32_t id) const;
+  // modes of the same resolution share a group, numbered in the order of modes()
+  uint32_t mode_group(size_t index) const {
+    return mode_groups_.at(index);
+  }
+  const DrmMode *largest_mode() const {
+    return largest_mode_ < 0 ? nullptr : &modes_[largest_mode_];
+  }
+  float peak_refresh() const {
+    return peak_refresh_;
+  }
   std::recursive_mutex &modesLock() {
     return modes_lock_;
   }
@@ -128,6 +146,22 @@ class DrmConnector {
   std::recursive_mutex modes_lock_;
   DrmMode lp_mode_;
 
+  // Every mode seen on the connector by DrmMode::TimingHash, so that a mode
+  // keeps its id when the same sink is plugged again
+  std::unordered_multimap<uint64_t, DrmMode> known_modes_;
+  std::unordered_map<uint32_t, size_t> mode_index_;
+  std::vector<uint32_t> mode_groups_;
+  ssize_t largest_mode_ = -1;
+  float peak_refresh_ = -1;
+
+  // The kernel recycles the ids of freed blobs, so the cached EDID is only
+  // trusted by blob id while the sink stays connected
+  std::mutex edid_lock_;
+  bool edid_valid_ = false;
+  uint64_t edid_blob_id_ = 0;
+  uint64_t edid_checksum_ = 0;
+  std::vector<uint8_t> edid_;
+
   DrmProperty dpms_property_;
   DrmProperty crtc_id_property_;
   DrmProperty edid_property_;
@@ -157,6 +191,9 @@ class DrmConnector {
   uint32_t preferred_mode_id_;
 
   int UpdateLpMode();
+  uint32_t GetKnownModeId(const DrmMode &mode, const drmModeModeInfo &info);
+  void UpdateModeIndex();
+  int ReadEdidLocked();
 };
 }  // namespace android
 
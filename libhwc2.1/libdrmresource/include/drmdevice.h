@@ -24,8 +24,11 @@
 #include "drmplane.h"
 
 #include <map>
+#include <mutex>
 #include <stdint.h>
+#include <string>
 #include <tuple>
+#include <unordered_map>
 
 namespace android {
 
@@ -90,12 +93,30 @@ class DrmDevice {
 
   int CallVendorIoctl(unsigned long request, void *arg);
 
-  private:
+ private:
   int UpdateObjectProperty(int id, int type, DrmProperty *property);
   int TryEncoderForDisplay(int display, DrmEncoder *enc);
   int GetProperty(uint32_t obj_id, uint32_t obj_type, const char *prop_name,
                   DrmProperty *property);
 
+  /*
+   * The metadata (name, flags, enums and range) of a property does not change
+   * while the device is open, so it is fetched once per property id.
+   * While the objects are initialized, the properties of each object are also
+   * fetched once into a snapshot and all the lookups by name are resolved
+   * from it instead of walking the properties with ioctls for every name.
+   */
+  struct PropertySnapshotEntry {
+    drmModePropertyPtr property;
+    uint64_t value;
+  };
+  typedef std::unordered_map<std::string, PropertySnapshotEntry> PropertySnapshot;
+
+  drmModePropertyPtr GetPropertyMetadataLocked(uint32_t prop_id);
+  const PropertySnapshot *GetPropertySnapshotLocked(uint32_t obj_id,
+                                                    uint32_t obj_type);
+  void ReleasePropertySnapshots();
+
   int CreateDisplayPipe(DrmConnector *connector);
   int AttachWriteback(DrmConnector *display_conn);
 
@@ -112,6 +133,11 @@ class DrmDevice {
   std::pair<uint32_t, uint32_t> min_resolution_;
   std::pair<uint32_t, uint32_t> max_resolution_;
   std::map<int, int> displays_;
+
+  std::mutex property_lock_;
+  std::unordered_map<uint32_t, drmModePropertyPtr> property_metadata_;
+  bool use_property_snapshot_ = false;
+  std::map<std::pair<uint32_t, uint32_t>, PropertySnapshot> property_snapshots_;
 };
 }  // namespace android
 
@@ -19,7 +19,9 @@
 
 #include <sys/epoll.h>
 
+#include <array>
 #include <map>
+#include <string_view>
 
 #include "autofd.h"
 #include "worker.h"
@@ -86,6 +88,13 @@ class DrmEventListener : public Worker {
   static const uint32_t maxFds = 4;
 
  public:
+  static constexpr size_t kUEventBufferSize = 2048;
+  // uevents read with a single recvmmsg
+  static constexpr unsigned kUEventBatch = 8;
+  // a hotplug is dispatched at once, and the ones following it within this
+  // window are coalesced into a single dispatch at the end of the window
+  static constexpr uint64_t kHotplugDebounceNs = 50'000'000;
+
   DrmEventListener(DrmDevice *drm);
   virtual ~DrmEventListener();
 
@@ -111,15 +120,24 @@ class DrmEventListener : public Worker {
 
  protected:
   virtual void Routine();
+  // CLOCK_MONOTONIC in ns, overridden by the tests
+  virtual uint64_t Now() const;
 
- private:
   void UEventHandler();
+  // the epoll timeout until the pending hotplug is due. -1 if none is pending
+  int HotplugTimeoutMs();
+  void DispatchPendingHotplug();
+
+  UniqueFd uevent_fd_;
+
+ private:
+  void ParseUEvent(const char *msg, size_t len, uint64_t timestamp);
+  void DispatchHotplug(uint64_t timestamp);
   void DRMEventHandler();
   void TUIEventHandler();
   void SysfsEventHandler(int fd);
 
   UniqueFd epoll_fd_;
-  UniqueFd uevent_fd_;
   UniqueFd tuievent_fd_;
 
   DrmDevice *drm_;
@@ -130,6 +148,14 @@ class DrmEventListener : public Worker {
   std::unique_ptr<DrmPanelIdleEventHandler> panel_idle_handler_;
   std::mutex mutex_;
   std::map<int, std::shared_ptr<DrmSysfsEventHandler>> sysfs_handlers_;
+
+  // accessed only by the listener thread
+  std::array<std::array<char, kUEventBufferSize>, kUEventBatch> uevent_buffers_;
+  // the time of the last hotplug dispatch. 0 if none was dispatched
+  uint64_t last_hotplug_ts_ = 0;
+  // the time of the first hotplug uevent coalesced since the last dispatch
+  uint64_t pending_hotplug_ts_ = 0;
+  uint32_t pending_hotplugs_ = 0;
 };
 
 }  // namespace android
@@ -29,6 +29,8 @@ class DrmMode {
   DrmMode(drmModeModeInfoPtr m);
 
   bool operator==(const drmModeModeInfo &m) const;
+  // Hash of the timing fields compared by operator==
+  static uint64_t TimingHash(const drmModeModeInfo &m);
   void ToDrmModeModeInfo(drm_mode_modeinfo *m) const;
 
   uint32_t id() const;
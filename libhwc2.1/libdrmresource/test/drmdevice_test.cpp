@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "drmdevice.h"
+#include "fake_drm.h"
+
+using namespace android;
+
+namespace {
+
+constexpr const char *kCrtcProperties[] = {
+    "ACTIVE",         "MODE_ID",         "OUT_FENCE_PTR",  "partial_region",
+    "cgc_lut",        "DEGAMMA_LUT",     "DEGAMMA_LUT_SIZE", "GAMMA_LUT",
+    "GAMMA_LUT_SIZE", "linear_matrix",   "gamma_matrix",   "force_bpc",
+    "disp_dither",    "adjusted_vblank", "ppc",            "max_disp_freq",
+    "dqe_enabled",    "color mode",      "expected_present_time",
+    "histogram_roi",  "histogram_weights", "histogram_threshold",
+    "histogram_pos",
+};
+
+constexpr const char *kConnectorProperties[] = {
+    "DPMS",          "CRTC_ID",          "EDID",        "max_luminance",
+    "max_avg_luminance", "min_luminance", "hdr_formats", "panel orientation",
+    "lp_mode",       "brightness_capability", "brightness_level", "hbm_mode",
+    "dimming_on",    "local_hbm_mode",   "mipi_sync",   "panel_idle_support",
+    "operation_rate", "refresh_on_lp",
+};
+
+constexpr const char *kPlaneProperties[] = {
+    "CRTC_ID", "FB_ID",    "CRTC_X",   "CRTC_Y",   "CRTC_W",
+    "CRTC_H",  "SRC_X",    "SRC_Y",    "SRC_W",    "SRC_H",
+    "zpos",    "rotation", "alpha",    "pixel blend mode",
+    "IN_FENCE_FD", "standard", "transfer", "range", "colormap",
+};
+
+}  // namespace
+
+/*
+ * Initializes a DrmDevice on a 2-CRTC/12-plane topology of the fake DRM. The
+ * device node is a pipe, so the event listener can poll it.
+ */
+class DrmDeviceTest : public ::testing::Test {
+ protected:
+  static constexpr int kNumCrtcs = 2;
+  static constexpr int kNumPlanes = 12;
+
+  void SetUp() override {
+    FakeDrm &fake = FakeDrm::Get();
+    fake.Reset();
+
+    for (int i = 0; i < kNumCrtcs; i++) {
+      uint32_t crtc = fake.AddCrtc();
+      for (const char *name : kCrtcProperties)
+        fake.SetProperty(crtc, name, 0);
+      crtcs_.push_back(crtc);
+
+      uint32_t conn = fake.AddConnector(fake.AddEncoder(crtc),
+                                        DRM_MODE_CONNECTOR_DSI);
+      for (const char *name : kConnectorProperties)
+        fake.SetProperty(conn, name, 0);
+      connectors_.push_back(conn);
+    }
+    for (int i = 0; i < kNumPlanes; i++) {
+      uint32_t plane = fake.AddPlane(
+          i < kNumCrtcs ? DRM_PLANE_TYPE_PRIMARY : DRM_PLANE_TYPE_OVERLAY,
+          (1 << kNumCrtcs) - 1);
+      for (const char *name : kPlaneProperties)
+        fake.SetProperty(plane, name, 0);
+    }
+
+    ASSERT_EQ(0, pipe(pipe_));
+    path_ = "/proc/self/fd/" + std::to_string(pipe_[0]);
+  }
+
+  void TearDown() override {
+    close(pipe_[0]);
+    close(pipe_[1]);
+  }
+
+  std::unique_ptr<DrmDevice> InitDevice() {
+    auto drm = std::make_unique<DrmDevice>();
+    auto [ret, num_displays] = drm->Init(path_.c_str(), 0);
+    EXPECT_EQ(0, ret);
+    EXPECT_EQ(kNumCrtcs, num_displays);
+    return drm;
+  }
+
+  static int NumObjects() {
+    return kNumCrtcs * 2 + kNumPlanes;
+  }
+
+  std::vector<uint32_t> crtcs_;
+  std::vector<uint32_t> connectors_;
+  int pipe_[2] = {-1, -1};
+  std::string path_;
+};
+
+TEST_F(DrmDeviceTest, InitFetchesPropertiesOnce) {
+  FakeDrm &fake = FakeDrm::Get();
+  auto drm = InitDevice();
+
+  ASSERT_EQ(kNumCrtcs, drm->crtcs().size());
+  ASSERT_EQ(kNumCrtcs, drm->connectors().size());
+  ASSERT_EQ(kNumPlanes, drm->planes().size());
+
+  // once per object and once per property
+  EXPECT_EQ(NumObjects(), fake.Calls("drmModeObjectGetProperties"));
+  EXPECT_EQ(fake.NumProperties(), fake.Calls("drmModeGetProperty"));
+}
+
+TEST_F(DrmDeviceTest, InitResolvesProperties) {
+  FakeDrm &fake = FakeDrm::Get();
+  fake.SetProperty(crtcs_[1], "ACTIVE", 1);
+  fake.SetProperty(connectors_[0], "DPMS", 3);
+
+  auto drm = InitDevice();
+
+  const DrmCrtc &crtc = *drm->crtcs()[1];
+  EXPECT_EQ(fake.PropertyId(crtcs_[1], "ACTIVE"), crtc.active_property().id());
+  EXPECT_EQ(std::make_tuple(0, uint64_t{1}), crtc.active_property().value());
+  EXPECT_EQ(fake.PropertyId(crtcs_[1], "MODE_ID"), crtc.mode_property().id());
+  // not exposed by the fake
+  EXPECT_EQ(0, crtc.cgc_lut_fd_property().id());
+
+  EXPECT_EQ(std::make_tuple(0, uint64_t{3}),
+            drm->connectors()[0]->dpms_property().value());
+
+  int num_primary = 0;
+  for (auto &plane : drm->planes()) {
+    if (plane->type() == DRM_PLANE_TYPE_PRIMARY)
+      num_primary++;
+    EXPECT_NE(0, plane->crtc_property().id());
+  }
+  EXPECT_EQ(kNumCrtcs, num_primary);
+}
+
+TEST_F(DrmDeviceTest, LookupAfterInitReadsValue) {
+  FakeDrm &fake = FakeDrm::Get();
+  auto drm = InitDevice();
+  const DrmCrtc &crtc = *drm->crtcs()[0];
+
+  fake.SetProperty(crtcs_[0], "ACTIVE", 1);
+  fake.ResetCalls();
+
+  DrmProperty active;
+  ASSERT_EQ(0, drm->GetCrtcProperty(crtc, "ACTIVE", &active));
+  EXPECT_EQ(std::make_tuple(0, uint64_t{1}), active.value());
+  DrmProperty missing;
+  EXPECT_EQ(-ENOENT, drm->GetCrtcProperty(crtc, "missing", &missing));
+
+  // the metadata is not fetched again
+  EXPECT_EQ(2, fake.Calls("drmModeObjectGetProperties"));
+  EXPECT_EQ(0, fake.Calls("drmModeGetProperty"));
+}
+
+TEST_F(DrmDeviceTest, UpdatePropertyComparesIds) {
+  FakeDrm &fake = FakeDrm::Get();
+  auto drm = InitDevice();
+  const DrmCrtc &crtc = *drm->crtcs()[0];
+
+  DrmProperty active;
+  ASSERT_EQ(0, drm->GetCrtcProperty(crtc, "ACTIVE", &active));
+  fake.SetProperty(crtcs_[0], "ACTIVE", 1);
+  fake.ResetCalls();
+
+  ASSERT_EQ(0, drm->UpdateCrtcProperty(crtc, &active));
+  EXPECT_EQ(std::make_tuple(0, uint64_t{1}), active.value());
+  EXPECT_EQ(1, fake.Calls());
+}
+
+TEST_F(DrmDeviceTest, StartupLatency) {
+  static constexpr int kIterations = 50;
+  FakeDrm &fake = FakeDrm::Get();
+
+  std::chrono::nanoseconds elapsed(0);
+  for (int i = 0; i < kIterations; i++) {
+    fake.ResetCalls();
+    auto begin = std::chrono::steady_clock::now();
+    auto drm = InitDevice();
+    elapsed += std::chrono::steady_clock::now() - begin;
+  }
+
+  const long init_ns = elapsed.count() / kIterations;
+  RecordProperty("init_ns", init_ns);
+  RecordProperty("drm_calls", fake.Calls());
+  std::cout << kNumCrtcs << " CRTCs, " << kNumPlanes << " planes: "
+            << fake.Calls() << " libdrm calls ("
+            << fake.Calls("drmModeObjectGetProperties") << " object, "
+            << fake.Calls("drmModeGetProperty") << " property), " << init_ns
+            << " ns" << std::endl;
+}
+
+namespace {
+
+drmModeModeInfo MakeMode(uint16_t width, uint16_t height, uint32_t refresh) {
+  drmModeModeInfo mode = {};
+  mode.hdisplay = width;
+  mode.hsync_start = width + 48;
+  mode.hsync_end = width + 80;
+  mode.htotal = width + 160;
+  mode.vdisplay = height;
+  mode.vsync_start = height + 3;
+  mode.vsync_end = height + 8;
+  mode.vtotal = height + 40;
+  mode.clock = refresh * mode.htotal * mode.vtotal / 1000;
+  mode.vrefresh = refresh;
+  return mode;
+}
+
+}  // namespace
+
+TEST_F(DrmDeviceTest, UpdateModesIndexesManyModes) {
+  static constexpr int kNumSizes = 40;
+  static constexpr uint32_t kRefreshRates[] = {24, 30, 48, 50, 60, 90, 120, 144};
+  FakeDrm &fake = FakeDrm::Get();
+
+  std::vector<drmModeModeInfo> infos;
+  for (int i = 0; i < kNumSizes; i++)
+    for (uint32_t refresh : kRefreshRates)
+      infos.push_back(MakeMode(640 + 32 * i, 480 + 18 * i, refresh));
+  ASSERT_GE(infos.size(), 300u);
+  fake.SetModes(connectors_[0], infos);
+
+  auto drm = InitDevice();
+  DrmConnector &conn = *drm->connectors()[0];
+  std::lock_guard<std::recursive_mutex> lock(conn.modesLock());
+
+  auto begin = std::chrono::steady_clock::now();
+  ASSERT_EQ(1, conn.UpdateModes());
+  auto update_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+  ASSERT_EQ(infos.size(), conn.modes().size());
+
+  std::set<uint32_t> ids;
+  std::set<uint32_t> groups;
+  for (size_t i = 0; i < conn.modes().size(); i++) {
+    const DrmMode &mode = conn.modes()[i];
+    EXPECT_TRUE(ids.insert(mode.id()).second);
+    EXPECT_EQ(&mode, conn.FindMode(mode.id()));
+    groups.insert(conn.mode_group(i));
+    // the modes of a size share the group
+    EXPECT_EQ(conn.mode_group(i - i % std::size(kRefreshRates)),
+              conn.mode_group(i));
+  }
+  EXPECT_EQ(kNumSizes, groups.size());
+  EXPECT_EQ(nullptr, conn.FindMode(0));
+  ASSERT_NE(nullptr, conn.largest_mode());
+  EXPECT_EQ(640 + 32 * (kNumSizes - 1), conn.largest_mode()->h_display());
+  EXPECT_NEAR(144.0f, conn.peak_refresh(), 0.5f);
+
+  // a plugged-in again sink keeps the ids of its modes
+  std::vector<uint32_t> old_ids;
+  for (const DrmMode &mode : conn.modes())
+    old_ids.push_back(mode.id());
+  fake.SetConnection(connectors_[0], DRM_MODE_DISCONNECTED);
+  fake.SetModes(connectors_[0], {});
+  ASSERT_EQ(1, conn.UpdateModes());
+  EXPECT_TRUE(conn.modes().empty());
+  fake.SetConnection(connectors_[0], DRM_MODE_CONNECTED);
+  fake.SetModes(connectors_[0], infos);
+  ASSERT_EQ(1, conn.UpdateModes());
+  ASSERT_EQ(old_ids.size(), conn.modes().size());
+  for (size_t i = 0; i < old_ids.size(); i++)
+    EXPECT_EQ(old_ids[i], conn.modes()[i].id());
+
+  begin = std::chrono::steady_clock::now();
+  for (uint32_t id : old_ids)
+    EXPECT_NE(nullptr, conn.FindMode(id));
+  auto find_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count() /
+                 old_ids.size();
+
+  RecordProperty("update_modes_ns", update_ns);
+  RecordProperty("find_mode_ns", find_ns);
+  std::cout << infos.size() << " modes: UpdateModes " << update_ns
+            << " ns, FindMode " << find_ns << " ns" << std::endl;
+}
+
+TEST_F(DrmDeviceTest, EdidCacheSurvivesBlobIdReuse) {
+  static constexpr uint8_t kEdidA[] = {0x00, 0xff, 0xff, 0xff, 0xff, 0xff,
+                                       0xff, 0x00, 0x10, 0xac, 0x01, 0x02};
+  static constexpr uint8_t kEdidB[] = {0x00, 0xff, 0xff, 0xff, 0xff, 0xff,
+                                       0xff, 0x00, 0x4c, 0x2d, 0x03, 0x04};
+  FakeDrm &fake = FakeDrm::Get();
+  fake.SetModes(connectors_[0], {MakeMode(1920, 1080, 60)});
+  uint32_t blob_id = fake.AddBlob(kEdidA, sizeof(kEdidA));
+  fake.SetProperty(connectors_[0], "EDID", blob_id);
+
+  auto drm = InitDevice();
+  DrmConnector &conn = *drm->connectors()[0];
+  std::lock_guard<std::recursive_mutex> lock(conn.modesLock());
+  ASSERT_EQ(1, conn.UpdateModes());
+  EXPECT_EQ(1, conn.UpdateEdidProperty());
+  EXPECT_EQ(0, conn.UpdateEdidProperty());
+
+  uint8_t edid[sizeof(kEdidA)];
+  uint32_t size = sizeof(edid);
+  ASSERT_EQ(0, conn.GetEdid(edid, &size));
+  EXPECT_EQ(0, memcmp(kEdidA, edid, size));
+  // cached while the sink stays connected
+  fake.ResetCalls();
+  ASSERT_EQ(0, conn.GetEdid(edid, &size));
+  EXPECT_EQ(0, fake.Calls("drmModeGetPropertyBlob"));
+
+  // another sink gets the id of the freed blob
+  fake.SetConnection(connectors_[0], DRM_MODE_DISCONNECTED);
+  fake.RemoveBlob(blob_id);
+  fake.SetProperty(connectors_[0], "EDID", 0);
+  ASSERT_EQ(1, conn.UpdateModes());
+  ASSERT_EQ(blob_id, fake.AddBlob(kEdidB, sizeof(kEdidB), blob_id));
+  fake.SetProperty(connectors_[0], "EDID", blob_id);
+  fake.SetConnection(connectors_[0], DRM_MODE_CONNECTED);
+  ASSERT_EQ(1, conn.UpdateModes());
+
+  size = sizeof(edid);
+  ASSERT_EQ(0, conn.GetEdid(edid, &size));
+  EXPECT_EQ(0, memcmp(kEdidB, edid, size));
+
+  // the content is compared when a hotplug is missed as well
+  fake.RemoveBlob(blob_id);
+  fake.AddBlob(kEdidA, sizeof(kEdidA), blob_id);
+  EXPECT_EQ(1, conn.UpdateEdidProperty());
+  EXPECT_EQ(0, conn.UpdateEdidProperty());
+  size = sizeof(edid);
+  ASSERT_EQ(0, conn.GetEdid(edid, &size));
+  EXPECT_EQ(0, memcmp(kEdidA, edid, size));
+}
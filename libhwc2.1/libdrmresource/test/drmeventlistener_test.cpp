@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "drmeventlistener.h"
+
+using namespace android;
+
+namespace {
+
+constexpr uint64_t kStartNs = 1'000'000'000;
+constexpr uint64_t kDebounceNs = DrmEventListener::kHotplugDebounceNs;
+
+class RecordingHotplugHandler : public DrmEventHandler {
+ public:
+  explicit RecordingHotplugHandler(std::vector<uint64_t> *timestamps)
+      : timestamps_(timestamps) {}
+
+  void handleEvent(uint64_t timestamp) override {
+    timestamps_->push_back(timestamp);
+  }
+
+ private:
+  std::vector<uint64_t> *timestamps_;
+};
+
+class RecordingPanelIdleHandler : public DrmPanelIdleEventHandler {
+ public:
+  explicit RecordingPanelIdleHandler(std::vector<std::string> *events)
+      : events_(events) {}
+
+  void handleIdleEnterEvent(char const *event) override {
+    events_->push_back(event);
+  }
+
+ private:
+  std::vector<std::string> *events_;
+};
+
+/*
+ * Reads the uevents from one end of a datagram socketpair instead of the
+ * netlink socket, on a clock driven by the test. The worker thread is not
+ * started, so the handlers run on the test thread.
+ */
+class TestListener : public DrmEventListener {
+ public:
+  TestListener() : DrmEventListener(nullptr) {}
+
+  using DrmEventListener::DispatchPendingHotplug;
+  using DrmEventListener::HotplugTimeoutMs;
+  using DrmEventListener::UEventHandler;
+
+  void SetUEventFd(int fd) { uevent_fd_.Set(fd); }
+  void SetNow(uint64_t now) { now_ = now; }
+
+ protected:
+  uint64_t Now() const override { return now_; }
+
+ private:
+  uint64_t now_ = 0;
+};
+
+}  // namespace
+
+class DrmEventListenerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+    listener_.SetUEventFd(fds[0]);
+    send_fd_ = fds[1];
+    listener_.SetNow(kStartNs);
+    listener_.RegisterHotplugHandler(new RecordingHotplugHandler(&hotplugs_));
+    listener_.RegisterPanelIdleHandler(new RecordingPanelIdleHandler(&idle_events_));
+  }
+
+  void TearDown() override { close(send_fd_); }
+
+  // sends the fields as one null-separated uevent
+  void Send(std::vector<std::string> fields) {
+    std::string msg;
+    for (auto &field : fields) {
+      msg += field;
+      msg += '\0';
+    }
+    ASSERT_EQ(msg.size(), send(send_fd_, msg.data(), msg.size(), 0));
+  }
+
+  void SendHotplug() {
+    Send({"ACTION=change", "DEVPATH=/devices/platform/exynos-drm/drm/card0",
+          "SUBSYSTEM=drm", "HOTPLUG=1", "DEVTYPE=drm_minor"});
+  }
+
+  TestListener listener_;
+  int send_fd_ = -1;
+  std::vector<uint64_t> hotplugs_;
+  std::vector<std::string> idle_events_;
+};
+
+TEST_F(DrmEventListenerTest, IsolatedHotplugIsDispatchedAtOnce) {
+  SendHotplug();
+  listener_.UEventHandler();
+
+  EXPECT_EQ(std::vector<uint64_t>{kStartNs}, hotplugs_);
+  EXPECT_EQ(-1, listener_.HotplugTimeoutMs());
+
+  // a later one outside of the window is not delayed either
+  listener_.SetNow(kStartNs + kDebounceNs);
+  SendHotplug();
+  listener_.UEventHandler();
+
+  EXPECT_EQ((std::vector<uint64_t>{kStartNs, kStartNs + kDebounceNs}), hotplugs_);
+  EXPECT_EQ(-1, listener_.HotplugTimeoutMs());
+}
+
+TEST_F(DrmEventListenerTest, BurstIsCoalescedAfterFirstHotplug) {
+  // read with a single recvmmsg
+  for (int i = 0; i < 5; i++)
+    SendHotplug();
+  listener_.UEventHandler();
+  ASSERT_EQ(std::vector<uint64_t>{kStartNs}, hotplugs_);
+
+  // read one by one within the window
+  listener_.SetNow(kStartNs + 10'000'000);
+  SendHotplug();
+  listener_.UEventHandler();
+  EXPECT_EQ(1, hotplugs_.size());
+  EXPECT_EQ(40, listener_.HotplugTimeoutMs());
+
+  listener_.SetNow(kStartNs + kDebounceNs - 1);
+  listener_.DispatchPendingHotplug();
+  EXPECT_EQ(1, hotplugs_.size());
+  EXPECT_EQ(1, listener_.HotplugTimeoutMs());
+
+  // the rest of the burst is handled once, with the time of its first uevent
+  listener_.SetNow(kStartNs + kDebounceNs);
+  EXPECT_EQ(0, listener_.HotplugTimeoutMs());
+  listener_.DispatchPendingHotplug();
+  EXPECT_EQ((std::vector<uint64_t>{kStartNs, kStartNs}), hotplugs_);
+  EXPECT_EQ(-1, listener_.HotplugTimeoutMs());
+
+  // the trailing dispatch opens a new window
+  listener_.SetNow(kStartNs + kDebounceNs + 1);
+  SendHotplug();
+  listener_.UEventHandler();
+  EXPECT_EQ(2, hotplugs_.size());
+  listener_.SetNow(kStartNs + 2 * kDebounceNs);
+  listener_.DispatchPendingHotplug();
+  EXPECT_EQ((std::vector<uint64_t>{kStartNs, kStartNs, kStartNs + kDebounceNs + 1}),
+            hotplugs_);
+}
+
+TEST_F(DrmEventListenerTest, HotplugNeedsDrmDevtype) {
+  Send({"ACTION=change", "SUBSYSTEM=drm", "HOTPLUG=1", "DEVTYPE=drm_minorx"});
+  Send({"ACTION=change", "SUBSYSTEM=drm", "HOTPLUG=10", "DEVTYPE=drm_minor"});
+  Send({"ACTION=change", "SUBSYSTEM=usb", "DEVTYPE=usb_device"});
+  listener_.UEventHandler();
+
+  EXPECT_TRUE(hotplugs_.empty());
+  EXPECT_EQ(-1, listener_.HotplugTimeoutMs());
+}
+
+TEST_F(DrmEventListenerTest, PanelIdleEnterGetsWholeField) {
+  Send({"ACTION=change", "PANEL_IDLE_ENTER=1", "SUBSYSTEM=drm"});
+  Send({"PANEL_IDLE_ENTER"});
+  Send({"ACTION=change", "PANEL_IDLE_ENTER=0"});
+  listener_.UEventHandler();
+
+  EXPECT_EQ((std::vector<std::string>{"PANEL_IDLE_ENTER=1", "PANEL_IDLE_ENTER=0"}),
+            idle_events_);
+  EXPECT_TRUE(hotplugs_.empty());
+}
+
+TEST_F(DrmEventListenerTest, MoreThanBatchIsReadOnNextCall) {
+  const size_t count = DrmEventListener::kUEventBatch + 2;
+  for (size_t i = 0; i < count; i++)
+    Send({"PANEL_IDLE_ENTER=" + std::to_string(i)});
+
+  listener_.UEventHandler();
+  EXPECT_EQ(DrmEventListener::kUEventBatch, idle_events_.size());
+  listener_.UEventHandler();
+  ASSERT_EQ(count, idle_events_.size());
+  EXPECT_EQ("PANEL_IDLE_ENTER=" + std::to_string(count - 1), idle_events_.back());
+
+  // nothing left, and the socket does not block
+  listener_.UEventHandler();
+  EXPECT_EQ(count, idle_events_.size());
+}
+
+TEST_F(DrmEventListenerTest, TruncatedUEventIsParsedUpToCut) {
+  // the field is cut by the buffer size and has no terminator of its own
+  std::string tail = "PANEL_IDLE_ENTER=";
+  tail.append(DrmEventListener::kUEventBufferSize, 'x');
+  Send({"HOTPLUG=1", "DEVTYPE=drm_minor", tail});
+  listener_.UEventHandler();
+
+  ASSERT_EQ(1, idle_events_.size());
+  const size_t head = sizeof("HOTPLUG=1") + sizeof("DEVTYPE=drm_minor");
+  EXPECT_EQ(DrmEventListener::kUEventBufferSize - 1 - head, idle_events_[0].size());
+  EXPECT_EQ(1, hotplugs_.size());
+}
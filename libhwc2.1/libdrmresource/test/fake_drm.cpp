@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fake_drm.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <xf86drm.h>
+
+#include <algorithm>
+
+namespace android {
+
+namespace {
+
+// allocates like libdrm, so the structs are released by the drmModeFree*() below
+template <typename T>
+T *Alloc(size_t count = 1) {
+  return static_cast<T *>(calloc(std::max<size_t>(count, 1), sizeof(T)));
+}
+
+template <typename T>
+T *Copy(const std::vector<T> &values) {
+  T *copy = Alloc<T>(values.size());
+  std::copy(values.begin(), values.end(), copy);
+  return copy;
+}
+
+}  // namespace
+
+FakeDrm &FakeDrm::Get() {
+  static FakeDrm drm;
+  return drm;
+}
+
+void FakeDrm::Reset() {
+  *this = FakeDrm();
+}
+
+uint32_t FakeDrm::AddObject(uint32_t type, uint32_t parent, uint32_t subtype,
+                            uint32_t possible_crtcs) {
+  uint32_t id = next_id_++;
+  objects_[id] = {type, parent, subtype, possible_crtcs, {}, {},
+                  DRM_MODE_CONNECTED};
+  return id;
+}
+
+std::vector<uint32_t> FakeDrm::Ids(uint32_t type) const {
+  std::vector<uint32_t> ids;
+  for (auto &[id, obj] : objects_)
+    if (obj.type == type)
+      ids.push_back(id);
+  return ids;
+}
+
+uint32_t FakeDrm::AddCrtc() {
+  return AddObject(DRM_MODE_OBJECT_CRTC, 0, 0, 0);
+}
+
+uint32_t FakeDrm::AddEncoder(uint32_t crtc_id) {
+  return AddObject(DRM_MODE_OBJECT_ENCODER, crtc_id, 0, 0);
+}
+
+uint32_t FakeDrm::AddConnector(uint32_t encoder_id, uint32_t type) {
+  return AddObject(DRM_MODE_OBJECT_CONNECTOR, encoder_id, type, 0);
+}
+
+uint32_t FakeDrm::AddPlane(uint64_t type, uint32_t possible_crtcs) {
+  uint32_t id = AddObject(DRM_MODE_OBJECT_PLANE, 0, 0, possible_crtcs);
+  SetProperty(id, "type", type, DRM_MODE_PROP_ENUM | DRM_MODE_PROP_IMMUTABLE,
+              {"Overlay", "Primary", "Cursor"});
+  return id;
+}
+
+void FakeDrm::SetProperty(uint32_t obj_id, const char *name, uint64_t value,
+                          uint32_t flags, std::vector<std::string> enums) {
+  Object &obj = objects_.at(obj_id);
+
+  // like the kernel, the objects of a type share the property of a name
+  auto key = std::make_pair(obj.type, std::string(name));
+  auto it = property_ids_.find(key);
+  if (it == property_ids_.end()) {
+    uint32_t prop_id = next_id_++;
+    properties_[prop_id] = {name, flags, std::move(enums)};
+    it = property_ids_.emplace(key, prop_id).first;
+  }
+
+  for (auto &[prop_id, prop_value] : obj.properties) {
+    if (prop_id == it->second) {
+      prop_value = value;
+      return;
+    }
+  }
+  obj.properties.emplace_back(it->second, value);
+}
+
+uint32_t FakeDrm::PropertyId(uint32_t obj_id, const char *name) const {
+  auto it = property_ids_.find(
+      std::make_pair(objects_.at(obj_id).type, std::string(name)));
+  return it == property_ids_.end() ? 0 : it->second;
+}
+
+void FakeDrm::SetModes(uint32_t connector_id,
+                       std::vector<drmModeModeInfo> modes) {
+  objects_.at(connector_id).modes = std::move(modes);
+}
+
+void FakeDrm::SetConnection(uint32_t connector_id,
+                            drmModeConnection connection) {
+  objects_.at(connector_id).connection = connection;
+}
+
+uint32_t FakeDrm::AddBlob(const void *data, size_t length, uint32_t blob_id) {
+  uint32_t id = blob_id ? blob_id : next_id_++;
+  auto bytes = static_cast<const uint8_t *>(data);
+  blobs_[id].assign(bytes, bytes + length);
+  return id;
+}
+
+void FakeDrm::RemoveBlob(uint32_t blob_id) {
+  blobs_.erase(blob_id);
+}
+
+int FakeDrm::Calls(const char *func) const {
+  if (func) {
+    auto it = calls_.find(func);
+    return it == calls_.end() ? 0 : it->second;
+  }
+
+  int total = 0;
+  for (auto &[name, count] : calls_)
+    total += count;
+  return total;
+}
+
+drmModeResPtr FakeDrm::GetResources() const {
+  drmModeResPtr res = Alloc<drmModeRes>();
+  std::vector<uint32_t> crtcs = Ids(DRM_MODE_OBJECT_CRTC);
+  std::vector<uint32_t> encoders = Ids(DRM_MODE_OBJECT_ENCODER);
+  std::vector<uint32_t> connectors = Ids(DRM_MODE_OBJECT_CONNECTOR);
+
+  res->count_crtcs = crtcs.size();
+  res->crtcs = Copy(crtcs);
+  res->count_encoders = encoders.size();
+  res->encoders = Copy(encoders);
+  res->count_connectors = connectors.size();
+  res->connectors = Copy(connectors);
+  res->min_width = res->min_height = 1;
+  res->max_width = res->max_height = 4096;
+  return res;
+}
+
+drmModeCrtcPtr FakeDrm::GetCrtc(uint32_t id) const {
+  auto it = objects_.find(id);
+  if (it == objects_.end() || it->second.type != DRM_MODE_OBJECT_CRTC)
+    return nullptr;
+
+  drmModeCrtcPtr crtc = Alloc<drmModeCrtc>();
+  crtc->crtc_id = id;
+  return crtc;
+}
+
+drmModeEncoderPtr FakeDrm::GetEncoder(uint32_t id) const {
+  auto it = objects_.find(id);
+  if (it == objects_.end() || it->second.type != DRM_MODE_OBJECT_ENCODER)
+    return nullptr;
+
+  std::vector<uint32_t> crtcs = Ids(DRM_MODE_OBJECT_CRTC);
+  auto pipe = std::find(crtcs.begin(), crtcs.end(), it->second.parent);
+
+  drmModeEncoderPtr enc = Alloc<drmModeEncoder>();
+  enc->encoder_id = id;
+  enc->crtc_id = it->second.parent;
+  enc->possible_crtcs = 1 << (pipe - crtcs.begin());
+  return enc;
+}
+
+drmModeConnectorPtr FakeDrm::GetConnector(uint32_t id) const {
+  auto it = objects_.find(id);
+  if (it == objects_.end() || it->second.type != DRM_MODE_OBJECT_CONNECTOR)
+    return nullptr;
+  const Object &obj = it->second;
+
+  drmModeConnectorPtr c = Alloc<drmModeConnector>();
+  c->connector_id = id;
+  c->encoder_id = obj.parent;
+  c->connector_type = obj.subtype;
+  c->connector_type_id = 1;
+  c->connection = obj.connection;
+  c->count_modes = obj.modes.size();
+  c->modes = Copy(obj.modes);
+  c->count_encoders = 1;
+  c->encoders = Copy(std::vector<uint32_t>{obj.parent});
+
+  std::vector<uint32_t> props;
+  std::vector<uint64_t> values;
+  for (auto &[prop_id, value] : obj.properties) {
+    props.push_back(prop_id);
+    values.push_back(value);
+  }
+  c->count_props = props.size();
+  c->props = Copy(props);
+  c->prop_values = Copy(values);
+  return c;
+}
+
+drmModePlaneResPtr FakeDrm::GetPlaneResources() const {
+  std::vector<uint32_t> planes = Ids(DRM_MODE_OBJECT_PLANE);
+
+  drmModePlaneResPtr res = Alloc<drmModePlaneRes>();
+  res->count_planes = planes.size();
+  res->planes = Copy(planes);
+  return res;
+}
+
+drmModePlanePtr FakeDrm::GetPlane(uint32_t id) const {
+  auto it = objects_.find(id);
+  if (it == objects_.end() || it->second.type != DRM_MODE_OBJECT_PLANE)
+    return nullptr;
+
+  drmModePlanePtr plane = Alloc<drmModePlane>();
+  plane->plane_id = id;
+  plane->possible_crtcs = it->second.possible_crtcs;
+  return plane;
+}
+
+drmModeObjectPropertiesPtr FakeDrm::GetObjectProperties(
+    uint32_t obj_id, uint32_t obj_type) const {
+  auto it = objects_.find(obj_id);
+  if (it == objects_.end() || it->second.type != obj_type)
+    return nullptr;
+
+  drmModeObjectPropertiesPtr props = Alloc<drmModeObjectProperties>();
+  props->count_props = it->second.properties.size();
+  props->props = Alloc<uint32_t>(props->count_props);
+  props->prop_values = Alloc<uint64_t>(props->count_props);
+  for (uint32_t i = 0; i < props->count_props; i++) {
+    props->props[i] = it->second.properties[i].first;
+    props->prop_values[i] = it->second.properties[i].second;
+  }
+  return props;
+}
+
+drmModePropertyPtr FakeDrm::GetProperty(uint32_t prop_id) const {
+  auto it = properties_.find(prop_id);
+  if (it == properties_.end())
+    return nullptr;
+
+  drmModePropertyPtr p = Alloc<drmModePropertyRes>();
+  p->prop_id = prop_id;
+  p->flags = it->second.flags;
+  strncpy(p->name, it->second.name.c_str(), DRM_PROP_NAME_LEN - 1);
+  if (p->flags & DRM_MODE_PROP_RANGE) {
+    p->count_values = 2;
+    p->values = Copy(std::vector<uint64_t>{0, UINT32_MAX});
+  } else if (p->flags & DRM_MODE_PROP_ENUM) {
+    const std::vector<std::string> &enums = it->second.enums;
+    p->count_values = p->count_enums = enums.size();
+    p->values = Alloc<uint64_t>(enums.size());
+    p->enums = Alloc<drm_mode_property_enum>(enums.size());
+    for (size_t i = 0; i < enums.size(); i++) {
+      p->values[i] = p->enums[i].value = i;
+      strncpy(p->enums[i].name, enums[i].c_str(), DRM_PROP_NAME_LEN - 1);
+    }
+  }
+  return p;
+}
+
+drmModePropertyBlobPtr FakeDrm::GetPropertyBlob(uint32_t blob_id) const {
+  auto it = blobs_.find(blob_id);
+  if (it == blobs_.end())
+    return nullptr;
+
+  drmModePropertyBlobPtr blob = Alloc<drmModePropertyBlobRes>();
+  blob->id = blob_id;
+  blob->length = it->second.size();
+  blob->data = Copy(it->second);
+  return blob;
+}
+
+}  // namespace android
+
+using android::FakeDrm;
+
+extern "C" {
+
+int drmSetClientCap(int, uint64_t, uint64_t) {
+  FakeDrm::Get().Count(__func__);
+  return 0;
+}
+
+drmModeResPtr drmModeGetResources(int) {
+  FakeDrm::Get().Count(__func__);
+  return FakeDrm::Get().GetResources();
+}
+
+void drmModeFreeResources(drmModeResPtr ptr) {
+  if (!ptr)
+    return;
+  free(ptr->fbs);
+  free(ptr->crtcs);
+  free(ptr->connectors);
+  free(ptr->encoders);
+  free(ptr);
+}
+
+drmModeCrtcPtr drmModeGetCrtc(int, uint32_t crtc_id) {
+  FakeDrm::Get().Count(__func__);
+  return FakeDrm::Get().GetCrtc(crtc_id);
+}
+
+void drmModeFreeCrtc(drmModeCrtcPtr ptr) {
+  free(ptr);
+}
+
+drmModeEncoderPtr drmModeGetEncoder(int, uint32_t encoder_id) {
+  FakeDrm::Get().Count(__func__);
+  return FakeDrm::Get().GetEncoder(encoder_id);
+}
+
+void drmModeFreeEncoder(drmModeEncoderPtr ptr) {
+  free(ptr);
+}
+
+drmModeConnectorPtr drmModeGetConnector(int, uint32_t connector_id) {
+  FakeDrm::Get().Count(__func__);
+  return FakeDrm::Get().GetConnector(connector_id);
+}
+
+void drmModeFreeConnector(drmModeConnectorPtr ptr) {
+  if (!ptr)
+    return;
+  free(ptr->modes);
+  free(ptr->props);
+  free(ptr->prop_values);
+  free(ptr->encoders);
+  free(ptr);
+}
+
+drmModePlaneResPtr drmModeGetPlaneResources(int) {
+  FakeDrm::Get().Count(__func__);
+  return FakeDrm::Get().GetPlaneResources();
+}
+
+void drmModeFreePlaneResources(drmModePlaneResPtr ptr) {
+  if (!ptr)
+    return;
+  free(ptr->planes);
+  free(ptr);
+}
+
+drmModePlanePtr drmModeGetPlane(int, uint32_t plane_id) {
+  FakeDrm::Get().Count(__func__);
+  return FakeDrm::Get().GetPlane(plane_id);
+}
+
+void drmModeFreePlane(drmModePlanePtr ptr) {
+  if (!ptr)
+    return;
+  free(ptr->formats);
+  free(ptr);
+}
+
+drmModeObjectPropertiesPtr drmModeObjectGetProperties(int, uint32_t object_id,
+                                                      uint32_t object_type) {
+  FakeDrm::Get().Count(__func__);
+  return FakeDrm::Get().GetObjectProperties(object_id, object_type);
+}
+
+void drmModeFreeObjectProperties(drmModeObjectPropertiesPtr ptr) {
+  if (!ptr)
+    return;
+  free(ptr->props);
+  free(ptr->prop_values);
+  free(ptr);
+}
+
+drmModePropertyPtr drmModeGetProperty(int, uint32_t property_id) {
+  FakeDrm::Get().Count(__func__);
+  return FakeDrm::Get().GetProperty(property_id);
+}
+
+void drmModeFreeProperty(drmModePropertyPtr ptr) {
+  if (!ptr)
+    return;
+  free(ptr->values);
+  free(ptr->enums);
+  free(ptr->blob_ids);
+  free(ptr);
+}
+
+drmModePropertyBlobPtr drmModeGetPropertyBlob(int, uint32_t blob_id) {
+  FakeDrm::Get().Count(__func__);
+  return FakeDrm::Get().GetPropertyBlob(blob_id);
+}
+
+void drmModeFreePropertyBlob(drmModePropertyBlobPtr ptr) {
+  if (!ptr)
+    return;
+  free(ptr->data);
+  free(ptr);
+}
+
+}  // extern "C"
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <xf86drmMode.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace android {
+
+/*
+ * Fake DRM device behind the libdrm calls of libdrmresource.
+ *
+ * The test binary defines the libdrm functions used by libdrmresource, so the
+ * library sources built into it talk to this fake instead of the kernel. Each
+ * call stands for at least one ioctl and is counted by function name.
+ */
+class FakeDrm {
+ public:
+  static FakeDrm &Get();
+
+  // forgets the topology, the blobs and the counters
+  void Reset();
+
+  uint32_t AddCrtc();
+  uint32_t AddEncoder(uint32_t crtc_id);
+  uint32_t AddConnector(uint32_t encoder_id, uint32_t type);
+  uint32_t AddPlane(uint64_t type, uint32_t possible_crtcs);
+
+  // adds the property @name to the object, or sets its value if it exists.
+  // The values of an enum property are the indices of @enums.
+  void SetProperty(uint32_t obj_id, const char *name, uint64_t value,
+                   uint32_t flags = DRM_MODE_PROP_RANGE,
+                   std::vector<std::string> enums = {});
+  uint32_t PropertyId(uint32_t obj_id, const char *name) const;
+
+  void SetModes(uint32_t connector_id, std::vector<drmModeModeInfo> modes);
+  void SetConnection(uint32_t connector_id, drmModeConnection connection);
+  // the blob gets @blob_id if not 0, as the kernel recycles the ids of the
+  // freed blobs
+  uint32_t AddBlob(const void *data, size_t length, uint32_t blob_id = 0);
+  void RemoveBlob(uint32_t blob_id);
+
+  // number of libdrm calls to @func, or to all the functions if null
+  int Calls(const char *func = nullptr) const;
+  void ResetCalls() { calls_.clear(); }
+  size_t NumProperties() const { return properties_.size(); }
+
+  // backs the libdrm functions
+  void Count(const char *func) { calls_[func]++; }
+  drmModeResPtr GetResources() const;
+  drmModeCrtcPtr GetCrtc(uint32_t id) const;
+  drmModeEncoderPtr GetEncoder(uint32_t id) const;
+  drmModeConnectorPtr GetConnector(uint32_t id) const;
+  drmModePlaneResPtr GetPlaneResources() const;
+  drmModePlanePtr GetPlane(uint32_t id) const;
+  drmModeObjectPropertiesPtr GetObjectProperties(uint32_t obj_id,
+                                                 uint32_t obj_type) const;
+  drmModePropertyPtr GetProperty(uint32_t prop_id) const;
+  drmModePropertyBlobPtr GetPropertyBlob(uint32_t blob_id) const;
+
+ private:
+  struct Object {
+    uint32_t type;
+    // for the encoders, the CRTC. For the connectors, the encoder
+    uint32_t parent;
+    uint32_t subtype;
+    uint32_t possible_crtcs;
+    std::vector<std::pair<uint32_t, uint64_t>> properties;
+    std::vector<drmModeModeInfo> modes;
+    drmModeConnection connection;
+  };
+  struct Property {
+    std::string name;
+    uint32_t flags;
+    std::vector<std::string> enums;
+  };
+
+  uint32_t AddObject(uint32_t type, uint32_t parent, uint32_t subtype,
+                     uint32_t possible_crtcs);
+  std::vector<uint32_t> Ids(uint32_t type) const;
+
+  uint32_t next_id_ = 1;
+  std::map<uint32_t, Object> objects_;
+  std::map<uint32_t, Property> properties_;
+  std::map<std::pair<uint32_t, std::string>, uint32_t> property_ids_;
+  std::map<uint32_t, std::vector<uint8_t>> blobs_;
+  std::map<std::string, int> calls_;
+};
+
+}  // namespace android
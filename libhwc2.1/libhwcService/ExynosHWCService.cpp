@@ -310,6 +310,7 @@ int ExynosHWCService::setHWCCtl(uint32_t display, uint32_t ctrl, int32_t val)
     case HWC_CTL_SKIP_VALIDATE:
     case HWC_CTL_DUMP_MID_BUF:
     case HWC_CTL_CAPTURE_READBACK:
+    case HWC_CTL_STREAM_READBACK:
     case HWC_CTL_ENABLE_COMPOSITION_CROP:
     case HWC_CTL_ENABLE_EXYNOSCOMPOSITION_OPT:
     case HWC_CTL_ENABLE_CLIENTCOMPOSITION_OPT:
@@ -551,4 +552,13 @@ int32_t ExynosHWCService::triggerRefreshRateIndicatorUpdate(uint32_t displayId,
     return NO_ERROR;
 }
 
+int32_t ExynosHWCService::getFrameTimeline(uint32_t displayId, std::vector<uint8_t>* outData) {
+    auto display = mHWCCtx->device->getDisplay(displayId);
+
+    if (display == nullptr || outData == nullptr) return -EINVAL;
+
+    display->mFrameTimeline.exportBinary(*outData);
+    return NO_ERROR;
+}
+
 } //namespace android
@@ -86,6 +86,8 @@ public:
                                                    const bool& enable) override;
     virtual int32_t triggerRefreshRateIndicatorUpdate(uint32_t displayId,
                                                       uint32_t refreshRate) override;
+    virtual int32_t getFrameTimeline(uint32_t displayId,
+                                     std::vector<uint8_t>* outData) override;
 
 private:
     friend class Singleton<ExynosHWCService>;
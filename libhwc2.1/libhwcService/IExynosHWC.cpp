@@ -69,6 +69,7 @@ enum {
     IGNORE_DISPLAY_BRIGHTNESS_UPDATE_REQUESTS = 1012,
     SET_DISPLAY_BRIGHTNESS_NITS = 1013,
     SET_DISPLAY_BRIGHTNESS_DBV = 1014,
+    GET_FRAME_TIMELINE = 1015,
 };
 
 class BpExynosHWCService : public BpInterface<IExynosHWCService> {
@@ -520,6 +521,21 @@ public:
                  result);
         return result;
     }
+
+    int32_t getFrameTimeline(uint32_t displayId, std::vector<uint8_t>* outData) override {
+        Parcel data, reply;
+        data.writeInterfaceToken(IExynosHWCService::getInterfaceDescriptor());
+        data.writeUint32(displayId);
+
+        auto result = remote()->transact(GET_FRAME_TIMELINE, data, &reply);
+        if (result != NO_ERROR) {
+            ALOGE("GET_FRAME_TIMELINE transact error(%d)", result);
+            return result;
+        }
+        result = reply.readInt32();
+        if (result == NO_ERROR) result = reply.readByteVector(outData);
+        return result;
+    }
 };
 
 IMPLEMENT_META_INTERFACE(ExynosHWCService, "android.hal.ExynosHWCService");
@@ -817,6 +833,16 @@ status_t BnExynosHWCService::onTransact(
             return NO_ERROR;
         } break;
 
+        case GET_FRAME_TIMELINE: {
+            CHECK_INTERFACE(IExynosHWCService, data, reply);
+            uint32_t displayId = data.readUint32();
+            std::vector<uint8_t> timeline;
+            int32_t error = getFrameTimeline(displayId, &timeline);
+            reply->writeInt32(error);
+            if (error == NO_ERROR) reply->writeByteVector(timeline);
+            return NO_ERROR;
+        } break;
+
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
@@ -80,6 +80,8 @@ public:
     virtual int32_t setDisplayMultiThreadedPresent(const int32_t& displayId,
                                                    const bool& enable) = 0;
     virtual int32_t triggerRefreshRateIndicatorUpdate(uint32_t displayId, uint32_t refreshRate) = 0;
+    /* The recent frame timeline of the display in the FrameTimeline export layout */
+    virtual int32_t getFrameTimeline(uint32_t displayId, std::vector<uint8_t>* outData) = 0;
 };
 
 /* Native Interface */
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cutils/native_handle.h>
+#include <hardware/hwcomposer_defs.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+/* The number of identical frames before the client target is reused */
+#define SKIP_STATIC_LAYER_STABLE_FRAMES  2
+
+class ExynosLayer;
+
+/* 64-bit FNV-1a hash of plain values */
+class SignatureHasher {
+    public:
+        template <typename T>
+        SignatureHasher &add(const T &value) {
+            static_assert(std::is_trivially_copyable<T>::value, "hash the members instead");
+            return addBytes(&value, sizeof(value));
+        }
+
+        SignatureHasher &addBytes(const void *data, size_t len) {
+            auto bytes = static_cast<const uint8_t *>(data);
+            for (size_t i = 0; i < len; i++) {
+                mHash ^= bytes[i];
+                mHash *= 0x100000001b3ULL;
+            }
+            return *this;
+        }
+
+        uint64_t get() const { return mHash; };
+
+    private:
+        uint64_t mHash = 0xcbf29ce484222325ULL;
+};
+
+/*
+ * The attributes the client composition of a layer depends on. The static client layers
+ * are rejected as changed by the hash of the states, and confirmed as unchanged by
+ * comparing the states, so a hash collision is never taken as a static frame.
+ */
+struct ClientLayerState {
+    /* the layer, for the layer order is also a part of the client composition */
+    const ExynosLayer *layer = nullptr;
+    buffer_handle_t buffer = nullptr;
+    hwc_frect_t sourceCrop = {0, 0, 0, 0};
+    hwc_rect_t displayFrame = {0, 0, 0, 0};
+    int32_t dataSpace = 0;
+    int32_t blending = 0;
+    int32_t transform = 0;
+    float planeAlpha = 1.0f;
+    hwc_color_t color = {0, 0, 0, 0};
+    float brightness = 1.0f;
+
+    bool operator==(const ClientLayerState &rhs) const {
+        return (layer == rhs.layer) && (buffer == rhs.buffer) &&
+                (sourceCrop.left == rhs.sourceCrop.left) &&
+                (sourceCrop.top == rhs.sourceCrop.top) &&
+                (sourceCrop.right == rhs.sourceCrop.right) &&
+                (sourceCrop.bottom == rhs.sourceCrop.bottom) &&
+                (displayFrame.left == rhs.displayFrame.left) &&
+                (displayFrame.top == rhs.displayFrame.top) &&
+                (displayFrame.right == rhs.displayFrame.right) &&
+                (displayFrame.bottom == rhs.displayFrame.bottom) &&
+                (dataSpace == rhs.dataSpace) && (blending == rhs.blending) &&
+                (transform == rhs.transform) && (planeAlpha == rhs.planeAlpha) &&
+                (color.r == rhs.color.r) && (color.g == rhs.color.g) &&
+                (color.b == rhs.color.b) && (color.a == rhs.color.a) &&
+                (brightness == rhs.brightness);
+    }
+    bool operator!=(const ClientLayerState &rhs) const { return !(*this == rhs); }
+
+    /* the fields are hashed one by one, so the padding is not hashed */
+    uint64_t hash() const {
+        SignatureHasher hasher;
+        hasher.add(layer).add(buffer).add(sourceCrop).add(displayFrame).add(dataSpace);
+        hasher.add(blending).add(transform).add(planeAlpha).add(color).add(brightness);
+        return hasher.get();
+    }
+};
+
+/*
+ * The client composition layers since they were recorded. The signature rejects a change
+ * quickly and the states confirm no change, so a hash collision is never taken as a static
+ * frame. @getState(i) returns the current state of the i-th of the @count layers.
+ */
+class StaticClientLayers {
+    public:
+        template <typename GetState>
+        bool isSame(std::optional<uint64_t> signature, size_t count, GetState &&getState) const {
+            if ((signature != mSignature) || (mStates.size() != count))
+                return false;
+            for (size_t i = 0; i < count; i++) {
+                if (getState(i) != mStates[i])
+                    return false;
+            }
+            return true;
+        }
+
+        /*
+         * Counts a frame of the layers. The layers are recorded again if they changed or
+         * if @recorded is false. Returns the number of frames they are unchanged for,
+         * capped at SKIP_STATIC_LAYER_STABLE_FRAMES, or 0 if they were recorded again.
+         */
+        template <typename GetState>
+        uint32_t update(bool recorded, uint64_t signature, size_t count, GetState &&getState) {
+            if (recorded && isSame(signature, count, getState)) {
+                if (mStableFrames < SKIP_STATIC_LAYER_STABLE_FRAMES)
+                    mStableFrames++;
+                return mStableFrames;
+            }
+
+            mSignature = signature;
+            mStates.clear();
+            for (size_t i = 0; i < count; i++)
+                mStates.push_back(getState(i));
+            mStableFrames = 0;
+            return 0;
+        }
+
+        void clear() {
+            mSignature = 0;
+            mStates.clear();
+            mStableFrames = 0;
+        }
+
+        uint64_t signature() const { return mSignature; }
+
+    private:
+        uint64_t mSignature = 0;
+        std::vector<ClientLayerState> mStates;
+        uint32_t mStableFrames = 0;
+};
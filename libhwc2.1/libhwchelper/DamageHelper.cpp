@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DamageHelper.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+hwc_rect transformDamage(const hwc_rect &damage, const hwc_frect_t &crop,
+                         const hwc_rect &frame)
+{
+    hwc_rect rect = {0, 0, 0, 0};
+    float cropW = crop.right - crop.left;
+    float cropH = crop.bottom - crop.top;
+
+    /* relative to the source crop */
+    float l = std::max((float)damage.left, crop.left) - crop.left;
+    float t = std::max((float)damage.top, crop.top) - crop.top;
+    float r = std::min((float)damage.right, crop.right) - crop.left;
+    float b = std::min((float)damage.bottom, crop.bottom) - crop.top;
+
+    if ((cropW <= 0) || (cropH <= 0) || (l >= r) || (t >= b))
+        return rect;
+
+    float scaleX = (frame.right - frame.left) / cropW;
+    float scaleY = (frame.bottom - frame.top) / cropH;
+
+    rect.left = frame.left + (int)floorf(l * scaleX);
+    rect.top = frame.top + (int)floorf(t * scaleY);
+    rect.right = frame.left + (int)ceilf(r * scaleX);
+    rect.bottom = frame.top + (int)ceilf(b * scaleY);
+
+    return rect;
+}
+
+hwc_rect getWindowUpdateRegion(const hwc_rect &bounds, int32_t width, int32_t height,
+                               int32_t alignX, int32_t alignY)
+{
+    hwc_rect region = {std::max(bounds.left, 0), std::max(bounds.top, 0),
+                       std::min(bounds.right, width), std::min(bounds.bottom, height)};
+
+    if (rectArea(region) == 0)
+        return {0, 0, 0, 0};
+
+    region.left -= region.left % alignX;
+    region.top -= region.top % alignY;
+    region.right = std::min((region.right + alignX - 1) / alignX * alignX, width);
+    region.bottom = std::min((region.bottom + alignY - 1) / alignY * alignY, height);
+    return region;
+}
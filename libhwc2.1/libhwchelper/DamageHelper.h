@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <hardware/hwcomposer_defs.h>
+#include <stdint.h>
+
+#include <algorithm>
+
+inline uint64_t rectArea(const hwc_rect &r)
+{
+    if ((r.right <= r.left) || (r.bottom <= r.top))
+        return 0;
+    return static_cast<uint64_t>(r.right - r.left) * (r.bottom - r.top);
+}
+
+/* Expands @area to the bounds of @area and @rect. An empty rectangle adds nothing */
+inline void addDamage(hwc_rect &area, const hwc_rect &rect)
+{
+    if (rectArea(rect) == 0)
+        return;
+    if (rectArea(area) == 0) {
+        area = rect;
+        return;
+    }
+    area = {std::min(area.left, rect.left), std::min(area.top, rect.top),
+            std::max(area.right, rect.right), std::max(area.bottom, rect.bottom)};
+}
+
+/*
+ * Maps @damage in the buffer coordinate to the display coordinate through the
+ * source crop and the scaling to the display frame of a layer which is neither
+ * rotated nor flipped. The result is rounded outwards and is empty if @damage
+ * is outside of the source crop.
+ */
+hwc_rect transformDamage(const hwc_rect &damage, const hwc_frect_t &crop,
+                         const hwc_rect &frame);
+
+/*
+ * Returns the window update region of the damage bounded by @bounds on a panel
+ * of @width x @height, i.e. @bounds clipped to the panel and expanded to the
+ * @alignX x @alignY granularity of the partial update of the panel. Empty if
+ * @bounds is outside of the panel.
+ */
+hwc_rect getWindowUpdateRegion(const hwc_rect &bounds, int32_t width, int32_t height,
+                               int32_t alignX, int32_t alignY);
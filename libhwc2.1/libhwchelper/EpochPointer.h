@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+/*
+ * An immutable object read without a lock and replaced by a writer (RCU-style).
+ * The readers enter the counter of the current epoch. publish() flips the epoch
+ * and waits only for the readers of the previous epoch, which may still see the
+ * old object, before freeing it. So the old object is never read after publish()
+ * returns. The writers are serialized by the caller.
+ */
+template <typename T>
+class EpochPointer {
+    public:
+        class Reader {
+            public:
+                explicit Reader(const EpochPointer &pointer) : mPointer(pointer) {
+                    while (true) {
+                        mEpoch = mPointer.mEpoch.load(std::memory_order_acquire);
+                        mPointer.mReaders[mEpoch & 1].fetch_add(1, std::memory_order_seq_cst);
+                        /* retry if publish() flipped the epoch before it saw this reader */
+                        if (mPointer.mEpoch.load(std::memory_order_seq_cst) == mEpoch) break;
+                        mPointer.mReaders[mEpoch & 1].fetch_sub(1, std::memory_order_release);
+                    }
+                    mObject = mPointer.mObject.load(std::memory_order_acquire);
+                }
+                ~Reader() { mPointer.mReaders[mEpoch & 1].fetch_sub(1, std::memory_order_release); }
+                Reader(const Reader &) = delete;
+                Reader &operator=(const Reader &) = delete;
+
+                const T &operator*() const { return *mObject; };
+                const T *operator->() const { return mObject; };
+
+            private:
+                const EpochPointer &mPointer;
+                uint32_t mEpoch;
+                const T *mObject;
+        };
+
+        explicit EpochPointer(const T *object) : mObject(object) {}
+        ~EpochPointer() { delete mObject.load(); }
+        EpochPointer(const EpochPointer &) = delete;
+        EpochPointer &operator=(const EpochPointer &) = delete;
+
+        /* the current object, for the writer which is the only one to replace it */
+        const T &current() const { return *mObject.load(std::memory_order_acquire); };
+
+        void publish(const T *object) {
+            const T *old = mObject.exchange(object, std::memory_order_seq_cst);
+            uint32_t epoch = mEpoch.fetch_add(1, std::memory_order_seq_cst);
+
+            /* the readers entered the new epoch see the new object */
+            while (mReaders[epoch & 1].load(std::memory_order_acquire) != 0)
+                std::this_thread::yield();
+
+            delete old;
+        }
+
+    private:
+        std::atomic<const T *> mObject;
+        std::atomic<uint32_t> mEpoch = 0;
+        mutable std::atomic<uint32_t> mReaders[2] = {0, 0};
+};
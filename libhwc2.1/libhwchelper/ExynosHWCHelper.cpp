@@ -24,6 +24,7 @@
 #include <utils/CallStack.h>
 #include <utils/Errors.h>
 
+#include <cmath>
 #include <iomanip>
 
 #include "ExynosHWC.h"
@@ -928,11 +929,42 @@ void setFenceInfo(uint32_t fd, const ExynosDisplay *display, HwcFdebugFenceType
                                           dupFrom);
 }
 
+void setFenceInfos(const std::vector<int32_t> &fds, const ExynosDisplay *display,
+                   HwcFdebugFenceType type, HwcFdebugIpType ip, HwcFenceDirection direction) {
+    if (display == NULL) return;
+
+    ExynosDevice* device = display->mDevice;
+    device->mFenceTracker.updateFenceInfos(fds, display, type, ip, direction);
+}
+
 void FenceTracker::updateFenceInfo(uint32_t fd, const ExynosDisplay *display,
                                    HwcFdebugFenceType type, HwcFdebugIpType ip,
                                    HwcFenceDirection direction, bool pendingAllowed,
                                    int32_t dupFrom) {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+
     std::scoped_lock lock(mFenceMutex);
+    updateFenceInfoLocked(fd, display, type, ip, direction, pendingAllowed, dupFrom, time);
+}
+
+void FenceTracker::updateFenceInfos(const std::vector<int32_t> &fds, const ExynosDisplay *display,
+                                    HwcFdebugFenceType type, HwcFdebugIpType ip,
+                                    HwcFenceDirection direction) {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+
+    std::scoped_lock lock(mFenceMutex);
+    for (int32_t fd : fds) {
+        if (!fence_valid(fd)) continue;
+        updateFenceInfoLocked(fd, display, type, ip, direction, false, -1, time);
+    }
+}
+
+void FenceTracker::updateFenceInfoLocked(uint32_t fd, const ExynosDisplay *display,
+                                         HwcFdebugFenceType type, HwcFdebugIpType ip,
+                                         HwcFenceDirection direction, bool pendingAllowed,
+                                         int32_t dupFrom, const struct timeval &time) {
     HwcFenceInfo &info = mFenceInfos[fd];
     info.displayId = display->mDisplayId;
 
@@ -970,9 +1002,7 @@ void FenceTracker::updateFenceInfo(uint32_t fd, const ExynosDisplay *display,
         printLastFenceInfoLocked(fd);
     }
 
-    HwcFenceTrace trace = {.direction = direction, .type = type, .ip = ip, .time = {0, 0}};
-
-    gettimeofday(&trace.time, NULL);
+    HwcFenceTrace trace = {.direction = direction, .type = type, .ip = ip, .time = time};
 
     info.traces.push_back(trace);
 
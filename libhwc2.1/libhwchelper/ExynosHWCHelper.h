@@ -28,6 +28,7 @@
 #include <string>
 #include <vector>
 
+#include "DamageHelper.h"
 #include "DeconCommonHeader.h"
 #include "VendorGraphicBuffer.h"
 #include "VendorVideoAPI.h"
@@ -554,15 +555,25 @@ void setFenceName(int fenceFd, HwcFenceType fenceType);
 void setFenceInfo(uint32_t fd, const ExynosDisplay *display, HwcFdebugFenceType type,
                   HwcFdebugIpType ip, HwcFenceDirection direction, bool pendingAllowed = false,
                   int32_t dupFrom = -1);
+// setFenceInfo() of @fds under one lock of the tracker. The invalid fds are skipped.
+void setFenceInfos(const std::vector<int32_t> &fds, const ExynosDisplay *display,
+                   HwcFdebugFenceType type, HwcFdebugIpType ip, HwcFenceDirection direction);
 
 class FenceTracker {
 public:
     void updateFenceInfo(uint32_t fd, const ExynosDisplay *display, HwcFdebugFenceType type,
                          HwcFdebugIpType ip, HwcFenceDirection direction,
                          bool pendingAllowed = false, int32_t dupFrom = -1);
+    void updateFenceInfos(const std::vector<int32_t> &fds, const ExynosDisplay *display,
+                          HwcFdebugFenceType type, HwcFdebugIpType ip,
+                          HwcFenceDirection direction);
     bool validateFences(ExynosDisplay *display);
 
 private:
+    void updateFenceInfoLocked(uint32_t fd, const ExynosDisplay *display, HwcFdebugFenceType type,
+                               HwcFdebugIpType ip, HwcFenceDirection direction,
+                               bool pendingAllowed, int32_t dupFrom, const struct timeval &time)
+            REQUIRES(mFenceMutex);
     void printLastFenceInfoLocked(uint32_t fd) REQUIRES(mFenceMutex);
     void dumpFenceInfoLocked(int32_t count) REQUIRES(mFenceMutex);
     void printLeakFdsLocked() REQUIRES(mFenceMutex);
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/*
+ * Hands the release fence @relFence of the client target window out to the client layers
+ * among the layers @first to @last, i.e. the layers @isClient(i). The caller of
+ * getReleaseFences() owns every fd it gets, so each client layer gets its own fd through
+ * @setFence(i, fd): the last client layer takes @relFence itself, which is set to -1, and
+ * the others get @dup(@relFence).
+ *
+ * The other layers in the range must be @canSkip(i). Returns the index of the first layer
+ * which is neither, after the client layers before it got their fences, or -1.
+ */
+template <typename IsClient, typename CanSkip, typename Dup, typename SetFence>
+int handOutClientReleaseFence(int &relFence, int first, int last, IsClient &&isClient,
+                              CanSkip &&canSkip, Dup &&dup, SetFence &&setFence) {
+    int lastClient = -1;
+    for (int i = last; i >= first; i--) {
+        if (isClient(i)) {
+            lastClient = i;
+            break;
+        }
+    }
+
+    for (int i = first; i <= last; i++) {
+        if (!isClient(i)) {
+            if (!canSkip(i)) return i;
+            continue;
+        }
+
+        if (i == lastClient) {
+            setFence(i, relFence);
+            relFence = -1;
+        } else {
+            setFence(i, dup(relFence));
+        }
+    }
+
+    return -1;
+}
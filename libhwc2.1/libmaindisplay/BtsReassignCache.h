@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <unordered_map>
+
+class ExynosLayer;
+
+/*
+ * The layer whose assignment does not hold at a refresh rate, raised above or lowered
+ * below the BTS refresh rate. The assignments change only in validation, so a result is
+ * kept until the next validation. A cached layer is returned only while it is still at the
+ * index it was found at, as the layers might be destroyed in the meantime.
+ */
+class BtsReassignCache {
+  public:
+    /*
+     * Returns the layer cached for @refreshRate and @raise in the validation @generation,
+     * nullptr if every assignment held, or nullopt if the layers must be checked again.
+     */
+    template <typename Layers>
+    std::optional<ExynosLayer *> find(uint32_t refreshRate, bool raise, uint64_t generation,
+                                      const Layers &layers) const {
+        auto it = mEntries.find(key(refreshRate, raise));
+        if (it == mEntries.end() || it->second.generation != generation) return std::nullopt;
+
+        const Entry &entry = it->second;
+        if (entry.layer == nullptr) return nullptr;
+        if (entry.index < layers.size() && layers[entry.index] == entry.layer)
+            return entry.layer;
+        return std::nullopt;
+    }
+
+    // @layer is at @index of the layers, or nullptr if every assignment holds
+    void store(uint32_t refreshRate, bool raise, uint64_t generation, size_t index,
+               ExynosLayer *layer) {
+        mEntries[key(refreshRate, raise)] = Entry{generation, index, layer};
+    }
+
+  private:
+    static uint32_t key(uint32_t refreshRate, bool raise) { return (refreshRate << 1) | raise; }
+
+    struct Entry {
+        // the validation the result is taken in
+        uint64_t generation = 0;
+        size_t index = 0;
+        ExynosLayer *layer = nullptr;
+    };
+    std::unordered_map<uint32_t, Entry> mEntries;
+};
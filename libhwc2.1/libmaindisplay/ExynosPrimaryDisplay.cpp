@@ -348,6 +348,9 @@ int32_t ExynosPrimaryDisplay::setPowerOff() {
 
     mDisplayInterface->setPowerMode(HWC2_POWER_MODE_OFF);
 
+    // the buffers returned later are freed by the periodic trim
+    mResourceManager->getDstBufferPool().clear(mDisplayId);
+
     {
         std::lock_guard<std::mutex> lock(mPowerModeMutex);
         mPowerModeState = HWC2_POWER_MODE_OFF;
@@ -978,15 +981,7 @@ void ExynosPrimaryDisplay::handleDisplayIdleEnter(const uint32_t idleTeRefreshRa
         return;
     }
 
-    bool needed = false;
-    for (size_t i = 0; i < mLayers.size(); i++) {
-        if (mLayers[i]->mOtfMPP && mLayers[i]->mM2mMPP == nullptr &&
-            !mLayers[i]->checkBtsCap(idleTeRefreshRate)) {
-            needed = true;
-            break;
-        }
-    }
-
+    bool needed = getBtsReassignLayer(idleTeRefreshRate, true) != nullptr;
     setDisplayNeedHandleIdleExit(needed, false);
 }
 
@@ -1160,31 +1155,48 @@ void ExynosPrimaryDisplay::checkBtsReassignResource(const uint32_t vsyncPeriod,
     uint32_t refreshRate = static_cast<uint32_t>(round(nsecsPerSec / vsyncPeriod * 0.1f) * 10);
 
     Mutex::Autolock lock(mDRMutex);
-    if (vsyncPeriod < btsVsyncPeriod) {
-        for (size_t i = 0; i < mLayers.size(); i++) {
-            if (mLayers[i]->mOtfMPP && mLayers[i]->mM2mMPP == nullptr &&
-                !mLayers[i]->checkBtsCap(refreshRate)) {
-                mLayers[i]->setGeometryChanged(GEOMETRY_DEVICE_CONFIG_CHANGED);
-                break;
-            }
+    if (vsyncPeriod == btsVsyncPeriod) return;
+
+    ExynosLayer* layer = getBtsReassignLayer(refreshRate, vsyncPeriod < btsVsyncPeriod);
+    if (layer) layer->setGeometryChanged(GEOMETRY_DEVICE_CONFIG_CHANGED);
+}
+
+ExynosLayer* ExynosPrimaryDisplay::getBtsReassignLayer(const uint32_t refreshRate,
+                                                       const bool raise) {
+    std::optional<ExynosLayer*> cached =
+            mBtsReassignCache.find(refreshRate, raise, mValidateGeneration, mLayers);
+    if (cached.has_value()) return cached.value();
+
+    size_t index = 0;
+    ExynosLayer* found = nullptr;
+    for (size_t i = 0; i < mLayers.size(); i++) {
+        ExynosLayer* layer = mLayers[i];
+        if (layer->mOtfMPP == nullptr) continue;
+
+        bool reassign = false;
+        if (raise) {
+            // the layer can not be processed by the OTF MPP alone at the higher rate
+            reassign = layer->mM2mMPP == nullptr && !layer->checkBtsCap(refreshRate);
+        } else if (layer->mM2mMPP) {
+            // the OTF MPP can process the layer alone at the lower rate
+            float srcWidth = layer->mSourceCrop.right - layer->mSourceCrop.left;
+            float srcHeight = layer->mSourceCrop.bottom - layer->mSourceCrop.top;
+            float resolution = srcWidth * srcHeight * refreshRate / 1000;
+            float ratioVertical =
+                    static_cast<float>(layer->mDisplayFrame.bottom - layer->mDisplayFrame.top) /
+                    mYres;
+            reassign = layer->mOtfMPP->checkDownscaleCap(resolution, ratioVertical);
         }
-    } else if (vsyncPeriod > btsVsyncPeriod) {
-        for (size_t i = 0; i < mLayers.size(); i++) {
-            if (mLayers[i]->mOtfMPP && mLayers[i]->mM2mMPP) {
-                float srcWidth = mLayers[i]->mSourceCrop.right - mLayers[i]->mSourceCrop.left;
-                float srcHeight = mLayers[i]->mSourceCrop.bottom - mLayers[i]->mSourceCrop.top;
-                float resolution = srcWidth * srcHeight * refreshRate / 1000;
-                float ratioVertical = static_cast<float>(mLayers[i]->mDisplayFrame.bottom -
-                                                         mLayers[i]->mDisplayFrame.top) /
-                        mYres;
-
-                if (mLayers[i]->mOtfMPP->checkDownscaleCap(resolution, ratioVertical)) {
-                    mLayers[i]->setGeometryChanged(GEOMETRY_DEVICE_CONFIG_CHANGED);
-                    break;
-                }
-            }
+
+        if (reassign) {
+            index = i;
+            found = layer;
+            break;
         }
     }
+
+    mBtsReassignCache.store(refreshRate, raise, mValidateGeneration, index, found);
+    return found;
 }
 
 bool ExynosPrimaryDisplay::isDbmSupported() {
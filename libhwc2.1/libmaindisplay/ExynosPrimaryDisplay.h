@@ -19,6 +19,7 @@
 #include <map>
 
 #include "../libdevice/ExynosDisplay.h"
+#include "BtsReassignCache.h"
 
 using namespace displaycolor;
 
@@ -170,6 +171,13 @@ class ExynosPrimaryDisplay : public ExynosDisplay {
         std::ofstream mDisplayNeedHandleIdleExitOfs;
         int64_t mDisplayIdleDelayNanos;
         bool mDisplayNeedHandleIdleExit;
+
+        /*
+         * The layer whose assignment does not hold at a refresh rate, raised above or
+         * lowered below the BTS refresh rate. nullptr if every assignment holds.
+         */
+        ExynosLayer* getBtsReassignLayer(const uint32_t refreshRate, const bool raise);
+        BtsReassignCache mBtsReassignCache;
 };
 
 #endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DamageHistory.h"
+
+#include <algorithm>
+
+#include "DamageHelper.h"
+
+DamageHistory::DamageHistory(uint32_t numBuffers)
+      : mDamage(numBuffers + 1, hwc_rect_t{0, 0, 0, 0}), mComposedCount(numBuffers, 0) {}
+
+bool DamageHistory::getIncrementalArea(uint32_t buffer, const hwc_rect_t &damage,
+                                       hwc_rect_t &area) const {
+    if (buffer >= mComposedCount.size()) return false;
+
+    const uint64_t composedCount = mComposedCount[buffer];
+    if ((composedCount == 0) || (mCompositionCount - composedCount >= mDamage.size()))
+        return false;
+
+    area = damage;
+    for (uint64_t count = composedCount + 1; count <= mCompositionCount; count++)
+        addDamage(area, mDamage[count % mDamage.size()]);
+
+    // nothing to update. The whole buffer is composited rather than an empty job
+    return rectArea(area) != 0;
+}
+
+void DamageHistory::composed(uint32_t buffer, const hwc_rect_t &damage) {
+    mCompositionCount++;
+    mDamage[mCompositionCount % mDamage.size()] = damage;
+    if (buffer < mComposedCount.size()) mComposedCount[buffer] = mCompositionCount;
+}
+
+void DamageHistory::invalidate(uint32_t buffer) {
+    if (buffer < mComposedCount.size()) mComposedCount[buffer] = 0;
+}
+
+void DamageHistory::invalidateAll() {
+    std::fill(mComposedCount.begin(), mComposedCount.end(), 0);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <hardware/hwcomposer_defs.h>
+#include <stdint.h>
+
+#include <vector>
+
+/*
+ * The damage of the compositions of an M2M MPP into its destination buffers, for the
+ * incremental composition. A destination buffer keeps the content of the composition which
+ * wrote it last, so the next composition into it updates only the region damaged by the
+ * compositions made into the other buffers since then.
+ *
+ * The damage of the last @numBuffers compositions is kept, which covers the buffers used in
+ * turn. A buffer not composited within that, or whose content is unknown because it was
+ * reallocated or a composition failed, is composited in full.
+ */
+class DamageHistory {
+  public:
+    explicit DamageHistory(uint32_t numBuffers);
+
+    // unites @damage of the next composition into @buffer with the damage of the
+    // compositions since @buffer was composited last. False if @buffer is composited in full
+    bool getIncrementalArea(uint32_t buffer, const hwc_rect_t &damage, hwc_rect_t &area) const;
+    // records the composition which changed @damage of @buffer
+    void composed(uint32_t buffer, const hwc_rect_t &damage);
+    // the content of @buffer is unknown, e.g. it was reallocated
+    void invalidate(uint32_t buffer);
+    // the content of every buffer is unknown
+    void invalidateAll();
+
+    uint64_t getCompositionCount() const { return mCompositionCount; }
+
+  private:
+    uint64_t mCompositionCount = 0;
+    // the damage of each composition, indexed by the composition count
+    std::vector<hwc_rect_t> mDamage;
+    // the composition which wrote each buffer last. 0 if the content is unknown
+    std::vector<uint64_t> mComposedCount;
+};
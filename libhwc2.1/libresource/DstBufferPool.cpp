@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG (ATRACE_TAG_GRAPHICS | ATRACE_TAG_HAL)
+
+#include "DstBufferPool.h"
+
+#include <inttypes.h>
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+
+using namespace android;
+
+DstBufferPool::DstBufferPool(std::unique_ptr<Allocator> allocator)
+      : mAllocator(std::move(allocator)) {}
+
+DstBufferPool::~DstBufferPool() {
+    std::vector<buffer_handle_t> buffers;
+    for (const auto &pooled : mPooledBuffers) buffers.push_back(pooled.buffer);
+    freeBuffers(buffers);
+}
+
+void DstBufferPool::freeBuffers(const std::vector<buffer_handle_t> &buffers) {
+    for (auto buffer : buffers) mAllocator->free(buffer);
+}
+
+status_t DstBufferPool::acquire(uint32_t width, uint32_t height, uint32_t format, uint64_t usage,
+                                uint32_t owner, buffer_handle_t *outBuffer) {
+    const Key key = {width, height, format, usage};
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // the most recently released buffer is the most likely to be in the caches
+        auto it = std::find_if(mPooledBuffers.rbegin(), mPooledBuffers.rend(),
+                               [&](const PooledBuffer &pooled) { return pooled.key == key; });
+        if (it != mPooledBuffers.rend()) {
+            *outBuffer = it->buffer;
+            mPooledBuffers.erase(std::next(it).base());
+            mLentBuffers[*outBuffer] = {key, owner};
+            mStats.reused++;
+            ALOGV("%s:: reuse %p (%ux%u, format 0x%x)", __func__, *outBuffer, width, height,
+                  format);
+            return NO_ERROR;
+        }
+    }
+
+    ATRACE_NAME("DstBufferPool::allocate");
+    buffer_handle_t buffer = nullptr;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    status_t error = mAllocator->allocate(width, height, format, usage, &buffer);
+    nsecs_t elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if ((error != NO_ERROR) || (buffer == nullptr)) {
+        mStats.failed++;
+        return (error != NO_ERROR) ? error : NO_MEMORY;
+    }
+
+    mLentBuffers[buffer] = {key, owner};
+    mStats.allocated++;
+    mStats.totalAllocTime += elapsed;
+    mStats.maxAllocTime = std::max(mStats.maxAllocTime, elapsed);
+    *outBuffer = buffer;
+
+    return NO_ERROR;
+}
+
+void DstBufferPool::release(buffer_handle_t buffer) {
+    if (buffer == nullptr) return;
+
+    std::vector<buffer_handle_t> overflow;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mLentBuffers.find(buffer);
+        if (it == mLentBuffers.end()) {
+            // not allocated by the pool
+            overflow.push_back(buffer);
+        } else {
+            mPooledBuffers.push_back({it->second.key, it->second.owner, buffer,
+                                      systemTime(SYSTEM_TIME_MONOTONIC)});
+            mLentBuffers.erase(it);
+            while (mPooledBuffers.size() > kMaxPooledBuffers) {
+                overflow.push_back(mPooledBuffers.front().buffer);
+                mPooledBuffers.erase(mPooledBuffers.begin());
+                mStats.freed++;
+            }
+        }
+    }
+
+    freeBuffers(overflow);
+}
+
+void DstBufferPool::trim(nsecs_t now) {
+    std::vector<buffer_handle_t> expired;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // the buffers are in the release order, so the expired ones are at the front
+        auto it = mPooledBuffers.begin();
+        while ((it != mPooledBuffers.end()) && (now - it->releaseTime > kMaxIdleTime)) {
+            expired.push_back(it->buffer);
+            it++;
+        }
+        mPooledBuffers.erase(mPooledBuffers.begin(), it);
+        mStats.freed += expired.size();
+    }
+
+    if (expired.empty()) return;
+
+    ATRACE_NAME("DstBufferPool::trim");
+    freeBuffers(expired);
+}
+
+void DstBufferPool::clear(uint32_t owner) {
+    std::vector<buffer_handle_t> pooled;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = std::remove_if(mPooledBuffers.begin(), mPooledBuffers.end(),
+                                 [&](const PooledBuffer &buffer) {
+                                     if (buffer.owner != owner) return false;
+                                     pooled.push_back(buffer.buffer);
+                                     return true;
+                                 });
+        mPooledBuffers.erase(it, mPooledBuffers.end());
+        mStats.freed += pooled.size();
+    }
+
+    if (pooled.empty()) return;
+
+    ATRACE_NAME("DstBufferPool::clear");
+    freeBuffers(pooled);
+}
+
+bool DstBufferPool::empty() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPooledBuffers.empty();
+}
+
+size_t DstBufferPool::getPooledCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPooledBuffers.size();
+}
+
+void DstBufferPool::dump(String8 &result) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    result.appendFormat("Dst buffer pool: %zu lent, %zu pooled\n", mLentBuffers.size(),
+                        mPooledBuffers.size());
+    result.appendFormat("\treused %" PRIu64 ", allocated %" PRIu64 ", failed %" PRIu64
+                        ", freed %" PRIu64 "\n",
+                        mStats.reused, mStats.allocated, mStats.failed, mStats.freed);
+    if (mStats.allocated != 0) {
+        result.appendFormat("\tallocation latency (us): avg %" PRId64 ", max %" PRId64 "\n",
+                            mStats.totalAllocTime / static_cast<nsecs_t>(mStats.allocated) / 1000,
+                            mStats.maxAllocTime / 1000);
+    }
+    for (const auto &pooled : mPooledBuffers) {
+        result.appendFormat("\t%p %ux%u format 0x%x usage 0x%" PRIx64 " display %u\n",
+                            pooled.buffer, pooled.key.width, pooled.key.height, pooled.key.format,
+                            pooled.key.usage, pooled.owner);
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cutils/native_handle.h>
+#include <utils/Errors.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Keeps the destination buffers freed by the M2M MPPs for reuse. An MPP released and
+ * assigned again, e.g. when a picture-in-picture window is toggled or a video is rotated
+ * back, gets its buffers from the pool instead of allocating in the middle of a frame.
+ *
+ * The buffers are returned by the ResourceManageThread of the MPP after their fences
+ * signal. A buffer is reused only for the same size, format and allocation usage. The
+ * buffers beyond kMaxPooledBuffers or idle longer than kMaxIdleTime are freed. trim() runs
+ * after every resource assignment and periodically in the DstBufMgrThread while the pool is
+ * not empty, so the buffers are freed on a static screen as well.
+ *
+ * A buffer is owned by the display of the MPP which acquired it last, so a display powered
+ * off frees only its own buffers and the other displays keep theirs warm.
+ */
+class DstBufferPool {
+  public:
+    static constexpr size_t kMaxPooledBuffers = 6;
+    static constexpr nsecs_t kMaxIdleTime = ms2ns(5000);
+    // the owner of the buffers acquired by an MPP without an assigned display
+    static constexpr uint32_t kNoOwner = UINT32_MAX;
+
+    // allocates and frees the buffers of the pool, replaced by a stub in the tests
+    class Allocator {
+      public:
+        virtual ~Allocator() = default;
+        virtual android::status_t allocate(uint32_t width, uint32_t height, uint32_t format,
+                                           uint64_t usage, buffer_handle_t *outBuffer) = 0;
+        virtual void free(buffer_handle_t buffer) = 0;
+    };
+
+    explicit DstBufferPool(std::unique_ptr<Allocator> allocator);
+    ~DstBufferPool();
+
+    // gets a pooled buffer of the same attributes or allocates a new one for the display
+    // @owner
+    android::status_t acquire(uint32_t width, uint32_t height, uint32_t format, uint64_t usage,
+                              uint32_t owner, buffer_handle_t *outBuffer);
+    // the fences of @buffer must be signaled
+    void release(buffer_handle_t buffer);
+    // frees the buffers idle longer than kMaxIdleTime
+    void trim(nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC));
+    // frees the pooled buffers of the display @owner, e.g. when it is powered off
+    void clear(uint32_t owner);
+    bool empty() const;
+    size_t getPooledCount() const;
+
+    void dump(android::String8 &result) const;
+
+  private:
+    struct Key {
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+        uint64_t usage;
+
+        bool operator==(const Key &other) const {
+            return width == other.width && height == other.height && format == other.format &&
+                    usage == other.usage;
+        }
+    };
+    struct LentBuffer {
+        Key key;
+        uint32_t owner;
+    };
+    struct PooledBuffer {
+        Key key;
+        uint32_t owner;
+        buffer_handle_t buffer;
+        nsecs_t releaseTime;
+    };
+    struct Stats {
+        uint64_t reused = 0;
+        uint64_t allocated = 0;
+        uint64_t failed = 0;
+        uint64_t freed = 0;
+        nsecs_t totalAllocTime = 0;
+        nsecs_t maxAllocTime = 0;
+    };
+
+    void freeBuffers(const std::vector<buffer_handle_t> &buffers);
+
+    const std::unique_ptr<Allocator> mAllocator;
+    mutable std::mutex mMutex;
+    // the buffers handed to the MPPs, to find the attributes and the owner on release
+    std::unordered_map<buffer_handle_t, LentBuffer> mLentBuffers;
+    // in the release order
+    std::vector<PooledBuffer> mPooledBuffers;
+    Stats mStats;
+};
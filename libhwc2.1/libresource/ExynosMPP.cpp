@@ -163,6 +163,9 @@ ExynosMPP::ExynosMPP(ExynosResourceManager* resourceManager,
     mCurrentDstBuf(0),
     mPrivDstBuf(-1),
     mNeedCompressedTarget(false),
+    mDamageHistory(NUM_MPP_DST_BUFS_DEFAULT),
+    mComposedDataspace(HAL_DATASPACE_UNKNOWN),
+    mIncrementalComposition(true),
     mDstAllocatedSize(DST_SIZE_UNKNOWN),
     mUseM2MSrcFence(false),
     mAttr(0),
@@ -845,7 +848,7 @@ bool ExynosMPP::ResourceManageThread::threadLoop()
 
 void ExynosMPP::ResourceManageThread::freeBuffers()
 {
-    VendorGraphicBufferAllocator& gAllocator(VendorGraphicBufferAllocator::get());
+    DstBufferPool &pool = mExynosMPP->mResourceManager->getDstBufferPool();
     android::List<exynos_mpp_img_info >::iterator it;
     android::List<exynos_mpp_img_info >::iterator end;
     it = mFreedBuffers.begin();
@@ -870,9 +873,10 @@ void ExynosMPP::ResourceManageThread::freeBuffers()
                 fence_close(freeBuffer.acrylicReleaseFenceFd, mExynosMPP->mAssignedDisplay,
                         FENCE_TYPE_SRC_RELEASE, FENCE_IP_ALL);
         }
-        gAllocator.free(freeBuffer.bufferHandle);
+        pool.release(freeBuffer.bufferHandle);
         it = mFreedBuffers.erase(it);
     }
+    mExynosMPP->mResourceManager->scheduleDstBufferPoolTrim();
 }
 
 bool ExynosMPP::ResourceManageThread::checkStateFences()
@@ -926,7 +930,6 @@ void ExynosMPP::ResourceManageThread::addStateFence(int fence)
  */
 int32_t ExynosMPP::allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t usage, uint32_t index) {
     ATRACE_CALL();
-    uint32_t dstStride = 0;
 
     MPP_LOGD(eDebugMPP|eDebugBuf, "index: %d++++++++", index);
 
@@ -942,19 +945,15 @@ int32_t ExynosMPP::allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t
     if (!needCompressDstBuf()) {
         allocUsage |= VendorGraphicBufferUsage::NO_AFBC;
     }
-    buffer_handle_t dstBuffer;
+    buffer_handle_t dstBuffer = NULL;
 
     MPP_LOGD(eDebugMPP|eDebugBuf, "\tw: %d, h: %d, format: 0x%8x, previousBuffer: %p, allocUsage: 0x%" PRIx64 ", usage: 0x%" PRIx64 "",
             w, h, format, freeDstBuf.bufferHandle, allocUsage, usage);
 
-    status_t error = NO_ERROR;
-
-    {
-        ATRACE_CALL();
-
-        VendorGraphicBufferAllocator& gAllocator(VendorGraphicBufferAllocator::get());
-        error = gAllocator.allocate(w, h, format, 1, allocUsage, &dstBuffer, &dstStride, "HWC");
-    }
+    const uint32_t owner = mAssignedDisplay ? mAssignedDisplay->mDisplayId
+                                            : DstBufferPool::kNoOwner;
+    status_t error = mResourceManager->getDstBufferPool().acquire(w, h, format, allocUsage, owner,
+                                                                  &dstBuffer);
 
     if ((error != NO_ERROR) || (dstBuffer == NULL)) {
         MPP_LOGE("failed to allocate destination buffer(%dx%d): %d", w, h, error);
@@ -962,6 +961,7 @@ int32_t ExynosMPP::allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t
     }
 
     memset(&mDstImgs[index], 0, sizeof(mDstImgs[index]));
+    mDamageHistory.invalidate(index);
 
     mDstImgs[index].acrylicAcquireFenceFd = -1;
     mDstImgs[index].acrylicReleaseFenceFd = -1;
@@ -992,6 +992,9 @@ int32_t ExynosMPP::allocOutBuf(uint32_t w, uint32_t h, uint32_t format, uint64_t
  * @return int32_t
  */
 int32_t ExynosMPP::setOutBuf(buffer_handle_t outbuf, int32_t fence) {
+    /* the content of another buffer is unknown */
+    if (mDstImgs[mCurrentDstBuf].bufferHandle != outbuf)
+        mDamageHistory.invalidate(mCurrentDstBuf);
     mDstImgs[mCurrentDstBuf].bufferHandle = NULL;
     if (outbuf != NULL) {
         mDstImgs[mCurrentDstBuf].bufferHandle = outbuf;
@@ -1158,6 +1161,62 @@ bool ExynosMPP::canUsePrevFrame()
     return true;
 }
 
+/*
+ * Collects the region of the destination changed from the previous frame.
+ * Returns false if the entire destination should be composited.
+ *
+ * The surface damage of the layers is not used because it is relative to the
+ * previous buffer of the layer that might not have been composited by this MPP.
+ */
+bool ExynosMPP::getFrameDamage(hwc_rect_t &damage)
+{
+    damage = {0, 0, 0, 0};
+
+    if ((mAssignedDisplay && !mAssignedDisplay->mDisplayControl.skipM2mProcessing) ||
+        !exynosHWCControl.skipM2mProcessing)
+        return false;
+
+    if ((mAssignedDisplay == NULL) || !mIncrementalComposition || !mAllocOutBufFlag ||
+        (mMaxSrcLayerNum <= 1))
+        return false;
+
+    /* partial write of a compressed or subsampled destination is not safe */
+    if (needCompressDstBuf() || !isFormatRgb(mDstImgs[mCurrentDstBuf].format))
+        return false;
+
+    if ((mPrevAssignedDisplayType != (int32_t)mAssignedDisplay->mType) ||
+        (mComposedDataspace != mDstImgs[mCurrentDstBuf].dataspace) ||
+        (mPrevFrameInfo.srcNum != mAssignedSources.size()))
+        return false;
+
+    for (uint32_t i = 0; i < mPrevFrameInfo.srcNum; i++) {
+        exynos_image &prevSrc = mPrevFrameInfo.srcInfo[i];
+        exynos_image &prevDst = mPrevFrameInfo.dstInfo[i];
+        exynos_image &src = mAssignedSources[i]->mSrcImg;
+        exynos_image &dst = mAssignedSources[i]->mMidImg;
+        hwc_rect_t dstRect = {(int)dst.x, (int)dst.y, (int)(dst.x + dst.w), (int)(dst.y + dst.h)};
+
+        if ((prevSrc.x != src.x) || (prevSrc.y != src.y) || (prevSrc.w != src.w) ||
+            (prevSrc.h != src.h) || (prevSrc.format != src.format) ||
+            (prevSrc.usageFlags != src.usageFlags) || (prevSrc.dataSpace != src.dataSpace) ||
+            (prevSrc.blending != src.blending) || (prevSrc.transform != src.transform) ||
+            (prevSrc.compressionInfo.type != src.compressionInfo.type) ||
+            (prevSrc.planeAlpha != src.planeAlpha) || (prevSrc.zOrder != src.zOrder) ||
+            (prevDst.x != dst.x) || (prevDst.y != dst.y) || (prevDst.w != dst.w) ||
+            (prevDst.h != dst.h) || (prevDst.format != dst.format)) {
+            /* the layer left its previous area */
+            hwc_rect_t prevRect = {(int)prevDst.x, (int)prevDst.y, (int)(prevDst.x + prevDst.w),
+                                   (int)(prevDst.y + prevDst.h)};
+            addDamage(damage, prevRect);
+            addDamage(damage, dstRect);
+        } else if (prevSrc.bufferHandle != src.bufferHandle) {
+            addDamage(damage, dstRect);
+        }
+    }
+
+    return true;
+}
+
 int32_t ExynosMPP::setupLayer(exynos_mpp_img_info *srcImgInfo, struct exynos_image &src, struct exynos_image &dst)
 {
     int ret = NO_ERROR;
@@ -1498,6 +1557,19 @@ int32_t ExynosMPP::doPostProcessingInternal()
     MPP_LOGD(eDebugFence, "setupDst -- mDstImgs[%d] acrylicAcquireFenceFd(%d) closed",
             mCurrentDstBuf, mDstImgs[mCurrentDstBuf].acrylicAcquireFenceFd);
 
+    /* Only the region changed since the destination buffer was composited is updated */
+    hwc_rect_t damage;
+    hwc_rect_t clip;
+    bool hasDamage = getFrameDamage(damage);
+    bool clipped = hasDamage &&
+            mDamageHistory.getIncrementalArea(mCurrentDstBuf, damage, clip) &&
+            mAcrylicHandle->setCanvasClip(clip);
+    if (clipped)
+        MPP_LOGD(eDebugMPP, "incremental composition [%d, %d, %d, %d], dstImg[%d]",
+                clip.left, clip.top, clip.right, clip.bottom, mCurrentDstBuf);
+    else
+        mAcrylicHandle->clearCanvasClip();
+
 
     int usingFenceCnt = 1;
     bool acrylicReturn = true;
@@ -1507,7 +1579,7 @@ int32_t ExynosMPP::doPostProcessingInternal()
         usingFenceCnt = sourceNum + 1; // Get and Use src + dst fence
     else
         usingFenceCnt = 1;             // Get and Use only dst fence
-    int *releaseFences = new int[usingFenceCnt];
+    int releaseFences[NUM_MPP_SRC_BUFS + 1];
     int dstBufIdx = usingFenceCnt - 1;
 #else
     usingFenceCnt = 0;                 // Get and Use no fences
@@ -1533,8 +1605,24 @@ int32_t ExynosMPP::doPostProcessingInternal()
                     mAssignedSources[i]->mSrcImg.transform);
         }
         mDstImgs[mCurrentDstBuf].acrylicReleaseFenceFd = -1;
+        if (clipped) {
+            MPP_LOGE("%s:: disable incremental composition", __func__);
+            mIncrementalComposition = false;
+        }
         ret = -EPERM;
     } else {
+        if (clipped && !mAcrylicHandle->hasCanvasClip()) {
+            // the clipped job failed and acryl composited the entire buffer instead
+            MPP_LOGE("%s:: disable incremental composition", __func__);
+            mIncrementalComposition = false;
+            hasDamage = false;
+        }
+        if (!hasDamage) {
+            damage = {0, 0, (int)pixel_align(mAssignedDisplay->mXres, G2D_JUSTIFIED_DST_ALIGN),
+                      (int)pixel_align(mAssignedDisplay->mYres, G2D_JUSTIFIED_DST_ALIGN)};
+        }
+        mDamageHistory.composed(mCurrentDstBuf, damage);
+        mComposedDataspace = mDstImgs[mCurrentDstBuf].dataspace;
 
         // set fence informations from acryl
         if (mPhysicalType == MPP_G2D) {
@@ -1647,10 +1735,6 @@ int32_t ExynosMPP::doPostProcessingInternal()
         }
     }
 
-#ifndef DISABLE_FENCE
-    delete [] releaseFences;
-#endif
-
     return ret;
 }
 
@@ -1739,6 +1823,10 @@ int32_t ExynosMPP::doPostProcessing(struct exynos_image &src, struct exynos_imag
     }
 
 save_frame_info:
+    /* The damage of the next frame can not be tracked from a frame not composited */
+    if (ret < 0)
+        mDamageHistory.invalidateAll();
+
     /* Save current frame information for next frame*/
     mPrevAssignedDisplayType = mAssignedDisplay->mType;
     mPrevFrameInfo.srcNum = (uint32_t)mAssignedSources.size();
@@ -1931,6 +2019,7 @@ int32_t ExynosMPP::requestHWStateChange(uint32_t state)
             for(uint32_t i = 0; i < NUM_MPP_DST_BUFS(mLogicalType); i++) {
                 exynos_mpp_img_info freeDstBuf = mDstImgs[i];
                 memset(&mDstImgs[i], 0, sizeof(mDstImgs[i]));
+                mDamageHistory.invalidate(i);
                 mDstImgs[i].acrylicAcquireFenceFd = freeDstBuf.acrylicAcquireFenceFd;
                 mDstImgs[i].acrylicReleaseFenceFd = freeDstBuf.acrylicReleaseFenceFd;
                 freeDstBuf.acrylicAcquireFenceFd = -1;
@@ -31,6 +31,7 @@
 #include <map>
 #include <hardware/exynos/acryl.h>
 #include <map>
+#include "DamageHistory.h"
 #include "ExynosHWCModule.h"
 #include "ExynosHWCHelper.h"
 #include "ExynosMPPType.h"
@@ -556,6 +557,10 @@ public:
     int32_t mCurrentDstBuf;
     int32_t mPrivDstBuf;
     bool mNeedCompressedTarget;
+    /* For incremental composition */
+    DamageHistory mDamageHistory;
+    android_dataspace_t mComposedDataspace;
+    bool mIncrementalComposition;
     struct restriction_size mSrcSizeRestrictions[RESTRICTION_MAX];
     struct restriction_size mDstSizeRestrictions[RESTRICTION_MAX];
 
@@ -713,6 +718,7 @@ protected:
     bool needCompressDstBuf() const;
     bool needDstBufRealloc(struct exynos_image &dst, uint32_t index);
     bool canUsePrevFrame();
+    bool getFrameDamage(hwc_rect_t &damage);
     int32_t setupDst(exynos_mpp_img_info *dstImgInfo);
     virtual int32_t doPostProcessingInternal();
     virtual int32_t setupLayer(exynos_mpp_img_info *srcImgInfo,
@@ -33,6 +33,7 @@
 #include "ExynosMPPModule.h"
 #include "ExynosPrimaryDisplayModule.h"
 #include "ExynosVirtualDisplay.h"
+#include "VendorGraphicBuffer.h"
 #include "hardware/exynos/acryl.h"
 
 using namespace std::chrono_literals;
@@ -46,6 +47,21 @@ ExynosMPPVector ExynosResourceManager::mOtfMPPs;
 ExynosMPPVector ExynosResourceManager::mM2mMPPs;
 extern struct exynos_hwc_control exynosHWCControl;
 
+namespace {
+
+class DstBufferAllocator : public DstBufferPool::Allocator {
+  public:
+    status_t allocate(uint32_t width, uint32_t height, uint32_t format, uint64_t usage,
+                      buffer_handle_t *outBuffer) override {
+        uint32_t stride = 0;
+        return VendorGraphicBufferAllocator::get().allocate(width, height, format, 1, usage,
+                                                            outBuffer, &stride, "HWC");
+    }
+    void free(buffer_handle_t buffer) override { VendorGraphicBufferAllocator::get().free(buffer); }
+};
+
+} // namespace
+
 ExynosMPPVector::ExynosMPPVector() {
 }
 
@@ -85,6 +101,7 @@ int ExynosMPPVector::do_compare(const void* lhs, const void* rhs) const
 
 ExynosResourceManager::DstBufMgrThread::DstBufMgrThread(ExynosResourceManager *exynosResourceManager)
 : mExynosResourceManager(exynosResourceManager),
+    mReallocRequested(false),
     mRunning(false),
     mBufXres(0),
     mBufYres(0)
@@ -95,6 +112,19 @@ ExynosResourceManager::DstBufMgrThread::~DstBufMgrThread()
 {
 }
 
+void ExynosResourceManager::DstBufMgrThread::scheduleTrim()
+{
+    android::Mutex::Autolock lock(mMutex);
+    mCondition.signal();
+}
+
+void ExynosResourceManager::DstBufMgrThread::requestStop()
+{
+    android::Mutex::Autolock lock(mMutex);
+    mRunning = false;
+    mCondition.signal();
+}
+
 
 ExynosResourceManager::ExynosResourceManager(ExynosDevice *device)
 : mForceReallocState(DST_REALLOC_DONE),
@@ -103,6 +133,8 @@ ExynosResourceManager::ExynosResourceManager(ExynosDevice *device)
     hasDrmLayer(false),
     mFormatRestrictionCnt(0),
     mDstBufMgrThread(sp<DstBufMgrThread>::make(this)),
+    mSupportCheckWorkers(std::make_unique<SupportCheckWorkers>(kSupportCheckThreads)),
+    mDstBufferPool(std::make_unique<DstBufferAllocator>()),
     mResourceReserved(0x0)
 {
 
@@ -177,7 +209,7 @@ ExynosResourceManager::~ExynosResourceManager()
     }
     mM2mMPPs.clear();
 
-    mDstBufMgrThread->mRunning = false;
+    mDstBufMgrThread->requestStop();
     mDstBufMgrThread->requestExitAndWait();
 }
 
@@ -267,6 +299,7 @@ void ExynosResourceManager::DstBufMgrThread::reallocDstBufs(uint32_t Xres, uint3
         if (mExynosResourceManager->mForceReallocState == DST_REALLOC_DONE) {
             mExynosResourceManager->mForceReallocState = DST_REALLOC_START;
             android::Mutex::Autolock lock(mMutex);
+            mReallocRequested = true;
             mCondition.signal();
         } else {
             HDEBUGLOGD(eDebugBuf, "M2M dst alloc thread : queue aready.");
@@ -278,7 +311,23 @@ bool ExynosResourceManager::DstBufMgrThread::threadLoop()
 {
     while(mRunning) {
         Mutex::Autolock lock(mMutex);
-        mCondition.wait(mMutex);
+        if (!mReallocRequested) {
+            /*
+             * The pooled buffers are trimmed after the resource assignments but no frame
+             * is validated on a static screen, so wake up to free the idle ones.
+             */
+            if (mExynosResourceManager->mDstBufferPool.empty())
+                mCondition.wait(mMutex);
+            else
+                mCondition.waitRelative(mMutex, DstBufferPool::kMaxIdleTime);
+        }
+        if (!mRunning)
+            break;
+        if (!mReallocRequested) {
+            mExynosResourceManager->mDstBufferPool.trim();
+            continue;
+        }
+        mReallocRequested = false;
 
         ExynosDevice *device = mExynosResourceManager->mDevice;
         if (device == NULL)
@@ -1841,89 +1890,109 @@ int32_t ExynosResourceManager::assignWindow(ExynosDisplay *display)
  */
 int32_t ExynosResourceManager::updateSupportedMPPFlag(ExynosDisplay * display)
 {
-    int64_t ret = 0;
     HDEBUGLOGD(eDebugResourceAssigning, "%s++++++++++", __func__);
+
+    std::vector<uint32_t> changedLayers;
     for (uint32_t i = 0; i < display->mLayers.size(); i++) {
-        ExynosLayer *layer = display->mLayers[i];
-        HDEBUGLOGD(eDebugResourceAssigning, "[%d] layer ", i);
+        if (display->mLayers[i]->mGeometryChanged != 0)
+            changedLayers.push_back(i);
+    }
 
-        if (layer->mGeometryChanged == 0)
-            continue;
+    auto check = [&](uint32_t n) {
+        uint32_t index = changedLayers[n];
+        updateSupportedMPPFlag(display, display->mLayers[index], index);
+    };
 
-        exynos_image src_img;
-        exynos_image dst_img;
-        exynos_image dst_img_yuv;
-        layer->setSrcExynosImage(&src_img);
-        layer->setDstExynosImage(&dst_img);
-        layer->setDstExynosImage(&dst_img_yuv);
-        dst_img.format = DEFAULT_MPP_DST_FORMAT;
-        dst_img_yuv.format = DEFAULT_MPP_DST_YUV_FORMAT;
-        HDEBUGLOGD(eDebugResourceAssigning, "\tsrc_img");
-        dumpExynosImage(eDebugResourceAssigning, src_img);
-        HDEBUGLOGD(eDebugResourceAssigning, "\tdst_img");
-        dumpExynosImage(eDebugResourceAssigning, dst_img);
-
-        /* Initialize flags */
-        layer->mSupportedMPPFlag = 0;
-        layer->mCheckMPPFlag.clear();
-
-        /* Check OtfMPPs */
-        for (uint32_t j = 0; j < mOtfMPPs.size(); j++) {
-            if ((ret = mOtfMPPs[j]->isSupported(*display, src_img, dst_img)) == NO_ERROR) {
+    /* The debug messages of the layers would be interleaved if they are checked concurrently */
+    if ((changedLayers.size() >= kParallelSupportCheckMinLayers) &&
+        !hwcCheckDebugMessages(eDebugResourceAssigning)) {
+        mSupportCheckWorkers->run(changedLayers.size(), check);
+    } else {
+        for (uint32_t n = 0; n < changedLayers.size(); n++)
+            check(n);
+    }
+
+    HDEBUGLOGD(eDebugResourceAssigning, "%s-------------", __func__);
+
+    return NO_ERROR;
+}
+
+void ExynosResourceManager::updateSupportedMPPFlag(ExynosDisplay *display, ExynosLayer *layer,
+                                                   uint32_t index)
+{
+    int64_t ret = 0;
+    HDEBUGLOGD(eDebugResourceAssigning, "[%d] layer ", index);
+
+    exynos_image src_img;
+    exynos_image dst_img;
+    exynos_image dst_img_yuv;
+    layer->setSrcExynosImage(&src_img);
+    layer->setDstExynosImage(&dst_img);
+    layer->setDstExynosImage(&dst_img_yuv);
+    dst_img.format = DEFAULT_MPP_DST_FORMAT;
+    dst_img_yuv.format = DEFAULT_MPP_DST_YUV_FORMAT;
+    HDEBUGLOGD(eDebugResourceAssigning, "\tsrc_img");
+    dumpExynosImage(eDebugResourceAssigning, src_img);
+    HDEBUGLOGD(eDebugResourceAssigning, "\tdst_img");
+    dumpExynosImage(eDebugResourceAssigning, dst_img);
+
+    /* Initialize flags */
+    layer->mSupportedMPPFlag = 0;
+    layer->mCheckMPPFlag.clear();
+
+    /* Check OtfMPPs */
+    for (uint32_t j = 0; j < mOtfMPPs.size(); j++) {
+        if ((ret = mOtfMPPs[j]->isSupported(*display, src_img, dst_img)) == NO_ERROR) {
+            layer->mSupportedMPPFlag |= mOtfMPPs[j]->mLogicalType;
+            HDEBUGLOGD(eDebugResourceAssigning, "\t%s: supported", mOtfMPPs[j]->mName.string());
+        } else {
+            if (((-ret) == eMPPUnsupportedFormat) &&
+                ((ret = mOtfMPPs[j]->isSupported(*display, src_img, dst_img_yuv)) == NO_ERROR)) {
                 layer->mSupportedMPPFlag |= mOtfMPPs[j]->mLogicalType;
-                HDEBUGLOGD(eDebugResourceAssigning, "\t%s: supported", mOtfMPPs[j]->mName.string());
-            } else {
-                if (((-ret) == eMPPUnsupportedFormat) &&
-                    ((ret = mOtfMPPs[j]->isSupported(*display, src_img, dst_img_yuv)) == NO_ERROR)) {
-                    layer->mSupportedMPPFlag |= mOtfMPPs[j]->mLogicalType;
-                    HDEBUGLOGD(eDebugResourceAssigning, "\t%s: supported with yuv dst",
-                               mOtfMPPs[j]->mName.string());
-                }
+                HDEBUGLOGD(eDebugResourceAssigning, "\t%s: supported with yuv dst",
+                           mOtfMPPs[j]->mName.string());
             }
-            if (ret < 0) {
-                HDEBUGLOGD(eDebugResourceAssigning, "\t%s: unsupported flag(0x%" PRIx64 ")",
-                           mOtfMPPs[j]->mName.string(), -ret);
-                uint64_t checkFlag = 0x0;
-                if (layer->mCheckMPPFlag.find(mOtfMPPs[j]->mLogicalType) !=
-                        layer->mCheckMPPFlag.end()) {
-                    checkFlag = layer->mCheckMPPFlag.at(mOtfMPPs[j]->mLogicalType);
-                }
-                checkFlag |= (-ret);
-                layer->mCheckMPPFlag[mOtfMPPs[j]->mLogicalType] = checkFlag;
+        }
+        if (ret < 0) {
+            HDEBUGLOGD(eDebugResourceAssigning, "\t%s: unsupported flag(0x%" PRIx64 ")",
+                       mOtfMPPs[j]->mName.string(), -ret);
+            uint64_t checkFlag = 0x0;
+            if (layer->mCheckMPPFlag.find(mOtfMPPs[j]->mLogicalType) !=
+                    layer->mCheckMPPFlag.end()) {
+                checkFlag = layer->mCheckMPPFlag.at(mOtfMPPs[j]->mLogicalType);
             }
+            checkFlag |= (-ret);
+            layer->mCheckMPPFlag[mOtfMPPs[j]->mLogicalType] = checkFlag;
         }
+    }
 
-        /* Check M2mMPPs */
-        for (uint32_t j = 0; j < mM2mMPPs.size(); j++) {
-            if ((ret = mM2mMPPs[j]->isSupported(*display, src_img, dst_img)) == NO_ERROR) {
+    /* Check M2mMPPs */
+    for (uint32_t j = 0; j < mM2mMPPs.size(); j++) {
+        if ((ret = mM2mMPPs[j]->isSupported(*display, src_img, dst_img)) == NO_ERROR) {
+            layer->mSupportedMPPFlag |= mM2mMPPs[j]->mLogicalType;
+            HDEBUGLOGD(eDebugResourceAssigning, "\t%s: supported", mM2mMPPs[j]->mName.string());
+        } else {
+            if (((-ret) == eMPPUnsupportedFormat) &&
+                ((ret = mM2mMPPs[j]->isSupported(*display, src_img, dst_img_yuv)) == NO_ERROR)) {
                 layer->mSupportedMPPFlag |= mM2mMPPs[j]->mLogicalType;
-                HDEBUGLOGD(eDebugResourceAssigning, "\t%s: supported", mM2mMPPs[j]->mName.string());
-            } else {
-                if (((-ret) == eMPPUnsupportedFormat) &&
-                    ((ret = mM2mMPPs[j]->isSupported(*display, src_img, dst_img_yuv)) == NO_ERROR)) {
-                    layer->mSupportedMPPFlag |= mM2mMPPs[j]->mLogicalType;
-                    HDEBUGLOGD(eDebugResourceAssigning, "\t%s: supported with yuv dst",
-                               mM2mMPPs[j]->mName.string());
-                }
+                HDEBUGLOGD(eDebugResourceAssigning, "\t%s: supported with yuv dst",
+                           mM2mMPPs[j]->mName.string());
             }
-            if (ret < 0) {
-                HDEBUGLOGD(eDebugResourceAssigning, "\t%s: unsupported flag(0x%" PRIx64 ")",
-                           mM2mMPPs[j]->mName.string(), -ret);
-                uint64_t checkFlag = 0x0;
-                if (layer->mCheckMPPFlag.find(mM2mMPPs[j]->mLogicalType) !=
-                        layer->mCheckMPPFlag.end()) {
-                    checkFlag = layer->mCheckMPPFlag.at(mM2mMPPs[j]->mLogicalType);
-                }
-                checkFlag |= (-ret);
-                layer->mCheckMPPFlag[mM2mMPPs[j]->mLogicalType] = checkFlag;
+        }
+        if (ret < 0) {
+            HDEBUGLOGD(eDebugResourceAssigning, "\t%s: unsupported flag(0x%" PRIx64 ")",
+                       mM2mMPPs[j]->mName.string(), -ret);
+            uint64_t checkFlag = 0x0;
+            if (layer->mCheckMPPFlag.find(mM2mMPPs[j]->mLogicalType) !=
+                    layer->mCheckMPPFlag.end()) {
+                checkFlag = layer->mCheckMPPFlag.at(mM2mMPPs[j]->mLogicalType);
             }
+            checkFlag |= (-ret);
+            layer->mCheckMPPFlag[mM2mMPPs[j]->mLogicalType] = checkFlag;
         }
-        HDEBUGLOGD(eDebugResourceAssigning, "[%d] layer mSupportedMPPFlag(0x%8x)", i,
-                   layer->mSupportedMPPFlag);
     }
-    HDEBUGLOGD(eDebugResourceAssigning, "%s-------------", __func__);
-
-    return NO_ERROR;
+    HDEBUGLOGD(eDebugResourceAssigning, "[%d] layer mSupportedMPPFlag(0x%8x)", index,
+               layer->mSupportedMPPFlag);
 }
 
 int32_t ExynosResourceManager::resetResources()
@@ -2388,6 +2457,9 @@ int32_t ExynosResourceManager::finishAssignResourceWork()
         return ret;
     }
 
+    /* The MPPs released by this assignment free their buffers into the pool */
+    mDstBufferPool.trim();
+
     mDevice->clearGeometryChanged();
     return ret;
 }
@@ -2557,6 +2629,13 @@ ExynosMPP* ExynosResourceManager::getOtfMPPWithChannel(int ch)
     return otfMPP;
 }
 
+ExynosMPP* ExynosResourceManager::getOtfMPPForSrcFormat(const exynos_image &src) {
+    exynos_image img = src;
+    auto mpp_it = std::find_if(mOtfMPPs.begin(), mOtfMPPs.end(),
+            [&img](auto m) { return m->isSrcFormatSupported(img); });
+    return mpp_it == mOtfMPPs.end() ? nullptr : *mpp_it;
+}
+
 void ExynosResourceManager::updateRestrictions() {
 
     if (mDevice->mDeviceInterface->getUseQuery() == true) {
@@ -2670,6 +2749,8 @@ void ExynosResourceManager::dump(String8 &result) const {
 
     result.appendFormat("[YUV Restrictions]\n");
     dump(RESTRICTION_YUV, result);
+
+    mDstBufferPool.dump(result);
 }
 
 void ExynosResourceManager::dump(const restriction_classification_t classification,
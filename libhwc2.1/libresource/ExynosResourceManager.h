@@ -21,12 +21,16 @@
 #ifndef _EXYNOSRESOURCEMANAGER_H
 #define _EXYNOSRESOURCEMANAGER_H
 
+#include <memory>
 #include <unordered_map>
+#include <vector>
+#include "DstBufferPool.h"
 #include "ExynosDevice.h"
 #include "ExynosDisplay.h"
 #include "ExynosHWCHelper.h"
 #include "ExynosMPPModule.h"
 #include "ExynosResourceRestriction.h"
+#include "SupportCheckWorkers.h"
 
 using namespace android;
 
@@ -85,6 +89,8 @@ class ExynosResourceManager {
         private:
             ExynosResourceManager *mExynosResourceManager;
             Condition mCondition;
+            /* guarded by mMutex, tells a reallocation from a wakeup to trim the pool */
+            bool mReallocRequested;
         public:
             bool mRunning;
             Mutex mMutex;
@@ -93,12 +99,18 @@ class ExynosResourceManager {
             uint32_t mBufXres;
             uint32_t mBufYres;
             void reallocDstBufs(uint32_t Xres, uint32_t Yres);
+            void scheduleTrim();
+            void requestStop();
             bool needDstRealloc(uint32_t Xres, uint32_t Yres, ExynosMPP *m2mMPP);
             DstBufMgrThread(ExynosResourceManager *exynosResourceManager);
             ~DstBufMgrThread();
             virtual bool threadLoop();
     };
 
+    /* the checks of fewer layers are not worth waking up the workers */
+    static constexpr uint32_t kParallelSupportCheckMinLayers = 8;
+    static constexpr uint32_t kSupportCheckThreads = 2;
+
     public:
         uint32_t mForceReallocState;
         ExynosDevice *mDevice;
@@ -177,11 +189,16 @@ class ExynosResourceManager {
         ExynosMPP* getOtfMPPWithChannel(int ch);
         uint32_t getFeatureTableSize() const;
         const static ExynosMPPVector& getOtfMPPs() { return mOtfMPPs; };
+        /* returns the first OTF MPP supporting the source format */
+        static ExynosMPP* getOtfMPPForSrcFormat(const exynos_image &src);
         float getM2MCapa(uint32_t physicalType);
         virtual bool hasHDR10PlusMPP();
         float getAssignedCapacity(uint32_t physicalType);
 
         void dump(String8 &result) const;
+        DstBufferPool &getDstBufferPool() { return mDstBufferPool; }
+        /* starts the timer to trim the buffers just returned to the pool */
+        void scheduleDstBufferPoolTrim() { mDstBufMgrThread->scheduleTrim(); }
         void setM2MCapa(uint32_t physicalType, uint32_t capa);
         bool isAssignable(ExynosMPP *candidateMPP, ExynosDisplay *display, struct exynos_image &src,
                           struct exynos_image &dst, ExynosMPPSource *mppSrc);
@@ -192,7 +209,11 @@ class ExynosResourceManager {
                                               ExynosMPP* m2mMPP, ExynosMPP* otfMPP);
         void dump(const restriction_classification_t, String8 &result) const;
 
+        void updateSupportedMPPFlag(ExynosDisplay *display, ExynosLayer *layer, uint32_t index);
+
         sp<DstBufMgrThread> mDstBufMgrThread;
+        std::unique_ptr<SupportCheckWorkers> mSupportCheckWorkers;
+        DstBufferPool mDstBufferPool;
 
     protected:
         virtual void setFrameRateForPerformance(ExynosMPP &mpp, AcrylicPerformanceRequestFrame *frame);
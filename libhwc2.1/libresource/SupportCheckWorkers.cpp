@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SupportCheckWorkers.h"
+
+#include <log/log.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <string>
+
+#ifdef __ANDROID__
+#include <processgroup/processgroup.h>
+#endif
+
+SupportCheckWorkers::SupportCheckWorkers(uint32_t numThreads) {
+    for (uint32_t i = 0; i < numThreads; i++) {
+        mThreads.emplace_back(&SupportCheckWorkers::threadLoop, this);
+
+        const std::string name = "SupportCheck" + std::to_string(i);
+        pthread_setname_np(mThreads.back().native_handle(), name.c_str());
+    }
+}
+
+SupportCheckWorkers::~SupportCheckWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExit = true;
+    }
+    mStartCondition.notify_all();
+    for (auto &thread : mThreads) thread.join();
+}
+
+void SupportCheckWorkers::drain(const std::function<void(uint32_t)> &job, uint32_t count) {
+    for (uint32_t i = mNext.fetch_add(1); i < count; i = mNext.fetch_add(1)) job(i);
+}
+
+void SupportCheckWorkers::run(uint32_t count, const std::function<void(uint32_t)> &job) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJob = &job;
+        mCount = count;
+        mNext = 0;
+        mPending = static_cast<uint32_t>(mThreads.size());
+        mGeneration++;
+    }
+    mStartCondition.notify_all();
+
+    drain(job, count);
+
+    // @job must outlive the workers using it
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [this] { return mPending == 0; });
+    mJob = nullptr;
+}
+
+void SupportCheckWorkers::threadLoop() {
+#ifdef __ANDROID__
+    if (!SetTaskProfiles(gettid(), {"SFMainPolicy"})) {
+        ALOGW("Failed to add `%d` into SFMainPolicy", gettid());
+    }
+#endif
+
+    uint64_t generation = 0;
+
+    while (true) {
+        const std::function<void(uint32_t)> *job;
+        uint32_t count;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStartCondition.wait(lock, [&] { return mExit || (mGeneration != generation); });
+            if (mExit) return;
+            generation = mGeneration;
+            job = mJob;
+            count = mCount;
+        }
+
+        drain(*job, count);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (--mPending == 0) mDoneCondition.notify_one();
+    }
+}
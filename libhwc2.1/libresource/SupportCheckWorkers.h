@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Runs the MPP support checks of the layers of a display concurrently. The checks
+ * of a layer only read the MPP restrictions and write the flags of the layer, so
+ * the layers are checked independently and the results match the serial checks.
+ *
+ * The workers are named SupportCheck<n> and join the SFMainPolicy task profile like
+ * the thread of presentDisplay(), because the caller waits for them in validation.
+ */
+class SupportCheckWorkers {
+  public:
+    SupportCheckWorkers(uint32_t numThreads);
+    ~SupportCheckWorkers();
+
+    // calls @job for every index in [0, @count) on the workers and the caller
+    void run(uint32_t count, const std::function<void(uint32_t)> &job);
+
+  private:
+    void threadLoop();
+    void drain(const std::function<void(uint32_t)> &job, uint32_t count);
+
+    std::mutex mMutex;
+    std::condition_variable mStartCondition;
+    std::condition_variable mDoneCondition;
+    std::vector<std::thread> mThreads;
+    const std::function<void(uint32_t)> *mJob = nullptr;
+    uint32_t mCount = 0;
+    std::atomic<uint32_t> mNext{0};
+    // the workers that have not finished the current job
+    uint32_t mPending = 0;
+    uint64_t mGeneration = 0;
+    bool mExit = false;
+};
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "libmaindisplay/BtsReassignCache.h"
+
+namespace {
+
+ExynosLayer *fakeLayer(uintptr_t id) {
+    return reinterpret_cast<ExynosLayer *>(0x1000 + id * 8);
+}
+
+} // namespace
+
+TEST(BtsReassignCacheTest, MissBeforeStore) {
+    BtsReassignCache cache;
+    const std::vector<ExynosLayer *> layers = {fakeLayer(0)};
+    EXPECT_FALSE(cache.find(120, true, 1, layers).has_value());
+}
+
+TEST(BtsReassignCacheTest, HitWithinValidation) {
+    BtsReassignCache cache;
+    const std::vector<ExynosLayer *> layers = {fakeLayer(0), fakeLayer(1), fakeLayer(2)};
+
+    cache.store(120, true, 1, 1, layers[1]);
+    cache.store(60, false, 1, 0, nullptr);
+
+    EXPECT_EQ(std::optional<ExynosLayer *>(layers[1]), cache.find(120, true, 1, layers));
+    // every assignment held at the lower rate
+    EXPECT_EQ(std::optional<ExynosLayer *>(nullptr), cache.find(60, false, 1, layers));
+    // the other directions and rates are not checked yet
+    EXPECT_FALSE(cache.find(120, false, 1, layers).has_value());
+    EXPECT_FALSE(cache.find(60, true, 1, layers).has_value());
+    EXPECT_FALSE(cache.find(90, true, 1, layers).has_value());
+}
+
+TEST(BtsReassignCacheTest, InvalidatedByNextValidation) {
+    BtsReassignCache cache;
+    const std::vector<ExynosLayer *> layers = {fakeLayer(0), fakeLayer(1)};
+
+    cache.store(120, true, 1, 1, layers[1]);
+    cache.store(60, false, 1, 0, nullptr);
+
+    // the assignments may have changed in validation 2
+    EXPECT_FALSE(cache.find(120, true, 2, layers).has_value());
+    EXPECT_FALSE(cache.find(60, false, 2, layers).has_value());
+
+    // the result of validation 2 replaces the one of validation 1
+    cache.store(120, true, 2, 0, nullptr);
+    EXPECT_EQ(std::optional<ExynosLayer *>(nullptr), cache.find(120, true, 2, layers));
+    EXPECT_FALSE(cache.find(120, true, 1, layers).has_value());
+}
+
+// the layers can be destroyed or reordered between the validations
+TEST(BtsReassignCacheTest, LayerNoLongerAtIndex) {
+    BtsReassignCache cache;
+    std::vector<ExynosLayer *> layers = {fakeLayer(0), fakeLayer(1), fakeLayer(2)};
+    cache.store(120, true, 1, 2, layers[2]);
+
+    std::vector<ExynosLayer *> destroyed = {fakeLayer(0), fakeLayer(1)};
+    EXPECT_FALSE(cache.find(120, true, 1, destroyed).has_value());
+
+    std::vector<ExynosLayer *> reordered = {fakeLayer(2), fakeLayer(0), fakeLayer(1)};
+    EXPECT_FALSE(cache.find(120, true, 1, reordered).has_value());
+
+    EXPECT_EQ(std::optional<ExynosLayer *>(layers[2]), cache.find(120, true, 1, layers));
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <vector>
+
+#include "libhwchelper/ClientLayerState.h"
+
+namespace {
+
+ClientLayerState makeState() {
+    ClientLayerState state;
+    state.layer = reinterpret_cast<const ExynosLayer *>(0x1000);
+    state.buffer = reinterpret_cast<buffer_handle_t>(0x2000);
+    state.sourceCrop = {0.f, 0.f, 1080.f, 2400.f};
+    state.displayFrame = {0, 0, 1080, 2400};
+    state.dataSpace = 0x10c10000;
+    state.blending = 2;
+    state.transform = 0;
+    state.planeAlpha = 1.0f;
+    state.color = {0, 0, 0, 255};
+    state.brightness = 1.0f;
+    return state;
+}
+
+} // namespace
+
+TEST(SignatureHasherTest, Deterministic) {
+    SignatureHasher a, b;
+    a.add(1).add(2u).add(3.0f);
+    b.add(1).add(2u).add(3.0f);
+    EXPECT_EQ(a.get(), b.get());
+    EXPECT_NE(SignatureHasher().get(), a.get());
+}
+
+TEST(SignatureHasherTest, OrderMatters) {
+    SignatureHasher a, b;
+    a.add(1).add(2);
+    b.add(2).add(1);
+    EXPECT_NE(a.get(), b.get());
+}
+
+TEST(ClientLayerStateTest, SameStates) {
+    EXPECT_EQ(makeState(), makeState());
+    EXPECT_EQ(makeState().hash(), makeState().hash());
+}
+
+// every attribute the client composition depends on is a change
+TEST(ClientLayerStateTest, EachFieldIsChange) {
+    const std::vector<std::function<void(ClientLayerState &)>> changes = {
+            [](auto &s) { s.layer = reinterpret_cast<const ExynosLayer *>(0x1008); },
+            [](auto &s) { s.buffer = reinterpret_cast<buffer_handle_t>(0x2008); },
+            [](auto &s) { s.sourceCrop.left = 0.5f; },
+            [](auto &s) { s.sourceCrop.bottom = 2399.f; },
+            [](auto &s) { s.displayFrame.top = 1; },
+            [](auto &s) { s.displayFrame.right = 1079; },
+            [](auto &s) { s.dataSpace = 0; },
+            [](auto &s) { s.blending = 1; },
+            [](auto &s) { s.transform = 4; },
+            [](auto &s) { s.planeAlpha = 0.99f; },
+            [](auto &s) { s.color.g = 1; },
+            [](auto &s) { s.brightness = 0.5f; },
+    };
+    const ClientLayerState base = makeState();
+
+    for (size_t i = 0; i < changes.size(); i++) {
+        ClientLayerState changed = base;
+        changes[i](changed);
+        EXPECT_NE(base, changed) << "change " << i;
+        EXPECT_NE(base.hash(), changed.hash()) << "change " << i;
+    }
+}
+
+// swapping two layers changes the client composition even if their attributes are kept
+TEST(ClientLayerStateTest, LayerOrderIsChange) {
+    ClientLayerState a = makeState();
+    ClientLayerState b = makeState();
+    b.layer = reinterpret_cast<const ExynosLayer *>(0x1008);
+
+    const std::vector<ClientLayerState> stored = {a, b};
+    const std::vector<ClientLayerState> current = {b, a};
+    EXPECT_NE(stored, current);
+}
+
+// -0.0 and 0.0 are hashed bitwise, which only costs a needless reinitialization
+TEST(ClientLayerStateTest, SignedZeroIsRejectedByHash) {
+    ClientLayerState a = makeState();
+    ClientLayerState b = makeState();
+    a.sourceCrop.left = 0.0f;
+    b.sourceCrop.left = -0.0f;
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a.hash(), b.hash());
+}
+
+namespace {
+
+/*
+ * Replays the client composition layers of the frames the way skipStaticLayers() feeds
+ * them to StaticClientLayers, and returns for each frame whether the client composition
+ * is skipped.
+ */
+class StaticClientLayersReplay {
+    public:
+        bool frame(const std::vector<ClientLayerState> &layers) {
+            return frame(signatureOf(layers), layers);
+        }
+
+        bool frame(uint64_t signature, const std::vector<ClientLayerState> &layers) {
+            uint32_t stableFrames = mStatic.update(mRecorded, signature, layers.size(),
+                                                   [&](size_t i) { return layers[i]; });
+            mRecorded = true;
+            return stableFrames >= SKIP_STATIC_LAYER_STABLE_FRAMES;
+        }
+
+        // skipStaticLayerChanged()
+        bool changed(const std::vector<ClientLayerState> &layers) const {
+            return !mStatic.isSame(signatureOf(layers), layers.size(),
+                                   [&](size_t i) { return layers[i]; });
+        }
+
+        static uint64_t signatureOf(const std::vector<ClientLayerState> &layers) {
+            SignatureHasher hasher;
+            hasher.add(layers.size());
+            for (const auto &layer : layers) hasher.add(layer.hash());
+            return hasher.get();
+        }
+
+    private:
+        StaticClientLayers mStatic;
+        bool mRecorded = false;
+};
+
+ClientLayerState makeLayer(uintptr_t id) {
+    ClientLayerState state = makeState();
+    state.layer = reinterpret_cast<const ExynosLayer *>(0x1000 + id * 8);
+    state.buffer = reinterpret_cast<buffer_handle_t>(0x2000 + id * 8);
+    return state;
+}
+
+} // namespace
+
+TEST(StaticClientLayersTest, SkippedAfterStableFrames) {
+    StaticClientLayersReplay replay;
+    const std::vector<ClientLayerState> layers = {makeLayer(0), makeLayer(1)};
+
+    for (int i = 0; i < SKIP_STATIC_LAYER_STABLE_FRAMES; i++)
+        EXPECT_FALSE(replay.frame(layers)) << "frame " << i;
+    for (int i = 0; i < 10; i++) EXPECT_TRUE(replay.frame(layers));
+    EXPECT_FALSE(replay.changed(layers));
+}
+
+TEST(StaticClientLayersTest, VisibilityToggle) {
+    StaticClientLayersReplay replay;
+    const std::vector<ClientLayerState> shown = {makeLayer(0), makeLayer(1), makeLayer(2)};
+    const std::vector<ClientLayerState> hidden = {makeLayer(0), makeLayer(2)};
+
+    for (int i = 0; i <= SKIP_STATIC_LAYER_STABLE_FRAMES; i++) replay.frame(shown);
+    ASSERT_TRUE(replay.frame(shown));
+
+    // the layer toggles every frame, so no frame is like the one before
+    EXPECT_TRUE(replay.changed(hidden));
+    for (int i = 0; i < 10; i++) {
+        EXPECT_FALSE(replay.frame(i % 2 ? shown : hidden)) << "frame " << i;
+    }
+
+    // the layer stays hidden
+    for (int i = 0; i < SKIP_STATIC_LAYER_STABLE_FRAMES; i++)
+        EXPECT_FALSE(replay.frame(hidden)) << "frame " << i;
+    EXPECT_TRUE(replay.frame(hidden));
+
+    // and is shown again with the states it had
+    EXPECT_TRUE(replay.changed(shown));
+    EXPECT_FALSE(replay.frame(shown));
+}
+
+TEST(StaticClientLayersTest, AlphaAnimation) {
+    StaticClientLayersReplay replay;
+    std::vector<ClientLayerState> layers = {makeLayer(0), makeLayer(1)};
+
+    for (int i = 0; i <= SKIP_STATIC_LAYER_STABLE_FRAMES; i++) replay.frame(layers);
+    ASSERT_TRUE(replay.frame(layers));
+
+    // fading out, one step per frame
+    for (int i = 1; i <= 10; i++) {
+        layers[1].planeAlpha = 1.0f - i * 0.1f;
+        EXPECT_TRUE(replay.changed(layers)) << "step " << i;
+        EXPECT_FALSE(replay.frame(layers)) << "step " << i;
+    }
+
+    // the animation ended, its last frame is recorded
+    for (int i = 1; i < SKIP_STATIC_LAYER_STABLE_FRAMES; i++)
+        EXPECT_FALSE(replay.frame(layers)) << "frame " << i;
+    EXPECT_TRUE(replay.frame(layers));
+}
+
+TEST(StaticClientLayersTest, BufferOnlyUpdate) {
+    StaticClientLayersReplay replay;
+    std::vector<ClientLayerState> layers = {makeLayer(0), makeLayer(1)};
+    const buffer_handle_t buffers[] = {reinterpret_cast<buffer_handle_t>(0x3000),
+                                       reinterpret_cast<buffer_handle_t>(0x3008)};
+
+    for (int i = 0; i <= SKIP_STATIC_LAYER_STABLE_FRAMES; i++) replay.frame(layers);
+    ASSERT_TRUE(replay.frame(layers));
+
+    // double buffered: the buffer of a frame is the one of two frames before
+    for (int i = 0; i < 10; i++) {
+        layers[0].buffer = buffers[i % 2];
+        EXPECT_TRUE(replay.changed(layers)) << "frame " << i;
+        EXPECT_FALSE(replay.frame(layers)) << "frame " << i;
+    }
+
+    // the buffer is kept from the last update on
+    for (int i = 1; i < SKIP_STATIC_LAYER_STABLE_FRAMES; i++)
+        EXPECT_FALSE(replay.frame(layers)) << "frame " << i;
+    EXPECT_TRUE(replay.frame(layers));
+}
+
+// a change which keeps the signature is caught by comparing the states
+TEST(StaticClientLayersTest, SignatureCollisionIsChange) {
+    static constexpr uint64_t kSignature = 0x1234;
+    StaticClientLayersReplay replay;
+    std::vector<ClientLayerState> layers = {makeLayer(0)};
+
+    for (int i = 0; i <= SKIP_STATIC_LAYER_STABLE_FRAMES; i++) replay.frame(kSignature, layers);
+    ASSERT_TRUE(replay.frame(kSignature, layers));
+
+    layers[0].transform = 4;
+    EXPECT_FALSE(replay.frame(kSignature, layers));
+    EXPECT_FALSE(replay.frame(kSignature, layers));
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "libdevice/CommitScheduler.h"
+
+namespace {
+
+constexpr nsecs_t kVsyncPeriod = ms2ns(16);
+
+// a simulated clock, which a hold advances to the latch time
+class FakeClock : public CommitScheduler::Clock {
+  public:
+    nsecs_t now() const override { return mNow; }
+    void sleepUntil(nsecs_t time) const override { mNow = std::max(mNow, time); }
+    void advance(nsecs_t duration) { mNow += duration; }
+
+  private:
+    mutable nsecs_t mNow = ms2ns(1000);
+};
+
+class CommitSchedulerTest : public ::testing::Test {
+  protected:
+    CommitSchedulerTest() {
+        auto clock = std::make_unique<FakeClock>();
+        mClock = clock.get();
+        mScheduler = std::make_unique<CommitScheduler>(std::move(clock));
+    }
+
+    // measures the latency of a frame which is not held
+    void measureLatency(nsecs_t latency) {
+        mScheduler->beginFrame(0, kVsyncPeriod);
+        mClock->advance(latency);
+        mScheduler->endFrame();
+    }
+
+    // commits a frame expected at @expectedPresentTime in @latency after its latch, returns
+    // how long it was held
+    nsecs_t commit(nsecs_t expectedPresentTime, nsecs_t latency) {
+        const nsecs_t holdTime = mScheduler->beginFrame(expectedPresentTime, kVsyncPeriod);
+        mClock->advance(latency);
+        mScheduler->endFrame();
+        return holdTime;
+    }
+
+    FakeClock *mClock;
+    std::unique_ptr<CommitScheduler> mScheduler;
+};
+
+TEST_F(CommitSchedulerTest, NotHeldUntilLatencyIsMeasured) {
+    const nsecs_t now = mClock->now();
+
+    EXPECT_EQ(0, mScheduler->getLatchTime(now + ms2ns(4), kVsyncPeriod, now));
+    EXPECT_EQ(0, commit(now + ms2ns(4), ms2ns(1)));
+}
+
+TEST_F(CommitSchedulerTest, NotHeldWithoutExpectedPresentTime) {
+    measureLatency(ms2ns(2));
+    const nsecs_t now = mClock->now();
+
+    EXPECT_EQ(0, mScheduler->getLatchTime(0, kVsyncPeriod, now));
+    EXPECT_EQ(0, mScheduler->beginFrame(0, kVsyncPeriod));
+    EXPECT_EQ(now, mClock->now());
+    mScheduler->endFrame();
+}
+
+TEST_F(CommitSchedulerTest, LatchedBeforeExpectedPresentTime) {
+    const nsecs_t latency = ms2ns(2);
+    measureLatency(latency);
+    const nsecs_t now = mClock->now();
+    const nsecs_t latchTime = now + ms2ns(6) - latency - CommitScheduler::kDefaultMargin;
+
+    EXPECT_EQ(latchTime, mScheduler->getLatchTime(now + ms2ns(6), kVsyncPeriod, now));
+    // the latch time already passed
+    EXPECT_EQ(0, mScheduler->getLatchTime(now + ms2ns(2), kVsyncPeriod, now));
+    // the hint is stale
+    EXPECT_EQ(0, mScheduler->getLatchTime(now + 2 * kVsyncPeriod, kVsyncPeriod, now));
+
+    EXPECT_EQ(latchTime - now, mScheduler->beginFrame(now + ms2ns(6), kVsyncPeriod));
+    EXPECT_EQ(latchTime, mClock->now());
+    mScheduler->endFrame();
+}
+
+TEST_F(CommitSchedulerTest, HoldIsBounded) {
+    measureLatency(us2ns(100));
+    const nsecs_t now = mClock->now();
+    const nsecs_t vsyncPeriod = ms2ns(33);
+
+    EXPECT_EQ(now + CommitScheduler::kMaxHoldTime,
+              mScheduler->getLatchTime(now + ms2ns(30), vsyncPeriod, now));
+    EXPECT_EQ(CommitScheduler::kMaxHoldTime,
+              mScheduler->beginFrame(now + ms2ns(30), vsyncPeriod));
+    mScheduler->endFrame();
+}
+
+TEST_F(CommitSchedulerTest, HoldIsExcludedFromWorkDuration) {
+    measureLatency(ms2ns(2));
+    // the work duration is measured from before the hold to after the commit
+    const nsecs_t start = mClock->now();
+    const nsecs_t holdTime = commit(start + ms2ns(8), ms2ns(2));
+    const nsecs_t end = mClock->now();
+
+    EXPECT_EQ(ms2ns(8) - ms2ns(2) - CommitScheduler::kDefaultMargin, holdTime);
+    EXPECT_EQ(ms2ns(2), CommitScheduler::getWorkDuration(start, end, holdTime));
+    EXPECT_EQ(end - start, CommitScheduler::getWorkDuration(start, end, 0));
+    EXPECT_EQ(0, CommitScheduler::getWorkDuration(start, start, holdTime));
+}
+
+TEST_F(CommitSchedulerTest, MissesAreCountedForHeldFrames) {
+    measureLatency(ms2ns(1));
+
+    // committed in the predicted latency, before the expected present time
+    nsecs_t expectedPresentTime = mClock->now() + ms2ns(10);
+    EXPECT_NE(0, commit(expectedPresentTime, ms2ns(1)));
+    EXPECT_LT(mClock->now(), expectedPresentTime);
+
+    // slower than the predicted latency and the margin
+    expectedPresentTime = mClock->now() + ms2ns(10);
+    EXPECT_NE(0, commit(expectedPresentTime, ms2ns(3)));
+    EXPECT_GT(mClock->now(), expectedPresentTime);
+
+    // a frame which is not held is not a miss of the scheduler
+    commit(0, ms2ns(20));
+
+    const CommitScheduler::Stats stats = mScheduler->getStats();
+    EXPECT_EQ(2, stats.held);
+    EXPECT_EQ(2, stats.notHeld);
+    EXPECT_EQ(1, stats.missed);
+    EXPECT_EQ(ms2ns(20), stats.maxLatency);
+    EXPECT_EQ(ms2ns(1 + 1 + 3 + 20), stats.totalLatency);
+}
+
+TEST_F(CommitSchedulerTest, LatencyIsTheMaxOfTheRecentFrames) {
+    const nsecs_t latency = ms2ns(1);
+    const nsecs_t outlier = ms2ns(5);
+    const nsecs_t expectedPresentOffset = ms2ns(8);
+    auto getHoldTime = [&]() {
+        const nsecs_t now = mClock->now();
+        const nsecs_t latchTime =
+                mScheduler->getLatchTime(now + expectedPresentOffset, kVsyncPeriod, now);
+        return latchTime ? latchTime - now : 0;
+    };
+    const nsecs_t holdTime = expectedPresentOffset - latency - CommitScheduler::kDefaultMargin;
+    const nsecs_t outlierHoldTime =
+            expectedPresentOffset - outlier - CommitScheduler::kDefaultMargin;
+
+    for (size_t i = 0; i < CommitScheduler::kNumLatencySamples; i++) measureLatency(latency);
+    EXPECT_EQ(holdTime, getHoldTime());
+
+    // one slow commit shortens the hold of every frame until it leaves the window
+    measureLatency(outlier);
+    for (size_t i = 1; i < CommitScheduler::kNumLatencySamples; i++) {
+        EXPECT_EQ(outlierHoldTime, getHoldTime()) << "frame " << i;
+        commit(mClock->now() + expectedPresentOffset, latency);
+    }
+    EXPECT_EQ(outlierHoldTime, getHoldTime());
+
+    commit(mClock->now() + expectedPresentOffset, latency);
+    EXPECT_EQ(holdTime, getHoldTime());
+}
+
+// the commit path of deliverWinConfigData(), returns -1 without committing if the atomic
+// commit fails
+int deliver(CommitScheduler &scheduler, FakeClock &clock, nsecs_t expectedPresentTime,
+            nsecs_t latency, bool commitFails) {
+    CommitScheduler::ScopedFrame commitLatch;
+    scheduler.beginFrame(expectedPresentTime, kVsyncPeriod);
+    commitLatch = CommitScheduler::ScopedFrame(&scheduler);
+
+    clock.advance(latency);
+    if (commitFails) return -1;
+
+    commitLatch.committed();
+    return 0;
+}
+
+TEST_F(CommitSchedulerTest, FailedCommitEndsTheFrame) {
+    measureLatency(ms2ns(2));
+    const nsecs_t expectedPresentTime = mClock->now() + ms2ns(10);
+
+    // a failed commit leaves no frame open and no latency sample
+    EXPECT_EQ(-1, deliver(*mScheduler, *mClock, expectedPresentTime, ms2ns(20), true));
+    CommitScheduler::Stats stats = mScheduler->getStats();
+    EXPECT_EQ(1, stats.held);
+    EXPECT_EQ(1, stats.failed);
+    EXPECT_EQ(0, stats.missed);
+    EXPECT_EQ(ms2ns(2), stats.totalLatency);
+
+    // an endFrame() without a frame is ignored
+    mScheduler->endFrame();
+    EXPECT_EQ(ms2ns(2), mScheduler->getStats().totalLatency);
+
+    // the latch time is still predicted from the committed frames
+    const nsecs_t now = mClock->now();
+    EXPECT_EQ(now + ms2ns(6) - ms2ns(2) - CommitScheduler::kDefaultMargin,
+              mScheduler->getLatchTime(now + ms2ns(6), kVsyncPeriod, now));
+
+    EXPECT_EQ(0, deliver(*mScheduler, *mClock, now + ms2ns(6), ms2ns(1), false));
+    stats = mScheduler->getStats();
+    EXPECT_EQ(2, stats.held);
+    EXPECT_EQ(1, stats.failed);
+    EXPECT_EQ(ms2ns(2 + 1), stats.totalLatency);
+}
+
+TEST_F(CommitSchedulerTest, ScopedFrameIsMovable) {
+    measureLatency(ms2ns(2));
+
+    mScheduler->beginFrame(0, kVsyncPeriod);
+    CommitScheduler::ScopedFrame frame(mScheduler.get());
+    CommitScheduler::ScopedFrame moved(std::move(frame));
+    // the moved-from scope does not end the frame
+    frame.committed();
+    EXPECT_EQ(ms2ns(2), mScheduler->getStats().totalLatency);
+
+    mClock->advance(ms2ns(3));
+    moved.committed();
+    moved.committed();
+    const CommitScheduler::Stats stats = mScheduler->getStats();
+    EXPECT_EQ(ms2ns(2 + 3), stats.totalLatency);
+    EXPECT_EQ(0, stats.failed);
+}
+
+TEST_F(CommitSchedulerTest, ReplayOfCommitLatencies) {
+    // latch to commit latencies around 1.2 ms with a slow commit every 10 frames
+    constexpr size_t kNumFrames = 200;
+    constexpr nsecs_t kVsyncPeriod120Hz = 8333333;
+    const nsecs_t latencies[] = {us2ns(1100), us2ns(1200), us2ns(1300), us2ns(1250), us2ns(1150)};
+    const nsecs_t slowLatency = us2ns(2600);
+
+    nsecs_t expectedPresentTime = mClock->now() + kVsyncPeriod120Hz;
+    nsecs_t maxSlack = 0;
+    for (size_t i = 0; i < kNumFrames; i++) {
+        const nsecs_t latency = (i % 10 == 9) ? slowLatency : latencies[i % 5];
+        const bool held = mScheduler->beginFrame(expectedPresentTime, kVsyncPeriod120Hz) != 0;
+        mClock->advance(latency);
+        mScheduler->endFrame();
+        if (held) maxSlack = std::max(maxSlack, expectedPresentTime - mClock->now());
+
+        expectedPresentTime += kVsyncPeriod120Hz;
+        // the next frame arrives half a vsync before its expected present time
+        mClock->sleepUntil(expectedPresentTime - kVsyncPeriod120Hz / 2);
+    }
+
+    const CommitScheduler::Stats stats = mScheduler->getStats();
+    // the first frame is not held until a latency is measured
+    EXPECT_EQ(kNumFrames - 1, stats.held);
+    EXPECT_EQ(1, stats.notHeld);
+    // only the first slow commit misses, the later ones are predicted by the slow commit
+    // in the last 16 frames
+    EXPECT_EQ(1, stats.missed);
+    EXPECT_EQ(slowLatency, stats.maxLatency);
+    // the held commits end at most the margin and the latency spread before the expected
+    // present time
+    EXPECT_EQ(CommitScheduler::kDefaultMargin + slowLatency - latencies[0], maxSlack);
+}
+
+} // namespace
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "libhwchelper/DamageHelper.h"
+
+namespace {
+
+constexpr int32_t kWidth = 1080;
+constexpr int32_t kHeight = 2400;
+
+void expectRect(const hwc_rect &expected, const hwc_rect &actual) {
+    EXPECT_EQ(expected.left, actual.left);
+    EXPECT_EQ(expected.top, actual.top);
+    EXPECT_EQ(expected.right, actual.right);
+    EXPECT_EQ(expected.bottom, actual.bottom);
+}
+
+TEST(DamageHelperTest, TransformDamageIdentity) {
+    const hwc_frect_t crop = {100.f, 200.f, 500.f, 600.f};
+    const hwc_rect frame = {10, 20, 410, 420};
+
+    expectRect({20, 30, 60, 70},
+               transformDamage({110, 210, 150, 250}, crop, frame));
+}
+
+TEST(DamageHelperTest, TransformDamageOutsideCrop) {
+    const hwc_frect_t crop = {100.f, 200.f, 500.f, 600.f};
+    const hwc_rect frame = {0, 0, 400, 400};
+
+    EXPECT_EQ(0u, rectArea(transformDamage({0, 0, 100, 100}, crop, frame)));
+    EXPECT_EQ(0u, rectArea(transformDamage({500, 600, 700, 800}, crop, frame)));
+    /* clipped to the source crop */
+    expectRect({0, 0, 50, 50}, transformDamage({0, 0, 150, 250}, crop, frame));
+}
+
+TEST(DamageHelperTest, TransformDamageScalesOutwards) {
+    const hwc_frect_t crop = {0.f, 0.f, 300.f, 300.f};
+    const hwc_rect frame = {0, 0, 100, 100};
+
+    /* 1/3 scaling, rounded to cover the damage */
+    expectRect({3, 3, 7, 7}, transformDamage({10, 10, 20, 20}, crop, frame));
+
+    const hwc_rect upscaled = {50, 50, 250, 250};
+    expectRect({70, 70, 90, 90},
+               transformDamage({10, 10, 20, 20}, {0.f, 0.f, 100.f, 100.f}, upscaled));
+}
+
+TEST(DamageHelperTest, WindowUpdateRegionClipsToPanel) {
+    expectRect({0, 0, 100, 100},
+               getWindowUpdateRegion({-50, -50, 100, 100}, kWidth, kHeight, 1, 1));
+    expectRect({1000, 2300, kWidth, kHeight},
+               getWindowUpdateRegion({1000, 2300, 1200, 2500}, kWidth, kHeight, 1, 1));
+    EXPECT_EQ(0u, rectArea(getWindowUpdateRegion({kWidth, 0, kWidth + 10, 10}, kWidth, kHeight,
+                                                 1, 1)));
+}
+
+TEST(DamageHelperTest, WindowUpdateRegionIsAligned) {
+    /* e.g. full width slices of 40 lines */
+    expectRect({0, 0, kWidth, 80},
+               getWindowUpdateRegion({900, 10, 1000, 80}, kWidth, kHeight, kWidth, 40));
+    expectRect({0, 1200, kWidth, 1280},
+               getWindowUpdateRegion({200, 1210, 204, 1260}, kWidth, kHeight, kWidth, 40));
+    /* the last slice ends at the panel */
+    expectRect({540, 2380, kWidth, kHeight},
+               getWindowUpdateRegion({600, 2390, 700, 2500}, kWidth, kHeight, 540, 20));
+}
+
+/*
+ * Runs the damage patterns of typical partial updates through the aligned window
+ * update region and reports the pixels which are not transferred to the panel.
+ */
+TEST(DamageHelperTest, SavedPixels) {
+    struct Pattern {
+        const char *name;
+        std::vector<hwc_rect> damage;
+    };
+    const std::vector<Pattern> patterns = {
+            {"status bar clock", {{900, 0, 1000, 80}}},
+            {"cursor blink", {{200, 1200, 204, 1260}}},
+            {"keyboard key", {{0, 1600, kWidth, kHeight}, {300, 1700, 420, 1820}}},
+            {"clock and notification", {{900, 0, 1000, 80}, {0, 300, kWidth, 500}}},
+            {"full screen video", {{0, 0, kWidth, kHeight}}},
+            {"far corners", {{0, 0, 10, 10}, {kWidth - 10, kHeight - 10, kWidth, kHeight}}},
+    };
+    const int32_t kSliceHeight = 40;
+    const uint64_t fullArea = static_cast<uint64_t>(kWidth) * kHeight;
+    uint64_t totalSaved = 0;
+
+    for (auto &pattern : patterns) {
+        hwc_rect bounds = pattern.damage[0];
+        for (auto &rect : pattern.damage) {
+            bounds.left = std::min(bounds.left, rect.left);
+            bounds.top = std::min(bounds.top, rect.top);
+            bounds.right = std::max(bounds.right, rect.right);
+            bounds.bottom = std::max(bounds.bottom, rect.bottom);
+        }
+        const hwc_rect region =
+                getWindowUpdateRegion(bounds, kWidth, kHeight, kWidth, kSliceHeight);
+        const uint64_t saved = fullArea - rectArea(region);
+
+        for (auto &rect : pattern.damage) {
+            EXPECT_LE(region.left, rect.left) << pattern.name;
+            EXPECT_LE(region.top, rect.top) << pattern.name;
+            EXPECT_GE(region.right, rect.right) << pattern.name;
+            EXPECT_GE(region.bottom, rect.bottom) << pattern.name;
+        }
+        totalSaved += saved;
+        std::cout << pattern.name << ": saved " << saved * 100 / fullArea << "% ("
+                  << saved << " pixels)" << std::endl;
+    }
+    RecordProperty("SavedPercent", static_cast<int>(totalSaved * 100 / (fullArea * patterns.size())));
+}
+
+} // namespace
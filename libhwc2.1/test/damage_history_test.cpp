@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "libresource/DamageHistory.h"
+
+namespace {
+
+// NUM_MPP_DST_BUFS_DEFAULT
+constexpr uint32_t kNumBuffers = 3;
+constexpr hwc_rect_t kFullFrame = {0, 0, 1088, 2400};
+
+void expectRect(const hwc_rect &expected, const hwc_rect &actual) {
+    EXPECT_EQ(expected.left, actual.left);
+    EXPECT_EQ(expected.top, actual.top);
+    EXPECT_EQ(expected.right, actual.right);
+    EXPECT_EQ(expected.bottom, actual.bottom);
+}
+
+// the destination buffers of an MPP used in turn like ExynosMPP::doPostProcessing()
+class DamageHistoryTest : public ::testing::Test {
+  protected:
+    // composites a frame with @damage, or in full if the frame damage is unknown, into the
+    // next buffer. Returns the area updated by the composition
+    hwc_rect_t compose(const hwc_rect_t *damage) {
+        const uint32_t buffer = mNextBuffer;
+        mNextBuffer = (mNextBuffer + 1) % kNumBuffers;
+
+        hwc_rect_t area;
+        if (!damage || !mHistory.getIncrementalArea(buffer, *damage, area)) area = kFullFrame;
+        mHistory.composed(buffer, damage ? *damage : kFullFrame);
+        return area;
+    }
+
+    hwc_rect_t compose(const hwc_rect_t &damage) { return compose(&damage); }
+
+    // the first compositions into the buffers
+    void warmUp() {
+        for (uint32_t i = 0; i < kNumBuffers; i++) expectRect(kFullFrame, compose(nullptr));
+    }
+
+    DamageHistory mHistory{kNumBuffers};
+    uint32_t mNextBuffer = 0;
+};
+
+TEST_F(DamageHistoryTest, BuffersAreCompositedInFullFirst) {
+    const hwc_rect_t damage = {10, 10, 20, 20};
+    hwc_rect_t area;
+
+    for (uint32_t i = 0; i < kNumBuffers; i++) {
+        SCOPED_TRACE(i);
+        EXPECT_FALSE(mHistory.getIncrementalArea(i, damage, area));
+        expectRect(kFullFrame, compose(damage));
+    }
+    EXPECT_EQ(static_cast<uint64_t>(kNumBuffers), mHistory.getCompositionCount());
+}
+
+TEST_F(DamageHistoryTest, DamageAccumulatesAcrossFrames) {
+    warmUp();
+
+    // a cursor moving to the right: a buffer misses the damage of the frames composited
+    // into the other buffers since it was composited last
+    const hwc_rect_t cursor[] = {
+            {100, 100, 120, 120}, {120, 100, 140, 120}, {140, 100, 160, 120},
+            {160, 100, 180, 120}, {180, 100, 200, 120},
+    };
+
+    // the full frames of the warm up are still to be updated
+    expectRect(kFullFrame, compose(cursor[0]));
+    expectRect(kFullFrame, compose(cursor[1]));
+
+    // the damage of the current frame and of the two previous frames
+    expectRect({100, 100, 160, 120}, compose(cursor[2]));
+    expectRect({120, 100, 180, 120}, compose(cursor[3]));
+    expectRect({140, 100, 200, 120}, compose(cursor[4]));
+
+    // a static frame updates only the damage the buffer missed
+    const hwc_rect_t none = {0, 0, 0, 0};
+    expectRect({160, 100, 200, 120}, compose(none));
+    expectRect({180, 100, 200, 120}, compose(none));
+}
+
+TEST_F(DamageHistoryTest, ReallocatedBufferIsCompositedInFull) {
+    warmUp();
+    const hwc_rect_t damage = {0, 0, 64, 64};
+    for (uint32_t i = 0; i < kNumBuffers; i++) compose(damage);
+
+    // the buffer 1 is reallocated, e.g. for a new size, the others keep their content
+    mHistory.invalidate(1);
+    expectRect(damage, compose(damage));
+    expectRect(kFullFrame, compose(damage));
+    expectRect(damage, compose(damage));
+
+    // the new buffer is incremental once it is composited
+    expectRect(damage, compose(damage));
+    expectRect(damage, compose(damage));
+}
+
+TEST_F(DamageHistoryTest, FailedCompositionInvalidatesAllBuffers) {
+    warmUp();
+    const hwc_rect_t damage = {0, 0, 64, 64};
+    for (uint32_t i = 0; i < kNumBuffers; i++) compose(damage);
+
+    mHistory.invalidateAll();
+    for (uint32_t i = 0; i < kNumBuffers; i++) expectRect(kFullFrame, compose(damage));
+    expectRect(damage, compose(damage));
+}
+
+TEST_F(DamageHistoryTest, FullFrameFallback) {
+    warmUp();
+    const hwc_rect_t damage = {0, 0, 64, 64};
+    for (uint32_t i = 0; i < kNumBuffers; i++) compose(damage);
+
+    // a frame of an unknown damage, e.g. a layer added, is composited in full and the next
+    // buffers update the full frame too
+    expectRect(kFullFrame, compose(nullptr));
+    expectRect(kFullFrame, compose(damage));
+    expectRect(kFullFrame, compose(damage));
+    expectRect(damage, compose(damage));
+
+    // no damage at all composites the whole buffer rather than an empty job
+    const hwc_rect_t none = {0, 0, 0, 0};
+    for (uint32_t i = 0; i < kNumBuffers; i++) compose(none);
+    hwc_rect_t area;
+    EXPECT_FALSE(mHistory.getIncrementalArea(mNextBuffer, none, area));
+}
+
+TEST_F(DamageHistoryTest, BufferOlderThanTheHistoryIsCompositedInFull) {
+    warmUp();
+    const hwc_rect_t damage = {0, 0, 64, 64};
+    hwc_rect_t area;
+
+    // the buffer 0 is not used while the compositions go to the buffers 1 and 2
+    for (uint32_t i = 0; i < kNumBuffers; i++) mHistory.composed(1 + i % 2, damage);
+    EXPECT_FALSE(mHistory.getIncrementalArea(0, damage, area));
+    EXPECT_TRUE(mHistory.getIncrementalArea(1, damage, area));
+    EXPECT_TRUE(mHistory.getIncrementalArea(2, damage, area));
+
+    // a buffer out of the range is never incremental
+    mHistory.composed(kNumBuffers, damage);
+    EXPECT_FALSE(mHistory.getIncrementalArea(kNumBuffers, damage, area));
+}
+
+} // namespace
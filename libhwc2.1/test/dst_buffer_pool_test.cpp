@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "libresource/DstBufferPool.h"
+
+namespace {
+
+constexpr uint32_t kPrimary = 0;
+constexpr uint32_t kExternal = 1;
+constexpr uint32_t kFormat = 1; // HAL_PIXEL_FORMAT_RGBA_8888
+constexpr uint64_t kUsage = 0x900;
+
+// the buffers of the stub allocator, kept by the test to outlive the pool
+struct AllocatorState {
+    std::set<buffer_handle_t> live;
+    uint32_t allocated = 0;
+    bool fail = false;
+};
+
+// hands out distinct fake handles and tracks the live ones
+class StubAllocator : public DstBufferPool::Allocator {
+  public:
+    explicit StubAllocator(AllocatorState &state) : mState(state) {}
+
+    android::status_t allocate(uint32_t, uint32_t, uint32_t, uint64_t,
+                               buffer_handle_t *outBuffer) override {
+        if (mState.fail) return android::NO_MEMORY;
+        *outBuffer = reinterpret_cast<buffer_handle_t>(++mNextHandle);
+        mState.live.insert(*outBuffer);
+        mState.allocated++;
+        return android::NO_ERROR;
+    }
+    void free(buffer_handle_t buffer) override {
+        EXPECT_EQ(1u, mState.live.erase(buffer)) << "freeing an unknown buffer " << buffer;
+    }
+
+  private:
+    AllocatorState &mState;
+    uintptr_t mNextHandle = 0x1000;
+};
+
+class DstBufferPoolTest : public ::testing::Test {
+  protected:
+    DstBufferPoolTest() : mPool(std::make_unique<DstBufferPool>(
+                                  std::make_unique<StubAllocator>(mAllocator))) {}
+
+    buffer_handle_t acquire(uint32_t width, uint32_t height, uint32_t owner) {
+        buffer_handle_t buffer = nullptr;
+        EXPECT_EQ(android::NO_ERROR,
+                  mPool->acquire(width, height, kFormat, kUsage, owner, &buffer));
+        return buffer;
+    }
+
+    AllocatorState mAllocator;
+    std::unique_ptr<DstBufferPool> mPool;
+};
+
+TEST_F(DstBufferPoolTest, ReusesBufferOfSameAttributes) {
+    buffer_handle_t buffer = acquire(1080, 2400, kPrimary);
+    mPool->release(buffer);
+
+    EXPECT_EQ(buffer, acquire(1080, 2400, kPrimary));
+    EXPECT_EQ(1u, mAllocator.allocated);
+
+    // another size is allocated
+    EXPECT_NE(buffer, acquire(1920, 1080, kPrimary));
+    EXPECT_EQ(2u, mAllocator.allocated);
+}
+
+TEST_F(DstBufferPoolTest, FailedAllocationIsReported) {
+    mAllocator.fail = true;
+    buffer_handle_t buffer = nullptr;
+
+    EXPECT_NE(android::NO_ERROR, mPool->acquire(64, 64, kFormat, kUsage, kPrimary, &buffer));
+    EXPECT_EQ(nullptr, buffer);
+}
+
+TEST_F(DstBufferPoolTest, OverflowIsFreed) {
+    std::vector<buffer_handle_t> buffers;
+    for (size_t i = 0; i < DstBufferPool::kMaxPooledBuffers + 2; i++)
+        buffers.push_back(acquire(64, 64 + i, kPrimary));
+    for (auto buffer : buffers) mPool->release(buffer);
+
+    EXPECT_EQ(DstBufferPool::kMaxPooledBuffers, mPool->getPooledCount());
+    EXPECT_EQ(DstBufferPool::kMaxPooledBuffers, mAllocator.live.size());
+    // the oldest are freed
+    EXPECT_EQ(0u, mAllocator.live.count(buffers[0]));
+    EXPECT_EQ(0u, mAllocator.live.count(buffers[1]));
+}
+
+TEST_F(DstBufferPoolTest, TrimFreesIdleBuffers) {
+    buffer_handle_t buffer = acquire(64, 64, kPrimary);
+    mPool->release(buffer);
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    mPool->trim(now);
+    EXPECT_EQ(1u, mPool->getPooledCount());
+
+    mPool->trim(now + DstBufferPool::kMaxIdleTime + ms2ns(1));
+    EXPECT_TRUE(mPool->empty());
+    EXPECT_TRUE(mAllocator.live.empty());
+}
+
+TEST_F(DstBufferPoolTest, ClearFreesOnlyTheBuffersOfTheDisplay) {
+    buffer_handle_t primary = acquire(1080, 2400, kPrimary);
+    buffer_handle_t external = acquire(1920, 1080, kExternal);
+    buffer_handle_t lent = acquire(1920, 1080, kExternal);
+    mPool->release(primary);
+    mPool->release(external);
+
+    mPool->clear(kExternal);
+    EXPECT_EQ(1u, mPool->getPooledCount());
+    EXPECT_EQ(0u, mAllocator.live.count(external));
+    // the primary keeps its warm buffer
+    EXPECT_EQ(primary, acquire(1080, 2400, kPrimary));
+
+    // a buffer lent while its display powers off is pooled on return
+    mPool->release(lent);
+    EXPECT_EQ(1u, mPool->getPooledCount());
+}
+
+TEST_F(DstBufferPoolTest, ReusedBufferMovesToTheNewOwner) {
+    buffer_handle_t buffer = acquire(1920, 1080, kExternal);
+    mPool->release(buffer);
+    EXPECT_EQ(buffer, acquire(1920, 1080, kPrimary));
+    mPool->release(buffer);
+
+    mPool->clear(kExternal);
+    EXPECT_EQ(1u, mPool->getPooledCount());
+    mPool->clear(kPrimary);
+    EXPECT_TRUE(mPool->empty());
+    EXPECT_TRUE(mAllocator.live.empty());
+}
+
+TEST_F(DstBufferPoolTest, PooledBuffersAreFreedWithThePool) {
+    mPool->release(acquire(64, 64, kPrimary));
+    mPool->release(acquire(128, 128, kExternal));
+
+    mPool.reset();
+    EXPECT_TRUE(mAllocator.live.empty());
+}
+
+} // namespace
@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libhwchelper/EpochPointer.h"
+
+namespace {
+
+constexpr uint32_t kAlive = 0xa11fe;
+constexpr uint32_t kFreed = 0xdead;
+
+std::atomic<int> gLiveTables = 0;
+
+// a callback table whose fields are all @id, so reads of a torn or freed table are detected
+struct Table {
+    explicit Table(uint32_t id) : id(id), copy(id) { gLiveTables++; }
+    ~Table() {
+        state = kFreed;
+        gLiveTables--;
+    }
+    uint32_t state = kAlive;
+    uint32_t id;
+    uint32_t copy;
+};
+
+/*
+ * The callback registration and the hotplug delivery of ExynosDevice, with the
+ * plugged state of a single display.
+ */
+class FakeDevice {
+  public:
+    using Callback = std::function<void(bool connected)>;
+
+    void registerCallback(Callback callback) {
+        std::lock_guard<std::mutex> lock(mRegisterMutex);
+        std::lock_guard<std::mutex> hotplugLock(mHotplugMutex);
+        mCallback.publish(new Callback(callback));
+        const bool plugged = mPlugged;
+        /* reporting the displays is a binder call to the client */
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        if (callback && plugged) callback(true);
+    }
+
+    // the hotplug handler updates the state and delivers the event
+    void hotplug(bool connected) {
+        mPlugged = connected;
+        std::lock_guard<std::mutex> lock(mHotplugMutex);
+        EpochPointer<Callback>::Reader callback(mCallback);
+        if (*callback) (*callback)(connected);
+    }
+
+  private:
+    EpochPointer<Callback> mCallback{new Callback()};
+    std::mutex mRegisterMutex;
+    std::mutex mHotplugMutex;
+    std::atomic<bool> mPlugged = false;
+};
+
+/* the dispatch latencies in power of two buckets of nanoseconds */
+class LatencyHistogram {
+  public:
+    void add(int64_t ns) {
+        size_t bucket = 0;
+        while (bucket + 1 < kNumBuckets && (int64_t{1} << bucket) < ns) bucket++;
+        mBuckets[bucket]++;
+        mCount++;
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (size_t bucket = 0; bucket < kNumBuckets; bucket++)
+            mBuckets[bucket] += other.mBuckets[bucket];
+        mCount += other.mCount;
+    }
+
+    uint64_t count() const { return mCount; }
+
+    /* the upper bound of the bucket holding the nearest-rank percentile */
+    int64_t percentile(uint32_t percent) const {
+        const uint64_t rank = std::max<uint64_t>(1, (mCount * percent + 99) / 100);
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < kNumBuckets; bucket++) {
+            seen += mBuckets[bucket];
+            if (seen >= rank) return int64_t{1} << bucket;
+        }
+        return int64_t{1} << (kNumBuckets - 1);
+    }
+
+    /* records the non empty buckets and the percentiles as test properties */
+    void record(const std::string &prefix) const {
+        for (size_t bucket = 0; bucket < kNumBuckets; bucket++) {
+            if (mBuckets[bucket] == 0) continue;
+            ::testing::Test::RecordProperty(prefix + "Le" + std::to_string(int64_t{1} << bucket) +
+                                                    "Ns",
+                                            std::to_string(mBuckets[bucket]));
+        }
+        ::testing::Test::RecordProperty(prefix + "P50Ns", std::to_string(percentile(50)));
+        ::testing::Test::RecordProperty(prefix + "P99Ns", std::to_string(percentile(99)));
+    }
+
+  private:
+    static constexpr size_t kNumBuckets = 32;
+    uint64_t mBuckets[kNumBuckets] = {};
+    uint64_t mCount = 0;
+};
+
+/* a vsync client of the device; the registration alternates between two of them */
+struct VsyncClient {
+    std::atomic<uint64_t> vsyncs = 0;
+};
+
+/* the vsync entry of the callback table, marked when it is freed */
+struct VsyncTable {
+    VsyncTable(void (*func)(VsyncClient *, uint32_t), VsyncClient *client)
+          : func(func), client(client) {}
+    ~VsyncTable() { state = kFreed; }
+    uint32_t state = kAlive;
+    void (*func)(VsyncClient *client, uint32_t displayId);
+    VsyncClient *client;
+};
+
+void onClientVsync(VsyncClient *client, uint32_t) {
+    client->vsyncs++;
+}
+
+} // namespace
+
+TEST(EpochPointerTest, PublishFreesOldObject) {
+    {
+        EpochPointer<Table> pointer(new Table(0));
+        {
+            EpochPointer<Table>::Reader table(pointer);
+            EXPECT_EQ(0u, table->id);
+        }
+        pointer.publish(new Table(1));
+        EXPECT_EQ(1, gLiveTables);
+        EXPECT_EQ(1u, pointer.current().id);
+
+        EpochPointer<Table>::Reader table(pointer);
+        EXPECT_EQ(1u, table->id);
+    }
+    EXPECT_EQ(0, gLiveTables);
+}
+
+// readers never see a freed or torn table while the tables are replaced
+TEST(EpochPointerTest, ReadersAgainstRepublish) {
+    constexpr int kNumReaders = 4;
+    constexpr uint32_t kNumPublishes = 5000;
+    EpochPointer<Table> pointer(new Table(0));
+    std::atomic<bool> done = false;
+    std::atomic<int> startedReaders = 0;
+    std::atomic<uint32_t> lastReadId = 0;
+    std::atomic<uint64_t> reads = 0;
+    std::atomic<uint64_t> badReads = 0;
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kNumReaders; i++) {
+        readers.emplace_back([&] {
+            uint32_t lastId = 0;
+            bool started = false;
+            while (!done) {
+                {
+                    EpochPointer<Table>::Reader table(pointer);
+                    /* a table is only replaced by a newer one */
+                    if (table->state != kAlive || table->id != table->copy || table->id < lastId)
+                        badReads++;
+                    lastId = table->id;
+                }
+                lastReadId = lastId;
+                reads++;
+                if (!started) {
+                    started = true;
+                    startedReaders++;
+                }
+                /* lets the publisher run between the reads on a single CPU */
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    /* every reader is in its loop before the first table is replaced */
+    while (startedReaders < kNumReaders) std::this_thread::yield();
+    for (uint32_t id = 1; id <= kNumPublishes; id++) {
+        pointer.publish(new Table(id));
+        /* the next table replaces this one only after a reader got it */
+        while (lastReadId < id) std::this_thread::yield();
+    }
+    done = true;
+    for (auto &reader : readers) reader.join();
+
+    EXPECT_EQ(0u, badReads);
+    EXPECT_GE(reads, kNumPublishes + kNumReaders);
+    EXPECT_EQ(1, gLiveTables);
+    EXPECT_EQ(kNumPublishes, pointer.current().id);
+}
+
+// the client sees the last hotplug state while the hotplug callback is registered again
+TEST(EpochPointerTest, HotplugAgainstRegistration) {
+    constexpr int kNumRounds = 1000;
+
+    for (int round = 0; round < kNumRounds; round++) {
+        FakeDevice device;
+        std::atomic<int> clientState = -1;
+        device.hotplug(true);
+        std::thread hotplug([&] {
+            for (int i = 0; i < 8; i++) device.hotplug(i % 2 == 0);
+            std::this_thread::sleep_for(std::chrono::microseconds(round % 100));
+            device.hotplug(round % 2 == 0);
+        });
+        device.registerCallback([&](bool connected) { clientState = connected; });
+        hotplug.join();
+
+        /* the registration reports nothing for a display which is not plugged */
+        if (clientState != -1) ASSERT_EQ(round % 2 == 0, clientState == 1) << "round " << round;
+        else ASSERT_FALSE(round % 2 == 0) << "round " << round;
+    }
+}
+
+// 3 displays deliver vsyncs at 240 Hz while the vsync callback is registered again
+TEST(EpochPointerTest, VsyncAgainstRegistration) {
+    constexpr int kNumDisplays = 3;
+    constexpr int kNumVsyncs = 240;
+    constexpr auto kVsyncPeriod = std::chrono::nanoseconds(1'000'000'000 / 240);
+    VsyncClient clients[2];
+    EpochPointer<VsyncTable> pointer(new VsyncTable(onClientVsync, &clients[0]));
+    std::atomic<bool> done = false;
+    std::atomic<uint64_t> badReads = 0;
+    std::atomic<uint64_t> registrations = 0;
+    LatencyHistogram histograms[kNumDisplays];
+
+    std::thread registration([&] {
+        for (int i = 1; !done; i++) {
+            pointer.publish(new VsyncTable(onClientVsync, &clients[i % 2]));
+            registrations++;
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> displays;
+    for (int display = 0; display < kNumDisplays; display++) {
+        displays.emplace_back([&, display] {
+            auto vsync = std::chrono::steady_clock::now();
+            for (int i = 0; i < kNumVsyncs; i++) {
+                vsync += kVsyncPeriod;
+                std::this_thread::sleep_until(vsync);
+                /* the event path of ExynosDevice::onVsync() */
+                auto start = std::chrono::steady_clock::now();
+                {
+                    EpochPointer<VsyncTable>::Reader table(pointer);
+                    if (table->state != kAlive) badReads++;
+                    table->func(table->client, display);
+                }
+                histograms[display].add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                std::chrono::steady_clock::now() - start)
+                                                .count());
+            }
+        });
+    }
+    for (auto &display : displays) display.join();
+    done = true;
+    registration.join();
+
+    LatencyHistogram all;
+    for (auto &histogram : histograms) {
+        EXPECT_EQ(kNumVsyncs, histogram.count());
+        all.merge(histogram);
+    }
+    all.record("Vsync");
+    EXPECT_EQ(0u, badReads);
+    EXPECT_GT(registrations, 0u);
+    /* no vsync is lost to a registration */
+    EXPECT_EQ(kNumDisplays * kNumVsyncs, clients[0].vsyncs + clients[1].vsyncs);
+}
+
+// reports the time a reader takes to enter and leave while the table is replaced
+TEST(EpochPointerTest, ReaderLatency) {
+    constexpr int kNumReads = 200000;
+    EpochPointer<Table> pointer(new Table(0));
+    std::atomic<bool> done = false;
+
+    std::thread writer([&] {
+        for (uint32_t id = 1; !done; id++) {
+            pointer.publish(new Table(id));
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+
+    LatencyHistogram histogram;
+    uint64_t badReads = 0;
+    for (int i = 0; i < kNumReads; i++) {
+        auto start = std::chrono::steady_clock::now();
+        {
+            EpochPointer<Table>::Reader table(pointer);
+            if (table->state != kAlive) badReads++;
+        }
+        histogram.add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+    }
+    done = true;
+    writer.join();
+
+    EXPECT_EQ(0u, badReads);
+    EXPECT_EQ(kNumReads, histogram.count());
+    histogram.record("Reader");
+}
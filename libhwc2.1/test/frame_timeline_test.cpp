@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "libdevice/FrameTimeline.h"
+
+namespace {
+
+using Stage = FrameTimeline::Stage;
+
+struct Frame {
+    uint64_t frame;
+    nsecs_t time[FrameTimeline::kNumStages];
+};
+
+std::vector<Frame> exportFrames(const FrameTimeline &timeline) {
+    std::vector<uint8_t> out;
+    timeline.exportBinary(out);
+
+    FrameTimeline::ExportHeader header;
+    EXPECT_GE(out.size(), sizeof(header));
+    std::memcpy(&header, out.data(), sizeof(header));
+    EXPECT_EQ(FrameTimeline::kExportMagic, header.magic);
+    EXPECT_EQ(FrameTimeline::kNumStages, header.numStages);
+    EXPECT_EQ(sizeof(header) + header.count * sizeof(Frame), out.size());
+
+    std::vector<Frame> frames(header.count);
+    std::memcpy(frames.data(), out.data() + sizeof(header), header.count * sizeof(Frame));
+    return frames;
+}
+
+nsecs_t timeOf(const Frame &frame, Stage stage) {
+    return frame.time[static_cast<size_t>(stage)];
+}
+
+} // namespace
+
+TEST(FrameTimelineTest, EndFrameWithoutOpenFrame) {
+    FrameTimeline timeline;
+    EXPECT_FALSE(timeline.endFrame().has_value());
+
+    // the first frame is frame 0
+    timeline.beginFrame();
+    EXPECT_EQ(std::optional<uint64_t>(0), timeline.endFrame());
+    EXPECT_FALSE(timeline.endFrame().has_value());
+
+    timeline.beginFrame();
+    EXPECT_EQ(std::optional<uint64_t>(1), timeline.endFrame());
+}
+
+TEST(FrameTimelineTest, ValidationAndPresentShareFrame) {
+    FrameTimeline timeline;
+    timeline.beginFrame();
+    timeline.stamp(Stage::VALIDATE_START, 100);
+    timeline.stamp(Stage::VALIDATE_END, 200);
+    // the present does not start another frame
+    timeline.beginFrame();
+    timeline.stamp(Stage::PRESENT_START, 300);
+    timeline.stamp(Stage::RELEASE, 400);
+    ASSERT_EQ(std::optional<uint64_t>(0), timeline.endFrame());
+    // ignored without an open frame
+    timeline.stamp(Stage::PRESENT_START, 500);
+
+    std::vector<Frame> frames = exportFrames(timeline);
+    ASSERT_EQ(1u, frames.size());
+    EXPECT_EQ(100, timeOf(frames[0], Stage::VALIDATE_START));
+    EXPECT_EQ(300, timeOf(frames[0], Stage::PRESENT_START));
+    EXPECT_EQ(400, timeOf(frames[0], Stage::RELEASE));
+    EXPECT_EQ(0, timeOf(frames[0], Stage::COMMIT_DONE));
+}
+
+// presentDisplay() returns early on a dropped frame, after the validation opened its record
+TEST(FrameTimelineTest, SkippedPresentDoesNotMergeFrames) {
+    FrameTimeline timeline;
+    timeline.beginFrame();
+    timeline.stamp(Stage::VALIDATE_START, 100);
+    timeline.stamp(Stage::VALIDATE_END, 200);
+    // the skipped present closes the frame without a retire
+    ASSERT_TRUE(timeline.endFrame().has_value());
+
+    timeline.beginFrame();
+    timeline.stamp(Stage::VALIDATE_START, 1000);
+    timeline.stamp(Stage::VALIDATE_END, 1100);
+    timeline.beginFrame();
+    timeline.stamp(Stage::PRESENT_START, 1200);
+    std::optional<uint64_t> presented = timeline.endFrame();
+    ASSERT_EQ(std::optional<uint64_t>(1), presented);
+    timeline.stampRetire(*presented, 1500);
+
+    std::vector<Frame> frames = exportFrames(timeline);
+    ASSERT_EQ(2u, frames.size());
+    EXPECT_EQ(200, timeOf(frames[0], Stage::VALIDATE_END));
+    EXPECT_EQ(0, timeOf(frames[0], Stage::PRESENT_START));
+    EXPECT_EQ(0, timeOf(frames[0], Stage::RETIRE_SIGNALED));
+    EXPECT_EQ(1000, timeOf(frames[1], Stage::VALIDATE_START));
+    EXPECT_EQ(1200, timeOf(frames[1], Stage::PRESENT_START));
+    EXPECT_EQ(1500, timeOf(frames[1], Stage::RETIRE_SIGNALED));
+}
+
+TEST(FrameTimelineTest, RetireOfOverwrittenFrameIsIgnored) {
+    FrameTimeline timeline;
+    for (size_t i = 0; i <= FrameTimeline::kNumRecords; i++) {
+        timeline.beginFrame();
+        timeline.stamp(Stage::VALIDATE_START, i + 1);
+        timeline.endFrame();
+    }
+    timeline.stampRetire(0, 5000);
+
+    std::vector<Frame> frames = exportFrames(timeline);
+    ASSERT_EQ(FrameTimeline::kNumRecords, frames.size());
+    EXPECT_EQ(1u, frames.front().frame);
+    for (const Frame &frame : frames) EXPECT_EQ(0, timeOf(frame, Stage::RETIRE_SIGNALED));
+}
+
+TEST(FrameTimelineTest, ReadersSeeCompleteFrames) {
+    static constexpr int kFrames = 20000;
+    FrameTimeline timeline;
+    std::atomic<bool> done{false};
+
+    std::thread reader([&]() {
+        while (!done.load()) {
+            for (const Frame &frame : exportFrames(timeline)) {
+                // written together by the composition thread
+                ASSERT_EQ(timeOf(frame, Stage::VALIDATE_START) + 10,
+                          timeOf(frame, Stage::VALIDATE_END));
+                ASSERT_EQ(static_cast<nsecs_t>(frame.frame) + 1,
+                          timeOf(frame, Stage::VALIDATE_START));
+            }
+            android::String8 result;
+            timeline.dump(result);
+        }
+    });
+
+    for (int i = 0; i < kFrames; i++) {
+        timeline.beginFrame();
+        timeline.stamp(Stage::VALIDATE_START, i + 1);
+        timeline.stamp(Stage::VALIDATE_END, i + 11);
+        timeline.endFrame();
+    }
+    done = true;
+    reader.join();
+}
+
+TEST(FrameTimelineTest, DumpReportsNearestRankPercentiles) {
+    static constexpr nsecs_t kUs = 1000;
+    static constexpr int kFrames = 100;
+    FrameTimeline timeline;
+    for (int i = 0; i < kFrames; i++) {
+        nsecs_t start = (i + 1) * 100000 * kUs;
+        timeline.beginFrame();
+        // validations of 1..100 us, in a shuffled order
+        timeline.stamp(Stage::VALIDATE_START, start);
+        timeline.stamp(Stage::VALIDATE_END, start + ((i * 37) % kFrames + 1) * kUs);
+        // 19 presents of 1 ms and one of 16 ms
+        if (i < 20) {
+            timeline.stamp(Stage::PRESENT_START, start + 200 * kUs);
+            timeline.stamp(Stage::RELEASE, start + (i == 7 ? 16200 : 1200) * kUs);
+        }
+        timeline.endFrame();
+    }
+
+    android::String8 result;
+    timeline.dump(result);
+    // the intervals without both stamps are left out
+    EXPECT_STREQ("Frame timeline: 100 frames (us)\n"
+                 "\tvalidate n  100 p50     50 p90     90 p99     99 max    100\n"
+                 "\tpresent  n   20 p50   1000 p90   1000 p99  16000 max  16000\n",
+                 result.c_str());
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "histogram_buffer.h"
+
+using namespace std::chrono_literals;
+using histogram::HISTOGRAM_BINS_SIZE;
+using histogram::HistogramBuffer;
+
+namespace {
+
+// every bin of the histogram @id holds the low bits of @id, so torn copies are detected
+void publish(HistogramBuffer &buffer, uint64_t id) {
+    char16_t bins[HISTOGRAM_BINS_SIZE];
+    std::fill(std::begin(bins), std::end(bins), static_cast<char16_t>(id));
+    buffer.publish(bins);
+}
+
+bool isConsistent(const uint16_t *bins, uint64_t id) {
+    return std::all_of(bins, bins + HISTOGRAM_BINS_SIZE,
+                       [id](uint16_t bin) { return bin == static_cast<uint16_t>(id); });
+}
+
+} // namespace
+
+TEST(HistogramBufferTest, ReadLatest) {
+    HistogramBuffer buffer;
+    uint16_t bins[HISTOGRAM_BINS_SIZE];
+
+    EXPECT_EQ(0u, buffer.getPublishedId());
+    EXPECT_EQ(0u, buffer.read(bins));
+
+    for (uint64_t id = 1; id <= 3; id++) publish(buffer, id);
+
+    EXPECT_EQ(3u, buffer.getPublishedId());
+    EXPECT_EQ(3u, buffer.read(bins));
+    EXPECT_TRUE(isConsistent(bins, 3));
+}
+
+TEST(HistogramBufferTest, WaitNewerTimesOut) {
+    HistogramBuffer buffer;
+    uint16_t bins[HISTOGRAM_BINS_SIZE];
+
+    publish(buffer, 1);
+    EXPECT_EQ(1u, buffer.waitNewer(0, 0ms, bins));
+    EXPECT_EQ(0u, buffer.waitNewer(1, 10ms, bins));
+}
+
+TEST(HistogramBufferTest, WaitNewerWaitsForNextHistogram) {
+    HistogramBuffer buffer;
+    uint16_t bins[HISTOGRAM_BINS_SIZE];
+
+    publish(buffer, 1);
+    std::thread publisher([&buffer]() {
+        std::this_thread::sleep_for(5ms);
+        publish(buffer, 2);
+    });
+
+    // the histogram already published is older than the request
+    EXPECT_EQ(2u, buffer.waitNewer(1, 1s, bins));
+    EXPECT_TRUE(isConsistent(bins, 2));
+    publisher.join();
+}
+
+/*
+ * Publishes the histograms at 120 Hz while several clients poll them as fast as they can,
+ * waiting for the next histogram like collectRoiLuma() or reading the latest one, and
+ * reports how long a reader is held by the read itself.
+ */
+TEST(HistogramBufferTest, ReaderLatency) {
+    static constexpr int kNumWaiters = 2;
+    static constexpr int kNumPollers = 2;
+    static constexpr auto kPeriod = std::chrono::nanoseconds(1s) / 120;
+    static constexpr int kNumHistograms = 60;
+
+    HistogramBuffer buffer;
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<int> stale{0};
+
+    std::vector<std::thread> readers;
+    std::vector<uint64_t> numWaits(kNumWaiters);
+    for (int i = 0; i < kNumWaiters; i++) {
+        readers.emplace_back([&, i]() {
+            uint16_t bins[HISTOGRAM_BINS_SIZE];
+            while (!done) {
+                const uint64_t requested = buffer.getPublishedId();
+                const uint64_t id = buffer.waitNewer(requested, 100ms, bins);
+                if (id == 0) continue;
+                if (id <= requested) stale++;
+                if (!isConsistent(bins, id)) torn++;
+                numWaits[i]++;
+            }
+        });
+    }
+
+    std::vector<uint64_t> numPolls(kNumPollers);
+    std::vector<std::chrono::nanoseconds> maxPoll(kNumPollers);
+    std::vector<std::chrono::nanoseconds> totalPoll(kNumPollers);
+    for (int i = 0; i < kNumPollers; i++) {
+        readers.emplace_back([&, i]() {
+            uint16_t bins[HISTOGRAM_BINS_SIZE];
+            while (!done) {
+                const auto begin = std::chrono::steady_clock::now();
+                const uint64_t id = buffer.read(bins);
+                const auto elapsed = std::chrono::steady_clock::now() - begin;
+                if (!isConsistent(bins, id)) torn++;
+                maxPoll[i] = std::max(maxPoll[i], elapsed);
+                totalPoll[i] += elapsed;
+                numPolls[i]++;
+            }
+        });
+    }
+
+    // the event source
+    auto next = std::chrono::steady_clock::now();
+    for (uint64_t id = 1; id <= kNumHistograms; id++) {
+        next += kPeriod;
+        std::this_thread::sleep_until(next);
+        publish(buffer, id);
+    }
+    done = true;
+    for (auto &reader : readers) reader.join();
+
+    EXPECT_EQ(0, torn);
+    EXPECT_EQ(0, stale);
+    for (int i = 0; i < kNumWaiters; i++) EXPECT_GT(numWaits[i], 0u);
+
+    std::chrono::nanoseconds maxLatency(0), totalLatency(0);
+    uint64_t polls = 0;
+    for (int i = 0; i < kNumPollers; i++) {
+        maxLatency = std::max(maxLatency, maxPoll[i]);
+        totalLatency += totalPoll[i];
+        polls += numPolls[i];
+    }
+    ASSERT_GT(polls, 0u);
+
+    const long avgNs = totalLatency.count() / static_cast<long>(polls);
+    RecordProperty("poll_avg_ns", avgNs);
+    RecordProperty("poll_max_ns", static_cast<long>(maxLatency.count()));
+    std::cout << polls << " polls: " << avgNs << " ns avg, " << maxLatency.count()
+              << " ns max" << std::endl;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "libdevice/PendingConfigSwitch.h"
+
+namespace {
+
+using State = hwc_request_state_t;
+
+/*
+ * The config switches of ExynosDisplay: setActiveConfigWithConstraints() makes a switch
+ * pending or drops it, the present requests the pending switch to the display, and the
+ * switch is done once the display applied it.
+ */
+class ConfigSwitchReplay {
+  public:
+    explicit ConfigSwitchReplay(hwc2_config_t config) : mActive(config), mApplied(config) {}
+
+    // returns true if the switch to @config dropped the pending switch
+    bool setActiveConfig(hwc2_config_t config) {
+        if (mPending.isSupersededBy(mState, config)) {
+            mState = State::SET_CONFIG_STATE_DONE;
+            mActive = config;
+            return true;
+        }
+        mPending.onPending(mState, mActive);
+        mState = State::SET_CONFIG_STATE_PENDING;
+        mActive = config;
+        return false;
+    }
+
+    void present() {
+        if (mState == State::SET_CONFIG_STATE_PENDING) {
+            mState = State::SET_CONFIG_STATE_REQUESTED;
+            mRequested = mActive;
+            mInFlight = true;
+            mNumRequests++;
+        }
+    }
+
+    // the display applied the config requested last
+    void applied() {
+        if (!mInFlight) return;
+        mInFlight = false;
+        mApplied = mRequested;
+        if (mState == State::SET_CONFIG_STATE_REQUESTED) mState = State::SET_CONFIG_STATE_DONE;
+    }
+
+    State state() const { return mState; }
+    hwc2_config_t active() const { return mActive; }
+    hwc2_config_t appliedConfig() const { return mApplied; }
+    int numRequests() const { return mNumRequests; }
+
+  private:
+    PendingConfigSwitch mPending;
+    State mState = State::SET_CONFIG_STATE_DONE;
+    hwc2_config_t mActive;
+    hwc2_config_t mApplied;
+    hwc2_config_t mRequested = 0;
+    bool mInFlight = false;
+    int mNumRequests = 0;
+};
+
+} // namespace
+
+TEST(PendingConfigSwitchTest, SwitchBackBeforePresentIsDropped) {
+    ConfigSwitchReplay display(0);
+
+    EXPECT_FALSE(display.setActiveConfig(1));
+    EXPECT_EQ(State::SET_CONFIG_STATE_PENDING, display.state());
+    EXPECT_TRUE(display.setActiveConfig(0));
+    EXPECT_EQ(State::SET_CONFIG_STATE_DONE, display.state());
+    EXPECT_EQ(0u, display.active());
+
+    display.present();
+    EXPECT_EQ(0, display.numRequests());
+}
+
+TEST(PendingConfigSwitchTest, SupersededAfterSeveralPendingSwitches) {
+    ConfigSwitchReplay display(0);
+
+    EXPECT_FALSE(display.setActiveConfig(1));
+    EXPECT_FALSE(display.setActiveConfig(2));
+    // the config applied is still the one before the first pending switch
+    EXPECT_TRUE(display.setActiveConfig(0));
+    EXPECT_EQ(State::SET_CONFIG_STATE_DONE, display.state());
+
+    display.present();
+    EXPECT_EQ(0, display.numRequests());
+}
+
+TEST(PendingConfigSwitchTest, PendingConfigIsNotSuperseded) {
+    ConfigSwitchReplay display(0);
+
+    EXPECT_FALSE(display.setActiveConfig(1));
+    EXPECT_FALSE(display.setActiveConfig(1));
+    EXPECT_FALSE(display.setActiveConfig(2));
+    EXPECT_EQ(State::SET_CONFIG_STATE_PENDING, display.state());
+
+    display.present();
+    display.applied();
+    EXPECT_EQ(1, display.numRequests());
+    EXPECT_EQ(2u, display.appliedConfig());
+}
+
+// the config requested to the display might not be applied yet, so nothing is dropped
+TEST(PendingConfigSwitchTest, NotSupersededWhileRequested) {
+    ConfigSwitchReplay display(0);
+
+    display.setActiveConfig(1);
+    display.present();
+    ASSERT_EQ(State::SET_CONFIG_STATE_REQUESTED, display.state());
+
+    EXPECT_FALSE(display.setActiveConfig(2));
+    EXPECT_FALSE(display.setActiveConfig(0));
+    EXPECT_FALSE(display.setActiveConfig(1));
+    EXPECT_EQ(State::SET_CONFIG_STATE_PENDING, display.state());
+
+    display.applied();
+    display.present();
+    display.applied();
+    EXPECT_EQ(2, display.numRequests());
+    EXPECT_EQ(1u, display.appliedConfig());
+}
+
+// the config before a pending switch is taken again once the previous switch is done
+TEST(PendingConfigSwitchTest, SupersededAfterSwitchIsDone) {
+    ConfigSwitchReplay display(0);
+
+    display.setActiveConfig(1);
+    display.present();
+    display.applied();
+    ASSERT_EQ(1u, display.appliedConfig());
+
+    EXPECT_FALSE(display.setActiveConfig(0));
+    EXPECT_FALSE(display.setActiveConfig(2));
+    EXPECT_TRUE(display.setActiveConfig(1));
+    display.present();
+    EXPECT_EQ(1, display.numRequests());
+    EXPECT_EQ(1u, display.appliedConfig());
+}
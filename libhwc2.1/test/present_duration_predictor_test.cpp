@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "libdevice/PresentDurationPredictor.h"
+
+namespace {
+
+using Features = PresentDurationPredictor::Features;
+
+// a synthetic present duration, linear in the composition of the frame
+nsecs_t getDuration(const Features &features, nsecs_t clientCost) {
+    return us2ns(800) + features.layers * us2ns(60) + features.m2mLayers * us2ns(400) +
+            (features.clientComposition ? clientCost : 0) +
+            static_cast<nsecs_t>(features.srcPixels / 100) +
+            (features.geometryChanged ? us2ns(700) : 0);
+}
+
+// replays frames of a UI which switches between a few compositions
+class Replay {
+  public:
+    Features nextFrame() {
+        Features features;
+        features.layers = 2 + mRandom() % 8;
+        features.m2mLayers = (mRandom() % 4 == 0) ? 1 : 0;
+        features.deviceLayers = features.layers - features.m2mLayers;
+        features.clientComposition = mRandom() % 5 == 0;
+        if (features.clientComposition) features.deviceLayers -= 1;
+        features.srcPixels = static_cast<uint64_t>(features.layers) * 1080 * 600;
+        features.geometryChanged = mRandom() % 10 == 0;
+        features.refreshRate = 120;
+        return features;
+    }
+    // the noise of the measured durations
+    nsecs_t noise() { return mNoise(mRandom); }
+
+  private:
+    std::mt19937 mRandom{42};
+    std::uniform_int_distribution<nsecs_t> mNoise{-us2ns(100), us2ns(100)};
+};
+
+// trains @predictor with @numFrames frames of @replay and returns the ratio of the frames
+// predicted within @tolerance
+double replay(PresentDurationPredictor &predictor, Replay &replay, size_t numFrames,
+              nsecs_t clientCost, nsecs_t tolerance) {
+    size_t numPredicted = 0;
+    size_t numAccurate = 0;
+    for (size_t i = 0; i < numFrames; i++) {
+        const Features features = replay.nextFrame();
+        const std::optional<nsecs_t> predicted = predictor.predict(features, true);
+        const nsecs_t actual = getDuration(features, clientCost) + replay.noise();
+        if (predicted.has_value()) {
+            numPredicted++;
+            if (std::abs(*predicted - actual) < tolerance) numAccurate++;
+            predictor.recordError(*predicted, actual);
+        }
+        predictor.update(features, true, actual);
+    }
+    return numPredicted ? static_cast<double>(numAccurate) / numPredicted : 0;
+}
+
+TEST(PresentDurationPredictorTest, NoPredictionUntilTrained) {
+    PresentDurationPredictor predictor;
+    Replay frames;
+    Features features = frames.nextFrame();
+
+    for (int i = 0; i < 15; i++) {
+        predictor.update(features, true, getDuration(features, ms2ns(2)));
+        EXPECT_FALSE(predictor.predict(features, true).has_value());
+    }
+    predictor.update(features, true, getDuration(features, ms2ns(2)));
+    EXPECT_TRUE(predictor.predict(features, true).has_value());
+    // the frames which skip validation have their own model
+    EXPECT_FALSE(predictor.predict(features, false).has_value());
+}
+
+TEST(PresentDurationPredictorTest, ReplayIsPredictedWithinTheNoise) {
+    PresentDurationPredictor predictor;
+    Replay frames;
+
+    replay(predictor, frames, 200, ms2ns(2), us2ns(250));
+    // the noise is +-100us, so a trained model predicts the frames within 250us
+    EXPECT_GE(replay(predictor, frames, 1000, ms2ns(2), us2ns(250)), 0.98);
+}
+
+TEST(PresentDurationPredictorTest, ReplayFollowsWorkloadChange) {
+    PresentDurationPredictor predictor;
+    Replay frames;
+
+    replay(predictor, frames, 500, ms2ns(2), us2ns(250));
+    // the client composition gets slower, e.g. the GPU clock drops
+    replay(predictor, frames, 1000, ms2ns(5), us2ns(250));
+    EXPECT_GE(replay(predictor, frames, 1000, ms2ns(5), us2ns(250)), 0.98);
+}
+
+} // namespace
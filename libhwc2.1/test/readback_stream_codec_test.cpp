@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "libdevice/ReadbackStreamCodec.h"
+
+namespace {
+
+constexpr size_t kWidth = 1080;
+constexpr size_t kHeight = 240;
+constexpr size_t kWords = kWidth * kHeight;
+
+// a frame with a gradient background and a moving box, like a scrolling list
+std::vector<uint32_t> makeFrame(uint32_t index) {
+    std::vector<uint32_t> frame(kWords);
+    for (size_t y = 0; y < kHeight; y++) {
+        for (size_t x = 0; x < kWidth; x++) frame[y * kWidth + x] = 0xff000000 | (y << 8) | x;
+    }
+    const size_t left = (index * 16) % (kWidth - 100);
+    for (size_t y = 40; y < 140; y++) {
+        for (size_t x = left; x < left + 100; x++) frame[y * kWidth + x] = 0xffffffff - index;
+    }
+    return frame;
+}
+
+} // namespace
+
+TEST(ReadbackStreamCodecTest, KeyFrameRoundTrip) {
+    std::vector<uint32_t> frame = makeFrame(0);
+    std::vector<uint32_t> prev(kWords, 0);
+    std::vector<uint32_t> payload;
+
+    ReadbackStreamCodec::encode(frame.data(), prev.data(), kWords, payload);
+    EXPECT_EQ(frame, prev);
+
+    std::vector<uint32_t> decoded(kWords, 0);
+    ASSERT_TRUE(ReadbackStreamCodec::decode(payload.data(), payload.size(), decoded.data(),
+                                            kWords));
+    EXPECT_EQ(frame, decoded);
+}
+
+TEST(ReadbackStreamCodecTest, UnchangedFrameIsEmpty) {
+    std::vector<uint32_t> frame = makeFrame(3);
+    std::vector<uint32_t> prev = frame;
+    std::vector<uint32_t> payload = {1, 2, 3};
+
+    ReadbackStreamCodec::encode(frame.data(), prev.data(), kWords, payload);
+    EXPECT_TRUE(payload.empty());
+}
+
+TEST(ReadbackStreamCodecTest, DeltaFramesRoundTrip) {
+    std::vector<uint32_t> prev(kWords, 0);
+    std::vector<uint32_t> decoded(kWords, 0);
+    std::vector<uint32_t> payload;
+    size_t rawBytes = 0;
+    size_t codedBytes = 0;
+
+    for (uint32_t index = 0; index < 30; index++) {
+        std::vector<uint32_t> frame = makeFrame(index);
+        ReadbackStreamCodec::encode(frame.data(), prev.data(), kWords, payload);
+        ASSERT_TRUE(ReadbackStreamCodec::decode(payload.data(), payload.size(), decoded.data(),
+                                                kWords));
+        ASSERT_EQ(frame, decoded) << "frame " << index;
+
+        rawBytes += kWords * sizeof(uint32_t);
+        codedBytes += sizeof(ReadbackStreamCodec::FrameHeader) + payload.size() * sizeof(uint32_t);
+    }
+    std::cout << "compression " << static_cast<double>(rawBytes) / codedBytes << ":1" << std::endl;
+    RecordProperty("CompressionRatio", static_cast<int>(rawBytes / codedBytes));
+}
+
+TEST(ReadbackStreamCodecTest, RandomChangesRoundTrip) {
+    std::mt19937 rng(0);
+    std::vector<uint32_t> frame(kWords, 0);
+    std::vector<uint32_t> prev(kWords, 0);
+    std::vector<uint32_t> decoded(kWords, 0);
+    std::vector<uint32_t> payload;
+
+    for (int index = 0; index < 20; index++) {
+        // short and long runs of changes, including at both ends of the frame
+        frame.front() = rng();
+        frame.back() = rng();
+        for (int i = 0; i < 200; i++) {
+            size_t start = rng() % kWords;
+            size_t length = std::min<size_t>(1 + rng() % 9, kWords - start);
+            for (size_t k = start; k < start + length; k++) frame[k] = rng();
+        }
+        ReadbackStreamCodec::encode(frame.data(), prev.data(), kWords, payload);
+        ASSERT_TRUE(ReadbackStreamCodec::decode(payload.data(), payload.size(), decoded.data(),
+                                                kWords));
+        ASSERT_EQ(frame, decoded) << "frame " << index;
+    }
+}
+
+TEST(ReadbackStreamCodecTest, CorruptedPayloadIsRejected) {
+    std::vector<uint32_t> frame(16, 0);
+
+    const std::vector<uint32_t> truncatedRun = {0};
+    EXPECT_FALSE(ReadbackStreamCodec::decode(truncatedRun.data(), truncatedRun.size(),
+                                             frame.data(), frame.size()));
+    const std::vector<uint32_t> pastFrame = {10, 7, 1, 2, 3, 4, 5, 6, 7};
+    EXPECT_FALSE(ReadbackStreamCodec::decode(pastFrame.data(), pastFrame.size(), frame.data(),
+                                             frame.size()));
+    const std::vector<uint32_t> missingWords = {0, 4, 1, 2};
+    EXPECT_FALSE(ReadbackStreamCodec::decode(missingWords.data(), missingWords.size(),
+                                             frame.data(), frame.size()));
+}
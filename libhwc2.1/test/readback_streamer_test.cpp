@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "libdevice/ReadbackStreamer.h"
+
+namespace {
+
+constexpr uint32_t kFormat = 1; // RGBA_8888
+constexpr uint32_t kWidth = 64;
+constexpr uint32_t kHeight = 32;
+constexpr size_t kWords = kWidth * kHeight;
+
+// a display whose readback is done when the test signals the fence of the frame
+class FakeDisplay : public ReadbackStreamer::Display {
+  public:
+    enum class FenceState { PENDING, SIGNALED, TIMED_OUT };
+
+    struct Buffer {
+        std::vector<uint32_t> pixels = std::vector<uint32_t>(kWords);
+    };
+
+    uint32_t getBitsPerPixel(uint32_t format) const override {
+        return (format == kFormat) ? 32 : 16;
+    }
+
+    buffer_handle_t allocateBuffer(uint32_t, uint32_t, uint32_t) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBuffers.push_back(std::make_unique<Buffer>());
+        return reinterpret_cast<buffer_handle_t>(mBuffers.back().get());
+    }
+
+    void freeBuffer(buffer_handle_t buffer) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFreedBuffers.push_back(buffer);
+    }
+
+    int waitFence(int32_t fence, int timeoutMs) override {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                            [&] { return mFences[fence] != FenceState::PENDING; });
+        return (mFences[fence] == FenceState::SIGNALED) ? 0 : -ETIME;
+    }
+
+    void closeFence(int32_t fence) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFences.erase(fence);
+    }
+
+    Mapping mapBuffer(buffer_handle_t buffer) override {
+        auto *b = reinterpret_cast<const Buffer *>(buffer);
+        Mapping mapping;
+        mapping.data = b->pixels.data();
+        mapping.size = b->pixels.size() * sizeof(uint32_t);
+        mapping.stride = kWidth;
+        mapping.vstride = kHeight;
+        return mapping;
+    }
+
+    void unmapBuffer(const Mapping &) override {}
+
+    nsecs_t now() const override { return 0; }
+
+    // the display reads the frame @pixel back into @buffer, which is done once @fence signals
+    int32_t readback(buffer_handle_t buffer, uint32_t pixel) {
+        auto *b = reinterpret_cast<Buffer *>(const_cast<native_handle_t *>(buffer));
+        std::fill(b->pixels.begin(), b->pixels.end(), pixel);
+        std::lock_guard<std::mutex> lock(mMutex);
+        const int32_t fence = mNextFence++;
+        mFences[fence] = FenceState::PENDING;
+        return fence;
+    }
+
+    void signal(int32_t fence, FenceState state = FenceState::SIGNALED) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFences[fence] = state;
+        }
+        mCondition.notify_all();
+    }
+
+    size_t openFences() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFences.size();
+    }
+
+    std::vector<buffer_handle_t> freedBuffers() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFreedBuffers;
+    }
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<std::unique_ptr<Buffer>> mBuffers;
+    std::vector<buffer_handle_t> mFreedBuffers;
+    std::map<int32_t, FenceState> mFences;
+    int32_t mNextFence = 100;
+};
+
+// lends the fake display to the streamer, which destroys its display with it
+class DisplayProxy : public ReadbackStreamer::Display {
+  public:
+    explicit DisplayProxy(std::shared_ptr<FakeDisplay> display) : mDisplay(std::move(display)) {}
+
+    uint32_t getBitsPerPixel(uint32_t format) const override {
+        return mDisplay->getBitsPerPixel(format);
+    }
+    buffer_handle_t allocateBuffer(uint32_t format, uint32_t width, uint32_t height) override {
+        return mDisplay->allocateBuffer(format, width, height);
+    }
+    void freeBuffer(buffer_handle_t buffer) override { mDisplay->freeBuffer(buffer); }
+    int waitFence(int32_t fence, int timeoutMs) override {
+        return mDisplay->waitFence(fence, timeoutMs);
+    }
+    void closeFence(int32_t fence) override { mDisplay->closeFence(fence); }
+    Mapping mapBuffer(buffer_handle_t buffer) override { return mDisplay->mapBuffer(buffer); }
+    void unmapBuffer(const Mapping &mapping) override { mDisplay->unmapBuffer(mapping); }
+    nsecs_t now() const override { return mDisplay->now(); }
+
+  private:
+    const std::shared_ptr<FakeDisplay> mDisplay;
+};
+
+struct DecodedFrame {
+    uint64_t frame;
+    uint32_t pixel;
+};
+
+class ReadbackStreamerTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        char path[] = "/tmp/readback_streamer_testXXXXXX";
+        const int fd = mkstemp(path);
+        ASSERT_GE(fd, 0);
+        close(fd);
+        mPath = path;
+
+        mDisplay = std::make_shared<FakeDisplay>();
+        mStreamer = std::make_unique<ReadbackStreamer>(android::String8("test"),
+                                                       std::make_unique<DisplayProxy>(mDisplay));
+    }
+
+    void TearDown() override { unlink(mPath.c_str()); }
+
+    android::String8 path() const { return android::String8(mPath.c_str()); }
+
+    // waits for the writer to be done with @count frames
+    bool waitForFrames(uint64_t count) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (std::chrono::steady_clock::now() < deadline) {
+            const ReadbackStreamer::Stats stats = mStreamer->getStats();
+            if (stats.written + stats.failed >= count) return true;
+            std::this_thread::yield();
+        }
+        return false;
+    }
+
+    // stops the stream and decodes its file
+    std::vector<DecodedFrame> decodeStream() {
+        mStreamer.reset();
+
+        std::vector<DecodedFrame> frames;
+        FILE *file = fopen(mPath.c_str(), "r");
+        if (!file) return frames;
+        std::vector<uint32_t> image(kWords, 0);
+        ReadbackStreamCodec::FrameHeader header;
+        while (fread(&header, sizeof(header), 1, file) == 1) {
+            EXPECT_EQ(ReadbackStreamCodec::kFrameMagic, header.magic);
+            std::vector<uint32_t> payload(header.payloadSize / sizeof(uint32_t));
+            if (!payload.empty()) {
+                EXPECT_EQ(1u, fread(payload.data(), header.payloadSize, 1, file));
+            }
+            if (header.flags & ReadbackStreamCodec::kFlagKeyFrame)
+                std::fill(image.begin(), image.end(), 0);
+            EXPECT_TRUE(ReadbackStreamCodec::decode(payload.data(), payload.size(),
+                                                    image.data(), kWords));
+            frames.push_back({header.frame, image[0]});
+            EXPECT_TRUE(std::all_of(image.begin(), image.end(),
+                                    [&](uint32_t p) { return p == image[0]; }))
+                    << "frame " << header.frame;
+        }
+        fclose(file);
+        return frames;
+    }
+
+    std::string mPath;
+    std::shared_ptr<FakeDisplay> mDisplay;
+    std::unique_ptr<ReadbackStreamer> mStreamer;
+};
+
+TEST_F(ReadbackStreamerTest, RejectsUnsupportedFormat) {
+    EXPECT_EQ(-EINVAL, mStreamer->start(kFormat + 1, kWidth, kHeight, 2, path()));
+}
+
+TEST_F(ReadbackStreamerTest, Lifecycle) {
+    ASSERT_EQ(0, mStreamer->start(kFormat, kWidth, kHeight, 2, path()));
+
+    // frame 0 and 1 are armed into the two buffers of the ring
+    buffer_handle_t first = mStreamer->armFrame();
+    ASSERT_NE(nullptr, first);
+    const int32_t fence0 = mDisplay->readback(first, 0xa0);
+    mStreamer->queueFrame(fence0);
+
+    buffer_handle_t second = mStreamer->armFrame();
+    ASSERT_NE(nullptr, second);
+    EXPECT_NE(first, second);
+    const int32_t fence1 = mDisplay->readback(second, 0xa1);
+    mStreamer->queueFrame(fence1);
+
+    // frame 2 is dropped while both buffers wait for their readback
+    EXPECT_EQ(nullptr, mStreamer->armFrame());
+    mStreamer->queueFrame(-1);
+    EXPECT_EQ(1u, mStreamer->getStats().dropped);
+
+    // frame 0 retires and its buffer is reused by frame 3
+    mDisplay->signal(fence0);
+    ASSERT_TRUE(waitForFrames(1));
+    EXPECT_EQ(1u, mStreamer->getStats().written);
+    buffer_handle_t reused = mStreamer->armFrame();
+    EXPECT_EQ(first, reused);
+
+    // the readback of frame 1 times out, frame 3 is read back
+    mDisplay->signal(fence1, FakeDisplay::FenceState::TIMED_OUT);
+    const int32_t fence3 = mDisplay->readback(reused, 0xa3);
+    mStreamer->queueFrame(fence3);
+    mDisplay->signal(fence3);
+    ASSERT_TRUE(waitForFrames(3));
+
+    const ReadbackStreamer::Stats stats = mStreamer->getStats();
+    EXPECT_EQ(3u, stats.armed);
+    EXPECT_EQ(1u, stats.dropped);
+    EXPECT_EQ(2u, stats.written);
+    EXPECT_EQ(1u, stats.failed);
+    EXPECT_EQ(0u, mDisplay->openFences());
+
+    // the buffer of the timed out frame is free again: frame 4 takes the first buffer and
+    // frame 5, which is cancelled, the other one
+    buffer_handle_t next = mStreamer->armFrame();
+    EXPECT_EQ(first, next);
+    const int32_t fence4 = mDisplay->readback(next, 0xa4);
+    mStreamer->queueFrame(fence4);
+    EXPECT_EQ(second, mStreamer->armFrame());
+    mStreamer->queueFrame(-1);
+    EXPECT_EQ(1u, mStreamer->getStats().cancelled);
+    mDisplay->signal(fence4);
+
+    const std::vector<DecodedFrame> frames = decodeStream();
+    ASSERT_EQ(3u, frames.size());
+    EXPECT_EQ(0u, frames[0].frame);
+    EXPECT_EQ(0xa0u, frames[0].pixel);
+    EXPECT_EQ(3u, frames[1].frame);
+    EXPECT_EQ(0xa3u, frames[1].pixel);
+    EXPECT_EQ(4u, frames[2].frame);
+    EXPECT_EQ(0xa4u, frames[2].pixel);
+
+    // the ring is freed with the streamer
+    const std::vector<buffer_handle_t> freed = mDisplay->freedBuffers();
+    ASSERT_EQ(2u, freed.size());
+    EXPECT_EQ(first, freed[0]);
+    EXPECT_EQ(second, freed[1]);
+}
+
+TEST_F(ReadbackStreamerTest, RearmedBufferTakesTheNewFrameNumber) {
+    ASSERT_EQ(0, mStreamer->start(kFormat, kWidth, kHeight, 2, path()));
+
+    // frame 0 is armed but never handed over, frame 1 reads back into the same buffer
+    buffer_handle_t buffer = mStreamer->armFrame();
+    ASSERT_NE(nullptr, buffer);
+    EXPECT_EQ(buffer, mStreamer->armFrame());
+    EXPECT_EQ(1u, mStreamer->getStats().armed);
+
+    const int32_t fence = mDisplay->readback(buffer, 0xb1);
+    mStreamer->queueFrame(fence);
+    mDisplay->signal(fence);
+
+    const std::vector<DecodedFrame> frames = decodeStream();
+    ASSERT_EQ(1u, frames.size());
+    EXPECT_EQ(1u, frames[0].frame);
+    EXPECT_EQ(0xb1u, frames[0].pixel);
+}
+
+TEST_F(ReadbackStreamerTest, StopWritesQueuedFrames) {
+    ASSERT_EQ(0, mStreamer->start(kFormat, kWidth, kHeight, 4, path()));
+
+    std::vector<int32_t> fences;
+    for (uint32_t i = 0; i < 4; i++) {
+        buffer_handle_t buffer = mStreamer->armFrame();
+        ASSERT_NE(nullptr, buffer);
+        fences.push_back(mDisplay->readback(buffer, 0xc0 + i));
+        mStreamer->queueFrame(fences.back());
+    }
+    for (int32_t fence : fences) mDisplay->signal(fence);
+
+    const std::vector<DecodedFrame> frames = decodeStream();
+    ASSERT_EQ(4u, frames.size());
+    for (uint32_t i = 0; i < 4; i++) {
+        EXPECT_EQ(i, frames[i].frame);
+        EXPECT_EQ(0xc0u + i, frames[i].pixel);
+    }
+    EXPECT_EQ(0u, mDisplay->openFences());
+}
+
+} // namespace
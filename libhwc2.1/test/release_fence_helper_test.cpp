@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <new>
+#include <set>
+
+#include "libhwchelper/ReleaseFenceHelper.h"
+
+namespace {
+
+std::atomic<size_t> gAllocations{0};
+
+} // namespace
+
+// counts the allocations of the test binary, not inlined so the compiler does not pair
+// free() with the allocations of the callers
+__attribute__((noinline)) void *operator new(size_t size) {
+    gAllocations++;
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+namespace {
+
+constexpr int kNumLayers = 16;
+constexpr int kPriorityHigh = 3;
+
+struct Layer {
+    bool client = true;
+    int priority = 0;
+    int releaseFence = -1;
+};
+
+size_t countOpenFds() {
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir) return 0;
+    size_t count = 0;
+    while (readdir(dir) != nullptr) count++;
+    closedir(dir);
+    // ".", ".." and the fd of the directory itself
+    return count - 3;
+}
+
+class ReleaseFenceHelperTest : public ::testing::Test {
+  protected:
+    // hands @relFence out to mLayers[@first..@last] like ExynosDisplay::setReleaseFences()
+    int handOut(int &relFence, int first, int last) {
+        return handOutClientReleaseFence(
+                relFence, first, last, [this](int i) { return mLayers[i].client; },
+                [this](int i) { return mLayers[i].priority >= kPriorityHigh; },
+                [this](int fd) {
+                    mDups++;
+                    return (fd >= 0) ? dup(fd) : -1;
+                },
+                [this](int i, int fd) { mLayers[i].releaseFence = fd; });
+    }
+
+    // a device composited layer among the client layers, like a cursor layer
+    void setDeviceLayer(int i) {
+        mLayers[i].client = false;
+        mLayers[i].priority = kPriorityHigh;
+    }
+
+    void closeReleaseFences() {
+        for (auto &layer : mLayers) {
+            if (layer.releaseFence >= 0) close(layer.releaseFence);
+            layer.releaseFence = -1;
+        }
+    }
+
+    ~ReleaseFenceHelperTest() { closeReleaseFences(); }
+
+    std::array<Layer, kNumLayers> mLayers;
+    size_t mDups = 0;
+};
+
+TEST_F(ReleaseFenceHelperTest, LastClientLayerTakesTheFence) {
+    const size_t baseFds = countOpenFds();
+
+    // layers 2 to 13 are composited by the client but layers 5 and 9
+    constexpr int kFirst = 2;
+    constexpr int kLast = 13;
+    setDeviceLayer(5);
+    setDeviceLayer(9);
+    constexpr size_t kNumClients = kLast - kFirst + 1 - 2;
+
+    int relFence = eventfd(0, EFD_CLOEXEC);
+    ASSERT_GE(relFence, 0);
+    const int windowFence = relFence;
+    const size_t fds = countOpenFds();
+    ASSERT_EQ(baseFds + 1, fds);
+
+    // the counter sees the allocations
+    size_t allocations = gAllocations;
+    ::operator delete(::operator new(sizeof(int)));
+    ASSERT_EQ(allocations + 1, gAllocations);
+
+    allocations = gAllocations;
+    EXPECT_EQ(-1, handOut(relFence, kFirst, kLast));
+    EXPECT_EQ(allocations, gAllocations);
+
+    // the last client layer takes the fence of the window without a dup
+    EXPECT_EQ(windowFence, mLayers[kLast].releaseFence);
+    EXPECT_EQ(-1, relFence);
+    EXPECT_EQ(kNumClients - 1, mDups);
+    EXPECT_EQ(fds + kNumClients - 1, countOpenFds());
+
+    // every client layer owns its own fd
+    std::set<int> fences;
+    for (int i = 0; i < kNumLayers; i++) {
+        if ((i < kFirst) || (i > kLast) || !mLayers[i].client) {
+            EXPECT_EQ(-1, mLayers[i].releaseFence) << "layer " << i;
+        } else {
+            EXPECT_GE(mLayers[i].releaseFence, 0) << "layer " << i;
+            fences.insert(mLayers[i].releaseFence);
+        }
+    }
+    EXPECT_EQ(kNumClients, fences.size());
+
+    // no fd is left open once the layers are released
+    closeReleaseFences();
+    EXPECT_EQ(baseFds, countOpenFds());
+}
+
+TEST_F(ReleaseFenceHelperTest, LastLayerOfTheRangeIsNotClient) {
+    setDeviceLayer(kNumLayers - 1);
+
+    int relFence = eventfd(0, EFD_CLOEXEC);
+    ASSERT_GE(relFence, 0);
+    const int windowFence = relFence;
+
+    EXPECT_EQ(-1, handOut(relFence, 0, kNumLayers - 1));
+    EXPECT_EQ(windowFence, mLayers[kNumLayers - 2].releaseFence);
+    EXPECT_EQ(-1, mLayers[kNumLayers - 1].releaseFence);
+    EXPECT_EQ(-1, relFence);
+    EXPECT_EQ(static_cast<size_t>(kNumLayers - 2), mDups);
+}
+
+TEST_F(ReleaseFenceHelperTest, SingleClientLayerIsNotDuplicated) {
+    const size_t baseFds = countOpenFds();
+    int relFence = eventfd(0, EFD_CLOEXEC);
+    ASSERT_GE(relFence, 0);
+    const int windowFence = relFence;
+
+    EXPECT_EQ(-1, handOut(relFence, 7, 7));
+    EXPECT_EQ(windowFence, mLayers[7].releaseFence);
+    EXPECT_EQ(0u, mDups);
+    EXPECT_EQ(baseFds + 1, countOpenFds());
+}
+
+TEST_F(ReleaseFenceHelperTest, WithoutFenceNoFdIsOpened) {
+    // the client layers of the virtual display
+    const size_t baseFds = countOpenFds();
+    int noFence = -1;
+
+    EXPECT_EQ(-1, handOut(noFence, 0, kNumLayers - 1));
+    for (const auto &layer : mLayers) EXPECT_EQ(-1, layer.releaseFence);
+    EXPECT_EQ(baseFds, countOpenFds());
+}
+
+TEST_F(ReleaseFenceHelperTest, StopsAtLayerWhichIsNotClient) {
+    // a device composited layer in the range which may not be skipped
+    mLayers[4].client = false;
+
+    int relFence = eventfd(0, EFD_CLOEXEC);
+    ASSERT_GE(relFence, 0);
+
+    EXPECT_EQ(4, handOut(relFence, 0, kNumLayers - 1));
+    for (int i = 0; i < 4; i++) EXPECT_GE(mLayers[i].releaseFence, 0) << "layer " << i;
+    for (int i = 4; i < kNumLayers; i++) EXPECT_EQ(-1, mLayers[i].releaseFence) << "layer " << i;
+
+    // the fence of the window is still owned by the caller
+    EXPECT_GE(relFence, 0);
+    close(relFence);
+}
+
+} // namespace
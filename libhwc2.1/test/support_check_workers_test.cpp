@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dirent.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "libresource/SupportCheckWorkers.h"
+
+namespace {
+
+constexpr uint32_t kNumThreads = 2;
+
+std::vector<std::string> getThreadNames() {
+    std::vector<std::string> names;
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) return names;
+
+    while (struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        std::ifstream comm(std::string("/proc/self/task/") + entry->d_name + "/comm");
+        std::string name;
+        std::getline(comm, name);
+        names.push_back(name);
+    }
+    closedir(dir);
+
+    return names;
+}
+
+// busy work of a support check of a layer
+uint64_t spin(uint32_t index, int iterations) {
+    uint64_t value = index;
+    for (int i = 0; i < iterations; i++) value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    return value;
+}
+
+TEST(SupportCheckWorkersTest, EveryIndexRunsOnce) {
+    SupportCheckWorkers workers(kNumThreads);
+
+    for (uint32_t count : {0u, 1u, kNumThreads, 8u, 64u}) {
+        std::vector<std::atomic<int>> runs(count);
+        workers.run(count, [&](uint32_t i) { runs[i]++; });
+        for (uint32_t i = 0; i < count; i++) EXPECT_EQ(1, runs[i].load()) << count << ": " << i;
+    }
+}
+
+TEST(SupportCheckWorkersTest, WorkersAreNamed) {
+    auto before = getThreadNames();
+    auto countWorkers = [](const std::vector<std::string> &names) {
+        return std::count_if(names.begin(), names.end(), [](const std::string &name) {
+            return name.rfind("SupportCheck", 0) == 0;
+        });
+    };
+
+    SupportCheckWorkers workers(kNumThreads);
+    EXPECT_EQ(countWorkers(before) + kNumThreads, countWorkers(getThreadNames()));
+}
+
+/*
+ * The latency of checking the layers of a frame on the workers against checking
+ * them serially on the caller.
+ */
+TEST(SupportCheckWorkersTest, RunBenchmark) {
+    constexpr int kNumFrames = 2000;
+    constexpr uint32_t kNumLayers = 16;
+    constexpr int kIterations = 2000;
+    SupportCheckWorkers workers(kNumThreads);
+    std::vector<uint64_t> results(kNumLayers);
+    auto check = [&](uint32_t i) { results[i] = spin(i, kIterations); };
+
+    auto measure = [&](auto &&frame) {
+        std::vector<int64_t> latencies;
+        latencies.reserve(kNumFrames);
+        for (int i = 0; i < kNumFrames; i++) {
+            auto start = std::chrono::steady_clock::now();
+            frame();
+            latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now() - start)
+                                        .count());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        return latencies[latencies.size() / 2];
+    };
+
+    const int64_t serial = measure([&] {
+        for (uint32_t i = 0; i < kNumLayers; i++) check(i);
+    });
+    const int64_t parallel = measure([&] { workers.run(kNumLayers, check); });
+
+    std::cout << kNumLayers << " layers: serial p50 " << serial << " ns, " << kNumThreads
+              << " workers p50 " << parallel << " ns" << std::endl;
+    RecordProperty("SerialP50Ns", static_cast<int>(serial));
+    RecordProperty("WorkersP50Ns", static_cast<int>(parallel));
+}
+
+} // namespace
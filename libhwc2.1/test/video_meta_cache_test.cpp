@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "libdevice/VideoMetaCache.h"
+
+namespace {
+
+// the size of ExynosVideoMeta is about a page
+constexpr size_t kMetaSize = 4096;
+constexpr int kPoolSize = 20;
+
+struct Meta {
+    uint64_t bufferId;
+    uint32_t sequence;
+};
+
+// counts the mappings of the cache
+class CountingMapper : public VideoMetaCache::Mapper {
+  public:
+    explicit CountingMapper(size_t *maps, size_t *unmaps) : mMaps(maps), mUnmaps(unmaps) {}
+
+    void *map(int fd, size_t size) override {
+        (*mMaps)++;
+        return Mapper::map(fd, size);
+    }
+    void unmap(void *addr, size_t size) override {
+        (*mUnmaps)++;
+        Mapper::unmap(addr, size);
+    }
+
+  private:
+    size_t *mMaps;
+    size_t *mUnmaps;
+};
+
+// a pool of video buffers with memfd backed metadata, cycled like a decoder does
+class VideoMetaCacheTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        for (int i = 0; i < kPoolSize; i++) {
+            const int fd = memfd_create("video_meta", MFD_CLOEXEC);
+            ASSERT_GE(fd, 0);
+            ASSERT_EQ(0, ftruncate(fd, kMetaSize));
+            mFds.push_back(fd);
+            writeMeta(i, 0);
+        }
+    }
+
+    void TearDown() override {
+        for (int fd : mFds) close(fd);
+    }
+
+    std::unique_ptr<VideoMetaCache> makeCache(size_t maxMappings = VideoMetaCache::kMaxMappings) {
+        return std::make_unique<VideoMetaCache>(kMetaSize, maxMappings,
+                                                std::make_unique<CountingMapper>(&mMaps,
+                                                                                 &mUnmaps));
+    }
+
+    // the producer fills the metadata of the buffer @i
+    void writeMeta(int i, uint32_t sequence) {
+        const Meta meta = {bufferId(i), sequence};
+        ASSERT_EQ(static_cast<ssize_t>(sizeof(meta)), pwrite(mFds[i], &meta, sizeof(meta), 0));
+    }
+
+    static uint64_t bufferId(int i) { return 1000 + i; }
+
+    // presents the buffer @i in a new frame and validates it @validates times like
+    // ExynosLayer::setLayerBuffer() and doPreProcess(), returns the parsed sequence
+    uint32_t present(VideoMetaCache &cache, int i, int validates = 1, uint64_t id = 0) {
+        cache.nextFrame();
+        uint32_t sequence = UINT32_MAX;
+        for (int v = 0; v < validates; v++) {
+            VideoMetaCache::Mapping *mapping = cache.get(id ? id : bufferId(i), mFds[i]);
+            EXPECT_NE(nullptr, mapping);
+            if (!mapping) return UINT32_MAX;
+            if (cache.checkChanged(mapping)) {
+                EXPECT_EQ(0, v) << "parsed again in the same frame";
+                Meta meta;
+                memcpy(&meta, mapping->addr, sizeof(meta));
+                sequence = meta.sequence;
+            }
+        }
+        return sequence;
+    }
+
+    std::vector<int> mFds;
+    size_t mMaps = 0;
+    size_t mUnmaps = 0;
+};
+
+TEST_F(VideoMetaCacheTest, RotatingPoolIsMappedOnce) {
+    auto cache = makeCache();
+
+    // warm up: every buffer of the pool is mapped once
+    for (int i = 0; i < kPoolSize; i++) present(*cache, i);
+    EXPECT_EQ(static_cast<size_t>(kPoolSize), mMaps);
+    EXPECT_EQ(static_cast<size_t>(kPoolSize), cache->size());
+
+    // steady state: no mapping at all while the decoder cycles the pool
+    mMaps = 0;
+    for (int frame = 0; frame < 10 * kPoolSize; frame++) present(*cache, frame % kPoolSize, 3);
+    EXPECT_EQ(0u, mMaps);
+    EXPECT_EQ(0u, mUnmaps);
+
+    cache.reset();
+    EXPECT_EQ(static_cast<size_t>(kPoolSize), mUnmaps);
+}
+
+TEST_F(VideoMetaCacheTest, ParsesNewMetadataOfEveryFrame) {
+    auto cache = makeCache();
+
+    for (uint32_t round = 1; round <= 3; round++) {
+        for (int i = 0; i < kPoolSize; i++) {
+            // the decoder writes the buffer while it is not presented
+            writeMeta(i, round);
+            EXPECT_EQ(round, present(*cache, i, 2)) << "buffer " << i;
+        }
+    }
+}
+
+TEST_F(VideoMetaCacheTest, InvalidateParsesAgain) {
+    auto cache = makeCache();
+    cache->nextFrame();
+
+    VideoMetaCache::Mapping *mapping = cache->get(bufferId(0), mFds[0]);
+    ASSERT_NE(nullptr, mapping);
+    EXPECT_TRUE(cache->checkChanged(mapping));
+    EXPECT_FALSE(cache->checkChanged(mapping));
+
+    // e.g. the dataspace of the layer changed and reset the parcel
+    cache->invalidate();
+    mapping = cache->get(bufferId(0), mFds[0]);
+    EXPECT_TRUE(cache->checkChanged(mapping));
+    EXPECT_FALSE(cache->checkChanged(mapping));
+    EXPECT_EQ(1u, mMaps);
+}
+
+TEST_F(VideoMetaCacheTest, IdleBuffersAreUnmapped) {
+    auto cache = makeCache();
+    for (int i = 0; i < kPoolSize; i++) present(*cache, i);
+
+    // the decoder reallocates its pool, only the new buffers are presented. The old pool is
+    // unmapped although the new buffers are all hits
+    for (uint64_t frame = 0; frame < 2 * VideoMetaCache::kIdleFrames; frame++)
+        present(*cache, 0, 1, 5000 + frame % 4);
+    EXPECT_EQ(static_cast<size_t>(kPoolSize), mUnmaps);
+    EXPECT_EQ(4u, cache->size());
+
+    // a buffer presented within kIdleFrames stays mapped
+    mUnmaps = 0;
+    for (uint64_t frame = 0; frame < 2 * VideoMetaCache::kIdleFrames; frame++)
+        present(*cache, 0, 1, (frame % 100 == 0) ? 6000 : 5000 + frame % 4);
+    EXPECT_EQ(0u, mUnmaps);
+    EXPECT_EQ(5u, cache->size());
+}
+
+TEST_F(VideoMetaCacheTest, BuffersWithoutIdAreMappedEveryTime) {
+    auto cache = makeCache();
+    cache->nextFrame();
+
+    for (int v = 0; v < 3; v++) {
+        VideoMetaCache::Mapping *mapping = cache->get(0, mFds[0]);
+        ASSERT_NE(nullptr, mapping);
+        EXPECT_TRUE(cache->checkChanged(mapping));
+    }
+    EXPECT_EQ(3u, mMaps);
+    EXPECT_EQ(1u, cache->size());
+}
+
+TEST_F(VideoMetaCacheTest, MappingsAreBounded) {
+    auto cache = makeCache(kPoolSize / 2);
+    for (int i = 0; i < kPoolSize; i++) present(*cache, i);
+    EXPECT_EQ(static_cast<size_t>(kPoolSize / 2), cache->size());
+    EXPECT_EQ(static_cast<size_t>(kPoolSize / 2), mUnmaps);
+
+    // the least recently presented buffers were unmapped
+    mMaps = 0;
+    for (int i = kPoolSize / 2; i < kPoolSize; i++) present(*cache, i);
+    EXPECT_EQ(0u, mMaps);
+}
+
+TEST_F(VideoMetaCacheTest, InvalidBufferIsNotMapped) {
+    auto cache = makeCache();
+    EXPECT_EQ(nullptr, cache->get(bufferId(0), -1));
+    EXPECT_EQ(0u, mMaps);
+}
+
+// mmap calls and validation time over a 20 buffer pool, against the former cache of the 16
+// most recently used buffers
+TEST_F(VideoMetaCacheTest, RotatingPoolBenchmark) {
+    constexpr int kFrames = 1200;
+    constexpr int kValidates = 2;
+
+    auto run = [&](size_t maxMappings, size_t &maps) {
+        auto cache = makeCache(maxMappings);
+        for (int i = 0; i < kPoolSize; i++) present(*cache, i);
+        mMaps = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < kFrames; frame++)
+            present(*cache, frame % kPoolSize, kValidates);
+        const auto end = std::chrono::steady_clock::now();
+        maps = mMaps;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() /
+                kFrames;
+    };
+
+    size_t lruMaps = 0;
+    const int64_t lruTime = run(16, lruMaps);
+    size_t maps = 0;
+    const int64_t time = run(VideoMetaCache::kMaxMappings, maps);
+
+    // the pool does not fit the former cache, which maps every frame
+    EXPECT_EQ(static_cast<size_t>(kFrames), lruMaps);
+    EXPECT_EQ(0u, maps);
+
+    RecordProperty("lru16_mmaps", static_cast<int>(lruMaps));
+    RecordProperty("lru16_ns_per_frame", static_cast<int>(lruTime));
+    RecordProperty("mmaps", static_cast<int>(maps));
+    RecordProperty("ns_per_frame", static_cast<int>(time));
+}
+
+} // namespace
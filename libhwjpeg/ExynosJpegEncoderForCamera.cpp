@@ -61,8 +61,9 @@ static int GetThumbnailFormat(int v4l2Format) {
         return v4l2Format;
 }
 
-ExynosJpegEncoderForCamera::ExynosJpegEncoderForCamera(bool bBTBComp)
-      : m_phwjpeg4thumb(NULL),
+ExynosJpegEncoderForCamera::ExynosJpegEncoderForCamera(bool bBTBComp, CHWJpegV4L2Device *device)
+      : ExynosJpegEncoder(device),
+        m_phwjpeg4thumb(NULL),
         m_fdIONClient(-1),
         m_fdIONThumbImgBuffer(-1),
         m_pIONThumbImgBuffer(NULL),
@@ -81,7 +82,7 @@ ExynosJpegEncoderForCamera::ExynosJpegEncoderForCamera(bool bBTBComp)
         return;
     }
 
-    m_phwjpeg4thumb = new CHWJpegV4L2Compressor();
+    m_phwjpeg4thumb = new CHWJpegV4L2Compressor(device);
     if (!m_phwjpeg4thumb) {
         ALOGE("Failed to create thumbnail compressor!");
         return;
@@ -117,11 +118,16 @@ ExynosJpegEncoderForCamera::~ExynosJpegEncoderForCamera() {
 
     if (m_pIONThumbImgBuffer != NULL) munmap(m_pIONThumbImgBuffer, m_szIONThumbImgBuffer);
 
-    if (m_fdIONThumbImgBuffer >= 0) close(m_fdIONThumbImgBuffer);
+    // the thumbnail buffers are recycled by the next encoder if the ION pool is enabled
+    if (m_fdIONThumbImgBuffer >= 0)
+        exynos_ion_free(m_fdIONClient, m_fdIONThumbImgBuffer, m_szIONThumbImgBuffer,
+                        EXYNOS_ION_HEAP_SYSTEM_MASK, 0);
 
     if (m_pIONThumbJpegBuffer) munmap(m_pIONThumbJpegBuffer, m_szIONThumbJpegBuffer);
 
-    if (m_fdIONThumbJpegBuffer >= 0) close(m_fdIONThumbJpegBuffer);
+    if (m_fdIONThumbJpegBuffer >= 0)
+        exynos_ion_free(m_fdIONClient, m_fdIONThumbJpegBuffer, m_szIONThumbJpegBuffer,
+                        EXYNOS_ION_HEAP_SYSTEM_MASK, ION_FLAG_CACHED | ION_FLAG_CACHED_NEEDS_SYNC);
 
     if (m_fdIONClient >= 0) exynos_ion_close(m_fdIONClient);
 
@@ -647,7 +653,8 @@ bool ExynosJpegEncoderForCamera::AllocThumbBuffer(int v4l2Format) {
 
         if (m_pIONThumbImgBuffer != NULL) munmap(m_pIONThumbImgBuffer, m_szIONThumbImgBuffer);
 
-        close(m_fdIONThumbImgBuffer);
+        exynos_ion_free(m_fdIONClient, m_fdIONThumbImgBuffer, m_szIONThumbImgBuffer,
+                        EXYNOS_ION_HEAP_SYSTEM_MASK, 0);
 
         m_fdIONThumbImgBuffer = -1;
         m_pIONThumbImgBuffer = NULL;
@@ -680,7 +687,8 @@ bool ExynosJpegEncoderForCamera::AllocThumbJpegBuffer() {
         if (m_szIONThumbJpegBuffer >= thumbbufsize) return true;
 
         munmap(m_pIONThumbJpegBuffer, m_szIONThumbJpegBuffer);
-        close(m_fdIONThumbJpegBuffer);
+        exynos_ion_free(m_fdIONClient, m_fdIONThumbJpegBuffer, m_szIONThumbJpegBuffer,
+                        EXYNOS_ION_HEAP_SYSTEM_MASK, ION_FLAG_CACHED | ION_FLAG_CACHED_NEEDS_SYNC);
 
         m_szIONThumbJpegBuffer = 0;
         m_pIONThumbJpegBuffer = NULL;
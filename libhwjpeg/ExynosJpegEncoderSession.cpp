@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ExynosJpegEncoderSession.h>
+
+#include "hwjpeg-internal.h"
+
+ExynosJpegEncoderSession::ExynosJpegEncoderSession(unsigned int depth, CHWJpegV4L2Device *device)
+      : mSubmitted(0), mCollected(0), mExit(false) {
+    if (depth == 0) {
+        ALOGE("Session depth should be larger than 0");
+        return;
+    }
+
+    for (unsigned int i = 0; i < depth; i++) {
+        std::unique_ptr<Slot> slot(new Slot());
+        slot->encoder.reset(new ExynosJpegEncoderForCamera(true, device));
+        if (slot->encoder->flagCreate() < 0) {
+            ALOGE("Failed to create the encoder of slot %u", i);
+            break;
+        }
+        slot->state = SLOT_IDLE;
+        mSlots.push_back(std::move(slot));
+    }
+
+    // a partially created session is not usable
+    if (mSlots.size() != depth) {
+        mSlots.clear();
+        return;
+    }
+
+    for (auto &slot : mSlots)
+        slot->thread = std::thread(&ExynosJpegEncoderSession::threadLoop, this, slot.get());
+
+    ALOGD("ExynosJpegEncoderSession Created: %p, depth %u", this, depth);
+}
+
+ExynosJpegEncoderSession::~ExynosJpegEncoderSession() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCond.notify_all();
+
+    // the captures in flight are completed before the threads exit
+    for (auto &slot : mSlots)
+        if (slot->thread.joinable()) slot->thread.join();
+
+    ALOGD("ExynosJpegEncoderSession Destroyed: %p, %lu submitted, %lu collected", this, mSubmitted,
+          mCollected);
+}
+
+int ExynosJpegEncoderSession::submit(const Capture &capture) {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    if (mSlots.empty()) {
+        ALOGE("Session is not created");
+        return -1;
+    }
+
+    if (mSubmitted - mCollected >= mSlots.size()) {
+        ALOGE("%lu captures are not collected yet", mSubmitted - mCollected);
+        return -1;
+    }
+
+    Slot &slot = *mSlots[mSubmitted % mSlots.size()];
+    slot.capture = capture;
+    slot.result = {capture.cookie, -1, 0};
+    slot.state = SLOT_QUEUED;
+    mSubmitted++;
+
+    lock.unlock();
+    mCond.notify_all();
+
+    return 0;
+}
+
+int ExynosJpegEncoderSession::collect(Result *result) {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    if (mSubmitted == mCollected) {
+        ALOGE("No capture is in flight");
+        return -1;
+    }
+
+    Slot &slot = *mSlots[mCollected % mSlots.size()];
+    mCond.wait(lock, [&slot] { return slot.state == SLOT_DONE; });
+
+    *result = slot.result;
+    slot.state = SLOT_IDLE;
+    mCollected++;
+
+    return 0;
+}
+
+void ExynosJpegEncoderSession::threadLoop(Slot *slot) {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    while (true) {
+        mCond.wait(lock, [this, slot] { return mExit || (slot->state == SLOT_QUEUED); });
+        if (slot->state != SLOT_QUEUED) return;
+
+        Capture capture = slot->capture;
+        lock.unlock();
+
+        Result result = {capture.cookie, -1, capture.outBufSize};
+        result.status = encodeCapture(*slot->encoder, capture, &result.size);
+
+        lock.lock();
+        slot->result = result;
+        slot->state = SLOT_DONE;
+        mCond.notify_all();
+    }
+}
+
+int ExynosJpegEncoderSession::encodeCapture(ExynosJpegEncoderForCamera &encoder,
+                                            const Capture &capture, int *size) {
+    encoder.setSize(capture.width, capture.height);
+    encoder.setColorFormat(capture.colorFormat);
+
+    if (encoder.setJpegFormat(capture.jpegFormat) < 0) {
+        ALOGE("Failed to configure JPEG format %#x", capture.jpegFormat);
+        return -1;
+    }
+
+    if (encoder.setQuality(capture.quality) < 0) {
+        ALOGE("Failed to configure quality factor %d", capture.quality);
+        return -1;
+    }
+
+    if (encoder.setThumbnailSize(capture.thumbWidth, capture.thumbHeight) < 0) return -1;
+
+    if (((capture.thumbWidth | capture.thumbHeight) != 0) &&
+        (encoder.setThumbnailQuality(capture.thumbQuality) < 0))
+        return -1;
+
+    int inBufFd[3] = {capture.inBufFd[0], capture.inBufFd[1], capture.inBufFd[2]};
+    int inBufSize[3] = {capture.inBufSize[0], capture.inBufSize[1], capture.inBufSize[2]};
+    if (encoder.setInBuf(inBufFd, inBufSize) < 0) {
+        ALOGE("Failed to configure image buffer %d", capture.inBufFd[0]);
+        return -1;
+    }
+
+    char *outBuf = capture.outBuf;
+    return encoder.encode(size, capture.exif, capture.outBufFd, &outBuf, capture.appInfo);
+}
@@ -25,13 +25,34 @@
 
 #include "hwjpeg-internal.h"
 
-CHWJpegBase::CHWJpegBase(const char *path) : m_iFD(-1), m_uiDeviceCaps(0), m_uiAuxFlags(0) {
-    m_iFD = open(path, O_RDWR);
+int CHWJpegV4L2Device::Open(const char *path, int flags) {
+    return open(path, flags);
+}
+
+int CHWJpegV4L2Device::Close(int fd) {
+    return close(fd);
+}
+
+int CHWJpegV4L2Device::Ioctl(int fd, unsigned long request, void *arg) {
+    return ioctl(fd, request, arg);
+}
+
+CHWJpegV4L2Device *CHWJpegV4L2Device::GetDefault() {
+    static CHWJpegV4L2Device device;
+    return &device;
+}
+
+CHWJpegBase::CHWJpegBase(const char *path, CHWJpegV4L2Device *device)
+      : m_pDevice(device ? device : CHWJpegV4L2Device::GetDefault()),
+        m_iFD(-1),
+        m_uiDeviceCaps(0),
+        m_uiAuxFlags(0) {
+    m_iFD = m_pDevice->Open(path, O_RDWR);
     if (m_iFD < 0) ALOGERR("Failed to open '%s'", path);
 }
 
 CHWJpegBase::~CHWJpegBase() {
-    if (m_iFD >= 0) close(m_iFD);
+    if (m_iFD >= 0) m_pDevice->Close(m_iFD);
 }
 
 void CHWJpegBase::SetAuxFlags(unsigned int auxflags) {
@@ -22,8 +22,8 @@
 #include "hwjpeg-internal.h"
 #include "log/log_main.h"
 
-CHWJpegV4L2Compressor::CHWJpegV4L2Compressor()
-      : CHWJpegCompressor("/dev/video12"), file_lock_(FileLock(GetDeviceFD())) {
+CHWJpegV4L2Compressor::CHWJpegV4L2Compressor(CHWJpegV4L2Device *device)
+      : CHWJpegCompressor("/dev/video12", device), file_lock_(FileLock(GetDeviceFD())) {
     memset(&m_v4l2Format, 0, sizeof(m_v4l2Format));
     memset(&m_v4l2SrcBuffer, 0, sizeof(m_v4l2SrcBuffer));
     memset(&m_v4l2DstBuffer, 0, sizeof(m_v4l2DstBuffer));
@@ -52,7 +52,7 @@ CHWJpegV4L2Compressor::CHWJpegV4L2Compressor()
 
     v4l2_capability cap;
     memset(&cap, 0, sizeof(cap));
-    if (ioctl(GetDeviceFD(), VIDIOC_QUERYCAP, &cap) < 0) {
+    if (DeviceIoctl(VIDIOC_QUERYCAP, &cap) < 0) {
         ALOGERR("Failed to query capability of /dev/video12");
     } else if (!!(cap.capabilities & V4L2_CAP_DEVICE_CAPS)) {
         SetDeviceCapabilities(cap.device_caps);
@@ -152,7 +152,7 @@ bool CHWJpegV4L2Compressor::SetQuality(const unsigned char qtable[]) {
     ctrl.size = 128; /* two quantization tables */
     ctrl.p_u8 = const_cast<unsigned char *>(qtable);
 
-    if (ioctl(GetDeviceFD(), VIDIOC_S_EXT_CTRLS, &ctrls) < 0) {
+    if (DeviceIoctl(VIDIOC_S_EXT_CTRLS, &ctrls) < 0) {
         ALOGERR("Failed to configure %u controls", ctrls.count);
         return false;
     }
@@ -450,7 +450,7 @@ ssize_t CHWJpegV4L2Compressor::Compress(size_t *secondary_stream_size, bool bloc
 }
 
 bool CHWJpegV4L2Compressor::TryFormat() {
-    if (ioctl(GetDeviceFD(), VIDIOC_TRY_FMT, &m_v4l2Format) < 0) {
+    if (DeviceIoctl(VIDIOC_TRY_FMT, &m_v4l2Format) < 0) {
         ALOGERR("Failed to TRY_FMT for compression");
         return false;
     }
@@ -459,7 +459,7 @@ bool CHWJpegV4L2Compressor::TryFormat() {
 }
 
 bool CHWJpegV4L2Compressor::SetFormat() {
-    if (ioctl(GetDeviceFD(), VIDIOC_S_FMT, &m_v4l2Format) < 0) {
+    if (DeviceIoctl(VIDIOC_S_FMT, &m_v4l2Format) < 0) {
         ALOGERR("Failed to S_FMT for image to compress");
         return false;
     }
@@ -472,7 +472,7 @@ bool CHWJpegV4L2Compressor::SetFormat() {
     v4l2JpegFormat.fmt.pix_mp.width = m_v4l2Format.fmt.pix_mp.width;
     v4l2JpegFormat.fmt.pix_mp.height = m_v4l2Format.fmt.pix_mp.height;
 
-    if (ioctl(GetDeviceFD(), VIDIOC_S_FMT, &v4l2JpegFormat) < 0) {
+    if (DeviceIoctl(VIDIOC_S_FMT, &v4l2JpegFormat) < 0) {
         ALOGERR("Failed to S_FMT for JPEG stream to capture");
         return false;
     }
@@ -513,7 +513,7 @@ bool CHWJpegV4L2Compressor::UpdateControls() {
         ctrls.count++;
     }
 
-    if (ioctl(GetDeviceFD(), VIDIOC_S_EXT_CTRLS, &ctrls) < 0) {
+    if (DeviceIoctl(VIDIOC_S_EXT_CTRLS, &ctrls) < 0) {
         ALOGERR("Failed to configure %u controls", ctrls.count);
         return false;
     }
@@ -534,7 +534,7 @@ bool CHWJpegV4L2Compressor::ReqBufs(unsigned int count) {
     reqbufs.count = count;
     reqbufs.memory = m_v4l2SrcBuffer.memory;
     reqbufs.type = m_v4l2SrcBuffer.type;
-    if (ioctl(GetDeviceFD(), VIDIOC_REQBUFS, &reqbufs) < 0) {
+    if (DeviceIoctl(VIDIOC_REQBUFS, &reqbufs) < 0) {
         ALOGERR("Failed to REQBUFS(%u) of the source image", count);
         return false;
     }
@@ -543,13 +543,13 @@ bool CHWJpegV4L2Compressor::ReqBufs(unsigned int count) {
     reqbufs.count = count;
     reqbufs.memory = m_v4l2DstBuffer.memory;
     reqbufs.type = m_v4l2DstBuffer.type;
-    if (ioctl(GetDeviceFD(), VIDIOC_REQBUFS, &reqbufs) < 0) {
+    if (DeviceIoctl(VIDIOC_REQBUFS, &reqbufs) < 0) {
         ALOGERR("Failed to REQBUFS(%u) of the JPEG stream", count);
         // rolling back the reqbufs for the source image
         reqbufs.memory = m_v4l2SrcBuffer.memory;
         reqbufs.type = m_v4l2SrcBuffer.type;
         reqbufs.count = 0;
-        ioctl(GetDeviceFD(), VIDIOC_REQBUFS, &reqbufs); // don't care if it fails
+        DeviceIoctl(VIDIOC_REQBUFS, &reqbufs); // don't care if it fails
         return false;
     }
 
@@ -569,14 +569,14 @@ bool CHWJpegV4L2Compressor::StreamOn() {
         return false;
     }
 
-    if (ioctl(GetDeviceFD(), VIDIOC_STREAMON, &m_v4l2SrcBuffer.type) < 0) {
+    if (DeviceIoctl(VIDIOC_STREAMON, &m_v4l2SrcBuffer.type) < 0) {
         ALOGERR("Failed to STREAMON for the source image");
         return false;
     }
 
-    if (ioctl(GetDeviceFD(), VIDIOC_STREAMON, &m_v4l2DstBuffer.type) < 0) {
+    if (DeviceIoctl(VIDIOC_STREAMON, &m_v4l2DstBuffer.type) < 0) {
         ALOGERR("Failed to STREAMON for the JPEG stream");
-        ioctl(GetDeviceFD(), VIDIOC_STREAMOFF, &m_v4l2SrcBuffer.type);
+        DeviceIoctl(VIDIOC_STREAMOFF, &m_v4l2SrcBuffer.type);
         return false;
     }
 
@@ -589,10 +589,10 @@ bool CHWJpegV4L2Compressor::StreamOff() {
     if (!TestFlag(HWJPEG_FLAG_STREAMING)) return true;
 
     // error during stream off do not need further handling because of nothing to do
-    if (ioctl(GetDeviceFD(), VIDIOC_STREAMOFF, &m_v4l2SrcBuffer.type) < 0)
+    if (DeviceIoctl(VIDIOC_STREAMOFF, &m_v4l2SrcBuffer.type) < 0)
         ALOGERR("Failed to STREAMOFF for the source image");
 
-    if (ioctl(GetDeviceFD(), VIDIOC_STREAMOFF, &m_v4l2DstBuffer.type) < 0)
+    if (DeviceIoctl(VIDIOC_STREAMOFF, &m_v4l2DstBuffer.type) < 0)
         ALOGERR("Failed to STREAMOFF for the JPEG stream");
 
     ClearFlag(HWJPEG_FLAG_STREAMING);
@@ -606,13 +606,13 @@ bool CHWJpegV4L2Compressor::QBuf() {
         return false;
     }
 
-    if (ioctl(GetDeviceFD(), VIDIOC_QBUF, &m_v4l2SrcBuffer) < 0) {
+    if (DeviceIoctl(VIDIOC_QBUF, &m_v4l2SrcBuffer) < 0) {
         ALOGERR("QBuf of the source buffers is failed (B2B %s)",
                 IsB2BCompression() ? "enabled" : "disabled");
         return false;
     }
 
-    if (ioctl(GetDeviceFD(), VIDIOC_QBUF, &m_v4l2DstBuffer) < 0) {
+    if (DeviceIoctl(VIDIOC_QBUF, &m_v4l2DstBuffer) < 0) {
         ALOGERR("QBuf of the JPEG buffers is failed (B2B %s)",
                 IsB2BCompression() ? "enabled" : "disabled");
         // Reqbufs(0) is the only way to cancel the previous queued buffer
@@ -647,12 +647,12 @@ ssize_t CHWJpegV4L2Compressor::DQBuf(size_t *secondary_stream_size) {
     buffer_dst.length = m_v4l2DstBuffer.length;
     buffer_dst.m.planes = planes_dst;
 
-    if (TestFlag(HWJPEG_FLAG_QBUF_OUT) && (ioctl(GetDeviceFD(), VIDIOC_DQBUF, &buffer_src) < 0)) {
+    if (TestFlag(HWJPEG_FLAG_QBUF_OUT) && (DeviceIoctl(VIDIOC_DQBUF, &buffer_src) < 0)) {
         ALOGERR("Failed to DQBUF of the image buffer");
         failed = true;
     }
 
-    if (TestFlag(HWJPEG_FLAG_QBUF_CAP) && (ioctl(GetDeviceFD(), VIDIOC_DQBUF, &buffer_dst) < 0)) {
+    if (TestFlag(HWJPEG_FLAG_QBUF_CAP) && (DeviceIoctl(VIDIOC_DQBUF, &buffer_dst) < 0)) {
         ALOGERR("Failed to DQBUF of the JPEG stream buffer");
         failed = true;
     }
@@ -755,7 +755,8 @@ void CHWJpegV4L2Compressor::Release() {
 /********* D E C O M P R E S S I O N   S U P P O R T **************************/
 /******************************************************************************/
 
-CHWJpegV4L2Decompressor::CHWJpegV4L2Decompressor() : CHWJpegDecompressor("/dev/video12") {
+CHWJpegV4L2Decompressor::CHWJpegV4L2Decompressor(CHWJpegV4L2Device *device)
+      : CHWJpegDecompressor("/dev/video12", device) {
     m_v4l2Format.type = 0; // inidication of uninitialized state
 
     memset(&m_v4l2DstBuffer, 0, sizeof(m_v4l2DstBuffer));
@@ -764,7 +765,7 @@ CHWJpegV4L2Decompressor::CHWJpegV4L2Decompressor() : CHWJpegDecompressor("/dev/v
     if (Okay()) {
         v4l2_capability cap;
         memset(&cap, 0, sizeof(cap));
-        if (ioctl(GetDeviceFD(), VIDIOC_QUERYCAP, &cap) < 0) {
+        if (DeviceIoctl(VIDIOC_QUERYCAP, &cap) < 0) {
             ALOGERR("Failed to query capability of /dev/video12");
         } else if (!!(cap.capabilities & V4L2_CAP_DEVICE_CAPS)) {
             SetDeviceCapabilities(cap.device_caps);
@@ -792,15 +793,15 @@ bool CHWJpegV4L2Decompressor::PrepareCapture() {
     reqbufs.memory = m_v4l2DstBuffer.memory;
     reqbufs.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-    if (ioctl(GetDeviceFD(), VIDIOC_REQBUFS, &reqbufs) < 0) {
+    if (DeviceIoctl(VIDIOC_REQBUFS, &reqbufs) < 0) {
         ALOGERR("Failed to REQBUFS for the decompressed image");
         return false;
     }
 
-    if (ioctl(GetDeviceFD(), VIDIOC_STREAMON, &reqbufs.type) < 0) {
+    if (DeviceIoctl(VIDIOC_STREAMON, &reqbufs.type) < 0) {
         ALOGERR("Failed to STREAMON for the decompressed image");
         reqbufs.count = 0;
-        ioctl(GetDeviceFD(), VIDIOC_REQBUFS, &reqbufs);
+        DeviceIoctl(VIDIOC_REQBUFS, &reqbufs);
         return false;
     }
 
@@ -818,8 +819,8 @@ void CHWJpegV4L2Decompressor::CancelCapture() {
     reqbufs.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     reqbufs.memory = m_v4l2DstBuffer.memory;
 
-    ioctl(GetDeviceFD(), VIDIOC_STREAMOFF, &reqbufs.type);
-    ioctl(GetDeviceFD(), VIDIOC_REQBUFS, &reqbufs);
+    DeviceIoctl(VIDIOC_STREAMOFF, &reqbufs.type);
+    DeviceIoctl(VIDIOC_REQBUFS, &reqbufs);
 
     ClearFlag(HWJPEG_FLAG_CAPTURE_READY);
 }
@@ -842,7 +843,7 @@ bool CHWJpegV4L2Decompressor::SetImageFormat(unsigned int v4l2_fmt, unsigned int
     m_v4l2Format.fmt.pix.width = width;
     m_v4l2Format.fmt.pix.height = height;
 
-    if (ioctl(GetDeviceFD(), VIDIOC_S_FMT, &m_v4l2Format) < 0) {
+    if (DeviceIoctl(VIDIOC_S_FMT, &m_v4l2Format) < 0) {
         ALOGERR("Failed to S_FMT for decompressed image (%08X,%ux%u)", v4l2_fmt, width, height);
         return false;
     }
@@ -885,17 +886,17 @@ bool CHWJpegV4L2Decompressor::PrepareStream() {
     rb.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
 
     // REQBUFS fails if no S_FMT is not performed
-    if (ioctl(GetDeviceFD(), VIDIOC_REQBUFS, &rb) < 0) {
+    if (DeviceIoctl(VIDIOC_REQBUFS, &rb) < 0) {
         ALOGERR("Failed to REQBUFS for the JPEG stream.");
         return false;
     }
 
-    if (ioctl(GetDeviceFD(), VIDIOC_STREAMON, &rb.type) < 0) {
+    if (DeviceIoctl(VIDIOC_STREAMON, &rb.type) < 0) {
         ALOGERR("Failed to STREAMON for the JPEG stream.");
 
         rb.count = 0;
         // don't care if reqbufs(0) fails.
-        ioctl(GetDeviceFD(), VIDIOC_REQBUFS, &rb);
+        DeviceIoctl(VIDIOC_REQBUFS, &rb);
 
         return false;
     }
@@ -915,8 +916,8 @@ void CHWJpegV4L2Decompressor::CancelStream() {
     rb.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
 
     // ignore error during canceling
-    ioctl(GetDeviceFD(), VIDIOC_STREAMOFF, &rb.type);
-    ioctl(GetDeviceFD(), VIDIOC_REQBUFS, &rb);
+    DeviceIoctl(VIDIOC_STREAMOFF, &rb.type);
+    DeviceIoctl(VIDIOC_REQBUFS, &rb);
 
     ClearFlag(HWJPEG_FLAG_OUTPUT_READY);
 }
@@ -930,12 +931,12 @@ bool CHWJpegV4L2Decompressor::QBufAndWait(const char *buffer, size_t len) {
     buf.m.userptr = reinterpret_cast<unsigned long>(buffer);
     buf.length = len;
 
-    if (ioctl(GetDeviceFD(), VIDIOC_QBUF, &buf) < 0) {
+    if (DeviceIoctl(VIDIOC_QBUF, &buf) < 0) {
         ALOGERR("Failed to QBUF for the JPEG stream");
         return false;
     }
 
-    if (ioctl(GetDeviceFD(), VIDIOC_QBUF, &m_v4l2DstBuffer) < 0) {
+    if (DeviceIoctl(VIDIOC_QBUF, &m_v4l2DstBuffer) < 0) {
         CancelStream();
         ALOGERR("Failed to QBUF for the decompressed image");
         return false;
@@ -943,7 +944,7 @@ bool CHWJpegV4L2Decompressor::QBufAndWait(const char *buffer, size_t len) {
 
     bool ret = true;
 
-    if (ioctl(GetDeviceFD(), VIDIOC_DQBUF, &buf) < 0) {
+    if (DeviceIoctl(VIDIOC_DQBUF, &buf) < 0) {
         ALOGERR("Failed to DQBUF of the stream buffer");
         ret = false;
     }
@@ -951,7 +952,7 @@ bool CHWJpegV4L2Decompressor::QBufAndWait(const char *buffer, size_t len) {
     buf.type = m_v4l2DstBuffer.type;
     buf.memory = m_v4l2DstBuffer.memory;
 
-    if (ioctl(GetDeviceFD(), VIDIOC_DQBUF, &buf) < 0) {
+    if (DeviceIoctl(VIDIOC_DQBUF, &buf) < 0) {
         ALOGERR("Failed to DQBUF of the image buffer");
         ret = false;
     }
@@ -98,8 +98,9 @@ protected:
     virtual bool EnsureFormatIsApplied() { return __EnsureFormatIsApplied(); }
 
 public:
-    ExynosJpegEncoder()
-          : m_hwjpeg(),
+    // @device is the V4L2 device of HWJPEG, or NULL for the kernel
+    ExynosJpegEncoder(CHWJpegV4L2Device *device = NULL)
+          : m_hwjpeg(device),
             m_iInBufType(JPEG_BUF_TYPE_USER_PTR),
             m_iOutBufType(JPEG_BUF_TYPE_USER_PTR),
             m_uiState(0),
@@ -103,7 +103,7 @@ protected:
     virtual bool EnsureFormatIsApplied();
 
 public:
-    ExynosJpegEncoderForCamera(bool bBTBComp = true);
+    ExynosJpegEncoderForCamera(bool bBTBComp = true, CHWJpegV4L2Device *device = NULL);
     virtual ~ExynosJpegEncoderForCamera();
 
     int encode(int *size, exif_attribute_t *exifInfo, char **pcJpegBuffer,
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HARDWARE_EXYNOS_JPEG_ENCODER_SESSION_H__
+#define __HARDWARE_EXYNOS_JPEG_ENCODER_SESSION_H__
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ExynosJpegEncoderForCamera.h"
+
+/*
+ * ExynosJpegEncoderSession - compresses a burst of captures with up to @depth
+ * captures in flight.
+ *
+ * Each in-flight slot owns an ExynosJpegEncoderForCamera and a worker thread.
+ * While the H/W compresses capture N in one slot, the APP markers and the
+ * thumbnail of capture N+1 are prepared by the next slot. The V4L2 driver
+ * serializes the H/W jobs of the slots. The encoders, their thumbnail scalers
+ * and ION buffers are kept across the captures of the session.
+ *
+ * The session does not acquire ExynosJpegEncoder::lock(). The buffers and
+ * @exif and @appInfo of a Capture should be valid until it is collected.
+ */
+class ExynosJpegEncoderSession {
+public:
+    struct Capture {
+        int width;
+        int height;
+        int colorFormat; // V4L2_PIX_FMT_*
+        int jpegFormat;  // V4L2_PIX_FMT_JPEG_*
+        int quality;
+        // thumbWidth == 0 and thumbHeight == 0 means no thumbnail
+        int thumbWidth;
+        int thumbHeight;
+        int thumbQuality;
+        // dma-buf of the image. inBufSize[i] is 0 for the unused planes.
+        int inBufFd[3];
+        int inBufSize[3];
+        // dma-buf of the stream and its mapping to write the APP markers
+        int outBufFd;
+        char *outBuf;
+        int outBufSize;
+        exif_attribute_t *exif;
+        extra_appinfo_t *appInfo;
+        void *cookie;
+    };
+
+    struct Result {
+        void *cookie;
+        // 0 on success, -1 on error
+        int status;
+        // length of the stream written to Capture::outBuf
+        int size;
+    };
+
+    // @device is the V4L2 device of HWJPEG, or NULL for the kernel
+    explicit ExynosJpegEncoderSession(unsigned int depth = 2, CHWJpegV4L2Device *device = NULL);
+    ~ExynosJpegEncoderSession();
+
+    // Return 0 on success, -1 on error
+    int flagCreate() { return mSlots.empty() ? -1 : 0; }
+
+    unsigned int getDepth() const { return static_cast<unsigned int>(mSlots.size()); }
+
+    // Queues @capture and returns without waiting for the compression.
+    // Return -1 if @depth captures are not collected yet.
+    int submit(const Capture &capture);
+    // Waits for the oldest capture not collected yet in the submission order.
+    // Return -1 if no capture is in flight.
+    int collect(Result *result);
+
+private:
+    enum SlotState {
+        SLOT_IDLE,
+        SLOT_QUEUED,
+        SLOT_DONE,
+    };
+
+    struct Slot {
+        std::unique_ptr<ExynosJpegEncoderForCamera> encoder;
+        std::thread thread;
+        SlotState state;
+        Capture capture;
+        Result result;
+    };
+
+    void threadLoop(Slot *slot);
+    static int encodeCapture(ExynosJpegEncoderForCamera &encoder, const Capture &capture,
+                             int *size);
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::vector<std::unique_ptr<Slot>> mSlots;
+    // sequence numbers of the captures. A capture goes to mSlots[seq % depth].
+    unsigned long mSubmitted;
+    unsigned long mCollected;
+    bool mExit;
+};
+
+#endif //__HARDWARE_EXYNOS_JPEG_ENCODER_SESSION_H__
@@ -51,6 +51,23 @@
 #define EXYNOS_HWJPEG_AUXOPT_SRC_NOCACHECLEAN (1 << 8)
 #define EXYNOS_HWJPEG_AUXOPT_DST_NOCACHECLEAN (1 << 9)
 
+/*
+ * CHWJpegV4L2Device - The system calls to the device node of HWJPEG
+ *
+ * The compressors and the decompressors call the kernel through the default
+ * instance returned by GetDefault(). A test passes its own instance to run
+ * libhwjpeg against a fake V4L2 device instead of the H/W.
+ */
+class CHWJpegV4L2Device {
+public:
+    virtual ~CHWJpegV4L2Device() {}
+    virtual int Open(const char *path, int flags);
+    virtual int Close(int fd);
+    virtual int Ioctl(int fd, unsigned long request, void *arg);
+
+    static CHWJpegV4L2Device *GetDefault();
+};
+
 /*
  * CHWJpegBase - The base class of JPEG compression and decompression
  *
@@ -61,6 +78,7 @@
  * This class also defines the getters and the setters of flags.
  */
 class CHWJpegBase {
+    CHWJpegV4L2Device *m_pDevice;
     int m_iFD;
     unsigned int m_uiDeviceCaps;
     /*
@@ -75,9 +93,13 @@ class CHWJpegBase {
     unsigned int m_uiAuxFlags;
 
 protected:
-    CHWJpegBase(const char *path);
+    // @device is the default device if it is NULL
+    CHWJpegBase(const char *path, CHWJpegV4L2Device *device = NULL);
     virtual ~CHWJpegBase();
     int GetDeviceFD() { return m_iFD; }
+    int DeviceIoctl(unsigned long request, void *arg) {
+        return m_pDevice->Ioctl(m_iFD, request, arg);
+    }
     void SetDeviceCapabilities(unsigned int cap) { m_uiDeviceCaps = cap; }
     unsigned int GetAuxFlags() { return m_uiAuxFlags; }
 
@@ -153,8 +175,8 @@ protected:
     }
 
 public:
-    CHWJpegCompressor(const char *path)
-          : CHWJpegBase(path), m_nLastStreamSize(0), m_nLastThumbStreamSize(0) {}
+    CHWJpegCompressor(const char *path, CHWJpegV4L2Device *device = NULL)
+          : CHWJpegBase(path, device), m_nLastStreamSize(0), m_nLastThumbStreamSize(0) {}
 
     /*
      * SetImageFormat - Configure uncompressed image format, width and height
@@ -418,7 +440,8 @@ public:
  */
 class CHWJpegDecompressor : public CHWJpegBase {
 public:
-    CHWJpegDecompressor(const char *path) : CHWJpegBase(path) {}
+    CHWJpegDecompressor(const char *path, CHWJpegV4L2Device *device = NULL)
+          : CHWJpegBase(path, device) {}
     virtual ~CHWJpegDecompressor() {}
     /*
      * SetImageFormat - Configure decompressed image pixel format
@@ -610,7 +633,7 @@ class CAPABILITY("CHWJpegV4L2Compressor") CHWJpegV4L2Compressor : public CHWJpeg
     bool StopStreaming() REQUIRES(this);
 
 public:
-    CHWJpegV4L2Compressor();
+    CHWJpegV4L2Compressor(CHWJpegV4L2Device *device = NULL);
     virtual ~CHWJpegV4L2Compressor();
 
     // Acquires exclusive lock to V4L2 device. This must be called before starting image
@@ -667,7 +690,7 @@ class CHWJpegV4L2Decompressor : public CHWJpegDecompressor, private CHWJpegFlagM
     bool QBufAndWait(const char *buffer, size_t len);
 
 public:
-    CHWJpegV4L2Decompressor();
+    CHWJpegV4L2Decompressor(CHWJpegV4L2Device *device = NULL);
     virtual ~CHWJpegV4L2Decompressor();
     virtual bool SetImageFormat(unsigned int v4l2_fmt, unsigned int width, unsigned int height);
     virtual bool SetImageBuffer(char *buffer, size_t len_buffer);
@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fake_v4l2_jpeg.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+
+// every 16th byte of the image is written to the stream
+constexpr size_t kSampleStep = 16;
+// bytes written by the "H/W" after the EOI, removed by libhwjpeg
+constexpr unsigned int kTrailingDummies = 3;
+
+int Fail(int err) {
+    errno = err;
+    return -1;
+}
+
+// maps the memory of a plane, or returns its user pointer
+char *MapPlane(unsigned int memory, const v4l2_plane &plane, int prot) {
+    if (memory == V4L2_MEMORY_USERPTR) return reinterpret_cast<char *>(plane.m.userptr);
+
+    void *addr = mmap(NULL, plane.length + plane.data_offset, prot, MAP_SHARED, plane.m.fd, 0);
+    return (addr == MAP_FAILED) ? NULL : static_cast<char *>(addr);
+}
+
+void UnmapPlane(unsigned int memory, const v4l2_plane &plane, char *addr) {
+    if (memory == V4L2_MEMORY_DMABUF) munmap(addr, plane.length + plane.data_offset);
+}
+
+} // namespace
+
+FakeV4L2Jpeg::FakeV4L2Jpeg(unsigned int caps, std::chrono::microseconds jobTime)
+      : mCaps(caps), mJobTime(jobTime) {
+    mEngine = std::thread(&FakeV4L2Jpeg::EngineLoop, this);
+}
+
+FakeV4L2Jpeg::~FakeV4L2Jpeg() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCond.notify_all();
+    mEngine.join();
+}
+
+int FakeV4L2Jpeg::Open(const char *, int flags) {
+    // a real file, so FileLock works on it
+    int fd = open("/dev/null", flags);
+    if (fd < 0) return fd;
+
+    std::lock_guard<std::mutex> lock(mLock);
+    Context &ctx = mContexts[fd];
+    memset(&ctx.image, 0, sizeof(ctx.image));
+    return fd;
+}
+
+int FakeV4L2Jpeg::Close(int fd) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mJobs.erase(std::remove_if(mJobs.begin(), mJobs.end(),
+                                   [fd](const Job &job) { return job.fd == fd; }),
+                    mJobs.end());
+        mContexts.erase(fd);
+    }
+    return close(fd);
+}
+
+int FakeV4L2Jpeg::Ioctl(int fd, unsigned long request, void *arg) {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    auto it = mContexts.find(fd);
+    if (it == mContexts.end()) return Fail(EBADF);
+    Context &ctx = it->second;
+
+    switch (request) {
+        case VIDIOC_QUERYCAP: {
+            v4l2_capability *cap = static_cast<v4l2_capability *>(arg);
+            memset(cap, 0, sizeof(*cap));
+            strncpy(reinterpret_cast<char *>(cap->driver), "fake-jpeg", sizeof(cap->driver) - 1);
+            cap->device_caps = V4L2_CAP_VIDEO_M2M_MPLANE | V4L2_CAP_STREAMING | mCaps;
+            cap->capabilities = cap->device_caps | V4L2_CAP_DEVICE_CAPS;
+            return 0;
+        }
+        case VIDIOC_TRY_FMT:
+            return SetFormat(ctx, static_cast<v4l2_format *>(arg), false);
+        case VIDIOC_S_FMT:
+            return SetFormat(ctx, static_cast<v4l2_format *>(arg), true);
+        case VIDIOC_S_EXT_CTRLS:
+            return SetControls(ctx, static_cast<v4l2_ext_controls *>(arg));
+        case VIDIOC_REQBUFS: {
+            v4l2_requestbuffers *reqbufs = static_cast<v4l2_requestbuffers *>(arg);
+            if (ctx.streaming && (reqbufs->count == 0)) return Fail(EBUSY);
+            ctx.reqbufs = reqbufs->count > 0;
+            return 0;
+        }
+        case VIDIOC_STREAMON:
+            if (!ctx.reqbufs) return Fail(EINVAL);
+            ctx.streaming = true;
+            return 0;
+        case VIDIOC_STREAMOFF:
+            // dequeues all the buffers and cancels the job not started yet
+            ctx.streaming = false;
+            ctx.srcQueued = false;
+            ctx.dstQueued = false;
+            mJobs.erase(std::remove_if(mJobs.begin(), mJobs.end(),
+                                       [fd](const Job &job) { return job.fd == fd; }),
+                        mJobs.end());
+            return 0;
+        case VIDIOC_QBUF:
+            return QBuf(fd, ctx, static_cast<v4l2_buffer *>(arg));
+        case VIDIOC_DQBUF:
+            return DQBuf(lock, ctx, static_cast<v4l2_buffer *>(arg));
+    }
+
+    return Fail(ENOTTY);
+}
+
+int FakeV4L2Jpeg::SetFormat(Context &ctx, v4l2_format *fmt, bool apply) {
+    if (fmt->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+        return (fmt->fmt.pix_mp.pixelformat == V4L2_PIX_FMT_JPEG) ? 0 : Fail(EINVAL);
+
+    if (fmt->type != V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) return Fail(EINVAL);
+
+    // the upper 16 bits are the size of the secondary image
+    const unsigned int width = fmt->fmt.pix_mp.width & 0xFFFF;
+    const unsigned int height = fmt->fmt.pix_mp.height & 0xFFFF;
+    const unsigned int size = width * height;
+    v4l2_pix_format_mplane &pix = fmt->fmt.pix_mp;
+    switch (pix.pixelformat) {
+        case V4L2_PIX_FMT_RGB24:
+            pix.num_planes = 1;
+            pix.plane_fmt[0].sizeimage = size * 3;
+            break;
+        case V4L2_PIX_FMT_YUYV:
+            pix.num_planes = 1;
+            pix.plane_fmt[0].sizeimage = size * 2;
+            break;
+        case V4L2_PIX_FMT_NV12:
+        case V4L2_PIX_FMT_NV21:
+            pix.num_planes = 1;
+            pix.plane_fmt[0].sizeimage = size + size / 2;
+            break;
+        case V4L2_PIX_FMT_NV12M:
+        case V4L2_PIX_FMT_NV21M:
+            pix.num_planes = 2;
+            pix.plane_fmt[0].sizeimage = size;
+            pix.plane_fmt[1].sizeimage = size / 2;
+            break;
+        default:
+            return Fail(EINVAL);
+    }
+
+    if (apply) ctx.image = *fmt;
+
+    return 0;
+}
+
+int FakeV4L2Jpeg::SetControls(Context &ctx, v4l2_ext_controls *ctrls) {
+    for (unsigned int i = 0; i < ctrls->count; i++) {
+        if (ctrls->controls[i].id == V4L2_CID_JPEG_COMPRESSION_QUALITY)
+            ctx.quality = ctrls->controls[i].value;
+    }
+    return 0;
+}
+
+int FakeV4L2Jpeg::QBuf(int fd, Context &ctx, v4l2_buffer *buf) {
+    if (!ctx.streaming) return Fail(EINVAL);
+
+    if (buf->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
+        if (ctx.srcQueued || (buf->length < ctx.image.fmt.pix_mp.num_planes)) return Fail(EINVAL);
+        ctx.src = *buf;
+        std::copy(buf->m.planes, buf->m.planes + buf->length, ctx.srcPlanes);
+        ctx.srcQueued = true;
+    } else if (buf->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        if (ctx.dstQueued || (buf->length < 1)) return Fail(EINVAL);
+        ctx.dst = *buf;
+        std::copy(buf->m.planes, buf->m.planes + buf->length, ctx.dstPlanes);
+        ctx.dstQueued = true;
+    } else {
+        return Fail(EINVAL);
+    }
+
+    if (ctx.srcQueued && ctx.dstQueued) {
+        ctx.done = false;
+        mJobs.push_back({fd, mNextSeq++});
+        mMaxJobs = std::max(mMaxJobs, mJobs.size() + (mRunning ? 1 : 0));
+        mCond.notify_all();
+    }
+
+    return 0;
+}
+
+int FakeV4L2Jpeg::DQBuf(std::unique_lock<std::mutex> &lock, Context &ctx, v4l2_buffer *buf) {
+    bool &queued = (buf->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) ? ctx.srcQueued
+                                                                     : ctx.dstQueued;
+    if (!queued) return Fail(EINVAL);
+
+    mCond.wait(lock, [&ctx, &queued] { return ctx.done || !queued; });
+    if (!queued) return Fail(EINVAL); // cancelled by STREAMOFF
+
+    queued = false;
+    buf->flags = ctx.error ? V4L2_BUF_FLAG_ERROR : 0;
+    if (buf->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        buf->m.planes[0].bytesused = ctx.error ? 0 : ctx.streamLength;
+        if (buf->length > 1) buf->m.planes[1].bytesused = 0;
+        // the H/W delay in usec.
+        buf->reserved2 = static_cast<__u32>(mJobTime.count());
+    }
+
+    return 0;
+}
+
+void FakeV4L2Jpeg::Pause() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mPaused = true;
+}
+
+void FakeV4L2Jpeg::Resume(bool newestFirst) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mPaused = false;
+        mNewestFirst = newestFirst;
+    }
+    mCond.notify_all();
+}
+
+bool FakeV4L2Jpeg::WaitForJobs(size_t count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mLock);
+    return mCond.wait_for(lock, timeout, [this, count] {
+        return (mJobs.size() + (mRunning ? 1 : 0)) >= count;
+    });
+}
+
+size_t FakeV4L2Jpeg::GetMaxJobs() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mMaxJobs;
+}
+
+std::vector<unsigned int> FakeV4L2Jpeg::GetCompletedJobs() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mCompletedJobs;
+}
+
+void FakeV4L2Jpeg::EngineLoop() {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    while (true) {
+        mCond.wait(lock, [this] { return mExit || (!mPaused && !mJobs.empty()); });
+        if (mExit) return;
+
+        Job job = mNewestFirst ? mJobs.back() : mJobs.front();
+        if (mNewestFirst)
+            mJobs.pop_back();
+        else
+            mJobs.pop_front();
+
+        // the client waits in DQBUF, so the buffers do not change during the job
+        Context ctx = mContexts[job.fd];
+        mRunning = true;
+        lock.unlock();
+
+        std::this_thread::sleep_for(mJobTime);
+        bool compressed = Compress(ctx);
+
+        lock.lock();
+        mRunning = false;
+        auto it = mContexts.find(job.fd);
+        if (it != mContexts.end() && it->second.srcQueued && it->second.dstQueued) {
+            it->second.done = true;
+            it->second.error = !compressed;
+            it->second.streamLength = ctx.streamLength;
+        }
+        mCompletedJobs.push_back(job.seq);
+        mCond.notify_all();
+    }
+}
+
+bool FakeV4L2Jpeg::Compress(Context &ctx) {
+    std::vector<char> stream = {'\xFF', '\xD8', static_cast<char>(ctx.quality)};
+
+    for (unsigned int i = 0; i < ctx.image.fmt.pix_mp.num_planes; i++) {
+        const v4l2_plane &plane = ctx.srcPlanes[i];
+        char *image = MapPlane(ctx.src.memory, plane, PROT_READ);
+        if (image == NULL) return false;
+
+        for (size_t offset = 0; offset < plane.bytesused; offset += kSampleStep) {
+            stream.push_back(image[offset]);
+            // byte stuffing, so no marker appears in the entropy coded data
+            if (image[offset] == '\xFF') stream.push_back('\0');
+        }
+
+        UnmapPlane(ctx.src.memory, plane, image);
+    }
+
+    stream.push_back('\xFF');
+    stream.push_back('\xD9');
+    stream.insert(stream.end(), kTrailingDummies, '\0');
+
+    const v4l2_plane &plane = ctx.dstPlanes[0];
+    if (stream.size() > plane.length) return false;
+
+    char *base = MapPlane(ctx.dst.memory, plane, PROT_READ | PROT_WRITE);
+    if (base == NULL) return false;
+
+    const size_t offset = (ctx.dst.memory == V4L2_MEMORY_DMABUF) ? plane.data_offset : 0;
+    memcpy(base + offset, stream.data(), stream.size());
+    UnmapPlane(ctx.dst.memory, plane, base);
+
+    ctx.streamLength = static_cast<unsigned int>(stream.size());
+
+    return true;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HARDWARE_EXYNOS_FAKE_V4L2_JPEG_H__
+#define __HARDWARE_EXYNOS_FAKE_V4L2_JPEG_H__
+
+#include <exynos-hwjpeg.h>
+#include <linux/videodev2.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * FakeV4L2Jpeg - a V4L2 JPEG compressor with a single engine, served without H/W
+ *
+ * Every open file is a context of the m2m device. A context queues a job when
+ * both of its image and stream buffers are queued, and the engine compresses
+ * the jobs one at a time, taking @jobTime for each. The "compressed" stream is
+ * the SOI, the quality, samples of the image and the EOI followed by a few
+ * dummy bytes, so the output depends only on the image and the quality.
+ */
+class FakeV4L2Jpeg : public CHWJpegV4L2Device {
+public:
+    explicit FakeV4L2Jpeg(unsigned int caps = 0,
+                          std::chrono::microseconds jobTime = std::chrono::microseconds(0));
+    virtual ~FakeV4L2Jpeg();
+
+    virtual int Open(const char *path, int flags);
+    virtual int Close(int fd);
+    virtual int Ioctl(int fd, unsigned long request, void *arg);
+
+    // Holds the jobs in the queue until Resume()
+    void Pause();
+    // Runs the queued jobs. The newest queued job runs first if @newestFirst.
+    void Resume(bool newestFirst = false);
+    // Waits until @count jobs are queued or running. Return false on timeout.
+    bool WaitForJobs(size_t count, std::chrono::milliseconds timeout);
+
+    // The largest number of jobs queued or running at the same time
+    size_t GetMaxJobs();
+    // The sequence numbers of the completed jobs in the completion order. The
+    // jobs are numbered in the queueing order from 0.
+    std::vector<unsigned int> GetCompletedJobs();
+
+private:
+    struct Context {
+        v4l2_format image;
+        int quality = 0;
+        bool reqbufs = false;
+        bool streaming = false;
+        bool srcQueued = false;
+        bool dstQueued = false;
+        bool done = false;
+        bool error = false;
+        v4l2_buffer src;
+        v4l2_plane srcPlanes[VIDEO_MAX_PLANES];
+        v4l2_buffer dst;
+        v4l2_plane dstPlanes[VIDEO_MAX_PLANES];
+        unsigned int streamLength = 0;
+    };
+
+    struct Job {
+        int fd;
+        unsigned int seq;
+    };
+
+    int SetFormat(Context &ctx, v4l2_format *fmt, bool apply);
+    int SetControls(Context &ctx, v4l2_ext_controls *ctrls);
+    int QBuf(int fd, Context &ctx, v4l2_buffer *buf);
+    int DQBuf(std::unique_lock<std::mutex> &lock, Context &ctx, v4l2_buffer *buf);
+    void EngineLoop();
+    // Writes the stream of @ctx. Return false if the stream buffer is too small.
+    static bool Compress(Context &ctx);
+
+    const unsigned int mCaps;
+    const std::chrono::microseconds mJobTime;
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::map<int, Context> mContexts;
+    std::deque<Job> mJobs;
+    bool mRunning = false;
+    bool mPaused = false;
+    bool mNewestFirst = false;
+    bool mExit = false;
+    unsigned int mNextSeq = 0;
+    size_t mMaxJobs = 0;
+    std::vector<unsigned int> mCompletedJobs;
+    std::thread mEngine;
+};
+
+#endif // __HARDWARE_EXYNOS_FAKE_V4L2_JPEG_H__
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ExynosJpegEncoderSession.h>
+#include <gtest/gtest.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+
+#include "fake_v4l2_jpeg.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr int kWidth = 320;
+constexpr int kHeight = 240;
+constexpr int kImageSize = kWidth * kHeight * 3 / 2; // NV21
+constexpr int kStreamSize = 64 * 1024;
+
+// an anonymous shared memory standing for a dma-buf
+class Buffer {
+public:
+    Buffer(const char *name, size_t size) : mSize(size) {
+        mFd = memfd_create(name, 0);
+        if ((mFd < 0) || (ftruncate(mFd, mSize) < 0)) return;
+        void *addr = mmap(NULL, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+        mAddr = (addr == MAP_FAILED) ? NULL : static_cast<char *>(addr);
+    }
+    Buffer(const Buffer &) = delete;
+    Buffer &operator=(const Buffer &) = delete;
+    ~Buffer() {
+        if (mAddr) munmap(mAddr, mSize);
+        if (mFd >= 0) close(mFd);
+    }
+
+    int fd() const { return mFd; }
+    char *addr() const { return mAddr; }
+    size_t size() const { return mSize; }
+
+private:
+    int mFd = -1;
+    char *mAddr = NULL;
+    size_t mSize;
+};
+
+// an image, its stream buffer and the Exif of a capture in a burst
+struct Shot {
+    Buffer image;
+    Buffer stream;
+    exif_attribute_t exif;
+
+    Shot(unsigned int index, int streamSize = kStreamSize)
+          : image("image", kImageSize), stream("stream", streamSize) {
+        // a different image for each shot
+        for (int i = 0; i < kImageSize; i++) image.addr()[i] = static_cast<char>(i * (index + 1));
+
+        memset(&exif, 0, sizeof(exif));
+        exif.width = kWidth;
+        exif.height = kHeight;
+        copyString(exif.maker, "Fake");
+        copyString(exif.model, ("Shot " + std::to_string(index)).c_str());
+    }
+
+    template <typename T, size_t N>
+    static void copyString(T (&field)[N], const char *str) {
+        strncpy(reinterpret_cast<char *>(field), str, N - 1);
+    }
+
+    ExynosJpegEncoderSession::Capture capture(void *cookie, int quality = 90) {
+        ExynosJpegEncoderSession::Capture capture = {};
+        capture.width = kWidth;
+        capture.height = kHeight;
+        capture.colorFormat = V4L2_PIX_FMT_NV21;
+        capture.jpegFormat = V4L2_PIX_FMT_JPEG_420;
+        capture.quality = quality;
+        capture.inBufFd[0] = image.fd();
+        capture.inBufFd[1] = -1;
+        capture.inBufFd[2] = -1;
+        capture.inBufSize[0] = kImageSize;
+        capture.outBufFd = stream.fd();
+        capture.outBuf = stream.addr();
+        capture.outBufSize = static_cast<int>(stream.size());
+        capture.exif = &exif;
+        capture.cookie = cookie;
+        return capture;
+    }
+
+    std::string jpeg(int size) const { return std::string(stream.addr(), size); }
+};
+
+// compresses @shot with a single ExynosJpegEncoderForCamera like the camera HAL does
+int encodeSequentially(ExynosJpegEncoderForCamera &encoder, Shot &shot, int quality = 90) {
+    encoder.setSize(kWidth, kHeight);
+    encoder.setColorFormat(V4L2_PIX_FMT_NV21);
+    if (encoder.setJpegFormat(V4L2_PIX_FMT_JPEG_420) < 0) return -1;
+    if (encoder.setQuality(quality) < 0) return -1;
+    if (encoder.setThumbnailSize(0, 0) < 0) return -1;
+
+    int inBufFd[3] = {shot.image.fd(), -1, -1};
+    int inBufSize[3] = {kImageSize, 0, 0};
+    if (encoder.setInBuf(inBufFd, inBufSize) < 0) return -1;
+
+    int size = static_cast<int>(shot.stream.size());
+    char *outBuf = shot.stream.addr();
+    extra_appinfo_t *appInfo = NULL;
+    if (encoder.encode(&size, &shot.exif, shot.stream.fd(), &outBuf, appInfo) < 0) return -1;
+
+    return size;
+}
+
+// the post-processing of the camera HAL on a compressed capture
+void consumeCapture() {
+    std::this_thread::sleep_for(5ms);
+}
+
+} // namespace
+
+TEST(ExynosJpegEncoderSessionTest, FailsWithoutDepth) {
+    FakeV4L2Jpeg device;
+    ExynosJpegEncoderSession session(0, &device);
+
+    EXPECT_EQ(-1, session.flagCreate());
+
+    Shot shot(0);
+    EXPECT_EQ(-1, session.submit(shot.capture(NULL)));
+}
+
+TEST(ExynosJpegEncoderSessionTest, MatchesSequentialEncoding) {
+    FakeV4L2Jpeg device;
+    ExynosJpegEncoderForCamera encoder(true, &device);
+    ASSERT_EQ(0, encoder.flagCreate());
+
+    constexpr unsigned int kShots = 4;
+    std::vector<std::string> expected;
+    for (unsigned int i = 0; i < kShots; i++) {
+        Shot shot(i);
+        int size = encodeSequentially(encoder, shot, 80 + i);
+        ASSERT_GT(size, 0);
+        expected.push_back(shot.jpeg(size));
+    }
+
+    ExynosJpegEncoderSession session(2, &device);
+    ASSERT_EQ(0, session.flagCreate());
+
+    std::vector<std::unique_ptr<Shot>> shots;
+    for (unsigned int i = 0; i < kShots; i++) shots.emplace_back(new Shot(i));
+
+    unsigned int submitted = 0;
+    for (unsigned int i = 0; i < kShots; i++) {
+        while ((submitted < kShots) && (submitted - i < session.getDepth())) {
+            ASSERT_EQ(0, session.submit(shots[submitted]->capture(shots[submitted].get(),
+                                                                  80 + submitted)));
+            submitted++;
+        }
+
+        ExynosJpegEncoderSession::Result result;
+        ASSERT_EQ(0, session.collect(&result));
+        EXPECT_EQ(shots[i].get(), result.cookie);
+        ASSERT_EQ(0, result.status);
+        EXPECT_EQ(expected[i], shots[i]->jpeg(result.size)) << "capture " << i;
+    }
+}
+
+TEST(ExynosJpegEncoderSessionTest, CollectsInSubmissionOrder) {
+    FakeV4L2Jpeg device;
+    ExynosJpegEncoderSession session(3, &device);
+    ASSERT_EQ(0, session.flagCreate());
+
+    Shot shots[] = {Shot(0), Shot(1), Shot(2)};
+
+    // the H/W completes the captures in the reverse order
+    device.Pause();
+    for (auto &shot : shots) ASSERT_EQ(0, session.submit(shot.capture(&shot)));
+    ASSERT_TRUE(device.WaitForJobs(3, 1s));
+    device.Resume(true);
+
+    for (auto &shot : shots) {
+        ExynosJpegEncoderSession::Result result;
+        ASSERT_EQ(0, session.collect(&result));
+        EXPECT_EQ(&shot, result.cookie);
+        EXPECT_EQ(0, result.status);
+    }
+
+    EXPECT_EQ((std::vector<unsigned int>{2, 1, 0}), device.GetCompletedJobs());
+}
+
+TEST(ExynosJpegEncoderSessionTest, PreparesNextCaptureDuringCompression) {
+    FakeV4L2Jpeg device;
+    ExynosJpegEncoderSession session(2, &device);
+    ASSERT_EQ(0, session.flagCreate());
+
+    Shot shots[] = {Shot(0), Shot(1)};
+
+    // the second capture reaches the H/W queue while the first one is pending
+    device.Pause();
+    for (auto &shot : shots) ASSERT_EQ(0, session.submit(shot.capture(&shot)));
+    EXPECT_TRUE(device.WaitForJobs(2, 1s));
+    device.Resume();
+
+    for (unsigned int i = 0; i < 2; i++) {
+        ExynosJpegEncoderSession::Result result;
+        ASSERT_EQ(0, session.collect(&result));
+        EXPECT_EQ(0, result.status);
+    }
+
+    EXPECT_EQ(2u, device.GetMaxJobs());
+}
+
+TEST(ExynosJpegEncoderSessionTest, RejectsSubmissionBeyondDepth) {
+    FakeV4L2Jpeg device;
+    ExynosJpegEncoderSession session(2, &device);
+    ASSERT_EQ(0, session.flagCreate());
+
+    ExynosJpegEncoderSession::Result result;
+    EXPECT_EQ(-1, session.collect(&result));
+
+    Shot shots[] = {Shot(0), Shot(1), Shot(2)};
+    EXPECT_EQ(0, session.submit(shots[0].capture(&shots[0])));
+    EXPECT_EQ(0, session.submit(shots[1].capture(&shots[1])));
+    EXPECT_EQ(-1, session.submit(shots[2].capture(&shots[2])));
+
+    ASSERT_EQ(0, session.collect(&result));
+    EXPECT_EQ(&shots[0], result.cookie);
+    EXPECT_EQ(0, session.submit(shots[2].capture(&shots[2])));
+
+    for (unsigned int i = 1; i < 3; i++) {
+        ASSERT_EQ(0, session.collect(&result));
+        EXPECT_EQ(&shots[i], result.cookie);
+    }
+    EXPECT_EQ(-1, session.collect(&result));
+}
+
+TEST(ExynosJpegEncoderSessionTest, ContinuesAfterFailedCapture) {
+    FakeV4L2Jpeg device;
+    ExynosJpegEncoderSession session(2, &device);
+    ASSERT_EQ(0, session.flagCreate());
+
+    // the stream buffer has room for the APP1 segment, but not for the stream
+    Shot small(0, 4096);
+    Shot shot(1);
+
+    ASSERT_EQ(0, session.submit(small.capture(&small)));
+    ASSERT_EQ(0, session.submit(shot.capture(&shot)));
+
+    ExynosJpegEncoderSession::Result result;
+    ASSERT_EQ(0, session.collect(&result));
+    EXPECT_EQ(&small, result.cookie);
+    EXPECT_EQ(-1, result.status);
+
+    ASSERT_EQ(0, session.collect(&result));
+    EXPECT_EQ(&shot, result.cookie);
+    EXPECT_EQ(0, result.status);
+    EXPECT_GT(result.size, 0);
+}
+
+// The camera HAL post-processes each capture after its compression. The
+// sequential encoder leaves the H/W idle meanwhile, the session does not.
+TEST(ExynosJpegEncoderSessionTest, BurstThroughput) {
+    constexpr unsigned int kShots = 16;
+    FakeV4L2Jpeg device(0, 10ms);
+
+    std::vector<std::unique_ptr<Shot>> shots;
+    for (unsigned int i = 0; i < kShots; i++) shots.emplace_back(new Shot(i));
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        ExynosJpegEncoderForCamera encoder(true, &device);
+        ASSERT_EQ(0, encoder.flagCreate());
+        for (auto &shot : shots) {
+            ASSERT_GT(encodeSequentially(encoder, *shot), 0);
+            consumeCapture();
+        }
+    }
+    auto sequential = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    {
+        ExynosJpegEncoderSession session(2, &device);
+        ASSERT_EQ(0, session.flagCreate());
+
+        unsigned int submitted = 0;
+        for (unsigned int i = 0; i < kShots; i++) {
+            while ((submitted < kShots) && (submitted - i < session.getDepth())) {
+                ASSERT_EQ(0, session.submit(shots[submitted]->capture(NULL)));
+                submitted++;
+            }
+
+            ExynosJpegEncoderSession::Result result;
+            ASSERT_EQ(0, session.collect(&result));
+            ASSERT_EQ(0, result.status);
+            consumeCapture();
+        }
+    }
+    auto pipelined = std::chrono::steady_clock::now() - start;
+
+    using std::chrono::microseconds;
+    RecordProperty("SequentialUs",
+                   std::to_string(std::chrono::duration_cast<microseconds>(sequential).count()));
+    RecordProperty("PipelinedUs",
+                   std::to_string(std::chrono::duration_cast<microseconds>(pipelined).count()));
+}
@@ -69,6 +69,18 @@ int exynos_ion_open(void);
 int exynos_ion_close(int fd);
 int exynos_ion_alloc(int ion_fd, size_t len,
                       unsigned int heap_mask, unsigned int flags);
+/*
+ * Releases @fd allocated by exynos_ion_alloc() with the same @len, @heap_mask
+ * and @flags. @fd is kept in the recycling pool for the next allocation if the
+ * pool is enabled by exynos_ion_pool_set_budget(). Otherwise, @fd is closed.
+ * The recycled buffers are not cleared.
+ */
+int exynos_ion_free(int ion_fd, int fd, size_t len,
+                    unsigned int heap_mask, unsigned int flags);
+/* The recycling pool is disabled if @bytes is 0 which is the default */
+void exynos_ion_pool_set_budget(size_t bytes);
+/* Closes the least recently freed buffers until the pool has @max_bytes at most */
+void exynos_ion_pool_trim(size_t max_bytes);
 int exynos_ion_import_handle(int ion_fd, int fd, int* handle);
 int exynos_ion_free_handle(int ion_fd, int handle);
 int exynos_ion_sync_fd(int ion_fd, int fd);
@@ -27,9 +27,12 @@
 #include <stdatomic.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <mutex>
 
+#include "ion_pool.h"
+
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(*(a)))
 
 static const struct {
@@ -73,22 +76,65 @@ BufferAllocator& exynos_ion_get_allocator(void) {
     return bufallocator;
 }
 
-int exynos_ion_alloc(int /* ion_fd */, size_t len, unsigned int heap_mask, unsigned int flags) {
+static IonBufferPool& exynos_ion_get_pool(void) {
+    static IonBufferPool pool([](unsigned int heap, size_t len, unsigned int flags) {
+        auto& bufallocator = exynos_ion_get_allocator();
+        const auto& it = heap_map_table[heap];
+
+        int ret = bufallocator.Alloc(it.heap_name, len, flags);
+        if (ret < 0)
+            ALOGE("Failed to alloc %s, %zu %x (%d)", it.heap_name.c_str(), len, flags, ret);
+
+        return ret;
+    });
+
+    return pool;
+}
+
+static int exynos_ion_find_heap(unsigned int heap_mask, unsigned int flags) {
     unsigned int heapflags = flags & (ION_FLAG_PROTECTED | ION_FLAG_CACHED);
 
-    auto& bufallocator = exynos_ion_get_allocator();
+    for (unsigned int i = 0; i < ARRAY_SIZE(heap_map_table); i++) {
+        if ((heap_mask == heap_map_table[i].legacy_ion_heap_mask) &&
+            (heapflags == heap_map_table[i].ion_heap_flags))
+            return i;
+    }
+
+    return -1;
+}
+
+int exynos_ion_alloc(int /* ion_fd */, size_t len, unsigned int heap_mask, unsigned int flags) {
+    int heap = exynos_ion_find_heap(heap_mask, flags);
+
+    if (heap < 0) {
+        ALOGE("%s: unable to find heaps of heap_mask %#x", __func__, heap_mask);
+        return -EINVAL;
+    }
 
-    for (const auto& it : heap_map_table) {
-        if ((heap_mask == it.legacy_ion_heap_mask) && (heapflags == it.ion_heap_flags)) {
-            int ret = bufallocator.Alloc(it.heap_name, len, flags);
-            if (ret < 0)
-                ALOGE("Failed to alloc %s, %zu %x (%d)", it.heap_name.c_str(), len, flags, ret);
+    return exynos_ion_get_pool().alloc(heap, len, flags);
+}
+
+int exynos_ion_free(int /* ion_fd */, int fd, size_t len, unsigned int heap_mask,
+                    unsigned int flags) {
+    int heap = exynos_ion_find_heap(heap_mask, flags);
 
-            return ret;
-        }
+    if (heap < 0) {
+        ALOGE("%s: unable to find heaps of heap_mask %#x", __func__, heap_mask);
+        close(fd);
+        return -EINVAL;
     }
-    ALOGE("%s: unable to find heaps of heap_mask %#x", __func__, heap_mask);
-    return -EINVAL;
+
+    exynos_ion_get_pool().free(heap, len, flags, fd);
+
+    return 0;
+}
+
+void exynos_ion_pool_set_budget(size_t bytes) {
+    exynos_ion_get_pool().setBudget(bytes);
+}
+
+void exynos_ion_pool_trim(size_t max_bytes) {
+    exynos_ion_get_pool().trim(max_bytes);
 }
 
 int exynos_ion_import_handle(int /* ion_fd */, int fd, int* handle) {
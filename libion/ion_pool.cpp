@@ -0,0 +1,184 @@
+/*
+ *  ion_pool.cpp
+ *
+ *   Copyright 2021 Samsung Electronics Co., Ltd.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include "ion_pool.h"
+
+#define ION_POOL_PAGE_SIZE 4096UL
+#define ION_POOL_CLASSES_PER_ORDER 8
+
+static inline size_t round_up(size_t len, size_t align) {
+    return (len + align - 1) / align * align;
+}
+
+size_t IonBufferPool::sizeClass(size_t len) {
+    len = round_up(len, ION_POOL_PAGE_SIZE);
+
+    if (len <= ION_POOL_PAGE_SIZE * ION_POOL_CLASSES_PER_ORDER)
+        return len;
+
+    size_t order = 1;
+    while ((order << 1) <= len)
+        order <<= 1;
+
+    return round_up(len, order / ION_POOL_CLASSES_PER_ORDER);
+}
+
+void IonBufferPool::setBudget(size_t bytes) {
+    std::vector<int> victims;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        mBudget = bytes;
+        trimLocked(bytes, victims);
+    }
+
+    for (int fd : victims)
+        close(fd);
+}
+
+size_t IonBufferPool::getBudget() {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    return mBudget;
+}
+
+int IonBufferPool::alloc(unsigned int heap, size_t len, unsigned int flags) {
+    size_t size = sizeClass(len);
+    bool pooled = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        if (mBudget == 0) {
+            size = len;
+        } else {
+            auto it = mBuffers.find(Key(heap, flags, size));
+            if (it != mBuffers.end()) {
+                // the most recently released buffer is likely to be still hot in the cache
+                int fd = it->second.back().fd;
+
+                it->second.pop_back();
+                if (it->second.empty())
+                    mBuffers.erase(it);
+
+                mPooledBytes -= size;
+                mPooledBuffers--;
+                mHits++;
+
+                return fd;
+            }
+
+            mMisses++;
+            pooled = mPooledBuffers > 0;
+        }
+    }
+
+    int fd = mAlloc(heap, size, flags);
+    if ((fd < 0) && pooled) {
+        // The system is short of memory. Give the pooled buffers back and try again.
+        trim(0);
+        fd = mAlloc(heap, size, flags);
+    }
+
+    return fd;
+}
+
+void IonBufferPool::free(unsigned int heap, size_t len, unsigned int flags, int fd) {
+    if (fd < 0)
+        return;
+
+    size_t size = sizeClass(len);
+    bool disabled;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        disabled = mBudget == 0;
+    }
+
+    // The pool is disabled. Close the buffer without looking into it.
+    if (disabled) {
+        close(fd);
+        return;
+    }
+
+    // The buffer allocated before the pool is enabled might be smaller than its size class
+    off_t bufsize = lseek(fd, 0, SEEK_END);
+    lseek(fd, 0, SEEK_SET);
+
+    std::vector<int> victims;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        if ((size == 0) || (size > mBudget) || (bufsize < static_cast<off_t>(size))) {
+            victims.push_back(fd);
+        } else {
+            mBuffers[Key(heap, flags, size)].push_back({fd, mSeq++});
+            mPooledBytes += size;
+            mPooledBuffers++;
+
+            trimLocked(mBudget, victims);
+        }
+    }
+
+    for (int victim : victims)
+        close(victim);
+}
+
+void IonBufferPool::trim(size_t maxBytes) {
+    std::vector<int> victims;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        trimLocked(maxBytes, victims);
+    }
+
+    for (int fd : victims)
+        close(fd);
+}
+
+void IonBufferPool::trimLocked(size_t maxBytes, std::vector<int> &victims) {
+    while (mPooledBytes > maxBytes) {
+        // buffers of each key are ordered by the release order
+        auto oldest = mBuffers.begin();
+        for (auto it = mBuffers.begin(); it != mBuffers.end(); ++it) {
+            if (it->second.front().seq < oldest->second.front().seq)
+                oldest = it;
+        }
+
+        victims.push_back(oldest->second.front().fd);
+        oldest->second.erase(oldest->second.begin());
+
+        mPooledBytes -= std::get<2>(oldest->first);
+        mPooledBuffers--;
+
+        if (oldest->second.empty())
+            mBuffers.erase(oldest);
+    }
+}
+
+IonBufferPool::Stats IonBufferPool::getStats() {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    return {mHits, mMisses, mPooledBytes, mPooledBuffers};
+}
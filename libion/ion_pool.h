@@ -0,0 +1,94 @@
+/*
+ *  ion_pool.h
+ *
+ *   Copyright 2021 Samsung Electronics Co., Ltd.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef __LIBION_ION_POOL_H__
+#define __LIBION_ION_POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+/*
+ * IonBufferPool keeps the dmabufs released by exynos_ion_free() and hands
+ * them out again to the allocations of the same heap, flags and size class
+ * instead of calling the allocator. The pooled buffers are limited by the byte
+ * budget and the least recently released buffers are closed first when the
+ * budget is exceeded or the pool is trimmed.
+ *
+ * The pool is disabled until a budget is given. The recycled buffers are NOT
+ * cleared, so the pool should be enabled only by the processes that do not
+ * depend on the zeroed buffers.
+ */
+class IonBufferPool {
+public:
+    // returns a dmabuf fd or a negative error number
+    typedef std::function<int(unsigned int heap, size_t len, unsigned int flags)> AllocFunc;
+
+    struct Stats {
+        size_t hits;
+        size_t misses;
+        size_t pooledBytes;
+        size_t pooledBuffers;
+    };
+
+    explicit IonBufferPool(AllocFunc alloc) : mAlloc(alloc) {}
+    ~IonBufferPool() { trim(0); }
+
+    // Rounds @len up to the size class. Each power of two is divided into
+    // 8 classes so that at most 1/8 of a buffer is wasted.
+    static size_t sizeClass(size_t len);
+
+    void setBudget(size_t bytes);
+    size_t getBudget();
+
+    int alloc(unsigned int heap, size_t len, unsigned int flags);
+    // takes the ownership of @fd. @fd is closed if it is not pooled.
+    void free(unsigned int heap, size_t len, unsigned int flags, int fd);
+    // closes the pooled buffers until the pooled bytes is not larger than @maxBytes
+    void trim(size_t maxBytes);
+
+    Stats getStats();
+
+private:
+    typedef std::tuple<unsigned int, unsigned int, size_t> Key; // heap, flags, size class
+
+    struct PooledBuffer {
+        int fd;
+        uint64_t seq; // release order to find the least recently released buffer
+    };
+
+    void trimLocked(size_t maxBytes, std::vector<int> &victims);
+
+    AllocFunc mAlloc;
+
+    std::mutex mLock;
+    std::map<Key, std::vector<PooledBuffer>> mBuffers;
+    size_t mBudget = 0;
+    size_t mPooledBytes = 0;
+    size_t mPooledBuffers = 0;
+    uint64_t mSeq = 0;
+    size_t mHits = 0;
+    size_t mMisses = 0;
+};
+
+#endif /* __LIBION_ION_POOL_H__ */
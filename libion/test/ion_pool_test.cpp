@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2021 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <gtest/gtest.h>
+
+#include "../ion_pool.h"
+#include "ion_test_define.h"
+
+/*
+ * The allocator is stubbed with memfd so that the pool is tested on the host
+ * without ION or dmabuf heaps.
+ */
+class IonPoolTest : public ::testing::Test {
+protected:
+    size_t m_allocCount = 0;
+    bool m_failNext = false;
+
+    IonBufferPool m_pool{[this](unsigned int, size_t len, unsigned int) { return stubAlloc(len); }};
+
+    int stubAlloc(size_t len) {
+        m_allocCount++;
+
+        if (m_failNext) {
+            m_failNext = false;
+            return -ENOMEM;
+        }
+
+        int fd = memfd_create("ion_pool_test", MFD_CLOEXEC);
+        if (fd < 0)
+            return -errno;
+
+        if (ftruncate(fd, len) < 0) {
+            close(fd);
+            return -errno;
+        }
+
+        return fd;
+    }
+
+    static ino_t inode(int fd) {
+        struct stat st;
+
+        return (fstat(fd, &st) < 0) ? 0 : st.st_ino;
+    }
+
+    static bool isOpen(int fd) {
+        return fcntl(fd, F_GETFD) >= 0;
+    }
+};
+
+TEST_F(IonPoolTest, SizeClass)
+{
+    EXPECT_EQ(kb(4), IonBufferPool::sizeClass(1));
+    EXPECT_EQ(kb(4), IonBufferPool::sizeClass(kb(4)));
+    EXPECT_EQ(kb(32), IonBufferPool::sizeClass(kb(29)));
+    EXPECT_EQ(kb(36), IonBufferPool::sizeClass(kb(33)));
+    EXPECT_EQ(mb(1), IonBufferPool::sizeClass(mb(1)));
+    EXPECT_EQ(mkb(1, 128), IonBufferPool::sizeClass(mb(1) + 1));
+
+    // at most 1/8 of the size class is wasted
+    for (size_t len = kb(64); len < mb(64); len = len * 3 / 2 + 1)
+        EXPECT_LE(IonBufferPool::sizeClass(len) - len, len / 8 + kb(4)) << "len " << len;
+}
+
+TEST_F(IonPoolTest, DisabledByDefault)
+{
+    int fd = m_pool.alloc(0, kb(10), 0);
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(kb(10), lseek(fd, 0, SEEK_END));
+
+    m_pool.free(0, kb(10), 0, fd);
+    EXPECT_FALSE(isOpen(fd));
+
+    ASSERT_EQ(0u, m_pool.getStats().pooledBuffers);
+}
+
+TEST_F(IonPoolTest, DisabledPoolClosesWithoutSeeking)
+{
+    int fd = m_pool.alloc(0, kb(10), 0);
+    ASSERT_GE(fd, 0);
+
+    // the duplicate shares the file offset with the freed fd
+    int dupfd = dup(fd);
+    ASSERT_GE(dupfd, 0);
+    ASSERT_EQ(100, lseek(dupfd, 100, SEEK_SET));
+
+    m_pool.free(0, kb(10), 0, fd);
+    EXPECT_FALSE(isOpen(fd));
+    EXPECT_EQ(100, lseek(dupfd, 0, SEEK_CUR));
+
+    close(dupfd);
+}
+
+TEST_F(IonPoolTest, Reuse)
+{
+    m_pool.setBudget(mb(4));
+
+    int fd = m_pool.alloc(0, kb(100), 0);
+    ASSERT_GE(fd, 0);
+    ino_t ino = inode(fd);
+    m_pool.free(0, kb(100), 0, fd);
+
+    // the same size class of the same heap and flags
+    fd = m_pool.alloc(0, kb(98), 0);
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(ino, inode(fd));
+    EXPECT_EQ(1u, m_allocCount);
+    m_pool.free(0, kb(98), 0, fd);
+
+    // different flags, heap and size class should not share the buffer
+    int fd1 = m_pool.alloc(0, kb(100), 1);
+    int fd2 = m_pool.alloc(1, kb(100), 0);
+    int fd3 = m_pool.alloc(0, kb(200), 0);
+    ASSERT_GE(fd1, 0);
+    ASSERT_GE(fd2, 0);
+    ASSERT_GE(fd3, 0);
+    EXPECT_EQ(4u, m_allocCount);
+    EXPECT_EQ(1u, m_pool.getStats().pooledBuffers);
+
+    m_pool.free(0, kb(100), 1, fd1);
+    m_pool.free(1, kb(100), 0, fd2);
+    m_pool.free(0, kb(200), 0, fd3);
+
+    IonBufferPool::Stats stats = m_pool.getStats();
+    EXPECT_EQ(1u, stats.hits);
+    EXPECT_EQ(4u, stats.misses);
+    EXPECT_EQ(4u, stats.pooledBuffers);
+}
+
+TEST_F(IonPoolTest, Budget)
+{
+    m_pool.setBudget(kb(256));
+
+    std::vector<int> fds;
+    for (int i = 0; i < 4; i++) {
+        fds.push_back(m_pool.alloc(0, kb(64), 0));
+        ASSERT_GE(fds.back(), 0);
+    }
+    int large = m_pool.alloc(0, kb(512), 0);
+    ASSERT_GE(large, 0);
+
+    for (int fd : fds)
+        m_pool.free(0, kb(64), 0, fd);
+    EXPECT_EQ(kb(256), m_pool.getStats().pooledBytes);
+
+    // larger than the budget
+    m_pool.free(0, kb(512), 0, large);
+    EXPECT_FALSE(isOpen(large));
+
+    // the least recently released buffer is closed first
+    int fd = m_pool.alloc(0, kb(128), 0);
+    ASSERT_GE(fd, 0);
+    m_pool.free(0, kb(128), 0, fd);
+    EXPECT_EQ(kb(256), m_pool.getStats().pooledBytes);
+    EXPECT_FALSE(isOpen(fds[0]));
+    EXPECT_FALSE(isOpen(fds[1]));
+    EXPECT_TRUE(isOpen(fds[2]));
+    EXPECT_TRUE(isOpen(fds[3]));
+    EXPECT_TRUE(isOpen(fd));
+
+    m_pool.setBudget(kb(128));
+    EXPECT_EQ(kb(128), m_pool.getStats().pooledBytes);
+    EXPECT_TRUE(isOpen(fd));
+
+    m_pool.setBudget(0);
+    EXPECT_EQ(0u, m_pool.getStats().pooledBytes);
+    EXPECT_FALSE(isOpen(fd));
+}
+
+TEST_F(IonPoolTest, Trim)
+{
+    m_pool.setBudget(mb(1));
+
+    int fd1 = m_pool.alloc(0, kb(64), 0);
+    int fd2 = m_pool.alloc(0, kb(64), 0);
+    ASSERT_GE(fd1, 0);
+    ASSERT_GE(fd2, 0);
+    m_pool.free(0, kb(64), 0, fd1);
+    m_pool.free(0, kb(64), 0, fd2);
+
+    m_pool.trim(kb(64));
+    EXPECT_FALSE(isOpen(fd1));
+    EXPECT_TRUE(isOpen(fd2));
+
+    m_pool.trim(0);
+    EXPECT_FALSE(isOpen(fd2));
+    EXPECT_EQ(0u, m_pool.getStats().pooledBuffers);
+}
+
+TEST_F(IonPoolTest, TrimOnAllocationFailure)
+{
+    m_pool.setBudget(mb(1));
+
+    int fd = m_pool.alloc(0, kb(256), 0);
+    ASSERT_GE(fd, 0);
+    ino_t ino = inode(fd);
+    m_pool.free(0, kb(256), 0, fd);
+
+    // the pooled buffers are released and the allocation is retried
+    m_failNext = true;
+    int fd2 = m_pool.alloc(0, kb(384), 0);
+    EXPECT_GE(fd2, 0);
+    EXPECT_EQ(3u, m_allocCount);
+    EXPECT_NE(ino, inode(fd2));
+    EXPECT_EQ(0u, m_pool.getStats().pooledBuffers);
+    close(fd2);
+}
+
+TEST_F(IonPoolTest, RejectSmallerBuffer)
+{
+    int fd = m_pool.alloc(0, kb(33), 0);
+    ASSERT_GE(fd, 0);
+
+    // allocated before the pool is enabled. It is smaller than the size class.
+    m_pool.setBudget(mb(1));
+    m_pool.free(0, kb(33), 0, fd);
+    EXPECT_FALSE(isOpen(fd));
+    EXPECT_EQ(0u, m_pool.getStats().pooledBuffers);
+}
+
+TEST_F(IonPoolTest, AllocationLatency)
+{
+    static const size_t sizes[] = {kb(4), kb(96), mb(1), mb(8)};
+    static const int iterations = 200;
+
+    for (size_t size : sizes) {
+        SCOPED_TRACE(::testing::Message() << "size " << size);
+
+        auto measure = [&] {
+            auto begin = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                int fd = m_pool.alloc(0, size, 0);
+                EXPECT_GE(fd, 0);
+                void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                EXPECT_NE(MAP_FAILED, p);
+                if (p != MAP_FAILED) {
+                    *reinterpret_cast<char *>(p) = 1;
+                    munmap(p, size);
+                }
+                m_pool.free(0, size, 0, fd);
+            }
+            auto elapsed = std::chrono::steady_clock::now() - begin;
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() /
+                    iterations;
+        };
+
+        m_pool.setBudget(0);
+        long direct = measure();
+        m_pool.setBudget(mb(32));
+        long pooled = measure();
+
+        RecordProperty("direct_ns_" + std::to_string(size), direct);
+        RecordProperty("pooled_ns_" + std::to_string(size), pooled);
+        std::cout << "size " << size << ": " << direct << " ns without pool, "
+                  << pooled << " ns with pool" << std::endl;
+    }
+}
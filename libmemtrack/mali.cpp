@@ -15,12 +15,22 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/inotify.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <log/log.h>
 
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include <hardware/memtrack.h>
 
 #include "memtrack_exynos.h"
@@ -33,10 +43,7 @@
 #define MALI_DEBUG_FS_PATH 		"/d/mali/mem/"
 #define MALI_DEBUG_MEM_FILE		"/mem_profile"
 
-#define MAX_FILES_PER_PID 		8
-#define MAX_FILES_PER_NAME		32
-static int libmemtrack_gbl_input_filename_counter = 	0;
-static char libmemtrack_gbl_input_filename[MAX_FILES_PER_PID][MAX_FILES_PER_NAME];
+#define MALI_PROFILE_BUFFER_SIZE	4096
 
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
 #define min(x, y) ((x) < (y) ? (x) : (y))
@@ -54,47 +61,252 @@ struct memtrack_record record_templates[] = {
     },
 };
 
-static void scan_directory_for_filenames(pid_t pid)
+/*
+ * The mem_profile files of the processes using Mali, found in one scan of
+ * MALI_DEBUG_FS_PATH, or of the directory set by the tests. A context
+ * directory of a process is named as "<pid>_<context id>". The cache is
+ * scanned again after a context directory is created or removed. It is
+ * notified by inotify. If inotify is not available, the link count and the
+ * modification time of the directory are compared instead.
+ */
+struct mali_profile_cache {
+    std::mutex lock;
+    std::string dir = MALI_DEBUG_FS_PATH;
+    bool use_inotify = true;
+    bool initialized = false;
+    bool valid = false;
+    int inotify_fd = -1;
+    nlink_t dir_nlink = 0;
+    struct timespec dir_mtime = {};
+    std::unordered_map<pid_t, std::vector<std::string>> profiles;
+};
+
+static mali_profile_cache libmemtrack_profile_cache;
+
+static void init_profile_watch(mali_profile_cache &cache)
+{
+    cache.initialized = true;
+
+    if (!cache.use_inotify)
+        return;
+
+    cache.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (cache.inotify_fd < 0) {
+        ALOGW("libmemtrack-hw -- inotify is not available: %s", strerror(errno));
+        return;
+    }
+
+    if (inotify_add_watch(cache.inotify_fd, cache.dir.c_str(),
+                          IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR) < 0) {
+        ALOGW("libmemtrack-hw -- Couldn't watch %s: %s", cache.dir.c_str(), strerror(errno));
+        close(cache.inotify_fd);
+        cache.inotify_fd = -1;
+    }
+}
+
+static bool profile_cache_is_stale(mali_profile_cache &cache)
+{
+    if (!cache.valid)
+        return true;
+
+    if (cache.inotify_fd >= 0) {
+        /* Any event including IN_Q_OVERFLOW makes the cache stale. */
+        char events[1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+        bool changed = false;
+
+        while (read(cache.inotify_fd, events, sizeof(events)) > 0)
+            changed = true;
+
+        return changed;
+    }
+
+    struct stat st;
+    if (stat(cache.dir.c_str(), &st))
+        return true;
+
+    return (st.st_nlink != cache.dir_nlink) ||
+           (st.st_mtim.tv_sec != cache.dir_mtime.tv_sec) ||
+           (st.st_mtim.tv_nsec != cache.dir_mtime.tv_nsec);
+}
+
+static void scan_directory_for_profiles(mali_profile_cache &cache)
 {
     /* As per ARM, there can be multiple files */
     DIR *directory;
     struct dirent *entries;
-    char pid_string[12] = {0};
-    int pid_index = 0;
+    struct stat st;
+
+    cache.profiles.clear();
+    cache.valid = false;
+
+    /* The directory is changed during the scan if it is changed after stat. */
+    if (cache.inotify_fd < 0) {
+        if (stat(cache.dir.c_str(), &st) == 0) {
+            cache.dir_nlink = st.st_nlink;
+            cache.dir_mtime = st.st_mtim;
+        }
+    }
 
     /* Open directory. */
-    directory = opendir(MALI_DEBUG_FS_PATH);
+    directory = opendir(cache.dir.c_str());
+    if (directory == NULL) {
+        ALOGE("libmemtrack-hw -- Couldn't open the directory - %s \r\n", cache.dir.c_str());
+        return;
+    }
 
-    sprintf(pid_string, "%d", pid);
-    for (pid_index = 0; pid_index < 12; pid_index++) {
-        if (pid_string[pid_index] == 0) {
-            pid_string[pid_index] = '_';
-            break;
+    /* Keep reading the directory. */
+    while ((entries = readdir(directory))) {
+        char *end;
+        long pid = strtol(entries->d_name, &end, 10);
+
+        if ((end == entries->d_name) || (*end != '_'))
+            continue;
+
+        cache.profiles[static_cast<pid_t>(pid)].push_back(
+                cache.dir + entries->d_name + MALI_DEBUG_MEM_FILE);
+    }
+
+    /* Close directory before leaving. */
+    (void) closedir(directory);
+
+    cache.valid = true;
+}
+
+static std::vector<std::string> get_profiles(pid_t pid)
+{
+    mali_profile_cache &cache = libmemtrack_profile_cache;
+    std::lock_guard<std::mutex> lock(cache.lock);
+
+    /* The watch is added before the first scan not to miss any change. */
+    if (!cache.initialized)
+        init_profile_watch(cache);
+
+    if (profile_cache_is_stale(cache))
+        scan_directory_for_profiles(cache);
+
+    auto it = cache.profiles.find(pid);
+    if (it == cache.profiles.end())
+        return std::vector<std::string>();
+
+    return it->second;
+}
+
+void mali_memtrack_set_debug_fs_path(const char *path, bool use_inotify)
+{
+    mali_profile_cache &cache = libmemtrack_profile_cache;
+    std::lock_guard<std::mutex> lock(cache.lock);
+
+    if (cache.inotify_fd >= 0)
+        close(cache.inotify_fd);
+    cache.inotify_fd = -1;
+    cache.dir = path;
+    cache.use_inotify = use_inotify;
+    cache.initialized = false;
+    cache.valid = false;
+    cache.profiles.clear();
+}
+
+static void invalidate_profiles()
+{
+    std::lock_guard<std::mutex> lock(libmemtrack_profile_cache.lock);
+    libmemtrack_profile_cache.valid = false;
+}
+
+/*
+ * Reads the whole file at @path to @buf. @buf is reused by the following reads
+ * of the same thread. Returns the length of the file terminated by '\0' or -1.
+ */
+static ssize_t read_profile(const char *path, std::vector<char> &buf)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    if (buf.size() < MALI_PROFILE_BUFFER_SIZE)
+        buf.resize(MALI_PROFILE_BUFFER_SIZE);
+
+    size_t len = 0;
+    while (true) {
+        /* one byte is left for '\0' */
+        if (len + 1 == buf.size())
+            buf.resize(buf.size() * 2);
+
+        ssize_t ret = TEMP_FAILURE_RETRY(pread(fd, buf.data() + len, buf.size() - len - 1, len));
+        if (ret < 0) {
+            close(fd);
+            return -1;
         }
+        if (ret == 0)
+            break;
+        len += ret;
     }
 
-    libmemtrack_gbl_input_filename_counter = 0;
-
-    if (directory != NULL) {
-        /* Keep reading the directory. */
-        while ((entries = readdir(directory))) {
-            /* Check if the PID is present in the direcotry entry.
-             * If it is present, then keep the filename for reading
-             * contents. Also concatenate the directory path, so that
-             * file can be opened.
-             * */
-            if (!strncmp(entries->d_name, pid_string, strlen(pid_string))) {
-                snprintf(&libmemtrack_gbl_input_filename[libmemtrack_gbl_input_filename_counter][0], MAX_FILES_PER_NAME, "%s%s%s", MALI_DEBUG_FS_PATH, entries->d_name, MALI_DEBUG_MEM_FILE);
-                libmemtrack_gbl_input_filename_counter++;
-            }
+    close(fd);
+    buf[len] = '\0';
+
+    return len;
+}
+
+static void add_memory_size(long long int *sum, long long int val)
+{
+    if ((INT64_MAX - val) > *sum)
+        *sum += val;
+    else
+        *sum = INT64_MAX;
+}
+
+/*
+ * Accumulates the Native Buffer memory and the total memory in the profile.
+ * The total memory is the sum of "Total" lines following the first Native
+ * Buffer line, or all "Total" lines if no Native Buffer is found.
+ */
+static void parse_profile(char *profile, size_t len,
+                          long long int *native_buf_mem_size, long long int *total_memory_size)
+{
+    char *end = profile + len;
+    char *totals = profile;
+    long long int temp_val = 0;
+
+    for (char *line = profile; line < end; line++)
+        if (*line == '\n')
+            *line = '\0';
+
+    for (char *line = profile; line < end; line += strlen(line) + 1) {
+        char memory_type[16] = {0};
+        char memory_type_2[16] = {0};
+
+        /* Search for Native Buffer. */
+        /* Format:
+         *
+         * Channel: Native Buffer (Total memory: 44285952)
+         *
+         */
+        if (sscanf(line, "%*s %15s %15s %*s %*s %lld \n", memory_type, memory_type_2, &temp_val) != 3)
+            continue;
+
+        if ((strcmp(memory_type, "Native") == 0) &&
+                (strcmp(memory_type_2, "Buffer") == 0)) {
+            add_memory_size(native_buf_mem_size, temp_val);
+            totals = line + strlen(line) + 1;
+            break;
         }
-        /* Close directory before leaving. */
-        (void) closedir(directory);
-    } else {
-        ALOGE("libmemtrack-hw -- Couldn't open the directory - %s \r\n", MALI_DEBUG_FS_PATH);
     }
 
-    return;
+    for (char *line = totals; line < end; line += strlen(line) + 1) {
+        char memory_type[16] = {0};
+
+        /* Search for Total memory. */
+        /* Format:
+         *
+         * Total allocated memory: 36146960
+         *
+         */
+        if (sscanf(line, "%15s %*s %*s %lld \n", memory_type, &temp_val) != 2)
+            continue;
+
+        if (strcmp(memory_type, "Total") == 0)
+            add_memory_size(total_memory_size, temp_val);
+    }
 }
 
 int mali_memtrack_get_memory(pid_t pid, int __unused type,
@@ -102,11 +314,8 @@ int mali_memtrack_get_memory(pid_t pid, int __unused type,
                              size_t *num_records)
 {
     size_t allocated_records = min(*num_records, ARRAY_SIZE(record_templates));
-    FILE *fp;
-    int local_count;
-    long long int temp_val = 0, total_memory_size = 0, native_buf_mem_size = 0;
-    bool native_buffer_read = false;
-    char line[1024] = {0};
+    long long int total_memory_size = 0, native_buf_mem_size = 0;
+    static thread_local std::vector<char> profile;
 
     *num_records = ARRAY_SIZE(record_templates);
 
@@ -118,109 +327,18 @@ int mali_memtrack_get_memory(pid_t pid, int __unused type,
     memcpy(records, record_templates,
            sizeof(struct memtrack_record) * allocated_records);
 
-    /* First, scan the directoy. */
-    scan_directory_for_filenames(pid);
-
-    local_count = 0;
-    total_memory_size = 0;
-    native_buf_mem_size = 0;
-
-    while (local_count < libmemtrack_gbl_input_filename_counter) {
-        fp = fopen(&libmemtrack_gbl_input_filename[local_count][0], "r");
+    for (const std::string &path : get_profiles(pid)) {
+        ssize_t len = read_profile(path.c_str(), profile);
 
-        if (fp == NULL) {
-            /* Unable to open the file. Either move to next file, or
-             * return to caller. */
-            local_count++;
+        if (len < 0) {
+            /* The context is destroyed after the scan. Move to next file. */
+            if (errno == ENOENT)
+                invalidate_profiles();
             continue;
         }
 
-        while (1) {
-            char memory_type[16] = {0};
-            char memory_type_2[16] = {0};
-            int ret = 0;
-
-            if (native_buffer_read == false) {
-                if (fgets(line, sizeof(line), fp) == NULL) {
-                    if (native_buffer_read == false) {
-                        /* Unable to read Native buffer.
-                         * Probably DDK doesn't support Native Buffer.
-                         * Reset to start of file and look for Total
-                         * Memory. */
-                        fseek(fp, 0, SEEK_SET);
-
-                        /* Also, set Native buffer flag and memory sizes. */
-                        native_buffer_read = true;
-                        continue;
-                    }
-                }
-
-                /* Search for Total memory. */
-                /* Format:
-                 *
-                 * Channel: Native Buffer (Total memory: 44285952)
-                 *
-                 */
-                ret = sscanf(line, "%*s %15s %15s %*s %*s %lld \n", memory_type, memory_type_2, &temp_val);
-
-                if (ret != 3)
-                    continue;
-
-                if ((strcmp(memory_type, "Native") == 0) &&
-                        (strcmp(memory_type_2, "Buffer") == 0)) {
-                    /* Set native buffer memory read flag to true. */
-                    native_buffer_read = true;
-                    if ((INT64_MAX - temp_val) > native_buf_mem_size)
-                        native_buf_mem_size += temp_val;
-                    else
-                        native_buf_mem_size = INT64_MAX;
-                } else {
-                    /* Ignore case. Nothing to do here. */
-                    /* Continue reading file until NativeBuffer is found. */
-                }
-            } else {
-                if (fgets(line, sizeof(line), fp) == NULL) {
-                    /* Unable to find, so break the loop here.*/
-                    break;
-                }
-
-                /* Search for Total memory. */
-                /* Format:
-                 *
-                 * Total allocated memory: 36146960
-                 *
-                 */
-                ret = sscanf(line, "%15s %*s %*s %lld \n", memory_type, &temp_val);
-
-                if (ret != 2)
-                    continue;
-
-                if (strcmp(memory_type, "Total") == 0) {
-                    /* Store total memory. */
-                    if ((INT64_MAX - temp_val) > total_memory_size)
-                        total_memory_size += temp_val;
-                    else
-                        total_memory_size = INT64_MAX;
-                } else {
-                    /* Ignore case. Nothing to do here. */
-                }
-            } /* end if (native_buffer_read == false) */
-
-        } /* End while(1) */
-
-        if (fp != NULL) {
-            /* Close the opened file. */
-            fclose(fp);
-
-            /* Reset some of the local variables here. */
-            fp = NULL;
-            native_buffer_read = false;
-        }
-
-        /* Manage local variables and counters. */
-        local_count++;
-
-    } /* while (local_count <= libmemtrack_gbl_input_filename_counter) */
+        parse_profile(profile.data(), len, &native_buf_mem_size, &total_memory_size);
+    }
 
     /* Arrange and return memory size details. */
     if (allocated_records > 0)
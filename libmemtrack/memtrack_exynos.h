@@ -20,6 +20,11 @@
 int mali_memtrack_get_memory(pid_t pid, int type,
                              struct memtrack_record *records,
                              size_t *num_records);
+/*
+ * Reads the Mali profiles from @path instead of MALI_DEBUG_FS_PATH, with the
+ * directory changes notified by inotify or found by stat. For the tests.
+ */
+void mali_memtrack_set_debug_fs_path(const char *path, bool use_inotify);
 int ion_memtrack_get_memory(pid_t pid, int type,
                              struct memtrack_record *records,
                              size_t *num_records);
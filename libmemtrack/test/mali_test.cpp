@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <hardware/memtrack.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "memtrack_exynos.h"
+
+namespace {
+
+constexpr pid_t kPid = 1234;
+
+const char *kNativeProfile =
+        "ctx 1\n"
+        "Channel: Native Buffer (Total memory: 1000)\n"
+        "Total allocated memory: 4000\n"
+        "Channel: Default Heap (Total memory: 600)\n"
+        "Total allocated memory: 3000\n";
+
+/*
+ * The parsing of mali_memtrack_get_memory() before the profiles were cached, for
+ * the comparison. Returns the unaccounted memory of the profiles at @paths.
+ */
+long long legacy_get_unaccounted(const std::vector<std::string> &paths)
+{
+    long long temp_val = 0, total_memory_size = 0, native_buf_mem_size = 0;
+    bool native_buffer_read = false;
+    char line[1024] = {0};
+
+    for (const std::string &path : paths) {
+        FILE *fp = fopen(path.c_str(), "r");
+        if (fp == NULL)
+            continue;
+
+        while (1) {
+            char memory_type[16] = {0};
+            char memory_type_2[16] = {0};
+
+            if (native_buffer_read == false) {
+                if (fgets(line, sizeof(line), fp) == NULL) {
+                    fseek(fp, 0, SEEK_SET);
+                    native_buffer_read = true;
+                    continue;
+                }
+                if (sscanf(line, "%*s %15s %15s %*s %*s %lld \n", memory_type, memory_type_2,
+                           &temp_val) != 3)
+                    continue;
+                if ((strcmp(memory_type, "Native") == 0) && (strcmp(memory_type_2, "Buffer") == 0)) {
+                    native_buffer_read = true;
+                    native_buf_mem_size += temp_val;
+                }
+            } else {
+                if (fgets(line, sizeof(line), fp) == NULL)
+                    break;
+                if (sscanf(line, "%15s %*s %*s %lld \n", memory_type, &temp_val) != 2)
+                    continue;
+                if (strcmp(memory_type, "Total") == 0)
+                    total_memory_size += temp_val;
+            }
+        }
+
+        fclose(fp);
+        native_buffer_read = false;
+    }
+
+    if (native_buf_mem_size >= 0 && total_memory_size > native_buf_mem_size)
+        return total_memory_size - native_buf_mem_size;
+    return 0;
+}
+
+class MaliMemtrackTest : public ::testing::TestWithParam<bool> {
+  protected:
+    void SetUp() override {
+        const char *tmp = getenv("TMPDIR");
+        std::string root = std::string(tmp ? tmp : "/data/local/tmp") + "/mali_test_XXXXXX";
+        ASSERT_NE(nullptr, mkdtemp(root.data()));
+        mRoot = root;
+        mDir = mRoot + "/mem/";
+        mStaging = mRoot + "/staging/";
+        ASSERT_EQ(0, mkdir(mDir.c_str(), 0700));
+        ASSERT_EQ(0, mkdir(mStaging.c_str(), 0700));
+        mali_memtrack_set_debug_fs_path(mDir.c_str(), GetParam());
+    }
+
+    void TearDown() override {
+        mali_memtrack_set_debug_fs_path("/d/mali/mem/", true);
+        std::string cmd = "rm -rf " + mRoot;
+        system(cmd.c_str());
+    }
+
+    std::string profilePath(pid_t pid, int ctx) {
+        return mDir + std::to_string(pid) + "_" + std::to_string(ctx) + "/mem_profile";
+    }
+
+    /* the context appears with its whole profile, as it does in debugfs */
+    void addContext(pid_t pid, int ctx, const std::string &profile) {
+        const std::string name = std::to_string(pid) + "_" + std::to_string(ctx);
+        const std::string staged = mStaging + name;
+        ASSERT_EQ(0, mkdir(staged.c_str(), 0700));
+        std::ofstream(staged + "/mem_profile") << profile;
+        ASSERT_EQ(0, rename(staged.c_str(), (mDir + name).c_str()));
+    }
+
+    void removeContext(pid_t pid, int ctx) {
+        const std::string name = std::to_string(pid) + "_" + std::to_string(ctx);
+        const std::string staged = mStaging + name;
+        ASSERT_EQ(0, rename((mDir + name).c_str(), staged.c_str()));
+        ASSERT_EQ(0, unlink((staged + "/mem_profile").c_str()));
+        ASSERT_EQ(0, rmdir(staged.c_str()));
+    }
+
+    static long long getUnaccounted(pid_t pid) {
+        struct memtrack_record records[2];
+        size_t num_records = 2;
+        EXPECT_EQ(0, mali_memtrack_get_memory(pid, 0, records, &num_records));
+        EXPECT_EQ(2u, num_records);
+        EXPECT_EQ(0u, records[0].size_in_bytes);
+        return records[1].size_in_bytes;
+    }
+
+    std::string mRoot;
+    std::string mDir;
+    std::string mStaging;
+};
+
+TEST_P(MaliMemtrackTest, ParsesAsLegacy) {
+    const std::vector<std::string> profiles = {
+            kNativeProfile,
+            /* no Native Buffer, all the totals are summed */
+            "Channel: Default Heap (Total memory: 600)\n"
+            "Total allocated memory: 3000\n"
+            "Total allocated memory: 2000\n",
+            /* the totals before the Native Buffer are not counted */
+            "Total allocated memory: 9000\n"
+            "Channel: Native Buffer (Total memory: 500)\n"
+            "Total allocated memory: 700\n",
+            /* only the first Native Buffer is counted */
+            "Channel: Native Buffer (Total memory: 100)\n"
+            "Channel: Native Buffer (Total memory: 200)\n"
+            "Total allocated memory: 5000\n",
+            /* less in total than in the native buffers */
+            "Channel: Native Buffer (Total memory: 8000)\n"
+            "Total allocated memory: 10\n",
+            /* no trailing newline, malformed lines */
+            "garbage\n\nTotal allocated\nTotal allocated memory: 42",
+            "",
+    };
+
+    for (size_t i = 0; i < profiles.size(); i++) {
+        const pid_t pid = kPid + i;
+        addContext(pid, 1, profiles[i]);
+        EXPECT_EQ(legacy_get_unaccounted({profilePath(pid, 1)}), getUnaccounted(pid))
+                << "profile " << i;
+    }
+
+    /* the contexts of a process are summed */
+    addContext(kPid, 2, profiles[1]);
+    addContext(kPid, 3, profiles[2]);
+    EXPECT_EQ(legacy_get_unaccounted(
+                      {profilePath(kPid, 1), profilePath(kPid, 2), profilePath(kPid, 3)}),
+              getUnaccounted(kPid));
+}
+
+TEST_P(MaliMemtrackTest, FollowsContextChanges) {
+    /* 3000 + 4000 - 1000 per context */
+    const long long perContext = 6000;
+
+    EXPECT_EQ(0, getUnaccounted(kPid));
+
+    addContext(kPid, 1, kNativeProfile);
+    EXPECT_EQ(perContext, getUnaccounted(kPid));
+
+    addContext(kPid, 2, kNativeProfile);
+    EXPECT_EQ(2 * perContext, getUnaccounted(kPid));
+
+    /* another process, whose pid has the same prefix */
+    addContext(kPid * 10, 1, kNativeProfile);
+    EXPECT_EQ(2 * perContext, getUnaccounted(kPid));
+    EXPECT_EQ(perContext, getUnaccounted(kPid * 10));
+
+    removeContext(kPid, 1);
+    EXPECT_EQ(perContext, getUnaccounted(kPid));
+
+    removeContext(kPid, 2);
+    EXPECT_EQ(0, getUnaccounted(kPid));
+}
+
+TEST_P(MaliMemtrackTest, ConcurrentQueries) {
+    constexpr int kNumContexts = 4;
+    constexpr int kNumQueriers = 4;
+    const long long perContext = 6000;
+    std::atomic<bool> done = false;
+    std::atomic<int> numBad = 0;
+
+    std::vector<std::thread> queriers;
+    for (int i = 0; i < kNumQueriers; i++) {
+        queriers.emplace_back([&] {
+            while (!done) {
+                long long size = getUnaccounted(kPid);
+                /* a context removed after the scan is skipped, never half read */
+                if ((size % perContext != 0) || (size > kNumContexts * perContext))
+                    numBad++;
+            }
+        });
+    }
+
+    for (int round = 0; round < 50; round++) {
+        for (int ctx = 0; ctx < kNumContexts; ctx++) addContext(kPid, ctx, kNativeProfile);
+        for (int ctx = 0; ctx < kNumContexts; ctx++) removeContext(kPid, ctx);
+    }
+    done = true;
+    for (auto &querier : queriers) querier.join();
+
+    EXPECT_EQ(0, numBad);
+
+    addContext(kPid, 0, kNativeProfile);
+    /* a stale cache misses the new context at most once, after a removed profile */
+    long long size = getUnaccounted(kPid);
+    if (size != perContext)
+        size = getUnaccounted(kPid);
+    EXPECT_EQ(perContext, size);
+}
+
+INSTANTIATE_TEST_SUITE_P(WatchModes, MaliMemtrackTest, ::testing::Bool(),
+                         [](const ::testing::TestParamInfo<bool> &info) {
+                             return info.param ? "Inotify" : "Stat";
+                         });
+
+} // namespace
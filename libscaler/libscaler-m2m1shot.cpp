@@ -79,7 +79,7 @@ const static PixFormat g_pixfmt_table[] = {
 };
 
 
-CScalerM2M1SHOT::CScalerM2M1SHOT(int devid, int __UNUSED__ drm) : m_iFD(-1)
+CScalerM2M1SHOT::CScalerM2M1SHOT(int devid, int __UNUSED__ drm) : m_iFD(-1), m_iInstance(devid)
 {
     memset(&m_task, 0, sizeof(m_task));
 
@@ -89,13 +89,19 @@ CScalerM2M1SHOT::CScalerM2M1SHOT(int devid, int __UNUSED__ drm) : m_iFD(-1)
     }
 
     m_iFD = open(dev_base_name[devid], O_RDWR);
-    if (m_iFD < 0) {
+    if (m_iFD < 0)
         SC_LOGERR("Failed to open '%s'", dev_base_name[devid]);
-    } else {
-        // default 3 planes not to miss any buffer address
-        m_task.buf_out.num_planes = 3;
-        m_task.buf_cap.num_planes = 3;
-    }
+    else
+        ResetTask();
+}
+
+void CScalerM2M1SHOT::ResetTask()
+{
+    memset(&m_task, 0, sizeof(m_task));
+
+    // default 3 planes not to miss any buffer address
+    m_task.buf_out.num_planes = 3;
+    m_task.buf_cap.num_planes = 3;
 }
 
 CScalerM2M1SHOT::~CScalerM2M1SHOT()
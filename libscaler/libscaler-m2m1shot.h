@@ -32,8 +32,11 @@
 
 class CScalerM2M1SHOT {
     int m_iFD;
+    int m_iInstance;
     m2m1shot m_task;
 
+    void ResetTask();
+
     bool SetFormat(m2m1shot_pix_format &fmt, m2m1shot_buffer &buf,
                    unsigned int width, unsigned int height, unsigned int v4l2_fmt);
     bool SetCrop(m2m1shot_pix_format &fmt,
@@ -48,6 +51,10 @@ public:
     bool Run();
 
     inline bool Valid() { return m_iFD >= 0; }
+    inline int GetScalerID() { return m_iInstance; }
+
+    // M2M1SHOT keeps no state in the device. Just forget the last task.
+    inline bool Recycle() { ResetTask(); return true; }
 
     inline bool SetSrcFormat(unsigned int width, unsigned int height, unsigned int v4l2_fmt) {
         return SetFormat(m_task.fmt_out, m_task.buf_out, width, height, v4l2_fmt);
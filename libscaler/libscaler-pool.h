@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ * Copyright@ Samsung Electronics Co. LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file      libscaler-pool.h
+ * \brief     process-wide pool of opened Scaler handles
+ */
+#ifndef _LIBSCALER_POOL_H_
+#define _LIBSCALER_POOL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "libscaler-common.h"
+
+/*
+ * CScalerPool keeps the Scaler handles released by the blocking mode clients
+ * opened so that the next client of the same device does not need to open the
+ * device node and to configure the same format again. The handles idle longer
+ * than the idle timeout are closed by a thread of the pool, which is started
+ * by the first release. The idle time is measured by a Clock which the tests
+ * replace by a simulated one.
+ *
+ * T should provide Valid(), GetScalerID() and Recycle().
+ */
+template <typename T>
+class CScalerPool {
+public:
+    enum { SC_POOL_MAX_IDLE_HANDLES = 4 };
+    enum { SC_POOL_IDLE_TIMEOUT_MS = 3000 };
+
+    class Clock {
+    public:
+        typedef std::chrono::steady_clock::time_point time_point;
+
+        virtual ~Clock() { }
+        virtual time_point now() { return std::chrono::steady_clock::now(); }
+        // Waits on @cond until it is notified or until @time if it is not max()
+        virtual void waitUntil(std::condition_variable &cond,
+                               std::unique_lock<std::mutex> &lock, time_point time) {
+            if (time == time_point::max())
+                cond.wait(lock);
+            else
+                cond.wait_until(lock, time);
+        }
+    };
+
+    explicit CScalerPool(std::chrono::milliseconds idleTimeout =
+                                 std::chrono::milliseconds(SC_POOL_IDLE_TIMEOUT_MS),
+                         std::unique_ptr<Clock> clock = std::make_unique<Clock>())
+        : m_idleTimeout(idleTimeout), m_clock(std::move(clock)) { }
+
+    ~CScalerPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_exit = true;
+        }
+        m_cond.notify_all();
+        if (m_reaper.joinable())
+            m_reaper.join();
+
+        Trim(true);
+    }
+
+    T *Acquire(int devid) {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            for (auto it = m_idle.begin(); it != m_idle.end(); ++it) {
+                if (it->devid == devid) {
+                    T *sc = it->handle;
+                    m_idle.erase(it);
+                    return sc;
+                }
+            }
+        }
+
+        T *sc = new T(devid);
+        if (!sc->Valid()) {
+            delete sc;
+            return NULL;
+        }
+
+        return sc;
+    }
+
+    bool Release(T *sc) {
+        if (!sc->Recycle()) {
+            SC_LOGE("Failed to recycle Scaler%d handle", sc->GetScalerID());
+            delete sc;
+            return false;
+        }
+
+        T *victim = NULL;
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            if (m_idle.size() >= SC_POOL_MAX_IDLE_HANDLES) {
+                victim = m_idle.front().handle;
+                m_idle.erase(m_idle.begin());
+            }
+
+            m_idle.push_back({sc->GetScalerID(), sc, m_clock->now()});
+
+            if (!m_reaper.joinable())
+                m_reaper = std::thread(&CScalerPool::Reap, this);
+        }
+
+        // wakes up the reaper if it waits for an idle handle
+        m_cond.notify_one();
+
+        delete victim;
+
+        return true;
+    }
+
+    // Closes the handles idle longer than the timeout or all the handles if @all is set
+    void Trim(bool all) {
+        std::vector<T *> victims;
+        typename Clock::time_point expiry = m_clock->now() - m_idleTimeout;
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            // m_idle is ordered by the release time
+            while (!m_idle.empty() && (all || (m_idle.front().released <= expiry))) {
+                victims.push_back(m_idle.front().handle);
+                m_idle.erase(m_idle.begin());
+            }
+        }
+
+        // closing the device node is done without the lock
+        for (T *sc : victims)
+            delete sc;
+    }
+
+private:
+    struct IdleHandle {
+        int devid;
+        T *handle;
+        typename Clock::time_point released;
+    };
+
+    // Closes the idle handles as they expire until the pool is destroyed
+    void Reap() {
+        std::unique_lock<std::mutex> lock(m_lock);
+
+        while (!m_exit) {
+            if (m_idle.empty()) {
+                m_clock->waitUntil(m_cond, lock, Clock::time_point::max());
+                continue;
+            }
+
+            typename Clock::time_point expiry = m_idle.front().released + m_idleTimeout;
+            if (m_clock->now() < expiry) {
+                m_clock->waitUntil(m_cond, lock, expiry);
+                continue;
+            }
+
+            lock.unlock();
+            Trim(false);
+            lock.lock();
+        }
+    }
+
+    const std::chrono::steady_clock::duration m_idleTimeout;
+    const std::unique_ptr<Clock> m_clock;
+
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    std::vector<IdleHandle> m_idle;
+    bool m_exit = false;
+    std::thread m_reaper;
+};
+
+#endif //_LIBSCALER_POOL_H_
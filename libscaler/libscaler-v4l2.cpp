@@ -63,6 +63,7 @@ CScalerV4L2::CScalerV4L2(int instance, int allow_drm)
     m_nRotDegree = 0;
     m_fStatus = 0;
     m_filter = 0;
+    m_colorspace = V4L2_COLORSPACE_DEFAULT;
 
     memset(&m_frmSrc, 0, sizeof(m_frmSrc));
     memset(&m_frmDst, 0, sizeof(m_frmDst));
@@ -77,6 +78,7 @@ CScalerV4L2::CScalerV4L2(int instance, int allow_drm)
     m_frmDst.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
 
     m_frameRate = 0;
+    m_frameRateSet = false;
 
     Initialize(instance);
 
@@ -111,6 +113,50 @@ bool CScalerV4L2::Stop()
     return true;
 }
 
+bool CScalerV4L2::StopForCtrl()
+{
+    // The controls are not changeable while the buffers are requested.
+    // Nothing to stop if the buffers are already released.
+    if (!TestFlag(m_frmSrc.flags, SCFF_REQBUFS) && !TestFlag(m_frmDst.flags, SCFF_REQBUFS) &&
+            !TestFlag(m_frmSrc.flags, SCFF_STREAMING) && !TestFlag(m_frmDst.flags, SCFF_STREAMING))
+        return true;
+
+    return Stop();
+}
+
+bool CScalerV4L2::Recycle()
+{
+    if (!Stop())
+        return false;
+
+    // The acquire fences are owned by the client
+    m_frmSrc.fdAcquireFence = -1;
+    m_frmDst.fdAcquireFence = -1;
+
+    // The device keeps the controls of the previous client. Requesting the
+    // defaults marks fresh only the controls different from the defaults so
+    // that they are restored on the next Run().
+    SetRotate(0, 0, 0);
+    SetDRM(false);
+    SetFilter(0);
+    // Not configured yet. The next SetFrameRate() is applied in any case
+    if (m_frameRateSet)
+        SetFrameRate(0);
+    if (TestFlag(m_fStatus, SCF_CSC_APPLIED)) {
+        SetCSCWide(false);
+        SetCSCEq(V4L2_COLORSPACE_DEFAULT);
+    } else {
+        // Never configured. The device still has the defaults.
+        ClearFlag(m_fStatus, SCF_CSC_WIDE);
+        ClearFlag(m_fStatus, SCF_CSC_FRESH);
+        m_colorspace = V4L2_COLORSPACE_DEFAULT;
+    }
+    SetSrcPremultiplied(false);
+    SetDstPremultiplied(false);
+
+    return true;
+}
+
 bool CScalerV4L2::Run()
 {
     if (LibScaler::UnderOne16thScaling(
@@ -144,7 +190,7 @@ bool CScalerV4L2::SetCtrl()
     struct v4l2_control ctrl;
 
     if (TestFlag(m_fStatus, SCF_DRM_FRESH)) {
-        if (!Stop())
+        if (!StopForCtrl())
             return false;
 
         ctrl.id = V4L2_CID_CONTENT_PROTECTION;
@@ -160,7 +206,7 @@ bool CScalerV4L2::SetCtrl()
     }
 
     if (TestFlag(m_fStatus, SCF_ROTATION_FRESH)) {
-        if (!Stop())
+        if (!StopForCtrl())
             return false;
 
         ctrl.id = V4L2_CID_ROTATE;
@@ -191,8 +237,8 @@ bool CScalerV4L2::SetCtrl()
         SC_LOGD("Skipping rotation and flip setting due to no change");
     }
 
-    if (m_filter > 0) {
-        if (!Stop())
+    if (TestFlag(m_fStatus, SCF_FILTER_FRESH)) {
+        if (!StopForCtrl())
             return false;
 
         ctrl.id = LIBSC_V4L2_CID_DNOISE_FT;
@@ -201,10 +247,11 @@ bool CScalerV4L2::SetCtrl()
             SC_LOGERR("Failed LIBSC_V4L2_CID_DNOISE_FT to %d", m_filter);
             return false;
         }
+        ClearFlag(m_fStatus, SCF_FILTER_FRESH);
     }
 
     if (TestFlag(m_fStatus, SCF_CSC_FRESH)) {
-        if (!Stop())
+        if (!StopForCtrl())
             return false;
 
         ctrl.id = V4L2_CID_CSC_RANGE;
@@ -220,11 +267,12 @@ bool CScalerV4L2::SetCtrl()
             SC_LOGERR("Failed V4L2_CID_CSC_EQ to %d", m_colorspace);
         }
         ClearFlag(m_fStatus, SCF_CSC_FRESH);
+        SetFlag(m_fStatus, SCF_CSC_APPLIED);
     }
 
     /* This is optional, so we don't return failure. */
     if (TestFlag(m_fStatus, SCF_FRAMERATE)) {
-        if (!Stop())
+        if (!StopForCtrl())
             return false;
 
         ctrl.id = SC_CID_FRAMERATE;
@@ -438,19 +486,11 @@ bool CScalerV4L2::SetRotate(int rot, int flip_h, int flip_v)
         return false;
     }
 
+    // V4L2_CID_ROTATE, V4L2_CID_VFLIP and V4L2_CID_HFLIP are configured
+    // again only if any of them is changed
     SetRotDegree(rot);
-
-    if (flip_h)
-        SetFlag(m_fStatus, SCF_VFLIP);
-    else
-        ClearFlag(m_fStatus, SCF_VFLIP);
-
-    if (flip_v)
-        SetFlag(m_fStatus, SCF_HFLIP);
-    else
-        ClearFlag(m_fStatus, SCF_HFLIP);
-
-    SetFlag(m_fStatus, SCF_ROTATION_FRESH);
+    SetFlipFlag(SCF_VFLIP, flip_h != 0);
+    SetFlipFlag(SCF_HFLIP, flip_v != 0);
 
     return true;
 }
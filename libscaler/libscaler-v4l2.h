@@ -79,6 +79,8 @@ public:
         SCF_CSC_WIDE,
 	SCF_SRC_BLEND,
 	SCF_FRAMERATE,
+        SCF_FILTER_FRESH,
+        SCF_CSC_APPLIED,
     };
 
     struct FrameInfo {
@@ -101,6 +103,7 @@ private:
 
     unsigned int m_nRotDegree;
     unsigned int m_frameRate;
+    bool m_frameRateSet;
     char m_cszNode[SC_MAX_NODENAME]; // /dev/videoXX
     int m_iInstance;
 
@@ -117,18 +120,38 @@ private:
         if (rot < 0)
             rot = 360 + rot;
 
-        m_nRotDegree = rot;
+        if (m_nRotDegree != static_cast<unsigned int>(rot)) {
+            m_nRotDegree = rot;
+            SetFlag(m_fStatus, SCF_ROTATION_FRESH);
+        }
+    }
+
+    inline void SetFlipFlag(unsigned long flag, bool set) {
+        if (set == TestFlag(m_fStatus, flag))
+            return;
+
+        if (set)
+            SetFlag(m_fStatus, flag);
+        else
+            ClearFlag(m_fStatus, flag);
         SetFlag(m_fStatus, SCF_ROTATION_FRESH);
     }
 
+    bool StopForCtrl();
+
     bool DevSetFormat(FrameInfo &frm);
     bool ReqBufs(FrameInfo &frm);
     bool QBuf(FrameInfo &frm, int *pfdReleaseFence);
     bool StreamOn(FrameInfo &frm);
     bool DQBuf(FrameInfo &frm);
 
+    // S_FMT and S_CROP are issued again only if the frame is changed
     inline bool SetFormat(FrameInfo &frm, unsigned int width, unsigned int height,
                    unsigned int v4l2_colorformat) {
+        if ((frm.color_format == v4l2_colorformat) &&
+                (frm.width == width) && (frm.height == height))
+            return true;
+
         frm.color_format = v4l2_colorformat;
         frm.width = width;
         frm.height = height;
@@ -138,6 +161,11 @@ private:
 
     inline bool SetCrop(FrameInfo &frm, unsigned int left, unsigned int top,
                  unsigned int width, unsigned int height) {
+        if ((frm.crop.left == static_cast<__s32>(left)) &&
+                (frm.crop.top == static_cast<__s32>(top)) &&
+                (frm.crop.width == width) && (frm.crop.height == height))
+            return true;
+
         frm.crop.left = left;
         frm.crop.top = top;
         frm.crop.width = width;
@@ -147,10 +175,14 @@ private:
     }
 
     inline void SetPremultiplied(FrameInfo &frm, unsigned int premultiplied) {
+        if ((premultiplied != 0) == TestFlag(frm.flags, SCFF_PREMULTIPLIED))
+            return;
+
         if (premultiplied)
             SetFlag(frm.flags, SCFF_PREMULTIPLIED);
         else
             ClearFlag(frm.flags, SCFF_PREMULTIPLIED);
+        SetFlag(frm.flags, SCFF_BUF_FRESH);
     }
 
     inline void SetCacheable(FrameInfo &frm, bool __UNUSED__ cacheable) {
@@ -159,6 +191,11 @@ private:
 
     inline void SetAddr(FrameInfo &frm, void *addr[SC_NUM_OF_PLANES], int mem_type, int fence)
     {
+        // buffers requested with the previous memory type should be released
+        if ((frm.memory != static_cast<v4l2_memory>(mem_type)) &&
+                TestFlag(frm.flags, SCFF_REQBUFS))
+            ResetDevice(frm);
+
         for (int i = 0; i < SC_MAX_PLANES; i++)
             frm.addr[i] = addr[i];
 
@@ -200,6 +237,10 @@ public:
     bool Stop();
     bool Run(); // Blocking mode
 
+    // Releases the buffers and restores the default parameters
+    // so that the handle is reused by another client
+    bool Recycle();
+
     // H/W Control
     virtual bool DevSetCtrl();
     bool DevSetFormat();
@@ -267,6 +308,10 @@ public:
     }
 
     inline void SetCSCWide(bool wide) {
+        if ((wide == TestFlag(m_fStatus, SCF_CSC_WIDE)) &&
+                TestFlag(m_fStatus, SCF_CSC_APPLIED))
+            return;
+
         if (wide)
             SetFlag(m_fStatus, SCF_CSC_WIDE);
         else
@@ -277,14 +322,20 @@ public:
 
     inline void SetCSCEq(unsigned int v4l2_colorspace) {
         if (v4l2_colorspace == V4L2_COLORSPACE_SMPTE170M)
-            m_colorspace = V4L2_COLORSPACE_DEFAULT;
-        else
-            m_colorspace = v4l2_colorspace;
+            v4l2_colorspace = V4L2_COLORSPACE_DEFAULT;
+
+        if ((m_colorspace == v4l2_colorspace) && TestFlag(m_fStatus, SCF_CSC_APPLIED))
+            return;
+
+        m_colorspace = v4l2_colorspace;
         SetFlag(m_fStatus, SCF_CSC_FRESH);
     }
 
     inline void SetFilter(unsigned int filter) {
-        m_filter = filter;
+        if (m_filter != filter) {
+            m_filter = filter;
+            SetFlag(m_fStatus, SCF_FILTER_FRESH);
+        }
     }
 
     inline void SetSrcCacheable(bool cacheable) {
@@ -317,8 +368,12 @@ public:
     }
 
     inline void SetFrameRate(int framerate) {
-        m_frameRate = framerate;
-        SetFlag(m_fStatus, SCF_FRAMERATE);
+        // The frame rate in the device is not known until it is configured once
+        if (!m_frameRateSet || (m_frameRate != static_cast<unsigned int>(framerate))) {
+            m_frameRate = framerate;
+            m_frameRateSet = true;
+            SetFlag(m_fStatus, SCF_FRAMERATE);
+        }
     }
 };
 
@@ -38,6 +38,7 @@
 
 #include "exynos_scaler.h"
 
+#include "libscaler-pool.h"
 #include "libscaler-common.h"
 #include "libscalerblend-v4l2.h"
 #include "libscaler-v4l2.h"
@@ -183,16 +184,13 @@ static bool find_pixel(unsigned int sc_pxfmt, unsigned int __out *v4l2_pxfmt)
     return false;
 }
 
-bool exynos_sc_copy_pixels(exynos_sc_pxinfo *pxinfo, int dev_num)
+static CScalerPool<CScalerM2M1SHOT> g_copyScalerPool;
+
+static bool CopyPixels(CScalerM2M1SHOT &sc, exynos_sc_pxinfo *pxinfo)
 {
     unsigned int srcfmt;
     unsigned int dstfmt;
 
-    CScalerM2M1SHOT sc(dev_num);
-
-    if (!sc.Valid())
-        return false;
-
     if (!find_pixel(pxinfo->src.pxfmt, &srcfmt))
         return false;
 
@@ -236,12 +234,27 @@ bool exynos_sc_copy_pixels(exynos_sc_pxinfo *pxinfo, int dev_num)
     return sc.Run();
 }
 
+bool exynos_sc_copy_pixels(exynos_sc_pxinfo *pxinfo, int dev_num)
+{
+    CScalerM2M1SHOT *sc = g_copyScalerPool.Acquire(dev_num);
+    if (!sc)
+        return false;
+
+    bool ret = CopyPixels(*sc, pxinfo);
+
+    g_copyScalerPool.Release(sc);
+
+    return ret;
+}
+
 #ifdef SCALER_USE_M2M1SHOT
 typedef CScalerM2M1SHOT CScalerNonStream;
 #else
 typedef CScalerV4L2 CScalerNonStream;
 #endif
 
+static CScalerPool<CScalerNonStream> g_scalerPool;
+
 static CScalerNonStream *GetNonStreamScaler(void *handle)
 {
     if (handle == NULL) {
@@ -260,16 +273,10 @@ static CScalerNonStream *GetNonStreamScaler(void *handle)
 
 void *exynos_sc_create(int dev_num)
 {
-    CScalerNonStream *sc = new CScalerNonStream(dev_num);
+    CScalerNonStream *sc = g_scalerPool.Acquire(dev_num);
 
     if (!sc) {
-        SC_LOGE("Failed to allocate a Scaler handle for instance %d", dev_num);
-        return NULL;
-    }
-
-    if (!sc->Valid()) {
         SC_LOGE("Failed to create a Scaler handle for instance %d", dev_num);
-        delete sc;
         return NULL;
     }
 
@@ -278,20 +285,17 @@ void *exynos_sc_create(int dev_num)
 
 int exynos_sc_destroy(void *handle)
 {
-    int ret = 0;
-
     CScalerNonStream *sc = GetNonStreamScaler(handle);
     if (!sc)
         return -1;
 
-    if (!sc->Stop()) {
+    // The handle is stopped and returned to the pool for the next client
+    if (!g_scalerPool.Release(sc)) {
         SC_LOGE("Failed to stop Scaler (handle %p)", handle);
-        ret = -1;
+        return -1;
     }
 
-    delete sc;
-
-    return ret;
+    return 0;
 }
 
 int exynos_sc_set_csc_property(
@@ -0,0 +1,601 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// open() is interposed below. It should not be a fortified inline function.
+#undef _FORTIFY_SOURCE
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "exynos_scaler.h"
+#include "libscaler-common.h"
+#include "libscaler-m2m1shot.h"
+#include "libscaler-pool.h"
+#include "libscaler-v4l2.h"
+#include "m2m1shot.h"
+
+/*
+ * The scaler device nodes are faked by interposing open(), close() and ioctl()
+ * of the test binary that libscaler is built into. A fake device is backed by
+ * /dev/null, accepts every request and counts them by the request code.
+ */
+class FakeScalerDevice {
+public:
+    // never destroyed. The pools of libscaler close the devices at exit.
+    static FakeScalerDevice &get() {
+        static FakeScalerDevice *dev = new FakeScalerDevice();
+        return *dev;
+    }
+
+    static bool isDevice(const char *path) {
+        return (strncmp(path, SC_DEV_NODE, strlen(SC_DEV_NODE)) == 0) ||
+                (strncmp(path, "/dev/m2m1shot_scaler", strlen("/dev/m2m1shot_scaler")) == 0);
+    }
+
+    int open() {
+        int fd = static_cast<int>(syscall(SYS_openat, AT_FDCWD, "/dev/null", O_RDWR | O_CLOEXEC));
+        if (fd >= 0) {
+            m_fds.insert(fd);
+            m_opens++;
+        }
+        return fd;
+    }
+
+    bool close(int fd) {
+        if (m_fds.erase(fd) == 0)
+            return false;
+        m_closes++;
+        m_ctrls.erase(fd);
+        return true;
+    }
+
+    bool ioctl(int fd, unsigned long request, void *arg, int *ret) {
+        if (m_fds.count(fd) == 0)
+            return false;
+
+        m_ioctls[request]++;
+
+        if (request == VIDIOC_S_FMT) {
+            v4l2_format *fmt = reinterpret_cast<v4l2_format *>(arg);
+            fmt->fmt.pix_mp.num_planes = 1;
+            fmt->fmt.pix_mp.plane_fmt[0].sizeimage = fmt->fmt.pix_mp.width *
+                    fmt->fmt.pix_mp.height * 4;
+        } else if (request == VIDIOC_S_CTRL) {
+            v4l2_control *ctrl = reinterpret_cast<v4l2_control *>(arg);
+            m_ctrls[fd][ctrl->id] = ctrl->value;
+        }
+
+        *ret = 0;
+        return true;
+    }
+
+    void resetCounts() {
+        m_opens = 0;
+        m_closes = 0;
+        m_ioctls.clear();
+    }
+
+    size_t opens() const { return m_opens; }
+    size_t closes() const { return m_closes; }
+    size_t ioctls(unsigned long request) const {
+        auto it = m_ioctls.find(request);
+        return (it == m_ioctls.end()) ? 0 : it->second;
+    }
+    size_t numOpened() const { return m_fds.size(); }
+
+    // the value of the control last configured to any opened device
+    bool getCtrl(unsigned int id, int *value) const {
+        for (auto &dev : m_ctrls) {
+            auto it = dev.second.find(id);
+            if (it != dev.second.end()) {
+                *value = it->second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::set<int> m_fds;
+    std::map<int, std::map<unsigned int, int>> m_ctrls;
+    std::map<unsigned long, size_t> m_ioctls;
+    size_t m_opens = 0;
+    size_t m_closes = 0;
+};
+
+extern "C" int open(const char *path, int flags, ...) {
+    mode_t mode = 0;
+
+    if (flags & O_CREAT) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = static_cast<mode_t>(va_arg(ap, int));
+        va_end(ap);
+    }
+
+    if (FakeScalerDevice::isDevice(path))
+        return FakeScalerDevice::get().open();
+
+    return static_cast<int>(syscall(SYS_openat, AT_FDCWD, path, flags, mode));
+}
+
+extern "C" int close(int fd) {
+    FakeScalerDevice::get().close(fd);
+    return static_cast<int>(syscall(SYS_close, fd));
+}
+
+extern "C" int ioctl(int fd, unsigned long request, ...) {
+    va_list ap;
+    va_start(ap, request);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+
+    int ret;
+    if (FakeScalerDevice::get().ioctl(fd, request, arg, &ret))
+        return ret;
+
+    return static_cast<int>(syscall(SYS_ioctl, fd, request, arg));
+}
+
+class ScalerTest : public ::testing::Test {
+protected:
+    static const unsigned int kSrcWidth = 640;
+    static const unsigned int kSrcHeight = 480;
+    static const unsigned int kDstWidth = 320;
+    static const unsigned int kDstHeight = 240;
+
+    FakeScalerDevice &m_dev = FakeScalerDevice::get();
+    char m_src[kSrcWidth * kSrcHeight * 4];
+    char m_dst[kDstWidth * kDstHeight * 4];
+
+    void SetUp() override {
+        m_dev.resetCounts();
+    }
+
+    void configure(void *handle, int rot = 0) {
+        ASSERT_EQ(0, exynos_sc_set_src_format(handle, kSrcWidth, kSrcHeight, 0, 0,
+                        kSrcWidth, kSrcHeight, V4L2_PIX_FMT_RGB32, 0, 0, 0));
+        ASSERT_EQ(0, exynos_sc_set_dst_format(handle, kDstWidth, kDstHeight, 0, 0,
+                        kDstWidth, kDstHeight, V4L2_PIX_FMT_RGB32, 0, 0, 0));
+        ASSERT_EQ(0, exynos_sc_set_rotation(handle, rot, 0, 0));
+
+        void *addr[SC_NUM_OF_PLANES] = {m_src, NULL, NULL};
+        ASSERT_EQ(0, exynos_sc_set_src_addr(handle, addr, V4L2_MEMORY_USERPTR, -1));
+        addr[0] = m_dst;
+        ASSERT_EQ(0, exynos_sc_set_dst_addr(handle, addr, V4L2_MEMORY_USERPTR, -1));
+    }
+
+    void fillPxInfo(exynos_sc_pxinfo *pxinfo, unsigned int width, unsigned int height) {
+        memset(pxinfo, 0, sizeof(*pxinfo));
+        pxinfo->src = {m_src, width, height, 0, 0, width, height, EXYNOS_SC_FMT_RGB32};
+        pxinfo->dst = {m_dst, width, height, 0, 0, width, height, EXYNOS_SC_FMT_RGB32};
+    }
+};
+
+TEST_F(ScalerTest, CopyPixelsReusesHandle)
+{
+    exynos_sc_pxinfo pxinfo;
+    fillPxInfo(&pxinfo, 16, 16);
+
+    for (int i = 0; i < 10; i++)
+        ASSERT_TRUE(exynos_sc_copy_pixels(&pxinfo, 0));
+
+    // opened once unless a handle was left in the pool by the previous tests
+    EXPECT_LE(m_dev.opens(), 1u);
+    EXPECT_EQ(0u, m_dev.closes());
+    EXPECT_EQ(10u, m_dev.ioctls(M2M1SHOT_IOC_PROCESS));
+}
+
+TEST_F(ScalerTest, UnchangedSettingsAreSkipped)
+{
+    void *handle = exynos_sc_create(0);
+    ASSERT_NE(nullptr, handle);
+
+    configure(handle);
+    ASSERT_EQ(0, exynos_sc_convert(handle));
+    EXPECT_EQ(2u, m_dev.ioctls(VIDIOC_S_FMT));
+    EXPECT_EQ(2u, m_dev.ioctls(VIDIOC_S_CROP));
+    EXPECT_EQ(2u, m_dev.ioctls(VIDIOC_STREAMON));
+
+    // the same configuration only queues and dequeues the buffers
+    m_dev.resetCounts();
+    configure(handle);
+    ASSERT_EQ(0, exynos_sc_convert(handle));
+    EXPECT_EQ(0u, m_dev.ioctls(VIDIOC_S_FMT));
+    EXPECT_EQ(0u, m_dev.ioctls(VIDIOC_S_CROP));
+    EXPECT_EQ(0u, m_dev.ioctls(VIDIOC_S_CTRL));
+    EXPECT_EQ(0u, m_dev.ioctls(VIDIOC_REQBUFS));
+    EXPECT_EQ(0u, m_dev.ioctls(VIDIOC_STREAMON));
+    EXPECT_EQ(2u, m_dev.ioctls(VIDIOC_QBUF));
+    EXPECT_EQ(2u, m_dev.ioctls(VIDIOC_DQBUF));
+
+    ASSERT_EQ(0, exynos_sc_destroy(handle));
+}
+
+TEST_F(ScalerTest, DestroyedHandleIsReused)
+{
+    void *handle = exynos_sc_create(0);
+    ASSERT_NE(nullptr, handle);
+    configure(handle);
+    ASSERT_EQ(0, exynos_sc_convert(handle));
+    ASSERT_EQ(0, exynos_sc_destroy(handle));
+
+    m_dev.resetCounts();
+
+    void *reused = exynos_sc_create(0);
+    EXPECT_EQ(handle, reused);
+    EXPECT_EQ(0u, m_dev.opens());
+
+    // the buffers are requested again but the format is kept in the device
+    configure(reused);
+    ASSERT_EQ(0, exynos_sc_convert(reused));
+    EXPECT_EQ(0u, m_dev.ioctls(VIDIOC_S_FMT));
+    EXPECT_EQ(0u, m_dev.ioctls(VIDIOC_S_CTRL));
+    EXPECT_EQ(2u, m_dev.ioctls(VIDIOC_REQBUFS));
+    EXPECT_EQ(2u, m_dev.ioctls(VIDIOC_STREAMON));
+
+    ASSERT_EQ(0, exynos_sc_destroy(reused));
+    EXPECT_EQ(0u, m_dev.closes());
+}
+
+TEST_F(ScalerTest, ChangedRotationIsConfigured)
+{
+    void *handle = exynos_sc_create(0);
+    ASSERT_NE(nullptr, handle);
+    configure(handle);
+    ASSERT_EQ(0, exynos_sc_convert(handle));
+
+    m_dev.resetCounts();
+    configure(handle, 90);
+    ASSERT_EQ(0, exynos_sc_convert(handle));
+
+    // the device is stopped to change the controls
+    EXPECT_EQ(2u, m_dev.ioctls(VIDIOC_STREAMOFF));
+    int rot = -1;
+    ASSERT_TRUE(m_dev.getCtrl(V4L2_CID_ROTATE, &rot));
+    EXPECT_EQ(90, rot);
+
+    ASSERT_EQ(0, exynos_sc_destroy(handle));
+}
+
+TEST_F(ScalerTest, RecycledHandleHasDefaults)
+{
+    void *handle = exynos_sc_create(0);
+    ASSERT_NE(nullptr, handle);
+    configure(handle, 90);
+    ASSERT_EQ(0, exynos_sc_set_csc_property(handle, 1, V4L2_COLORSPACE_REC709, 1));
+    ASSERT_EQ(0, exynos_sc_convert(handle));
+    ASSERT_EQ(0, exynos_sc_destroy(handle));
+
+    // the next client does not configure the rotation and the CSC
+    void *reused = exynos_sc_create(0);
+    ASSERT_EQ(handle, reused);
+    ASSERT_EQ(0, exynos_sc_set_src_format(reused, kSrcWidth, kSrcHeight, 0, 0,
+                    kSrcWidth, kSrcHeight, V4L2_PIX_FMT_RGB32, 0, 0, 0));
+    ASSERT_EQ(0, exynos_sc_set_dst_format(reused, kDstWidth, kDstHeight, 0, 0,
+                    kDstWidth, kDstHeight, V4L2_PIX_FMT_RGB32, 0, 0, 0));
+    ASSERT_EQ(0, exynos_sc_convert(reused));
+
+    int value = -1;
+    ASSERT_TRUE(m_dev.getCtrl(V4L2_CID_ROTATE, &value));
+    EXPECT_EQ(0, value);
+    ASSERT_TRUE(m_dev.getCtrl(LIBSC_V4L2_CID_DNOISE_FT, &value));
+    EXPECT_EQ(0, value);
+    ASSERT_TRUE(m_dev.getCtrl(V4L2_CID_CSC_RANGE, &value));
+    EXPECT_EQ(0, value);
+    ASSERT_TRUE(m_dev.getCtrl(V4L2_CID_CSC_EQ, &value));
+    EXPECT_EQ(V4L2_COLORSPACE_DEFAULT, value);
+
+    ASSERT_EQ(0, exynos_sc_destroy(reused));
+}
+
+TEST_F(ScalerTest, FrameRateOfFreshHandleIsConfigured)
+{
+    CScalerV4L2 sc(0);
+    ASSERT_TRUE(sc.Valid());
+    void *src[SC_NUM_OF_PLANES] = {m_src, NULL, NULL};
+    void *dst[SC_NUM_OF_PLANES] = {m_dst, NULL, NULL};
+    auto run = [&] {
+        return sc.SetSrcFormat(kSrcWidth, kSrcHeight, V4L2_PIX_FMT_RGB32) &&
+                sc.SetDstFormat(kDstWidth, kDstHeight, V4L2_PIX_FMT_RGB32) &&
+                sc.SetSrcCrop(0, 0, kSrcWidth, kSrcHeight) &&
+                sc.SetDstCrop(0, 0, kDstWidth, kDstHeight) &&
+                sc.SetSrcAddr(src, V4L2_MEMORY_USERPTR) &&
+                sc.SetDstAddr(dst, V4L2_MEMORY_USERPTR) && sc.Run();
+    };
+
+    // the device might have another frame rate than the default of the handle
+    sc.SetFrameRate(0);
+    ASSERT_TRUE(run());
+    int value = -1;
+    ASSERT_TRUE(m_dev.getCtrl(SC_CID_FRAMERATE, &value));
+    EXPECT_EQ(0, value);
+
+    m_dev.resetCounts();
+    sc.SetFrameRate(0);
+    ASSERT_TRUE(run());
+    EXPECT_EQ(0u, m_dev.ioctls(VIDIOC_S_CTRL));
+
+    sc.SetFrameRate(60);
+    ASSERT_TRUE(run());
+    ASSERT_TRUE(m_dev.getCtrl(SC_CID_FRAMERATE, &value));
+    EXPECT_EQ(60, value);
+
+    // the next client of a recycled handle gets the default
+    ASSERT_TRUE(sc.Recycle());
+    m_dev.resetCounts();
+    ASSERT_TRUE(run());
+    ASSERT_TRUE(m_dev.getCtrl(SC_CID_FRAMERATE, &value));
+    EXPECT_EQ(0, value);
+}
+
+TEST_F(ScalerTest, CopyLatency)
+{
+    static const int iterations = 1000;
+    exynos_sc_pxinfo pxinfo;
+    fillPxInfo(&pxinfo, 16, 16);
+
+    auto measure = [&](const std::function<bool()> &copy) {
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            EXPECT_TRUE(copy());
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() /
+                iterations;
+    };
+
+    // a handle opened and closed by every copy as exynos_sc_copy_pixels() did
+    long direct = measure([&] {
+        CScalerM2M1SHOT sc(0);
+        void *src[SC_NUM_OF_PLANES] = {m_src, NULL, NULL};
+        void *dst[SC_NUM_OF_PLANES] = {m_dst, NULL, NULL};
+        return sc.Valid() && sc.SetSrcFormat(16, 16, V4L2_PIX_FMT_RGB32) &&
+                sc.SetDstFormat(16, 16, V4L2_PIX_FMT_RGB32) &&
+                sc.SetSrcCrop(0, 0, 16, 16) && sc.SetDstCrop(0, 0, 16, 16) &&
+                sc.SetRotate(0, 0, 0) && sc.SetSrcAddr(src, V4L2_MEMORY_USERPTR) &&
+                sc.SetDstAddr(dst, V4L2_MEMORY_USERPTR) && sc.Run();
+    });
+    size_t directOpens = m_dev.opens();
+
+    m_dev.resetCounts();
+    long pooled = measure([&] { return exynos_sc_copy_pixels(&pxinfo, 0); });
+
+    EXPECT_EQ(static_cast<size_t>(iterations), directOpens);
+    EXPECT_LE(m_dev.opens(), 1u);
+
+    RecordProperty("direct_ns", direct);
+    RecordProperty("pooled_ns", pooled);
+    std::cout << iterations << " copies of 16x16: " << direct << " ns without pool, "
+              << pooled << " ns with pool" << std::endl;
+}
+
+/*
+ * CScalerPool is tested with a handle that only counts the instances
+ */
+class FakeHandle {
+public:
+    // closed by the reaper thread of the pool too
+    static std::atomic<int> s_instances;
+    static bool s_failRecycle;
+
+    explicit FakeHandle(int devid) : m_devid(devid) { s_instances++; }
+    ~FakeHandle() { s_instances--; }
+
+    bool Valid() { return m_devid >= 0; }
+    int GetScalerID() { return m_devid; }
+    bool Recycle() { return !s_failRecycle; }
+
+private:
+    int m_devid;
+};
+
+std::atomic<int> FakeHandle::s_instances{0};
+bool FakeHandle::s_failRecycle = false;
+
+TEST(ScalerPoolTest, ReuseByDevice)
+{
+    CScalerPool<FakeHandle> pool;
+
+    FakeHandle *sc0 = pool.Acquire(0);
+    ASSERT_NE(nullptr, sc0);
+    ASSERT_TRUE(pool.Release(sc0));
+
+    FakeHandle *sc1 = pool.Acquire(1);
+    ASSERT_NE(nullptr, sc1);
+    EXPECT_NE(sc0, sc1);
+    EXPECT_EQ(sc0, pool.Acquire(0));
+    EXPECT_EQ(2, FakeHandle::s_instances);
+
+    EXPECT_EQ(nullptr, pool.Acquire(-1));
+    EXPECT_EQ(2, FakeHandle::s_instances);
+
+    pool.Release(sc0);
+    pool.Release(sc1);
+    pool.Trim(true);
+    EXPECT_EQ(0, FakeHandle::s_instances);
+}
+
+TEST(ScalerPoolTest, IdleHandlesAreLimited)
+{
+    CScalerPool<FakeHandle> pool;
+    std::vector<FakeHandle *> handles;
+
+    for (int i = 0; i < CScalerPool<FakeHandle>::SC_POOL_MAX_IDLE_HANDLES + 2; i++)
+        handles.push_back(pool.Acquire(0));
+    for (FakeHandle *sc : handles)
+        pool.Release(sc);
+
+    EXPECT_EQ(CScalerPool<FakeHandle>::SC_POOL_MAX_IDLE_HANDLES, FakeHandle::s_instances);
+
+    pool.Trim(true);
+    EXPECT_EQ(0, FakeHandle::s_instances);
+}
+
+TEST(ScalerPoolTest, UnrecyclableHandleIsClosed)
+{
+    CScalerPool<FakeHandle> pool;
+
+    FakeHandle *sc = pool.Acquire(0);
+    FakeHandle::s_failRecycle = true;
+    EXPECT_FALSE(pool.Release(sc));
+    FakeHandle::s_failRecycle = false;
+
+    EXPECT_EQ(0, FakeHandle::s_instances);
+}
+
+/*
+ * The clock of the idle timer of the pool. The reaper thread of the pool waits
+ * until the clock is advanced instead of the real time.
+ */
+class FakePoolClock : public CScalerPool<FakeHandle>::Clock {
+public:
+    time_point now() override { return m_now; }
+
+    void waitUntil(std::condition_variable &cond, std::unique_lock<std::mutex> &lock,
+                   time_point time) override {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_cond = &cond;
+            m_poolLock = lock.mutex();
+            m_waitingAt = m_generation;
+        }
+        m_parked.notify_all();
+
+        // m_now changes with the lock of the pool held, so no advance is missed
+        if (time > m_now.load())
+            cond.wait(lock);
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_waitingAt = -1;
+    }
+
+    // Advances the time and returns after the reaper thread has handled it
+    void advance(std::chrono::milliseconds duration) {
+        ASSERT_TRUE(waitForReaper());
+
+        {
+            std::lock_guard<std::mutex> pool(*m_poolLock);
+            m_now = m_now.load() + duration;
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_generation++;
+        }
+        m_cond.load()->notify_all();
+
+        ASSERT_TRUE(waitForReaper());
+    }
+
+private:
+    // Waits for the reaper to wait on the current time
+    bool waitForReaper() {
+        std::unique_lock<std::mutex> guard(m_mutex);
+        return m_parked.wait_for(guard, std::chrono::seconds(5),
+                                 [this] { return m_waitingAt == m_generation; });
+    }
+
+    std::atomic<time_point> m_now{time_point(std::chrono::seconds(1000))};
+
+    std::mutex m_mutex;
+    std::condition_variable m_parked;
+    // of the pool, set by the reaper thread
+    std::atomic<std::condition_variable *> m_cond{nullptr};
+    std::atomic<std::mutex *> m_poolLock{nullptr};
+    int64_t m_generation = 0;
+    // the generation of the time the reaper waits on, -1 if it does not wait
+    int64_t m_waitingAt = -1;
+};
+
+class ScalerPoolClockTest : public testing::Test {
+protected:
+    void SetUp() override {
+        std::unique_ptr<FakePoolClock> clock = std::make_unique<FakePoolClock>();
+        m_clock = clock.get();
+        m_pool = std::make_unique<CScalerPool<FakeHandle>>(std::chrono::milliseconds(300),
+                                                             std::move(clock));
+    }
+
+    void TearDown() override {
+        m_pool.reset();
+        EXPECT_EQ(0, FakeHandle::s_instances);
+    }
+
+    FakePoolClock *m_clock = nullptr;
+    std::unique_ptr<CScalerPool<FakeHandle>> m_pool;
+};
+
+TEST_F(ScalerPoolClockTest, IdleHandlesExpire)
+{
+    m_pool->Release(m_pool->Acquire(0));
+    EXPECT_EQ(1, FakeHandle::s_instances);
+
+    m_clock->advance(std::chrono::milliseconds(299));
+    EXPECT_EQ(1, FakeHandle::s_instances);
+
+    // closed without another access to the pool
+    m_clock->advance(std::chrono::milliseconds(1));
+    EXPECT_EQ(0, FakeHandle::s_instances);
+}
+
+TEST_F(ScalerPoolClockTest, IdleHandlesExpireInReleaseOrder)
+{
+    m_pool->Release(m_pool->Acquire(0));
+    m_clock->advance(std::chrono::milliseconds(150));
+    m_pool->Release(m_pool->Acquire(1));
+    EXPECT_EQ(2, FakeHandle::s_instances);
+
+    // the handle of device 0 expires at 300ms, the other one at 450ms
+    m_clock->advance(std::chrono::milliseconds(149));
+    EXPECT_EQ(2, FakeHandle::s_instances);
+    m_clock->advance(std::chrono::milliseconds(1));
+    EXPECT_EQ(1, FakeHandle::s_instances);
+
+    m_clock->advance(std::chrono::milliseconds(149));
+    EXPECT_EQ(1, FakeHandle::s_instances);
+    m_clock->advance(std::chrono::milliseconds(1));
+    EXPECT_EQ(0, FakeHandle::s_instances);
+}
+
+TEST_F(ScalerPoolClockTest, ReusedHandleDoesNotExpire)
+{
+    m_pool->Release(m_pool->Acquire(0));
+    m_clock->advance(std::chrono::milliseconds(200));
+
+    // acquired and released again restarts the idle time of the handle
+    FakeHandle *sc = m_pool->Acquire(0);
+    m_clock->advance(std::chrono::milliseconds(200));
+    m_pool->Release(sc);
+    m_clock->advance(std::chrono::milliseconds(299));
+    EXPECT_EQ(1, FakeHandle::s_instances);
+
+    m_clock->advance(std::chrono::milliseconds(1));
+    EXPECT_EQ(0, FakeHandle::s_instances);
+}